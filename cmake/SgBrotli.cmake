@@ -0,0 +1,108 @@
+#.rst:
+# SgBrotli
+# --------
+#
+# Build Brotli.
+#
+# Build the Brotli encoder from Sagui building.
+#
+# ::
+#
+# BROTLI_INCLUDE_DIR - Directory of includes.
+# BROTLI_ARCHIVE_LIBS - AR archive libraries (encoder and common).
+# BROTLI_DEC_ARCHIVE_LIB - AR archive library of the decoder (tests only).
+
+#                         _
+#   ___  __ _  __ _ _   _(_)
+#  / __|/ _` |/ _` | | | | |
+#  \__ \ (_| | (_| | |_| | |
+#  |___/\__,_|\__, |\__,_|_|
+#             |___/
+#
+# Cross-platform library which helps to develop web servers or frameworks.
+#
+# Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+#
+# Sagui library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# Sagui library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with Sagui library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+#
+
+
+if(__SG_BROTLI_INCLUDED)
+  return()
+endif()
+set(__SG_BROTLI_INCLUDED ON)
+
+if(CMAKE_VERSION VERSION_GREATER "3.23")
+  cmake_policy(SET CMP0135 NEW)
+endif()
+
+set(BROTLI_NAME "brotli")
+set(BROTLI_VER "1.1.0")
+set(BROTLI_FULL_NAME "${BROTLI_NAME}-${BROTLI_VER}")
+set(BROTLI_URL
+    "https://github.com/google/brotli/archive/refs/tags/v${BROTLI_VER}.tar.gz")
+set(BROTLI_SHA256
+    "e720a6ca29428b803f4ad165371771f5398faba397edf6778837a18599ea13ff")
+if(CMAKE_C_COMPILER)
+  set(BROTLI_OPTIONS -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER})
+endif()
+if(CMAKE_RC_COMPILER)
+  set(BROTLI_OPTIONS ${BROTLI_OPTIONS} -DCMAKE_RC_COMPILER=${CMAKE_RC_COMPILER})
+endif()
+if(CMAKE_SYSTEM_NAME)
+  set(BROTLI_OPTIONS ${BROTLI_OPTIONS} -DCMAKE_SYSTEM_NAME=${CMAKE_SYSTEM_NAME})
+endif()
+if(UNIX)
+  set(BROTLI_OPTIONS ${BROTLI_OPTIONS} -DCMAKE_POSITION_INDEPENDENT_CODE=ON)
+endif()
+if(ANDROID)
+  set(BROTLI_OPTIONS
+      ${BROTLI_OPTIONS}
+      -DCMAKE_ANDROID_ARM_MODE=${CMAKE_ANDROID_ARM_MODE}
+      -DCMAKE_SYSTEM_VERSION=${CMAKE_SYSTEM_VERSION}
+      -DCMAKE_ANDROID_ARCH_ABI=${CMAKE_ANDROID_ARCH_ABI}
+      -DCMAKE_ANDROID_STANDALONE_TOOLCHAIN=${CMAKE_ANDROID_STANDALONE_TOOLCHAIN}
+  )
+endif()
+set(BROTLI_OPTIONS
+    ${BROTLI_OPTIONS}
+    -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE}
+    -DCMAKE_INSTALL_PREFIX=${CMAKE_BINARY_DIR}/${BROTLI_FULL_NAME}
+    -DCMAKE_INSTALL_LIBDIR=lib
+    -DBUILD_SHARED_LIBS=OFF
+    -DBROTLI_DISABLE_TESTS=ON)
+
+ExternalProject_Add(
+  ${BROTLI_FULL_NAME}
+  URL ${BROTLI_URL}
+  URL_HASH SHA256=${BROTLI_SHA256}
+  TIMEOUT 15
+  DOWNLOAD_NAME ${BROTLI_FULL_NAME}.tar.gz
+  DOWNLOAD_DIR ${CMAKE_SOURCE_DIR}/lib
+  PREFIX ${CMAKE_BINARY_DIR}/${BROTLI_FULL_NAME}
+  SOURCE_DIR ${CMAKE_SOURCE_DIR}/lib/${BROTLI_FULL_NAME}
+  CMAKE_ARGS ${BROTLI_OPTIONS}
+  LOG_DOWNLOAD ON
+  LOG_CONFIGURE ON
+  LOG_BUILD ON
+  LOG_INSTALL ON)
+
+ExternalProject_Get_Property(${BROTLI_FULL_NAME} INSTALL_DIR)
+set(BROTLI_INCLUDE_DIR ${INSTALL_DIR}/include)
+# the encoder depends on the common library, so it must come first
+set(BROTLI_ARCHIVE_LIBS ${INSTALL_DIR}/lib/libbrotlienc.a
+                        ${INSTALL_DIR}/lib/libbrotlicommon.a)
+set(BROTLI_DEC_ARCHIVE_LIB ${INSTALL_DIR}/lib/libbrotlidec.a)
+unset(INSTALL_DIR)
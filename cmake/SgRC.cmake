@@ -63,6 +63,12 @@ endif()
 if(SG_HTTP_COMPRESSION)
   list(APPEND RC_FILE_DESC_MODS "ZLIB")
 endif()
+if(SG_HTTP_BROTLI)
+  list(APPEND RC_FILE_DESC_MODS "BROTLI")
+endif()
+if(SG_HTTP_ZSTD)
+  list(APPEND RC_FILE_DESC_MODS "ZSTD")
+endif()
 if(SG_PATH_ROUTING)
   list(APPEND RC_FILE_DESC_MODS "PCRE2")
 endif()
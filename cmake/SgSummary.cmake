@@ -84,7 +84,14 @@ else()
 endif()
 
 if(SG_HTTP_COMPRESSION)
-  set(_http_compression "Yes")
+  set(_http_compression "Yes (zlib")
+  if(SG_HTTP_BROTLI)
+    string(CONCAT _http_compression ${_http_compression} ", brotli")
+  endif()
+  if(SG_HTTP_ZSTD)
+    string(CONCAT _http_compression ${_http_compression} ", zstd")
+  endif()
+  string(CONCAT _http_compression ${_http_compression} ")")
 else()
   set(_http_compression "No")
 endif()
@@ -0,0 +1,36 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef EXAMPLE_HTTPCOMP_BENCHMARK_H
+#define EXAMPLE_HTTPCOMP_BENCHMARK_H
+
+/**
+ * \example example_httpcomp_benchmark.c
+ * Benchmark comparing the size, CPU and allocator cost of each response
+ * encoding.
+ */
+
+#endif /* EXAMPLE_HTTPCOMP_BENCHMARK_H */
@@ -0,0 +1,99 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sagui.h>
+
+/*
+ * Compares finding entry-points by binary search against finding them after
+ * freezing the entry-points into a perfect hash, and shows the cost of the
+ * allocating sg_extract_entrypoint() which the lookups no longer pay.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define LOOKUPS 1000000
+#define MAX_COUNT 10000
+
+static char paths[MAX_COUNT][32];
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double) ts.tv_sec * 1e9) + (double) ts.tv_nsec;
+}
+
+static double bench_find(struct sg_entrypoints *entrypoints,
+                         unsigned int count) {
+  struct sg_entrypoint *entrypoint;
+  double start;
+  unsigned int i;
+  start = now();
+  for (i = 0; i < LOOKUPS; i++) {
+    if (sg_entrypoints_find(entrypoints, &entrypoint, paths[i % count]) != 0) {
+      fprintf(stderr, "No entry-point for: %s\n", paths[i % count]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  return (now() - start) / LOOKUPS;
+}
+
+static double bench_extract(unsigned int count) {
+  double start;
+  unsigned int i;
+  start = now();
+  for (i = 0; i < LOOKUPS; i++)
+    sg_free(sg_extract_entrypoint(paths[i % count]));
+  return (now() - start) / LOOKUPS;
+}
+
+int main(void) {
+  const unsigned int counts[] = {10, 1000, MAX_COUNT};
+  struct sg_entrypoints *entrypoints;
+  char name[32];
+  double sorted, frozen;
+  unsigned int i, j;
+  for (i = 0; i < MAX_COUNT; i++)
+    snprintf(paths[i], sizeof(paths[i]), "/tenant%u/api/users", i);
+  printf("%8s %14s %14s %14s\n", "names", "sorted (ns)", "frozen (ns)",
+         "extract (ns)");
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    entrypoints = sg_entrypoints_new();
+    for (j = 0; j < counts[i]; j++) {
+      snprintf(name, sizeof(name), "/tenant%u", j);
+      sg_entrypoints_add(entrypoints, name, NULL);
+    }
+    sorted = bench_find(entrypoints, counts[i]);
+    sg_entrypoints_freeze(entrypoints);
+    frozen = bench_find(entrypoints, counts[i]);
+    printf("%8u %14.1f %14.1f %14.1f\n", counts[i], sorted, frozen,
+           bench_extract(counts[i]));
+    sg_entrypoints_free(entrypoints);
+  }
+  return EXIT_SUCCESS;
+}
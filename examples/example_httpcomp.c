@@ -35,19 +35,10 @@
   "world</body></html>"
 #define CONTENT_TYPE "text/html; charset=utf-8"
 
-static void req_cb(__SG_UNUSED void *cls, struct sg_httpreq *req,
+/* The encoding (gzip, deflate or none) is negotiated from `Accept-Encoding`. */
+static void req_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req,
                    struct sg_httpres *res) {
-  struct sg_strmap **headers;
-  const char *header;
-  headers = sg_httpreq_headers(req);
-  if (headers) {
-    header = sg_strmap_get(*headers, "Accept-Encoding");
-    if (header && strstr(header, "deflate")) {
-      sg_httpres_zsendbinary(res, PAGE, strlen(PAGE), CONTENT_TYPE, 200);
-      return;
-    }
-  }
-  sg_httpres_sendbinary(res, PAGE, strlen(PAGE), CONTENT_TYPE, 200);
+  sg_httpres_zsendbinary(res, PAGE, strlen(PAGE), CONTENT_TYPE, 200);
 }
 
 int main(int argc, const char *argv[]) {
@@ -0,0 +1,187 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sagui.h>
+
+/*
+ * Serves a JSON payload through sg_httpres_zsendbinary2() to an in-process
+ * client asking for each `Accept-Encoding`, and prints the compression ratio
+ * and the CPU time per response, plus the calls and bytes requested from the
+ * Sagui allocator per response. Encoders not built into Sagui fall back to
+ * identity, as the `encoding` column shows. Pass the compression level
+ * (1..9 or -1 for default) and optionally the number of JSON records (e.g. 10
+ * for small responses) as arguments.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define RECORDS 5000
+#define ROUNDS 50
+#define RESPONSE_SIZE 4194304 /* 4 MB */
+
+static char *payload;
+static size_t payload_size;
+static unsigned int records = RECORDS;
+static int level = -1;
+static pthread_mutex_t mm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t mm_calls;
+static size_t mm_bytes;
+
+static void mm_count(size_t size) {
+  pthread_mutex_lock(&mm_mutex);
+  mm_calls++;
+  mm_bytes += size;
+  pthread_mutex_unlock(&mm_mutex);
+}
+
+static void *mm_malloc(size_t size) {
+  mm_count(size);
+  return malloc(size);
+}
+
+static void *mm_realloc(void *ptr, size_t size) {
+  mm_count(size);
+  return realloc(ptr, size);
+}
+
+static void req_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req,
+                   struct sg_httpres *res) {
+  sg_httpres_zsendbinary2(res, level, payload, payload_size,
+                          "application/json", 200);
+}
+
+static void make_payload(void) {
+  size_t len;
+  unsigned int i;
+  payload = malloc(records * 128 + 2);
+  payload[0] = '[';
+  len = 1;
+  for (i = 0; i < records; i++)
+    len += (size_t) sprintf(
+      payload + len,
+      "%s{\"id\":%u,\"name\":\"user%u\",\"email\":\"user%u@example.com\","
+      "\"active\":%s,\"score\":%u.%02u}",
+      i > 0 ? "," : "", i, i, (i * 7919) % 100000, i % 3 ? "true" : "false",
+      (i * 31) % 100, (i * 17) % 100);
+  payload[len++] = ']';
+  payload_size = len;
+}
+
+static size_t fetch(uint16_t port, const char *accept, char *buf,
+                    char *encoding, size_t encoding_size) {
+  struct sockaddr_in addr;
+  const char *body, *hdr;
+  size_t size = 0;
+  ssize_t got;
+  int fd;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+  snprintf(buf, RESPONSE_SIZE,
+           "GET / HTTP/1.1\r\n"
+           "Host: localhost\r\n"
+           "Connection: close\r\n"
+           "Accept-Encoding: %s\r\n"
+           "\r\n",
+           accept);
+  send(fd, buf, strlen(buf), 0);
+  while ((size < RESPONSE_SIZE - 1) &&
+         ((got = recv(fd, buf + size, RESPONSE_SIZE - 1 - size, 0)) > 0))
+    size += (size_t) got;
+  close(fd);
+  buf[size] = '\0';
+  body = strstr(buf, "\r\n\r\n");
+  hdr = strstr(buf, "Content-Encoding: ");
+  if (hdr && (!body || (hdr < body)))
+    sscanf(hdr + strlen("Content-Encoding: "), "%15[^\r]", encoding);
+  else
+    snprintf(encoding, encoding_size, "identity");
+  return body ? size - (size_t) (body + 4 - buf) : 0;
+}
+
+int main(int argc, const char *argv[]) {
+  const char *accepts[] = {"identity", "deflate", "gzip", "br", "zstd"};
+  struct sg_httpsrv *srv;
+  char encoding[16], *buf;
+  size_t i, size = 0, calls, bytes;
+  clock_t start;
+  double cpu;
+  int j;
+  if (argc > 1)
+    level = (int) strtol(argv[1], NULL, 10);
+  if (argc > 2)
+    records = (unsigned int) strtoul(argv[2], NULL, 10);
+  sg_mm_set(mm_malloc, mm_realloc, free);
+  make_payload();
+  buf = malloc(RESPONSE_SIZE);
+  srv = sg_httpsrv_new(req_cb, NULL);
+  if (!sg_httpsrv_listen(srv, 0, false)) {
+    sg_httpsrv_free(srv);
+    free(buf);
+    free(payload);
+    return EXIT_FAILURE;
+  }
+  printf("payload: %lu bytes, level: %d\n", (unsigned long) payload_size,
+         level);
+  printf("%-10s %-10s %10s %8s %14s %12s %10s\n", "accept", "encoding",
+         "bytes", "ratio", "cpu (ms/res)", "allocs/res", "KB/res");
+  for (i = 0; i < sizeof(accepts) / sizeof(accepts[0]); i++) {
+    pthread_mutex_lock(&mm_mutex);
+    calls = mm_calls;
+    bytes = mm_bytes;
+    pthread_mutex_unlock(&mm_mutex);
+    start = clock();
+    for (j = 0; j < ROUNDS; j++)
+      size = fetch(sg_httpsrv_port(srv), accepts[i], buf, encoding,
+                   sizeof(encoding));
+    cpu = (double) (clock() - start) * 1000 / CLOCKS_PER_SEC / ROUNDS;
+    pthread_mutex_lock(&mm_mutex);
+    calls = mm_calls - calls;
+    bytes = mm_bytes - bytes;
+    pthread_mutex_unlock(&mm_mutex);
+    printf("%-10s %-10s %10lu %8.2f %14.3f %12.1f %10.1f\n", accepts[i],
+           encoding, (unsigned long) size,
+           (double) payload_size / (double) size, cpu,
+           (double) calls / ROUNDS, (double) bytes / 1024 / ROUNDS);
+  }
+  fflush(stdout);
+  sg_httpsrv_free(srv);
+  free(buf);
+  free(payload);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sagui.h>
+
+/*
+ * Posts a 100 MB multipart/form-data body to an in-process server and prints
+ * the upload throughput. Build Sagui with `-DSG__HTTPFORM_NATIVE=0` in the
+ * CMAKE_C_FLAGS to measure the libmicrohttpd post processor instead of the
+ * native parser.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define BODY_SIZE 104857600 /* 100 MB */
+#define BLOCK_SIZE 65536 /* 64 kB */
+#define ROUNDS 5
+#define BOUNDARY "----SaguiBenchmarkBoundary"
+
+#define PART_HEADER                                                            \
+  "--" BOUNDARY "\r\n"                                                         \
+  "Content-Disposition: form-data; name=\"file\"; filename=\"file.bin\"\r\n"   \
+  "Content-Type: application/octet-stream\r\n"                                 \
+  "\r\n"
+
+#define PART_FOOTER "\r\n--" BOUNDARY "--\r\n"
+
+static uint64_t received;
+
+static int upld_cb(__SG_UNUSED void *cls, void **handle,
+                   __SG_UNUSED const char *dir, __SG_UNUSED const char *field,
+                   __SG_UNUSED const char *name, __SG_UNUSED const char *mime,
+                   __SG_UNUSED const char *encoding) {
+  *handle = &received;
+  return 0;
+}
+
+static ssize_t upld_write_cb(void *handle, __SG_UNUSED uint64_t offset,
+                             __SG_UNUSED const char *buf, size_t size) {
+  *((uint64_t *) handle) += size;
+  return (ssize_t) size;
+}
+
+static void upld_free_cb(__SG_UNUSED void *handle) {
+}
+
+static int upld_save_cb(__SG_UNUSED void *handle,
+                        __SG_UNUSED bool overwritten) {
+  return 0;
+}
+
+static int upld_save_as_cb(__SG_UNUSED void *handle,
+                           __SG_UNUSED const char *path,
+                           __SG_UNUSED bool overwritten) {
+  return 0;
+}
+
+static void req_cb(__SG_UNUSED void *cls, __SG_UNUSED struct sg_httpreq *req,
+                   struct sg_httpres *res) {
+  sg_httpres_send(res, "OK", "text/plain", 200);
+}
+
+static void send_all(int fd, const char *buf, size_t size) {
+  ssize_t sent;
+  while (size > 0) {
+    sent = send(fd, buf, size, 0);
+    if (sent <= 0)
+      return;
+    buf += sent;
+    size -= (size_t) sent;
+  }
+}
+
+static double post_body(uint16_t port, const char *block) {
+  struct sockaddr_in addr;
+  struct timespec start, end;
+  char buf[1024];
+  size_t left;
+  int fd;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  connect(fd, (struct sockaddr *) &addr, sizeof(addr));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  snprintf(buf, sizeof(buf),
+           "POST / HTTP/1.1\r\n"
+           "Host: localhost\r\n"
+           "Connection: close\r\n"
+           "Content-Type: multipart/form-data; boundary=" BOUNDARY "\r\n"
+           "Content-Length: %lu\r\n"
+           "\r\n" PART_HEADER,
+           (unsigned long) (strlen(PART_HEADER) + BODY_SIZE +
+                            strlen(PART_FOOTER)));
+  send_all(fd, buf, strlen(buf));
+  for (left = BODY_SIZE; left > 0; left -= BLOCK_SIZE)
+    send_all(fd, block, left < BLOCK_SIZE ? left : BLOCK_SIZE);
+  send_all(fd, PART_FOOTER, strlen(PART_FOOTER));
+  while (recv(fd, buf, sizeof(buf), 0) > 0)
+    ;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  close(fd);
+  return (double) (end.tv_sec - start.tv_sec) +
+         (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(void) {
+  struct sg_httpsrv *srv;
+  char *block;
+  double secs, total = 0;
+  int i;
+  srand(1);
+  block = malloc(BLOCK_SIZE);
+  for (i = 0; i < BLOCK_SIZE; i++)
+    block[i] = (char) rand();
+  srv = sg_httpsrv_new(req_cb, NULL);
+  sg_httpsrv_set_upld_cbs(srv, upld_cb, NULL, upld_write_cb, upld_free_cb,
+                          upld_save_cb, upld_save_as_cb);
+  sg_httpsrv_set_uplds_limit(srv, 0);
+  if (!sg_httpsrv_listen(srv, 0, false)) {
+    sg_httpsrv_free(srv);
+    free(block);
+    return EXIT_FAILURE;
+  }
+  for (i = 1; i <= ROUNDS; i++) {
+    received = 0;
+    secs = post_body(sg_httpsrv_port(srv), block);
+    total += secs;
+    fprintf(stdout, "Round %d: %llu bytes in %.3f s (%.2f MB/s)\n", i,
+            (unsigned long long) received, secs,
+            BODY_SIZE / 1048576.0 / secs);
+  }
+  fprintf(stdout, "Average: %.2f MB/s\n",
+          BODY_SIZE / 1048576.0 * ROUNDS / total);
+  fflush(stdout);
+  sg_httpsrv_free(srv);
+  free(block);
+  return EXIT_SUCCESS;
+}
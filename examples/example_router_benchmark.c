@@ -0,0 +1,94 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sagui.h>
+
+/*
+ * Compares dispatching through routes indexed by the router's radix tree
+ * (literals, `([^/]+)` segments and a trailing `(.*)`) against equivalent
+ * routes which must be matched by PCRE2, one by one or combined into a single
+ * pattern, and against the same routes behind the router's path cache. The
+ * dispatched paths repeat over a set of distinct paths, as in real traffic.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define DISPATCHES 200000
+#define PATHS 500
+#define CACHE_SIZE 1024
+
+static void route_cb(__SG_UNUSED void *cls,
+                     __SG_UNUSED struct sg_route *route) {
+}
+
+static double bench(unsigned int count, const char *fmt, bool combined,
+                    unsigned int cache_size) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  struct timespec start, end;
+  char pattern[64], path[64];
+  unsigned int i;
+  for (i = 0; i < count; i++) {
+    snprintf(pattern, sizeof(pattern), fmt, i);
+    sg_routes_add(&routes, pattern, route_cb, NULL);
+  }
+  router = sg_router_new(routes);
+  sg_router_set_combined(router, combined);
+  sg_router_set_cache(router, cache_size);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < DISPATCHES; i++) {
+    snprintf(path, sizeof(path), "/api/res%u/%u", (i % PATHS) % count,
+             i % PATHS);
+    if (sg_router_dispatch(router, path, NULL) != 0) {
+      fprintf(stderr, "No route for: %s\n", path);
+      exit(EXIT_FAILURE);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+  return (((double) (end.tv_sec - start.tv_sec) * 1e9) +
+          (double) (end.tv_nsec - start.tv_nsec)) /
+         DISPATCHES;
+}
+
+int main(void) {
+  const unsigned int counts[] = {1, 100, 1000};
+  unsigned int i;
+  printf("%8s %14s %14s %14s %14s\n", "routes", "tree (ns)", "regex (ns)",
+         "combined (ns)", "cached (ns)");
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    printf("%8u %14.1f %14.1f %14.1f %14.1f\n", counts[i],
+           bench(counts[i], "/api/res%u/([^/]+)", false, 0),
+           bench(counts[i], "/api/res%u/([0-9]+)", false, 0),
+           bench(counts[i], "/api/res%u/([0-9]+)", true, 0),
+           bench(counts[i], "/api/res%u/([0-9]+)", false, CACHE_SIZE));
+  return EXIT_SUCCESS;
+}
@@ -35,12 +35,15 @@
  * curl http://localhost:<PORT>/download/<FILENAME>
  * # return "About"
  * curl http://localhost:<PORT>/about
+ * # return "405" with the header "Allow: GET, HEAD"
+ * curl -i -X POST http://localhost:<PORT>/about
  * # return "404"
  * curl http://localhost:<PORT>/other
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <sagui.h>
 
 /* NOTE: Error checking has been omitted to make it clear. */
@@ -91,20 +94,29 @@ static void req_cb(__SG_UNUSED void *cls, struct sg_httpreq *req,
                    struct sg_httpres *res) {
   struct sg_router *router = cls;
   struct holder holder = {req, res};
-  if (sg_router_dispatch(router, sg_httpreq_path(req), &holder) != 0)
+  unsigned int methods;
+  int ret = sg_router_dispatch3(router, sg_httpreq_method(req),
+                                sg_httpreq_path(req), &holder, NULL, NULL,
+                                NULL);
+  if (ret == ENOTSUP) {
+    sg_router_allowed(router, sg_httpreq_path(req), &methods);
+    sg_httpres_sendallowed(res, methods);
+  } else if (ret != 0)
     sg_httpres_send(
       res, "<html><head><title>Not found</title></head><body>404</body></html>",
       "text/html", 404);
 }
 
 int main(void) {
-  struct sg_route *routes = NULL;
+  struct sg_route *routes = NULL, *route;
   struct sg_router *router;
   struct sg_httpsrv *srv;
+  char err[SG_ERR_SIZE];
   sg_routes_add(&routes, "/home", route_home_cb, NULL);
   sg_routes_add(&routes, "/download", route_download_cb, NULL);
   sg_routes_add(&routes, "/download/(?P<file>[a-z]+)", route_download_cb, NULL);
-  sg_routes_add(&routes, "/about", route_about_cb, NULL);
+  sg_routes_add3(&routes, &route, "/about", SG_METHOD_GET | SG_METHOD_HEAD, err,
+                 sizeof(err), route_about_cb, NULL);
   router = sg_router_new(routes);
   srv = sg_httpsrv_new(req_cb, router);
   if (!sg_httpsrv_listen(srv, 0 /* 0 = port chosen randomly */, false)) {
@@ -0,0 +1,106 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sagui.h>
+
+/*
+ * Dispatches paths from several threads sharing a single router and checks
+ * each match sees its own path and variables, printing the throughput.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define ROUTES 100
+#define THREADS 8
+#define DISPATCHES 200000
+
+struct worker {
+  pthread_t thread;
+  struct sg_router *router;
+  char id[16];
+  unsigned long errors;
+};
+
+static void route_cb(__SG_UNUSED void *cls, struct sg_route *route) {
+  struct worker *worker = sg_route_user_data(route);
+  const char *id;
+  size_t len;
+  if ((sg_route_var(route, "id", &id, &len) != 0) ||
+      (len != strlen(worker->id)) || (memcmp(id, worker->id, len) != 0))
+    worker->errors++;
+}
+
+static void *worker_cb(void *cls) {
+  struct worker *worker = cls;
+  char path[64];
+  unsigned int i;
+  for (i = 0; i < DISPATCHES; i++) {
+    snprintf(path, sizeof(path), "/api/res%u/%s", i % ROUTES, worker->id);
+    if (sg_router_dispatch(worker->router, path, worker) != 0)
+      worker->errors++;
+  }
+  return NULL;
+}
+
+int main(void) {
+  struct worker workers[THREADS];
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  struct timespec start, end;
+  char pattern[64];
+  unsigned long errors = 0;
+  double secs;
+  unsigned int i;
+  for (i = 0; i < ROUTES; i++) {
+    snprintf(pattern, sizeof(pattern), "/api/res%u/(?<id>[0-9]+)", i);
+    sg_routes_add(&routes, pattern, route_cb, NULL);
+  }
+  router = sg_router_new(routes);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < THREADS; i++) {
+    workers[i].router = router;
+    snprintf(workers[i].id, sizeof(workers[i].id), "%u", 1000 + i);
+    workers[i].errors = 0;
+    pthread_create(&workers[i].thread, NULL, worker_cb, &workers[i]);
+  }
+  for (i = 0; i < THREADS; i++) {
+    pthread_join(workers[i].thread, NULL);
+    errors += workers[i].errors;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  secs = (double) (end.tv_sec - start.tv_sec) +
+         ((double) (end.tv_nsec - start.tv_nsec) / 1e9);
+  printf("%d threads, %d routes: %.0f dispatches/s, %lu errors\n", THREADS,
+         ROUTES, (THREADS * (double) DISPATCHES) / secs, errors);
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
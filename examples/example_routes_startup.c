@@ -0,0 +1,100 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sagui.h>
+
+/*
+ * Compares the startup time of adding generated routes one by one, adding
+ * them in bulk, and loading their patterns precompiled by a previous run.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define ROUTES_FILE "routes_startup.bin"
+
+static void route_cb(__SG_UNUSED void *cls,
+                     __SG_UNUSED struct sg_route *route) {
+}
+
+static double elapsed(struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((double) (end.tv_sec - start->tv_sec) * 1e3) +
+         ((double) (end.tv_nsec - start->tv_nsec) / 1e6);
+}
+
+static void bench(unsigned int count) {
+  struct sg_route_entry *entries;
+  struct sg_route *routes = NULL;
+  struct timespec start;
+  char err[SG_ERR_SIZE], (*patterns)[64];
+  double add, add_many, load;
+  unsigned int i;
+  entries = malloc(count * sizeof(struct sg_route_entry));
+  patterns = malloc(count * sizeof(*patterns));
+  for (i = 0; i < count; i++) {
+    snprintf(patterns[i], sizeof(patterns[i]), "/tenant%u/(?<id>[0-9]+)", i);
+    entries[i].pattern = patterns[i];
+    entries[i].methods = SG_METHOD_ANY;
+    entries[i].cb = route_cb;
+    entries[i].cls = NULL;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    sg_routes_add(&routes, patterns[i], route_cb, NULL);
+  add = elapsed(&start);
+  sg_routes_cleanup(&routes);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sg_routes_add_many(&routes, entries, count, err, sizeof(err));
+  add_many = elapsed(&start);
+  sg_routes_save(routes, ROUTES_FILE);
+  sg_routes_cleanup(&routes);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (sg_routes_load(&routes, ROUTES_FILE, entries, count, err,
+                     sizeof(err)) != 0) {
+    fprintf(stderr, "%s", err);
+    exit(EXIT_FAILURE);
+  }
+  load = elapsed(&start);
+  sg_routes_cleanup(&routes);
+  remove(ROUTES_FILE);
+  free(patterns);
+  free(entries);
+  printf("%8u %14.1f %14.1f %14.1f\n", count, add, add_many, load);
+}
+
+int main(void) {
+  const unsigned int counts[] = {100, 1000, 5000};
+  unsigned int i;
+  printf("%8s %14s %14s %14s\n", "routes", "add (ms)", "add_many (ms)",
+         "load (ms)");
+  for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    bench(counts[i]);
+  return EXIT_SUCCESS;
+}
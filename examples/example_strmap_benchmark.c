@@ -0,0 +1,93 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sagui.h>
+
+/*
+ * Measures the average time of the add, find, set and rm string map operations
+ * with 10, 100 and 10000 entries. Lookups use upper-cased names to exercise
+ * the case-insensitive hashing.
+ */
+
+/* NOTE: Error checking has been omitted to make it clear. */
+
+#define MAX_ENTRIES 10000
+#define MIN_OPS 1000000
+
+static char names[MAX_ENTRIES][16];
+static char upper_names[MAX_ENTRIES][16];
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double) ts.tv_sec * 1e9) + (double) ts.tv_nsec;
+}
+
+static void bench(unsigned int entries) {
+  struct sg_strmap *map;
+  struct sg_strmap *pair;
+  unsigned int i, r, rounds = (MIN_OPS / entries) + 1;
+  double add = 0, find = 0, set = 0, rm = 0, t;
+  for (r = 0; r < rounds; r++) {
+    map = NULL;
+    t = now();
+    for (i = 0; i < entries; i++)
+      sg_strmap_add(&map, names[i], "value");
+    add += now() - t;
+    t = now();
+    for (i = 0; i < entries; i++)
+      sg_strmap_find(map, upper_names[i], &pair);
+    find += now() - t;
+    t = now();
+    for (i = 0; i < entries; i++)
+      sg_strmap_set(&map, upper_names[i], "other value");
+    set += now() - t;
+    t = now();
+    for (i = 0; i < entries; i++)
+      sg_strmap_rm(&map, names[i]);
+    rm += now() - t;
+    sg_strmap_cleanup(&map);
+  }
+  t = (double) rounds * entries;
+  printf("%5u entries: add %7.1f ns, find %7.1f ns, set %7.1f ns, "
+         "rm %7.1f ns\n",
+         entries, add / t, find / t, set / t, rm / t);
+}
+
+int main(void) {
+  unsigned int i;
+  for (i = 0; i < MAX_ENTRIES; i++) {
+    snprintf(names[i], sizeof(names[i]), "x-header-%u", i);
+    snprintf(upper_names[i], sizeof(upper_names[i]), "X-HEADER-%u", i);
+  }
+  bench(10);
+  bench(100);
+  bench(MAX_ENTRIES);
+  return EXIT_SUCCESS;
+}
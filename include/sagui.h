@@ -497,7 +497,7 @@ SG_EXTERN int sg_strmap_set(struct sg_strmap **map, const char *name,
  * \retval 0 Success.
  * \retval EINVAL Invalid argument.
  * \retval ENOENT Pair not found.
- * \retval ENOMEM Out of memory.
+ * \note The name is compared ignoring case and the lookup allocates nothing.
  */
 SG_EXTERN int sg_strmap_find(struct sg_strmap *map, const char *name,
                              struct sg_strmap **pair);
@@ -518,7 +518,6 @@ SG_EXTERN const char *sg_strmap_get(struct sg_strmap *map, const char *name);
  * \retval 0 Success.
  * \retval EINVAL Invalid argument.
  * \retval ENOENT Pair already removed.
- * \retval ENOMEM Out of memory.
  */
 SG_EXTERN int sg_strmap_rm(struct sg_strmap **map, const char *name);
 
@@ -609,6 +608,107 @@ struct sg_httpres;
  */
 struct sg_httpsrv;
 
+/**
+ * Well-known HTTP header names, usable to read request headers and to set
+ * response headers without hashing their names.
+ * \enum sg_hdr
+ */
+enum sg_hdr {
+  /** `Accept` header. */
+  SG_HDR_ACCEPT = 0,
+  /** `Accept-Encoding` header. */
+  SG_HDR_ACCEPT_ENCODING,
+  /** `Accept-Language` header. */
+  SG_HDR_ACCEPT_LANGUAGE,
+  /** `Accept-Ranges` header. */
+  SG_HDR_ACCEPT_RANGES,
+  /** `Authorization` header. */
+  SG_HDR_AUTHORIZATION,
+  /** `Cache-Control` header. */
+  SG_HDR_CACHE_CONTROL,
+  /** `Connection` header. */
+  SG_HDR_CONNECTION,
+  /** `Content-Disposition` header. */
+  SG_HDR_CONTENT_DISPOSITION,
+  /** `Content-Encoding` header. */
+  SG_HDR_CONTENT_ENCODING,
+  /** `Content-Length` header. */
+  SG_HDR_CONTENT_LENGTH,
+  /** `Content-Range` header. */
+  SG_HDR_CONTENT_RANGE,
+  /** `Content-Type` header. */
+  SG_HDR_CONTENT_TYPE,
+  /** `Cookie` header. */
+  SG_HDR_COOKIE,
+  /** `ETag` header. */
+  SG_HDR_ETAG,
+  /** `Expires` header. */
+  SG_HDR_EXPIRES,
+  /** `Host` header. */
+  SG_HDR_HOST,
+  /** `If-Match` header. */
+  SG_HDR_IF_MATCH,
+  /** `If-Modified-Since` header. */
+  SG_HDR_IF_MODIFIED_SINCE,
+  /** `If-None-Match` header. */
+  SG_HDR_IF_NONE_MATCH,
+  /** `If-Range` header. */
+  SG_HDR_IF_RANGE,
+  /** `If-Unmodified-Since` header. */
+  SG_HDR_IF_UNMODIFIED_SINCE,
+  /** `Last-Modified` header. */
+  SG_HDR_LAST_MODIFIED,
+  /** `Location` header. */
+  SG_HDR_LOCATION,
+  /** `Origin` header. */
+  SG_HDR_ORIGIN,
+  /** `Range` header. */
+  SG_HDR_RANGE,
+  /** `Referer` header. */
+  SG_HDR_REFERER,
+  /** `Set-Cookie` header. */
+  SG_HDR_SET_COOKIE,
+  /** `Transfer-Encoding` header. */
+  SG_HDR_TRANSFER_ENCODING,
+  /** `User-Agent` header. */
+  SG_HDR_USER_AGENT,
+  /** `Vary` header. */
+  SG_HDR_VARY,
+  /** `WWW-Authenticate` header. */
+  SG_HDR_WWW_AUTHENTICATE,
+  /** `X-Forwarded-For` header. */
+  SG_HDR_X_FORWARDED_FOR,
+  /** Number of well-known headers (not a header). */
+  SG_HDR_COUNT
+};
+
+/**
+ * HTTP method flags, combined to restrict the methods served by a route.
+ * \enum sg_method
+ */
+enum sg_method {
+  /** `GET` method. */
+  SG_METHOD_GET = 1 << 0,
+  /** `HEAD` method. */
+  SG_METHOD_HEAD = 1 << 1,
+  /** `POST` method. */
+  SG_METHOD_POST = 1 << 2,
+  /** `PUT` method. */
+  SG_METHOD_PUT = 1 << 3,
+  /** `DELETE` method. */
+  SG_METHOD_DELETE = 1 << 4,
+  /** `CONNECT` method. */
+  SG_METHOD_CONNECT = 1 << 5,
+  /** `OPTIONS` method. */
+  SG_METHOD_OPTIONS = 1 << 6,
+  /** `TRACE` method. */
+  SG_METHOD_TRACE = 1 << 7,
+  /** `PATCH` method. */
+  SG_METHOD_PATCH = 1 << 8,
+  /** Any method, including the ones not listed above. */
+  SG_METHOD_ANY = (1 << 9) - 1
+};
+
 /**
  * Callback signature used to handle client connection events.
  * \param[out] cls User-defined closure.
@@ -862,6 +962,8 @@ SG_EXTERN struct sg_httpsrv *sg_httpreq_srv(struct sg_httpreq *req);
  * \return Reference to the client headers map.
  * \retval NULL If \pr{req} is null and set the `errno` to `EINVAL`
  * \note The headers map is automatically freed by the library.
+ * \note The map is built on the first call and its pairs borrow the
+ * connection values, prefer #sg_httpreq_get_header() to read a few headers.
  */
 SG_EXTERN struct sg_strmap **sg_httpreq_headers(struct sg_httpreq *req);
 
@@ -883,6 +985,57 @@ SG_EXTERN struct sg_strmap **sg_httpreq_cookies(struct sg_httpreq *req);
  */
 SG_EXTERN struct sg_strmap **sg_httpreq_params(struct sg_httpreq *req);
 
+/**
+ * Returns the value of a client header without building the headers map.
+ * \param[in] req Request handle.
+ * \param[in] name Header name (case-insensitive).
+ * \return Header value.
+ * \retval NULL If \pr{req} or \pr{name} is null and set the `errno` to
+ * `EINVAL`, or if the header is not found.
+ * \note The value is owned by the request and is valid until it is finished.
+ */
+SG_EXTERN const char *sg_httpreq_get_header(struct sg_httpreq *req,
+                                            const char *name);
+
+/**
+ * Returns the value of a well-known client header in constant time.
+ * \param[in] req Request handle.
+ * \param[in] id Header ID, e.g. #SG_HDR_ACCEPT_ENCODING.
+ * \return Header value.
+ * \retval NULL If \pr{req} is null or \pr{id} is invalid and set the `errno`
+ * to `EINVAL`, or if the header is not found.
+ * \note The well-known headers are recorded in a single pass on the first
+ * call, keeping the first value of repeated headers.
+ * \note The value is owned by the request and is valid until it is finished.
+ */
+SG_EXTERN const char *sg_httpreq_header(struct sg_httpreq *req,
+                                        enum sg_hdr id);
+
+/**
+ * Returns the value of a client cookie without building the cookies map.
+ * \param[in] req Request handle.
+ * \param[in] name Cookie name.
+ * \return Cookie value.
+ * \retval NULL If \pr{req} or \pr{name} is null and set the `errno` to
+ * `EINVAL`, or if the cookie is not found.
+ * \note The value is owned by the request and is valid until it is finished.
+ */
+SG_EXTERN const char *sg_httpreq_get_cookie(struct sg_httpreq *req,
+                                            const char *name);
+
+/**
+ * Returns the value of a query-string parameter without building the
+ * query-string map.
+ * \param[in] req Request handle.
+ * \param[in] name Parameter name.
+ * \return Parameter value.
+ * \retval NULL If \pr{req} or \pr{name} is null and set the `errno` to
+ * `EINVAL`, or if the parameter is not found or has no value.
+ * \note The value is owned by the request and is valid until it is finished.
+ */
+SG_EXTERN const char *sg_httpreq_get_param(struct sg_httpreq *req,
+                                           const char *name);
+
 /**
  * Returns the fields of a HTML form into #sg_strmap map.
  * \param[in] req Request handle.
@@ -1006,6 +1159,23 @@ SG_EXTERN void *sg_httpreq_user_data(struct sg_httpreq *req);
  */
 SG_EXTERN struct sg_strmap **sg_httpres_headers(struct sg_httpres *res);
 
+/**
+ * Sets a well-known server header without hashing its name.
+ * \param[in] res Response handle.
+ * \param[in] id Header ID, e.g. #SG_HDR_CACHE_CONTROL.
+ * \param[in] val Header value.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument, including #SG_HDR_SET_COOKIE.
+ * \retval ENOMEM Out of memory.
+ * \note Each ID holds a single value: the header replaces any previous value
+ * set by this function and any pair with the same name in the
+ * #sg_httpres_headers() map. To send a list, join its items with commas in
+ * \pr{val}. Cookies, which cannot be joined, are set by
+ * #sg_httpres_set_cookie().
+ */
+SG_EXTERN int sg_httpres_set_header(struct sg_httpres *res, enum sg_hdr id,
+                                    const char *val);
+
 /**
  * Sets server cookie to the response handle.
  * \param[in] res Response handle.
@@ -1045,11 +1215,28 @@ SG_EXTERN int sg_httpres_set_cookie(struct sg_httpres *res, const char *name,
  * \retval EINVAL Invalid argument.
  * \retval EALREADY Operation already in progress.
  * \retval ENOMEM Out of memory.
+ * \note When the server has a compression policy (see
+ * #sg_httpsrv_set_ztypes()), the content may be compressed as by
+ * #sg_httpres_zsendbinary2().
  */
 SG_EXTERN int sg_httpres_sendbinary(struct sg_httpres *res, void *buf,
                                     size_t size, const char *content_type,
                                     unsigned int status);
 
+/**
+ * Sends the "405 Method Not Allowed" status to the client, listing the
+ * methods in \pr{methods} in the `Allow` header.
+ * \param[in] res Response handle.
+ * \param[in] methods Method flags allowed for the resource, e.g. filled by
+ * #sg_router_allowed().
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EALREADY Operation already in progress.
+ * \retval ENOMEM Out of memory.
+ */
+SG_EXTERN int sg_httpres_sendallowed(struct sg_httpres *res,
+                                     unsigned int methods);
+
 /**
  * Offers a file as download.
  * \param[in] res Response handle.
@@ -1098,6 +1285,16 @@ SG_EXTERN int sg_httpres_sendbinary(struct sg_httpres *res, void *buf,
  * \retval EBADF Bad file number.
  * \retval EFBIG File too large.
  * \retval ENOMEM Out of memory.
+ * \note When the whole file is sent with status 200, the response gets a weak
+ * `ETag` built from the file inode, size and modification time, and a
+ * `Last-Modified` header, unless already set. A GET or HEAD whose
+ * `If-None-Match` matches the `ETag`, or whose `If-Modified-Since` is not older
+ * than the file, gets a 304 (Not Modified) without the file being read.
+ * A GET also gets `Accept-Ranges: bytes` and its `Range` header is answered by
+ * itself: one range gets a 206 with `Content-Range`, several ranges get a 206
+ * with a `multipart/byteranges` body, and unsatisfiable ranges get a 416. An
+ * `If-Range` not matching the file modification time or a strong `ETag` sends
+ * the whole file.
  * \warning The parameter `disposition` is not checked internally, thus any
  * non-`NULL` value is passed directly to the header `Content-Disposition`.
  */
@@ -1150,6 +1347,19 @@ SG_EXTERN int sg_httpres_sendstream(struct sg_httpres *res, uint64_t size,
 
 #ifdef SG_HTTP_COMPRESSION
 
+/**
+ * \name Compression
+ * \anchor sg_httpres_zcoding
+ * The coding is negotiated with the request header `Accept-Encoding`, picking
+ * `gzip` or `deflate` (also `br` and `zstd` when built with Brotli and
+ * Zstandard support) by their q-values or sending the content uncompressed
+ * when the client accepts none of them; without that header, each function
+ * uses its default coding. When compression succeeds, the chosen coding is
+ * added as the header `Content-Encoding`, and `Vary: Accept-Encoding` is
+ * always added.
+ * \{
+ */
+
 /**
  * Compresses a null-terminated string content and sends it to the client. The
  * compression is done by zlib library using the DEFLATE compression algorithm.
@@ -1163,8 +1373,8 @@ SG_EXTERN int sg_httpres_sendstream(struct sg_httpres *res, uint64_t size,
  * \retval ENOBUFS No buffer space available.
  * \retval EALREADY Operation already in progress.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: deflate` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `deflate` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 #define sg_httpres_zsend(res, val, content_type, status)                       \
   sg_httpres_zsendbinary((res), (void *) (val),                                \
@@ -1186,8 +1396,8 @@ SG_EXTERN int sg_httpres_sendstream(struct sg_httpres *res, uint64_t size,
  * \retval ENOBUFS No buffer space available.
  * \retval EALREADY Operation already in progress.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: deflate` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `deflate` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 SG_EXTERN int sg_httpres_zsendbinary2(struct sg_httpres *res, int level,
                                       void *buf, size_t size,
@@ -1208,8 +1418,8 @@ SG_EXTERN int sg_httpres_zsendbinary2(struct sg_httpres *res, int level,
  * \retval ENOBUFS No buffer space available.
  * \retval EALREADY Operation already in progress.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: deflate` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `deflate` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 SG_EXTERN int sg_httpres_zsendbinary(struct sg_httpres *res, void *buf,
                                      size_t size, const char *content_type,
@@ -1230,8 +1440,8 @@ SG_EXTERN int sg_httpres_zsendbinary(struct sg_httpres *res, void *buf,
  * \retval EALREADY Operation already in progress.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: deflate` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `deflate` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 SG_EXTERN int sg_httpres_zsendstream2(struct sg_httpres *res, int level,
                                       uint64_t size, sg_read_cb read_cb,
@@ -1251,8 +1461,8 @@ SG_EXTERN int sg_httpres_zsendstream2(struct sg_httpres *res, int level,
  * \retval EALREADY Operation already in progress.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: deflate` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `deflate` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 SG_EXTERN int sg_httpres_zsendstream(struct sg_httpres *res, sg_read_cb read_cb,
                                      void *handle, sg_free_cb free_cb,
@@ -1271,8 +1481,8 @@ SG_EXTERN int sg_httpres_zsendstream(struct sg_httpres *res, sg_read_cb read_cb,
  * \retval EBADF Bad file number.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: gzip` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `gzip` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 #define sg_httpres_zdownload(res, filename, status)                            \
   sg_httpres_zsendfile2((res), 1, 0, 0, 0, (filename), "attachment", (status))
@@ -1290,8 +1500,8 @@ SG_EXTERN int sg_httpres_zsendstream(struct sg_httpres *res, sg_read_cb read_cb,
  * \retval EBADF Bad file number.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: gzip` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `gzip` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 #define sg_httpres_zrender(res, filename, status)                              \
   sg_httpres_zsendfile2((res), 1, 0, 0, 0, (filename), "inline", (status))
@@ -1317,8 +1527,13 @@ SG_EXTERN int sg_httpres_zsendstream(struct sg_httpres *res, sg_read_cb read_cb,
  * \retval EFBIG File too large.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: gzip` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `gzip` is used (see
+ * \ref sg_httpres_zcoding "compression").
+ * \note When the server serves precompressed files (see
+ * #sg_httpsrv_set_zstatic()), whole files are sent as is from a sibling such
+ * as `app.js.br`, `app.js.zst` or `app.js.gz`, or from the cache directory.
+ * \note Whole files get the validators of #sg_httpres_sendfile2(), so a
+ * matching conditional request gets a 304 before anything is compressed.
  * \warning The parameter `disposition` is not checked internally, thus any
  * non-`NULL` value is passed directly to the header `Content-Disposition`.
  */
@@ -1347,14 +1562,16 @@ SG_EXTERN int sg_httpres_zsendfile2(struct sg_httpres *res, int level,
  * \retval EFBIG File too large.
  * \retval ENOMEM Out of memory.
  * \retval Z_<ERROR> zlib error as negative number.
- * \note When compression succeeds, the header `Content-Encoding: gzip` is
- * automatically added to the response.
+ * \note Without `Accept-Encoding`, `gzip` is used (see
+ * \ref sg_httpres_zcoding "compression").
  */
 SG_EXTERN int sg_httpres_zsendfile(struct sg_httpres *res, uint64_t size,
                                    uint64_t max_size, uint64_t offset,
                                    const char *filename, bool downloaded,
                                    unsigned int status);
 
+/** \} */
+
 #endif /* SG_HTTP_COMPRESSION */
 
 /**
@@ -1639,6 +1856,8 @@ SG_EXTERN const char *sg_httpsrv_upld_dir(struct sg_httpsrv *srv);
  * \param[in] size Post buffering size.
  * \retval 0 Success.
  * \retval EINVAL Invalid argument.
+ * \note Multipart forms are parsed natively and streamed in whole received
+ * chunks, so this size only applies to URL-encoded forms.
  */
 SG_EXTERN int sg_httpsrv_set_post_buf_size(struct sg_httpsrv *srv, size_t size);
 
@@ -1740,6 +1959,185 @@ SG_EXTERN int sg_httpsrv_set_con_limit(struct sg_httpsrv *srv,
  */
 SG_EXTERN unsigned int sg_httpsrv_con_limit(struct sg_httpsrv *srv);
 
+/**
+ * Enables the entity-tags of the binary contents. When enabled,
+ * #sg_httpres_sendbinary() (and so #sg_httpres_send()) hashes 200 responses
+ * with XXH64 into a weak `ETag` and, if the `If-None-Match` of a GET or HEAD
+ * request matches it, answers 304 (Not Modified) without copying or
+ * compressing the content. An `ETag` already set in the response is kept.
+ * \param[in] srv Server handle.
+ * \param[in] enabled Enables the entity-tags (default: disabled).
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_etag(struct sg_httpsrv *srv, bool enabled);
+
+/**
+ * Checks if the server sends entity-tags of the binary contents.
+ * \param[in] srv Server handle.
+ * \retval true If the entity-tags are enabled, `false` otherwise. If
+ * \pr{srv} is null, set the `errno` to `EINVAL`.
+ */
+SG_EXTERN bool sg_httpsrv_etag(struct sg_httpsrv *srv);
+
+#ifdef SG_HTTP_COMPRESSION
+
+/**
+ * Sets the media types compressed automatically by #sg_httpres_sendbinary()
+ * (and so #sg_httpres_send()), enabling the compression policy of the server.
+ * Contents of these types with at least #sg_httpsrv_zmin_size() bytes are sent
+ * as #sg_httpres_zsendbinary2() does, unless the response already has the
+ * header `Content-Encoding`.
+ * \param[in] srv Server handle.
+ * \param[in] types Comma-separated media types, e.g.
+ * `"text/\*, application/json, image/svg+xml"`, where `type/\*` matches any
+ * subtype. Pass null to disable the policy (default).
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ */
+SG_EXTERN int sg_httpsrv_set_ztypes(struct sg_httpsrv *srv, const char *types);
+
+/**
+ * Gets the media types compressed automatically.
+ * \param[in] srv Server handle.
+ * \return Media types as a null-terminated string.
+ * \retval NULL If the policy is disabled, or if the \pr{srv} is null and set
+ * the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_httpsrv_ztypes(struct sg_httpsrv *srv);
+
+/**
+ * Sets the minimum size of the contents compressed automatically. Smaller
+ * contents are sent as they are, since compressing them costs more than it
+ * saves.
+ * \param[in] srv Server handle.
+ * \param[in] size Minimum content size. Default: 1 kB.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_zmin_size(struct sg_httpsrv *srv, size_t size);
+
+/**
+ * Gets the minimum size of the contents compressed automatically.
+ * \param[in] srv Server handle.
+ * \return Minimum content size.
+ * \retval 0 If the \pr{srv} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN size_t sg_httpsrv_zmin_size(struct sg_httpsrv *srv);
+
+/**
+ * Sets the level of the contents compressed automatically.
+ * \param[in] srv Server handle.
+ * \param[in] level Compression level (1..9 or -1 for default). Default: 1.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_zlevel(struct sg_httpsrv *srv, int level);
+
+/**
+ * Gets the level of the contents compressed automatically.
+ * \param[in] srv Server handle.
+ * \return Compression level.
+ * \retval 0 If the \pr{srv} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN int sg_httpsrv_zlevel(struct sg_httpsrv *srv);
+
+/**
+ * Sets how many contents can be compressed automatically at the same time
+ * before the level drops to 1, shedding CPU when the server is busy.
+ * \param[in] srv Server handle.
+ * \param[in] max Maximum of contents compressed concurrently at the level
+ * set by #sg_httpsrv_set_zlevel(). Use zero to never drop it (default).
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_zmax_active(struct sg_httpsrv *srv,
+                                         unsigned int max);
+
+/**
+ * Gets how many contents can be compressed automatically at the same time
+ * before the level drops.
+ * \param[in] srv Server handle.
+ * \return Maximum of contents compressed concurrently.
+ * \retval 0 If the \pr{srv} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN unsigned int sg_httpsrv_zmax_active(struct sg_httpsrv *srv);
+
+/**
+ * Enables serving precompressed files from #sg_httpres_zsendfile2() and its
+ * wrappers. Instead of compressing a whole file on every request, the sibling
+ * file with the extension `.br`, `.zst` or `.gz` the client prefers is sent
+ * by `sendfile()` with the headers `Content-Encoding` and `Content-Length`.
+ * Siblings older than the file are ignored. When no sibling fits and a cache
+ * directory is set, the file is compressed into it once and served from there.
+ * \param[in] srv Server handle.
+ * \param[in] enabled Enables the precompressed files. Default: `false`.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_httpsrv_set_zstatic(struct sg_httpsrv *srv, bool enabled);
+
+/**
+ * Checks if the server serves precompressed files.
+ * \param[in] srv Server handle.
+ * \retval true If the precompressed files are enabled, `false` otherwise. If
+ * \pr{srv} is null, set the `errno` to `EINVAL`.
+ */
+SG_EXTERN bool sg_httpsrv_zstatic(struct sg_httpsrv *srv);
+
+/**
+ * Sets the directory where files without precompressed siblings are
+ * compressed on first use, each copy named after the device, inode (the path
+ * on Windows), modification time and size of the file, so a changed file
+ * gets a new copy.
+ * \param[in] srv Server handle.
+ * \param[in] dir Directory as a null-terminated string. Pass null to disable
+ * the cache (default).
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \note Old copies are never removed: every change of a file adds a new copy
+ * and leaves the previous one behind, so the directory keeps growing until
+ * the application removes the stale copies.
+ */
+SG_EXTERN int sg_httpsrv_set_zcache_dir(struct sg_httpsrv *srv,
+                                        const char *dir);
+
+/**
+ * Gets the directory where files are compressed on first use.
+ * \param[in] srv Server handle.
+ * \return Directory as a null-terminated string.
+ * \retval NULL If the cache is disabled, or if the \pr{srv} is null and set
+ * the `errno` to `EINVAL`.
+ */
+SG_EXTERN const char *sg_httpsrv_zcache_dir(struct sg_httpsrv *srv);
+
+/**
+ * Sets how many threads gzip a large file sent by the zsendfile functions,
+ * each one deflating a block of 128 kB primed with the tail of the previous
+ * block. The output keeps the order of the input and is a regular gzip stream.
+ * \param[in] srv Server handle.
+ * \param[in] threads Number of threads per file. Use zero or one to gzip on
+ * the thread of the request (default).
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \note Only files of at least 1 MB are split, since the threads are started
+ * per response.
+ */
+SG_EXTERN int sg_httpsrv_set_zthreads(struct sg_httpsrv *srv,
+                                      unsigned int threads);
+
+/**
+ * Gets how many threads gzip a large file sent by the zsendfile functions.
+ * \param[in] srv Server handle.
+ * \return Number of threads per file.
+ * \retval 0 If the \pr{srv} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN unsigned int sg_httpsrv_zthreads(struct sg_httpsrv *srv);
+
+#endif /* SG_HTTP_COMPRESSION */
+
 /**
  * Returns the MHD instance.
  * \param[in] srv Server handle.
@@ -1834,10 +2232,41 @@ SG_EXTERN void sg_entrypoints_free(struct sg_entrypoints *entrypoints);
  * \retval EINVAL Invalid argument.
  * \retval ENOMEM Out of memory.
  * \retval EALREADY Entry-point already added.
+ * \note The item is inserted in place, growing the list capacity by doubling
+ * it.
  */
 SG_EXTERN int sg_entrypoints_add(struct sg_entrypoints *entrypoints,
                                  const char *path, void *user_data);
 
+/**
+ * Entry-point item to be added in bulk by #sg_entrypoints_add_many().
+ * \struct sg_entrypoint_entry
+ */
+struct sg_entrypoint_entry {
+  /** Entry-point path. */
+  const char *path;
+  /** User data pointer. */
+  void *user_data;
+};
+
+/**
+ * Adds several entry-point items at once to the entry-points
+ * \pr{entrypoints}. Either all the items are added or none of them.
+ * \param[in] entrypoints Entry-points handle.
+ * \param[in] entries Array of entry-point items to be added.
+ * \param[in] count Number of items in \pr{entries}.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \retval EALREADY Entry-point already added or repeated in \pr{entries}.
+ * \note The items are sorted once and merged with the existing ones into a
+ * single allocation, so adding \e N entry-points takes \e O(N log N) time
+ * instead of calling #sg_entrypoints_add() for each one.
+ */
+SG_EXTERN int sg_entrypoints_add_many(struct sg_entrypoints *entrypoints,
+                                      const struct sg_entrypoint_entry *entries,
+                                      unsigned int count);
+
 /**
  * Removes an entry-point item from the entry-points \pr{entrypoints}.
  * \param[in] entrypoints Entry-points handle.
@@ -1878,13 +2307,74 @@ SG_EXTERN int sg_entrypoints_clear(struct sg_entrypoints *entrypoints);
  * \param[in] path Entry-point path to be found.
  * \retval 0 Success.
  * \retval EINVAL Invalid argument.
- * \retval ENOMEM Out of memory.
  * \retval ENOENT Pair not found.
+ * \note The first segment of \pr{path} is looked up in place, without
+ * allocating memory. It takes a binary search, or constant time after
+ * #sg_entrypoints_freeze().
+ * \note In the snapshots mode (see #sg_entrypoints_set_snapshots()), the
+ * found entry-point is valid until the next change, or until the end of the
+ * read-side section when called inside #sg_entrypoints_read_lock().
  */
 SG_EXTERN int sg_entrypoints_find(struct sg_entrypoints *entrypoints,
                                   struct sg_entrypoint **entrypoint,
                                   const char *path);
 
+/**
+ * Builds a minimal perfect hash over the entry-point names, making
+ * #sg_entrypoints_find() take constant time.
+ * \param[in] entrypoints Entry-points handle.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \retval EAGAIN No perfect hash found, the binary search is kept.
+ * \note Adding, removing or clearing entry-points drops the hash, so it should
+ * be called once all the entry-points are added.
+ */
+SG_EXTERN int sg_entrypoints_freeze(struct sg_entrypoints *entrypoints);
+
+/**
+ * Enables or disables the snapshots mode of the entry-points. In this mode,
+ * each change builds an immutable copy of the entry-points and publishes it
+ * at once, so #sg_entrypoints_find() and #sg_entrypoints_iter() can run
+ * concurrently with the changes, without waiting for locks.
+ * \param[in] entrypoints Entry-points handle.
+ * \param[in] enabled Enables the snapshots mode. Default: `false`.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EDEADLK Called inside a read-side section.
+ * \retval ENOMEM Out of memory.
+ * \note Each change waits for the lookups started before its copy was
+ * published, then frees the previous copy. A change whose copy cannot be
+ * published, e.g. on `ENOMEM`, is kept and published by the next one.
+ * \warning It must be called before the entry-points are shared by other
+ * threads, and the changes must be serialized by the caller.
+ * \warning Each change also waits for the read-side sections open in any
+ * thread, even on other entry-points, so it must not be called while holding
+ * a lock taken inside them.
+ */
+SG_EXTERN int sg_entrypoints_set_snapshots(struct sg_entrypoints *entrypoints,
+                                           bool enabled);
+
+/**
+ * Enters a read-side section, keeping the entry-points found inside it valid
+ * in the snapshots mode until #sg_entrypoints_read_unlock(). It never waits
+ * for the changes, and sections can be nested.
+ * \param[in] entrypoints Entry-points handle.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \warning The entry-points must not be changed inside the section.
+ */
+SG_EXTERN int sg_entrypoints_read_lock(struct sg_entrypoints *entrypoints);
+
+/**
+ * Leaves the read-side section entered by #sg_entrypoints_read_lock().
+ * \param[in] entrypoints Entry-points handle.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ */
+SG_EXTERN int sg_entrypoints_read_unlock(struct sg_entrypoints *entrypoints);
+
 /**
  * Handle for the route item. It holds a user data to be dispatched when a path
  * matches the user defined pattern (route pattern).
@@ -1915,6 +2405,35 @@ typedef int (*sg_segments_iter_cb)(void *cls, unsigned int index,
  */
 typedef int (*sg_vars_iter_cb)(void *cls, const char *name, const char *val);
 
+/**
+ * Callback signature used by #sg_route_segments_iter2() to iterate the path
+ * segments without copying them.
+ * \param[out] cls User-defined closure.
+ * \param[out] index Current iterated item index.
+ * \param[out] segment Current iterated segment, pointing into the path (not
+ * null-terminated) or `NULL` if the segment did not participate in the match.
+ * \param[out] len Length of the segment.
+ * \retval 0 Success.
+ * \retval E<ERROR> User-defined error to stop the segments iteration.
+ */
+typedef int (*sg_segments_iter2_cb)(void *cls, unsigned int index,
+                                    const char *segment, size_t len);
+
+/**
+ * Callback signature used by #sg_route_vars_iter2() to iterate the path
+ * variables without copying them.
+ * \param[out] cls User-defined closure.
+ * \param[out] name Current iterated variable name.
+ * \param[out] val Current iterated variable value, pointing into the path
+ * (not null-terminated) or `NULL` if the variable did not participate in the
+ * match.
+ * \param[out] len Length of the value.
+ * \retval 0 Success.
+ * \retval E<ERROR> User-defined error to stop the variables iteration.
+ */
+typedef int (*sg_vars_iter2_cb)(void *cls, const char *name, const char *val,
+                                size_t len);
+
 /**
  * Callback signature used to handle the path routing.
  * \param[out] cls User-defined closure.
@@ -1940,10 +2459,12 @@ typedef int (*sg_routes_iter_cb)(void *cls, struct sg_route *route);
 SG_EXTERN void *sg_route_handle(struct sg_route *route);
 
 /**
- * Returns the PCRE2 match data created from the route pattern.
+ * Returns the PCRE2 match data of the current dispatch.
  * \param[in] route Route handle.
  * \return PCRE2 match data.
  * \retval NULL If \pr{route} is null and set the `errno` to `EINVAL`.
+ * \note The match data is only available inside the #sg_router_match_cb and
+ * #sg_route_cb callbacks, it belongs to the dispatching thread.
  */
 SG_EXTERN void *sg_route_match(struct sg_route *route);
 
@@ -2000,6 +2521,62 @@ SG_EXTERN int sg_route_segments_iter(struct sg_route *route,
 SG_EXTERN int sg_route_vars_iter(struct sg_route *route, sg_vars_iter_cb cb,
                                  void *cls);
 
+/**
+ * Iterates over path segments without allocating memory.
+ * \param[in] route Route handle.
+ * \param[in] cb Callback to iterate the path segments.
+ * \param[in,out] cls User-specified value.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \return Callback result when it is different from `0`.
+ * \note The segments point into the path and are valid only while the route
+ * is being dispatched.
+ */
+SG_EXTERN int sg_route_segments_iter2(struct sg_route *route,
+                                      sg_segments_iter2_cb cb, void *cls);
+
+/**
+ * Iterates over path variables without allocating memory.
+ * \param[in] route Route handle.
+ * \param[in] cb Callback to iterate the path variables.
+ * \param[in,out] cls User-specified value.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \return Callback result when it is different from `0`.
+ * \note The values point into the path and are valid only while the route is
+ * being dispatched.
+ */
+SG_EXTERN int sg_route_vars_iter2(struct sg_route *route, sg_vars_iter2_cb cb,
+                                  void *cls);
+
+/**
+ * Gets a path segment by its index without allocating memory.
+ * \param[in] route Route handle.
+ * \param[in] index Segment index, starting from `0`.
+ * \param[out] segment Segment pointing into the path (not null-terminated).
+ * \param[out] len Length of the segment.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOENT Segment not found or not set by the match.
+ */
+SG_EXTERN int sg_route_segment(struct sg_route *route, unsigned int index,
+                               const char **segment, size_t *len);
+
+/**
+ * Gets a path variable by its name without allocating memory.
+ * \param[in] route Route handle.
+ * \param[in] name Variable name.
+ * \param[out] val Value pointing into the path (not null-terminated).
+ * \param[out] len Length of the value.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOENT Variable not found or not set by the match.
+ * \note The name is looked up directly in the compiled pattern, so no
+ * iteration over the name table is performed.
+ */
+SG_EXTERN int sg_route_var(struct sg_route *route, const char *name,
+                           const char **val, size_t *len);
+
 /**
  * Gets user data from the route handle.
  * \param[in] route Route handle.
@@ -2008,6 +2585,46 @@ SG_EXTERN int sg_route_vars_iter(struct sg_route *route, sg_vars_iter_cb cb,
  */
 SG_EXTERN void *sg_route_user_data(struct sg_route *route);
 
+/**
+ * Gets the HTTP methods served by the route.
+ * \param[in] route Route handle.
+ * \return Method flags, e.g. `SG_METHOD_GET | SG_METHOD_HEAD`.
+ * \retval 0 If \pr{route} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN unsigned int sg_route_methods(struct sg_route *route);
+
+/** Number of buckets in the latency histogram of #sg_route_stats. */
+#define SG_ROUTE_STATS_BUCKETS 32
+
+/**
+ * Counters of a route recorded by the router when its stats are enabled by
+ * #sg_router_set_stats().
+ * \struct sg_route_stats
+ */
+struct sg_route_stats {
+  /** Number of dispatches handled by the route. */
+  uint64_t hits;
+  /** Number of failed matches of other routes before matching the route. */
+  uint64_t misses;
+  /** Cumulative time spent in the route callback, in nanoseconds. */
+  uint64_t time;
+  /** Latency histogram, where the bucket `i` counts the callbacks taking from
+   * `2^i` to `2^(i+1)-1` nanoseconds. The last bucket also counts the slower
+   * ones. */
+  uint64_t buckets[SG_ROUTE_STATS_BUCKETS];
+};
+
+/**
+ * Gets the counters of the route aggregated from all threads.
+ * \param[in] route Route handle.
+ * \param[out] stats Pointer to store the counters.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \note The counters are zeroed if no router has enabled the stats.
+ */
+SG_EXTERN int sg_route_stats(struct sg_route *route,
+                             struct sg_route_stats *stats);
+
 /**
  * Adds a route item to the route list \pr{routes}.
  * \param[in,out] routes Route list pointer to add a new route item.
@@ -2033,6 +2650,33 @@ SG_EXTERN int sg_routes_add2(struct sg_route **routes, struct sg_route **route,
                              const char *pattern, char *errmsg, size_t errlen,
                              sg_route_cb cb, void *cls);
 
+/**
+ * Adds a route item serving only the HTTP methods in \pr{methods} to the
+ * route list \pr{routes}.
+ * \param[in,out] routes Route list pointer to add a new route item.
+ * \param[in,out] route Pointer of the variable to store the added route
+ * reference.
+ * \param[in] pattern Pattern as a null-terminated string. It must be a valid
+ * regular expression in PCRE2 syntax.
+ * \param[in] methods Method flags, e.g. `SG_METHOD_GET | SG_METHOD_HEAD`, or
+ * #SG_METHOD_ANY.
+ * \param[in,out] errmsg Pointer of a string to store the error message.
+ * \param[in] errlen Length of the error message.
+ * \param[in] cb Callback to handle the path routing.
+ * \param[in] cls User-defined closure.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EALREADY Route already added for any of the methods.
+ * \retval ENOMEM Out of memory.
+ * \note The same pattern can be added once per method, e.g. with different
+ * callbacks for `GET` and `POST`.
+ * \note Routes are dispatched by method using #sg_router_dispatch3().
+ */
+SG_EXTERN int sg_routes_add3(struct sg_route **routes, struct sg_route **route,
+                             const char *pattern, unsigned int methods,
+                             char *errmsg, size_t errlen, sg_route_cb cb,
+                             void *cls);
+
 /**
  * Adds a route item to the route list \pr{routes}. It uses the `stderr` to
  * print the validation errors.
@@ -2054,6 +2698,88 @@ SG_EXTERN int sg_routes_add2(struct sg_route **routes, struct sg_route **route,
 SG_EXTERN bool sg_routes_add(struct sg_route **routes, const char *pattern,
                              sg_route_cb cb, void *cls);
 
+/**
+ * Route item to be added in bulk by #sg_routes_add_many() or
+ * #sg_routes_load().
+ * \struct sg_route_entry
+ */
+struct sg_route_entry {
+  /** Pattern as a null-terminated string. It must be a valid regular
+   * expression in PCRE2 syntax. */
+  const char *pattern;
+  /** Method flags, e.g. `SG_METHOD_GET | SG_METHOD_HEAD`, or
+   * #SG_METHOD_ANY. */
+  unsigned int methods;
+  /** Callback to handle the path routing. */
+  sg_route_cb cb;
+  /** User-defined closure. */
+  void *cls;
+};
+
+/**
+ * Adds several route items at once to the route list \pr{routes}. Either all
+ * the items are added or none of them.
+ * \param[in,out] routes Route list pointer to add the new route items.
+ * \param[in] entries Array of route items to be added.
+ * \param[in] count Number of items in \pr{entries}.
+ * \param[in,out] errmsg Pointer of a string to store the error message.
+ * \param[in] errlen Length of the error message.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EALREADY Route already added for any of the methods.
+ * \retval ENOMEM Out of memory.
+ * \note Duplicates are found through a hash table, so adding \e N routes takes
+ * linear time instead of the quadratic time of calling #sg_routes_add3() for
+ * each one. Only identical patterns are considered duplicates.
+ */
+SG_EXTERN int sg_routes_add_many(struct sg_route **routes,
+                                 const struct sg_route_entry *entries,
+                                 unsigned int count, char *errmsg,
+                                 size_t errlen);
+
+/**
+ * Saves the compiled patterns of the route list \pr{routes} to a file, allowing
+ * to load them later by #sg_routes_load() without compiling them again.
+ * \param[in] routes Route list handle.
+ * \param[in] path Path of the file to be written.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \retval EIO Error writing the file.
+ * \retval E<ERROR> Any other error opening the file.
+ * \note The file can be only loaded by the same library build on the same
+ * architecture, so it is suitable as a cache shared by worker processes.
+ */
+SG_EXTERN int sg_routes_save(struct sg_route *routes, const char *path);
+
+/**
+ * Adds several route items at once to the route list \pr{routes}, taking
+ * their compiled patterns from a file saved by #sg_routes_save(). The items
+ * must be the same, in the same order, as the ones in the saved route list.
+ * \param[in,out] routes Route list pointer to add the new route items.
+ * \param[in] path Path of the file to be read.
+ * \param[in] entries Array of route items to be added.
+ * \param[in] count Number of items in \pr{entries}.
+ * \param[in,out] errmsg Pointer of a string to store the error message.
+ * \param[in] errlen Length of the error message.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument, or the file does not match \pr{entries} or
+ * was saved by another library build.
+ * \retval EALREADY Route already added for any of the methods.
+ * \retval ENOMEM Out of memory.
+ * \retval EIO Error reading the file.
+ * \retval E<ERROR> Any other error opening the file.
+ * \note A failed load can be followed by #sg_routes_add_many() and
+ * #sg_routes_save() to rebuild the file.
+ * \note The patterns are still compiled using just-in-time optimization (JIT)
+ * when it is supported, since JIT code is not saved.
+ * \warning The file must be trusted, PCRE2 does not validate the compiled
+ * patterns it loads.
+ */
+SG_EXTERN int sg_routes_load(struct sg_route **routes, const char *path,
+                             const struct sg_route_entry *entries,
+                             unsigned int count, char *errmsg, size_t errlen);
+
 /**
  * Removes a route item from the route list \pr{routes}.
  * \param[in,out] routes Route list pointer to add a new route item.
@@ -2135,6 +2861,13 @@ typedef int (*sg_router_match_cb)(void *cls, struct sg_route *route);
  * \return New router handle.
  * \retval NULL If the \pr{routes} is null and set the `errno` to `EINVAL` or
  * no memory space.
+ * \note Routes made only of literals, `([^/]+)` segments and an optional
+ * trailing `(.*)`, named or not, are indexed in a radix tree, so they are
+ * dispatched in time proportional to the path length. Other routes are still
+ * matched by PCRE2, keeping the first-match order of the list.
+ * \note Routes added or removed after the router creation are indexed again
+ * in the next dispatching, which must not run concurrently with the changes.
+ * Use #sg_router_swap() to change the routes while dispatching.
  */
 SG_EXTERN struct sg_router *sg_router_new(struct sg_route *routes) __SG_MALLOC;
 
@@ -2144,6 +2877,133 @@ SG_EXTERN struct sg_router *sg_router_new(struct sg_route *routes) __SG_MALLOC;
  */
 SG_EXTERN void sg_router_free(struct sg_router *router);
 
+/**
+ * Replaces the routes of the router while it is being dispatched. The new
+ * routes are indexed before being published at once, so each dispatch uses
+ * either the previous or the new routes, without waiting for locks.
+ * \param[in] router Router handle.
+ * \param[in] routes New route list handle.
+ * \param[out] old Previous route list handle, no longer used by any
+ * dispatch when the function returns.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EDEADLK Called inside a dispatch, e.g. by a route callback.
+ * \retval ENOMEM Out of memory.
+ * \note It waits for the dispatches of the router started before the new
+ * routes were published, including their route callbacks, so the \pr{old}
+ * list can be freed by #sg_routes_cleanup().
+ * \note Once swapped, the routes must not be changed by #sg_routes_add() or
+ * #sg_routes_rm(). Build a new list and swap it instead.
+ * \note Each swapped list gets a new path cache (see #sg_router_set_cache()).
+ * \warning Concurrent swaps of the same router must be serialized by the
+ * caller.
+ * \warning It must not be called while holding a lock taken by the route
+ * callbacks, otherwise it can wait forever for them.
+ */
+SG_EXTERN int sg_router_swap(struct sg_router *router, struct sg_route *routes,
+                             struct sg_route **old);
+
+/**
+ * Enables or disables the combined matching of the router. When enabled, the
+ * routes not indexed by the radix tree are compiled into a single PCRE2
+ * alternation, so one match identifies the winning route instead of matching
+ * each route pattern separately.
+ * \param[in] router Router handle.
+ * \param[in] combined Enables the combined matching. Default: `false`.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval EDEADLK Called inside a dispatch of a swapped router.
+ * \retval ENOMEM Out of memory.
+ * \note Only anchored patterns are combined, as long as they do not refer to
+ * their groups (back-references, conditions, recursion or subroutine calls)
+ * and do not use backtracking verbs. The others are still matched one by
+ * one, keeping the first-match order of the list.
+ * \note The combined pattern is compiled in the next dispatching and again
+ * whenever routes are added or removed. Once #sg_router_swap() has been called,
+ * it is compiled at once instead and published like swapped routes, waiting
+ * for the route callbacks in flight as well.
+ * \warning Before the first #sg_router_swap(), it must not be called while the
+ * router is being dispatched.
+ */
+SG_EXTERN int sg_router_set_combined(struct sg_router *router, bool combined);
+
+/**
+ * Indicates if the combined matching is enabled in the router.
+ * \param[in] router Router handle.
+ * \return `true` if the combined matching is enabled.
+ * \retval false If the \pr{router} is null and set the `errno` to `EINVAL`.
+ */
+SG_EXTERN bool sg_router_combined(struct sg_router *router);
+
+/**
+ * Enables a cache of the dispatched paths in the router. A cached path
+ * reuses its matched route and captures, skipping the matching entirely.
+ * \param[in] router Router handle.
+ * \param[in] size Maximum number of cached paths. Use zero to disable the
+ * cache. Default: `0`.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \note The cache is bounded, evicting the least recently hit paths in
+ * approximate (CLOCK) order, and can be used by concurrent dispatches.
+ * \note Cached paths are ignored once routes are added or removed.
+ * \warning It must not be called while the router is being dispatched.
+ */
+SG_EXTERN int sg_router_set_cache(struct sg_router *router, unsigned int size);
+
+/**
+ * Gets the hit and miss counters of the router cache.
+ * \param[in] router Router handle.
+ * \param[out] hits Number of dispatches served by the cache.
+ * \param[out] misses Number of dispatches not found in the cache.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \note Dispatches using a \pr{dispatch_cb} callback or paths containing a
+ * new line skip the cache, counting neither a hit nor a miss.
+ */
+SG_EXTERN int sg_router_cache_stats(struct sg_router *router, uint64_t *hits,
+                                    uint64_t *misses);
+
+/**
+ * Enables or disables the recording of the route stats by the router.
+ * \param[in] router Router handle.
+ * \param[in] enabled Enables the route stats. Default: `false`.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ * \note The counters are kept in per-thread shards and survive disabling the
+ * stats, they are aggregated by #sg_route_stats() or #sg_router_stats_iter().
+ * \note Dispatches using a \pr{dispatch_cb} callback record the stats of
+ * routes added after enabling them only once the router indexes those routes
+ * in a dispatch without \pr{dispatch_cb}.
+ */
+SG_EXTERN int sg_router_set_stats(struct sg_router *router, bool enabled);
+
+/**
+ * Callback signature used by #sg_router_stats_iter() to iterate the route
+ * stats.
+ * \param[out] cls User-defined closure.
+ * \param[out] route Current iterated route.
+ * \param[out] stats Counters of the route.
+ * \retval 0 Success.
+ * \retval E<ERROR> User-defined error to stop the iteration.
+ */
+typedef int (*sg_router_stats_iter_cb)(void *cls, struct sg_route *route,
+                                       const struct sg_route_stats *stats);
+
+/**
+ * Iterates over the stats of all the routes of the router, e.g. to export
+ * them.
+ * \param[in] router Router handle.
+ * \param[in] cb Callback to iterate the route stats.
+ * \param[in,out] cls User-specified value.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \return Callback result when it is different from `0`.
+ */
+SG_EXTERN int sg_router_stats_iter(struct sg_router *router,
+                                   sg_router_stats_iter_cb cb, void *cls);
+
 /**
  * Dispatches a route that its pattern matches the path passed in \pr{path}.
  * \param[in] router Router handle.
@@ -2163,12 +3023,61 @@ SG_EXTERN void sg_router_free(struct sg_router *router);
  * route pattern.
  * \note The match logic uses just-in-time optimization (JIT) when it is
  * supported.
+ * \note The router can be dispatched by several threads at once. The match
+ * state (path, user data, segments and variables) lives in a copy of the
+ * matched route passed to the callbacks, using match data cached per thread.
+ * \note Since \pr{dispatch_cb} must see every route up to the matched one, it
+ * disables the radix tree index created by #sg_router_new().
  */
 SG_EXTERN int sg_router_dispatch2(struct sg_router *router, const char *path,
                                   void *user_data,
                                   sg_router_dispatch_cb dispatch_cb, void *cls,
                                   sg_router_match_cb match_cb);
 
+/**
+ * Dispatches a route serving the HTTP method \pr{method} that its pattern
+ * matches the path passed in \pr{path}. Only the routes serving the method
+ * are considered in the dispatching.
+ * \param[in] router Router handle.
+ * \param[in] method HTTP method, e.g. the #sg_httpreq_method() result. When
+ * null, the routes are dispatched regardless of their methods.
+ * \param[in] path Path to dispatch a route.
+ * \param[in] user_data User data pointer to be held by the route.
+ * \param[in] dispatch_cb Callback triggered for each route item in the route
+ * dispatching loop.
+ * \param[in] cls User-defined closure passed to the \pr{dispatch_cb} and
+ * \pr{match_cb} callbacks.
+ * \param[in] match_cb Callback triggered when the path matches the route
+ * pattern.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOENT Route not found or path not matched.
+ * \retval ENOTSUP Path matched only by routes of other methods, which can be
+ * reported to the client by #sg_router_allowed() and
+ * #sg_httpres_sendallowed().
+ * \retval E<ERROR> User-defined error in \pr{dispatch_cb} or \pr{match_cb}.
+ * \note Methods not listed in #sg_method are served only by routes added with
+ * #SG_METHOD_ANY.
+ */
+SG_EXTERN int sg_router_dispatch3(struct sg_router *router, const char *method,
+                                  const char *path, void *user_data,
+                                  sg_router_dispatch_cb dispatch_cb, void *cls,
+                                  sg_router_match_cb match_cb);
+
+/**
+ * Gets the HTTP methods served by the routes matching the path passed in
+ * \pr{path}, e.g. to fill the `Allow` header.
+ * \param[in] router Router handle.
+ * \param[in] path Path to match the routes.
+ * \param[out] methods Method flags served for the path, or `0` if no route
+ * matches it.
+ * \retval 0 Success.
+ * \retval EINVAL Invalid argument.
+ * \retval ENOMEM Out of memory.
+ */
+SG_EXTERN int sg_router_allowed(struct sg_router *router, const char *path,
+                                unsigned int *methods);
+
 /**
  * Dispatches a route that its pattern matches the path passed in \pr{path}.
  * \param[in] router Router handle.
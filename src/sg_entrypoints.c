@@ -25,70 +25,286 @@
  */
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
 #include <errno.h>
 #include "sg_macros.h"
 #include "sg_entrypoint.h"
+#include "sg_rcu.h"
 #include "sg_entrypoints.h"
 #include "sagui.h"
 
+#define SG__ENTRYPOINTS_MAX_SEED (1U << 24)
+
+/* Drops the perfect hash once the list changes. */
+static void sg__entrypoints_thaw(struct sg_entrypoints *entrypoints) {
+  sg_free(entrypoints->seeds);
+  sg_free(entrypoints->slots);
+  entrypoints->seeds = NULL;
+  entrypoints->slots = NULL;
+}
+
+/* Gets the position of `name` in the list, or where it would be inserted. */
+static unsigned int sg__entrypoints_bound(struct sg_entrypoints *entrypoints,
+                                          const char *name, bool *found) {
+  unsigned int lo = 0, hi = entrypoints->count, mid;
+  int ret;
+  *found = false;
+  while (lo < hi) {
+    mid = lo + ((hi - lo) >> 1);
+    ret = strcmp(entrypoints->list[mid].name, name);
+    if (ret == 0) {
+      *found = true;
+      return mid;
+    }
+    if (ret < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Gets the capacity for `count` items, doubling the current one. */
+static unsigned int sg__entrypoints_capacity(struct sg_entrypoints *entrypoints,
+                                             unsigned int count) {
+  unsigned int size = (entrypoints->size > 0) ? entrypoints->size : 8;
+  while ((size < count) && (size <= (UINT_MAX >> 1)))
+    size <<= 1;
+  return (size < count) ? count : size;
+}
+
 static int sg__entrypoints_add(struct sg_entrypoints *entrypoints,
                                struct sg_entrypoint *entrypoint,
                                void *user_data) {
   struct sg_entrypoint *list;
-  if (bsearch(entrypoint, entrypoints->list, entrypoints->count,
-              sizeof(struct sg_entrypoint), sg__entrypoint_cmp))
+  unsigned int i, size;
+  bool found;
+  i = sg__entrypoints_bound(entrypoints, entrypoint->name, &found);
+  if (found)
     return EALREADY;
-  list = sg_realloc(entrypoints->list,
-                    (entrypoints->count + 1) * sizeof(struct sg_entrypoint));
-  if (!list) {
-    sg_entrypoints_free(entrypoints);
-    return ENOMEM;
+  if (entrypoints->count == entrypoints->size) {
+    if (entrypoints->count == UINT_MAX)
+      return ENOMEM;
+    size = sg__entrypoints_capacity(entrypoints, entrypoints->count + 1);
+    list = sg_realloc(entrypoints->list, size * sizeof(struct sg_entrypoint));
+    if (!list)
+      return ENOMEM;
+    entrypoints->list = list;
+    entrypoints->size = size;
   }
-  entrypoints->list = list;
-  sg__entrypoint_prepare(entrypoints->list + entrypoints->count++,
-                         entrypoint->name, user_data);
-  qsort(entrypoints->list, entrypoints->count, sizeof(struct sg_entrypoint),
-        sg__entrypoint_cmp);
+  sg__entrypoints_thaw(entrypoints);
+  memmove(entrypoints->list + i + 1, entrypoints->list + i,
+          (entrypoints->count - i) * sizeof(struct sg_entrypoint));
+  sg__entrypoint_prepare(entrypoints->list + i, entrypoint->name, user_data);
+  entrypoints->count++;
   return 0;
 }
 
 static int sg__entrypoints_rm(struct sg_entrypoints *entrypoints,
                               const char *name) {
   struct sg_entrypoint *entrypoint;
-  for (unsigned int i = 0; i < entrypoints->count; i++) {
-    entrypoint = entrypoints->list + i;
-    if (strcmp(entrypoint->name, name) == 0) {
-      entrypoints->count--;
-      sg_free(entrypoint->name);
-      memcpy(entrypoint, entrypoint + 1,
-             (entrypoints->count - i) * sizeof(struct sg_entrypoint));
-      entrypoint = sg_realloc(
-        entrypoints->list, entrypoints->count * sizeof(struct sg_entrypoint));
-      entrypoints->list = entrypoint ? entrypoint : NULL;
-      return 0;
+  unsigned int i;
+  bool found;
+  i = sg__entrypoints_bound(entrypoints, name, &found);
+  if (!found)
+    return ENOENT;
+  sg__entrypoints_thaw(entrypoints);
+  entrypoint = entrypoints->list + i;
+  sg_free(entrypoint->name);
+  entrypoints->count--;
+  memmove(entrypoint, entrypoint + 1,
+          (entrypoints->count - i) * sizeof(struct sg_entrypoint));
+  return 0;
+}
+
+/* Merges the sorted `batch` into a new list allocated at once. */
+static int sg__entrypoints_merge(struct sg_entrypoints *entrypoints,
+                                 struct sg_entrypoint *batch,
+                                 unsigned int count) {
+  struct sg_entrypoint *list;
+  unsigned int i = 0, j = 0, k = 0, size;
+  int ret;
+  size = sg__entrypoints_capacity(entrypoints, entrypoints->count + count);
+  list = sg_malloc(size * sizeof(struct sg_entrypoint));
+  if (!list)
+    return ENOMEM;
+  while ((i < entrypoints->count) && (j < count)) {
+    ret = strcmp(entrypoints->list[i].name, batch[j].name);
+    if (ret == 0) {
+      sg_free(list);
+      return EALREADY;
     }
+    list[k++] = (ret < 0) ? entrypoints->list[i++] : batch[j++];
   }
-  return ENOENT;
+  while (i < entrypoints->count)
+    list[k++] = entrypoints->list[i++];
+  while (j < count)
+    list[k++] = batch[j++];
+  sg_free(entrypoints->list);
+  entrypoints->list = list;
+  entrypoints->count = k;
+  entrypoints->size = size;
+  sg__entrypoints_thaw(entrypoints);
+  return 0;
+}
+
+/* Compares the entry-point name, e.g. `/foo`, to the path segment `foo`. */
+static int sg__entrypoints_cmp(const char *name, const char *segment,
+                               size_t len) {
+  int ret = strncmp(name + 1, segment, len);
+  return (ret != 0) ? ret : (unsigned char) name[len + 1];
+}
+
+/* FNV-1a of the path segment, seeded and mixed for the perfect hash. */
+static uint32_t sg__entrypoints_hash(uint32_t seed, const char *segment,
+                                     size_t len) {
+  uint32_t hash = 2166136261U ^ (seed * 0x9e3779b9U);
+  while (len-- > 0) {
+    hash ^= (unsigned char) *segment++;
+    hash *= 16777619U;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bU;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35U;
+  hash ^= hash >> 16;
+  return hash;
 }
 
 static int sg__entrypoints_find(struct sg_entrypoints *entrypoints,
-                                struct sg_entrypoint *key,
+                                const char *segment, size_t len,
                                 struct sg_entrypoint **entrypoint) {
-  if ((entrypoints->count > 0)) {
-    *entrypoint = bsearch(key, entrypoints->list, entrypoints->count,
-                          sizeof(struct sg_entrypoint), sg__entrypoint_cmp);
-    if (*entrypoint)
+  unsigned int lo = 0, hi = entrypoints->count, mid, i;
+  int ret;
+  *entrypoint = NULL;
+  if (entrypoints->count == 0)
+    return ENOENT;
+  if (entrypoints->slots) {
+    i = sg__entrypoints_hash(0, segment, len) % entrypoints->count;
+    i = entrypoints->slots[sg__entrypoints_hash(entrypoints->seeds[i], segment,
+                                                len) %
+                           entrypoints->count];
+    if (sg__entrypoints_cmp(entrypoints->list[i].name, segment, len) != 0)
+      return ENOENT;
+    *entrypoint = entrypoints->list + i;
+    return 0;
+  }
+  while (lo < hi) {
+    mid = lo + ((hi - lo) >> 1);
+    ret = sg__entrypoints_cmp(entrypoints->list[mid].name, segment, len);
+    if (ret == 0) {
+      *entrypoint = entrypoints->list + mid;
       return 0;
+    }
+    if (ret < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  *entrypoint = NULL;
   return ENOENT;
 }
 
+/* Places the names of a bucket in free slots, trying seeds until the hashes
+   of all of them fall in distinct free slots. */
+static bool sg__entrypoints_place(struct sg_entrypoints *entrypoints,
+                                  const unsigned int *keys, unsigned int size,
+                                  uint32_t *seed) {
+  const char *name;
+  unsigned int i, j, pos;
+  for (*seed = 1; *seed < SG__ENTRYPOINTS_MAX_SEED; (*seed)++) {
+    for (i = 0; i < size; i++) {
+      name = entrypoints->list[keys[i]].name + 1;
+      pos = sg__entrypoints_hash(*seed, name, strlen(name)) %
+            entrypoints->count;
+      if (entrypoints->slots[pos] != UINT_MAX)
+        break;
+      entrypoints->slots[pos] = keys[i];
+    }
+    if (i == size)
+      return true;
+    for (j = 0; j < i; j++) {
+      name = entrypoints->list[keys[j]].name + 1;
+      pos = sg__entrypoints_hash(*seed, name, strlen(name)) %
+            entrypoints->count;
+      entrypoints->slots[pos] = UINT_MAX;
+    }
+  }
+  return false;
+}
+
+/* Copies the list, the perfect hash and the names in a single block. */
+static struct sg_entrypoints *sg__entrypoints_copy(
+  struct sg_entrypoints *entrypoints) {
+  struct sg_entrypoints *snap;
+  unsigned int count = entrypoints->count, i;
+  size_t size, len;
+  char *names;
+  size = sizeof(struct sg_entrypoints) + (count * sizeof(struct sg_entrypoint));
+  if (entrypoints->slots)
+    size += count * (sizeof(uint32_t) + sizeof(unsigned int));
+  for (i = 0; i < count; i++)
+    size += strlen(entrypoints->list[i].name) + 1;
+  snap = sg_alloc(size);
+  if (!snap)
+    return NULL;
+  snap->count = count;
+  snap->list = (struct sg_entrypoint *) (snap + 1);
+  names = (char *) (snap->list + count);
+  if (entrypoints->slots) {
+    snap->seeds = memcpy(names, entrypoints->seeds, count * sizeof(uint32_t));
+    snap->slots = memcpy(snap->seeds + count, entrypoints->slots,
+                         count * sizeof(unsigned int));
+    names = (char *) (snap->slots + count);
+  }
+  for (i = 0; i < count; i++) {
+    len = strlen(entrypoints->list[i].name) + 1;
+    snap->list[i].name = memcpy(names, entrypoints->list[i].name, len);
+    snap->list[i].user_data = entrypoints->list[i].user_data;
+    names += len;
+  }
+  return snap;
+}
+
+/* Publishes a copy of the entry-points to the readers, then frees the
+   previous one once no reader can be using it. */
+static int sg__entrypoints_publish(struct sg_entrypoints *entrypoints,
+                                   struct sg_entrypoints *snap) {
+  struct sg_entrypoints *prev = entrypoints->snap;
+  int errnum = sg__rcu_sync_begin();
+  if (errnum != 0) {
+    sg_free(snap);
+    return errnum;
+  }
+  sg__rcu_assign(entrypoints->snap, snap);
+  sg__rcu_sync_end();
+  sg_free(prev);
+  return 0;
+}
+
+/* Publishes the changes made by a writer in the snapshots mode. */
+static int sg__entrypoints_commit(struct sg_entrypoints *entrypoints) {
+  struct sg_entrypoints *snap;
+  if (!entrypoints->snapshots)
+    return 0;
+  snap = sg__entrypoints_copy(entrypoints);
+  if (!snap)
+    return ENOMEM;
+  return sg__entrypoints_publish(entrypoints, snap);
+}
+
 struct sg_entrypoints *sg_entrypoints_new(void) {
   return sg_alloc(sizeof(struct sg_entrypoints));
 }
 
 void sg_entrypoints_free(struct sg_entrypoints *entrypoints) {
+  if (!entrypoints)
+    return;
+  sg_free(entrypoints->snap);
+  entrypoints->snap = NULL;
+  entrypoints->snapshots = false;
   sg_entrypoints_clear(entrypoints);
   sg_free(entrypoints);
 }
@@ -103,8 +319,54 @@ int sg_entrypoints_add(struct sg_entrypoints *entrypoints, const char *path,
   if (!entrypoint.name)
     return ENOMEM;
   ret = sg__entrypoints_add(entrypoints, &entrypoint, user_data);
-  if (ret != 0)
+  if (ret != 0) {
     sg_free(entrypoint.name);
+    return ret;
+  }
+  return sg__entrypoints_commit(entrypoints);
+}
+
+int sg_entrypoints_add_many(struct sg_entrypoints *entrypoints,
+                            const struct sg_entrypoint_entry *entries,
+                            unsigned int count) {
+  struct sg_entrypoint *batch;
+  unsigned int i, n;
+  int ret = 0;
+  if (!entrypoints || !entries)
+    return EINVAL;
+  for (i = 0; i < count; i++)
+    if (!entries[i].path)
+      return EINVAL;
+  if (count == 0)
+    return 0;
+  if (count > (UINT_MAX - entrypoints->count))
+    return ENOMEM;
+  batch = sg_malloc(count * sizeof(struct sg_entrypoint));
+  if (!batch)
+    return ENOMEM;
+  for (n = 0; n < count; n++) {
+    batch[n].name = sg_extract_entrypoint(entries[n].path);
+    if (!batch[n].name) {
+      ret = ENOMEM;
+      goto error;
+    }
+    batch[n].user_data = entries[n].user_data;
+  }
+  qsort(batch, count, sizeof(struct sg_entrypoint), sg__entrypoint_cmp);
+  for (i = 1; i < count; i++)
+    if (strcmp(batch[i - 1].name, batch[i].name) == 0) {
+      ret = EALREADY;
+      goto error;
+    }
+  ret = sg__entrypoints_merge(entrypoints, batch, count);
+  if (ret != 0)
+    goto error;
+  sg_free(batch);
+  return sg__entrypoints_commit(entrypoints);
+error:
+  while (n-- > 0)
+    sg_free(batch[n].name);
+  sg_free(batch);
   return ret;
 }
 
@@ -118,14 +380,26 @@ int sg_entrypoints_rm(struct sg_entrypoints *entrypoints, const char *path) {
     return ENOMEM;
   ret = sg__entrypoints_rm(entrypoints, name);
   sg_free(name);
-  return ret;
+  if (ret != 0)
+    return ret;
+  return sg__entrypoints_commit(entrypoints);
 }
 
 int sg_entrypoints_iter(struct sg_entrypoints *entrypoints,
                         sg_entrypoints_iter_cb cb, void *cls) {
+  struct sg_entrypoints *snap;
   int ret;
   if (!entrypoints || !cb)
     return EINVAL;
+  if (sg__rcu_dereference(entrypoints->snap)) {
+    ret = sg__rcu_read_lock();
+    if (ret != 0)
+      return ret;
+    snap = sg__rcu_dereference(entrypoints->snap);
+    ret = snap ? sg_entrypoints_iter(snap, cb, cls) : 0;
+    sg__rcu_read_unlock();
+    return ret;
+  }
   for (unsigned int i = 0; i < entrypoints->count; i++) {
     ret = cb(cls, entrypoints->list + i);
     if (ret != 0)
@@ -142,19 +416,125 @@ int sg_entrypoints_clear(struct sg_entrypoints *entrypoints) {
   sg_free(entrypoints->list);
   entrypoints->list = NULL;
   entrypoints->count = 0;
-  return 0;
+  entrypoints->size = 0;
+  sg__entrypoints_thaw(entrypoints);
+  return sg__entrypoints_commit(entrypoints);
 }
 
 int sg_entrypoints_find(struct sg_entrypoints *entrypoints,
                         struct sg_entrypoint **entrypoint, const char *path) {
-  struct sg_entrypoint key;
+  struct sg_entrypoints *snap;
   int ret;
   if (!entrypoints || !entrypoint || !path)
     return EINVAL;
-  key.name = sg_extract_entrypoint(path);
-  if (!key.name)
-    return ENOMEM;
-  ret = sg__entrypoints_find(entrypoints, &key, entrypoint);
-  sg_free(key.name);
-  return ret;
+  /* the segment is taken as sg_extract_entrypoint() does, but in place */
+  while (*path == '/')
+    path++;
+  if (sg__rcu_dereference(entrypoints->snap)) {
+    ret = sg__rcu_read_lock();
+    if (ret != 0)
+      return ret;
+    snap = sg__rcu_dereference(entrypoints->snap);
+    ret = snap ? sg__entrypoints_find(snap, path, strcspn(path, "/"),
+                                      entrypoint)
+               : ENOENT;
+    sg__rcu_read_unlock();
+    return ret;
+  }
+  return sg__entrypoints_find(entrypoints, path, strcspn(path, "/"),
+                              entrypoint);
+}
+
+/* Builds a hash-and-displace minimal perfect hash: names are grouped in
+   buckets by a first hash, then the buckets, largest first, get a seed
+   placing all their names in free slots. */
+int sg_entrypoints_freeze(struct sg_entrypoints *entrypoints) {
+  unsigned int *starts, *keys, *next, count, i, size, max = 0;
+  const char *name;
+  int ret = 0;
+  if (!entrypoints)
+    return EINVAL;
+  sg__entrypoints_thaw(entrypoints);
+  count = entrypoints->count;
+  if (count == 0)
+    return 0;
+  entrypoints->seeds = sg_alloc(count * sizeof(uint32_t));
+  entrypoints->slots = sg_malloc(count * sizeof(unsigned int));
+  starts = sg_alloc((count + 1) * sizeof(unsigned int));
+  keys = sg_malloc(count * sizeof(unsigned int));
+  next = sg_malloc(count * sizeof(unsigned int));
+  if (!entrypoints->seeds || !entrypoints->slots || !starts || !keys ||
+      !next) {
+    ret = ENOMEM;
+    goto done;
+  }
+  /* counting sort of the names by bucket */
+  for (i = 0; i < count; i++) {
+    name = entrypoints->list[i].name + 1;
+    next[i] = sg__entrypoints_hash(0, name, strlen(name)) % count;
+    starts[next[i] + 1]++;
+  }
+  for (i = 0; i < count; i++) {
+    size = starts[i + 1];
+    if (size > max)
+      max = size;
+    starts[i + 1] += starts[i];
+  }
+  /* the slots are free yet, use them as the bucket cursors */
+  memcpy(entrypoints->slots, starts, count * sizeof(unsigned int));
+  for (i = 0; i < count; i++)
+    keys[entrypoints->slots[next[i]]++] = i;
+  memset(entrypoints->slots, 0xff, count * sizeof(unsigned int));
+  for (size = max; size > 0; size--)
+    for (i = 0; i < count; i++) {
+      if ((starts[i + 1] - starts[i]) != size)
+        continue;
+      if (!sg__entrypoints_place(entrypoints, keys + starts[i], size,
+                                 &entrypoints->seeds[i])) {
+        ret = EAGAIN;
+        goto done;
+      }
+    }
+done:
+  sg_free(next);
+  sg_free(keys);
+  sg_free(starts);
+  if (ret != 0) {
+    sg__entrypoints_thaw(entrypoints);
+    return ret;
+  }
+  return sg__entrypoints_commit(entrypoints);
+}
+
+int sg_entrypoints_set_snapshots(struct sg_entrypoints *entrypoints,
+                                 bool enabled) {
+  struct sg_entrypoints *snap = NULL;
+  int errnum;
+  if (!entrypoints)
+    return EINVAL;
+  if (entrypoints->snapshots == enabled)
+    return 0;
+  if (enabled) {
+    snap = sg__entrypoints_copy(entrypoints);
+    if (!snap)
+      return ENOMEM;
+  }
+  errnum = sg__entrypoints_publish(entrypoints, snap);
+  if (errnum != 0)
+    return errnum;
+  entrypoints->snapshots = enabled;
+  return 0;
+}
+
+int sg_entrypoints_read_lock(struct sg_entrypoints *entrypoints) {
+  if (!entrypoints)
+    return EINVAL;
+  return sg__rcu_read_lock();
+}
+
+int sg_entrypoints_read_unlock(struct sg_entrypoints *entrypoints) {
+  if (!entrypoints)
+    return EINVAL;
+  sg__rcu_read_unlock();
+  return 0;
 }
@@ -27,12 +27,23 @@
 #ifndef SG_ENTRYPOINTS_H
 #define SG_ENTRYPOINTS_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "sg_entrypoint.h"
 #include "sagui.h"
 
 struct sg_entrypoints {
+  /* sorted by name, with room for `size` items */
   struct sg_entrypoint *list;
   unsigned int count;
+  unsigned int size;
+  /* minimal perfect hash of the names built by #sg_entrypoints_freeze(): the
+     seed of each bucket and the list index of each slot */
+  uint32_t *seeds;
+  unsigned int *slots;
+  /* self-contained copy looked up by the readers in the snapshots mode */
+  struct sg_entrypoints *snap;
+  bool snapshots;
 };
 
 #endif /* SG_ENTRYPOINTS_H */
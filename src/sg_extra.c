@@ -25,10 +25,12 @@
  */
 
 #include <stdbool.h>
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
 #include "sg_macros.h"
 #ifdef SG_HTTP_COMPRESSION
+#include <pthread.h>
 #include "zlib.h"
 #endif /* SG_HTTP_COMPRESSION */
 #include "microhttpd.h"
@@ -42,6 +44,42 @@ enum MHD_Result sg__convals_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind,
   return MHD_YES;
 }
 
+struct sg__convals_holder {
+  struct sg_strmap **map;
+  struct sg_strmap *pair;
+};
+
+static enum MHD_Result
+  sg__convals_view_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind,
+                        const char *key, const char *val) {
+  struct sg__convals_holder *holder = cls;
+  if (key && val)
+    sg__strmap_borrow(holder->map, holder->pair++, key, val);
+  return MHD_YES;
+}
+
+/* Fills the map with pairs borrowing the connection values, which live as
+   long as the request. Returns the block holding the pairs. */
+struct sg_strmap *sg__convals_view(struct MHD_Connection *con,
+                                   enum MHD_ValueKind kind,
+                                   struct sg_strmap **map) {
+  struct sg__convals_holder holder;
+  struct sg_strmap *pairs;
+  int count;
+  if (!con || !map)
+    return NULL;
+  count = MHD_get_connection_values(con, kind, NULL, NULL);
+  if (count <= 0)
+    return NULL;
+  pairs = sg_alloc((size_t) count * sizeof(struct sg_strmap));
+  if (!pairs)
+    return NULL;
+  holder.map = map;
+  holder.pair = pairs;
+  MHD_get_connection_values(con, kind, sg__convals_view_iter, &holder);
+  return pairs;
+}
+
 int sg__strmap_iter(void *cls, struct sg_strmap *header) {
   MHD_add_response_header(cls, header->name, header->val);
   return 0;
@@ -67,66 +105,549 @@ void sg__zfree(__SG_UNUSED voidpf opaque, voidpf ptr) {
   sg_free(ptr);
 }
 
+/* Deflate stream kept initialized between compressions. */
+struct sg__zentry {
+  z_stream stream;
+  int level;
+  int wbits;
+};
+
+/* Idle streams of the calling thread. A stream taken by a response may be
+   given back by another thread, which then keeps it, so no entry is ever
+   shared between threads. */
+struct sg__zpool {
+  struct sg__zentry *idle[SG__ZPOOL_SIZE];
+  unsigned int count;
+};
+
+static pthread_once_t sg__zpool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t sg__zpool_key;
+static int sg__zpool_key_err;
+
+static void sg__zentry_free(struct sg__zentry *entry) {
+  deflateEnd(&entry->stream);
+  sg_free(entry);
+}
+
+static void sg__zpool_free(void *cls) {
+  struct sg__zpool *pool = cls;
+  while (pool->count > 0)
+    sg__zentry_free(pool->idle[--pool->count]);
+  sg_free(pool);
+}
+
+static void sg__zpool_key_new(void) {
+  sg__zpool_key_err = pthread_key_create(&sg__zpool_key, sg__zpool_free);
+}
+
+static struct sg__zpool *sg__zpool(void) {
+  struct sg__zpool *pool;
+  if ((pthread_once(&sg__zpool_once, sg__zpool_key_new) != 0) ||
+      (sg__zpool_key_err != 0))
+    return NULL;
+  pool = pthread_getspecific(sg__zpool_key);
+  if (pool)
+    return pool;
+  pool = sg_alloc(sizeof(struct sg__zpool));
+  if (!pool)
+    return NULL;
+  if (pthread_setspecific(sg__zpool_key, pool) != 0) {
+    sg_free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+int sg__zpool_get(int level, int wbits, z_stream **stream) {
+  struct sg__zpool *pool = sg__zpool();
+  struct sg__zentry *entry;
+  unsigned int i;
+  int errnum;
+  if (level == Z_DEFAULT_COMPRESSION)
+    level = 6;
+  for (i = pool ? pool->count : 0; i-- > 0;) {
+    entry = pool->idle[i];
+    if ((entry->level != level) || (entry->wbits != wbits))
+      continue;
+    pool->idle[i] = pool->idle[--pool->count];
+    if (deflateReset(&entry->stream) == Z_OK) {
+      *stream = &entry->stream;
+      return Z_OK;
+    }
+    sg__zentry_free(entry);
+    break;
+  }
+  entry = sg_malloc(sizeof(struct sg__zentry));
+  if (!entry)
+    return Z_MEM_ERROR;
+  entry->stream.zalloc = sg__zalloc;
+  entry->stream.zfree = sg__zfree;
+  entry->stream.opaque = Z_NULL;
+  errnum = deflateInit2(&entry->stream, level, Z_DEFLATED, wbits,
+                        MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+  if (errnum != Z_OK) {
+    sg_free(entry);
+    return errnum;
+  }
+  entry->level = level;
+  entry->wbits = wbits;
+  *stream = &entry->stream;
+  return Z_OK;
+}
+
+void sg__zpool_put(z_stream *stream) {
+  struct sg__zpool *pool;
+  if (!stream)
+    return;
+  pool = sg__zpool();
+  if (!pool || (pool->count >= SG__ZPOOL_SIZE)) {
+    sg__zentry_free((struct sg__zentry *) stream);
+    return;
+  }
+  pool->idle[pool->count++] = (struct sg__zentry *) stream;
+}
+
 int sg__zcompress(z_const Bytef *src, uLong src_size, Bytef *dest,
-                  uLongf *dest_size, int level) {
+                  uLongf *dest_size, int level, int wbits) {
   z_const uInt max = (uInt) -1;
-  z_stream stream;
+  z_stream *stream;
   uLong left;
   int errnum;
   left = *dest_size;
   *dest_size = 0;
-  stream.zalloc = sg__zalloc;
-  stream.zfree = sg__zfree;
-  stream.opaque = Z_NULL;
-  errnum = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL,
-                        Z_DEFAULT_STRATEGY);
+  errnum = sg__zpool_get(level, wbits, &stream);
   if (errnum != Z_OK)
     return errnum;
-  stream.next_out = dest;
-  stream.avail_out = 0;
-  stream.next_in = src;
-  stream.avail_in = 0;
+  stream->next_out = dest;
+  stream->avail_out = 0;
+  stream->next_in = src;
+  stream->avail_in = 0;
   do {
-    if (stream.avail_out == 0) {
-      stream.avail_out = left > (uLong) max ? max : (uInt) left;
-      left -= stream.avail_out;
+    if (stream->avail_out == 0) {
+      stream->avail_out = left > (uLong) max ? max : (uInt) left;
+      left -= stream->avail_out;
     }
-    if (stream.avail_in == 0) {
-      stream.avail_in = src_size > (uLong) max ? max : (uInt) src_size;
-      src_size -= stream.avail_in;
+    if (stream->avail_in == 0) {
+      stream->avail_in = src_size > (uLong) max ? max : (uInt) src_size;
+      src_size -= stream->avail_in;
     }
-    errnum = deflate(&stream, src_size ? Z_NO_FLUSH : Z_FINISH);
+    errnum = deflate(stream, src_size ? Z_NO_FLUSH : Z_FINISH);
   } while (errnum == Z_OK);
-  *dest_size = stream.total_out;
-  deflateEnd(&stream);
+  *dest_size = stream->total_out;
+  sg__zpool_put(stream);
   return errnum == Z_STREAM_END ? Z_OK : errnum;
 }
 
-int sg__zdeflate(z_stream *stream, Bytef *zbuf, int flush, z_const Bytef *src,
-                 uInt src_size, Bytef **dest, z_size_t *dest_size) {
-  uLong have;
+int sg__zdeflate(z_stream *stream, const Bytef **next_in, size_t *avail_in,
+                 bool finish, Bytef *dest, size_t *dest_size, bool *finished) {
   int errnum;
-  stream->avail_in = src_size;
-  stream->next_in = src;
-  *dest = Z_NULL;
-  *dest_size = 0;
-  do {
-    stream->avail_out = SG__ZLIB_CHUNK;
-    stream->next_out = zbuf;
-    errnum = deflate(stream, flush);
-    if (errnum < Z_OK) {
-      sg_free(*dest);
-      *dest = Z_NULL;
-      return errnum;
+  stream->next_in = (Bytef *) *next_in;
+  stream->avail_in = (uInt) *avail_in;
+  stream->next_out = dest;
+  stream->avail_out = *dest_size > UINT_MAX ? UINT_MAX : (uInt) *dest_size;
+  *dest_size = stream->avail_out;
+  errnum = deflate(stream, finish ? Z_FINISH : Z_NO_FLUSH);
+  if ((errnum != Z_OK) && (errnum != Z_STREAM_END) && (errnum != Z_BUF_ERROR))
+    return errnum;
+  *next_in = stream->next_in;
+  *avail_in = stream->avail_in;
+  *dest_size -= stream->avail_out;
+  *finished = errnum == Z_STREAM_END;
+  return 0;
+}
+
+/* deflate window, the largest dictionary a block can be primed with */
+#define SG__PGZ_DICT_SIZE 32768
+
+enum sg__pgz_state {
+  SG__PGZ_FREE,
+  SG__PGZ_QUEUED,
+  SG__PGZ_RUNNING,
+  SG__PGZ_DONE,
+  SG__PGZ_FAILED
+};
+
+/* Block of the stream; `in` holds the dictionary followed by the block. */
+struct sg__pgz_job {
+  Bytef *in;
+  Bytef *out;
+  size_t dict_len;
+  size_t in_len;
+  size_t out_len;
+  size_t out_pos;
+  uLong crc;
+  bool last;
+  enum sg__pgz_state state;
+};
+
+/* Blocks are used as a ring: the caller fills them at `fill` and writes their
+   output at `head`, while the workers deflate them at `next`. The states are
+   guarded by `mutex`. */
+struct sg__pgz {
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  pthread_t *workers;
+  struct sg__pgz_job *jobs;
+  unsigned int nworkers;
+  unsigned int njobs;
+  unsigned int head;
+  unsigned int fill;
+  unsigned int next;
+  size_t out_size;
+  int level;
+  bool stop;
+  bool filling;
+  bool started;
+  bool queued_last;
+  bool ended;
+  /* gzip header or trailer pending to be written */
+  Bytef wrap[10];
+  size_t wrap_len;
+  size_t wrap_pos;
+  uLong crc;
+  uLong isize;
+};
+
+static int sg__pgz_deflate(z_stream *stream, struct sg__pgz_job *job,
+                           size_t out_size) {
+  int ret;
+  if (deflateReset(stream) != Z_OK)
+    return EIO;
+  if ((job->dict_len > 0) &&
+      (deflateSetDictionary(stream, job->in, (uInt) job->dict_len) != Z_OK))
+    return EIO;
+  stream->next_in = job->in + job->dict_len;
+  stream->avail_in = (uInt) job->in_len;
+  stream->next_out = job->out;
+  stream->avail_out = (uInt) out_size;
+  /* a sync flush ends the block on a byte boundary, so the blocks can be
+     concatenated into a single deflate stream */
+  ret = deflate(stream, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+  if ((ret != (job->last ? Z_STREAM_END : Z_OK)) || (stream->avail_in > 0) ||
+      (stream->avail_out == 0))
+    return EIO;
+  job->out_len = out_size - stream->avail_out;
+  job->out_pos = 0;
+  job->crc = crc32(crc32(0L, Z_NULL, 0), job->in + job->dict_len,
+                   (uInt) job->in_len);
+  return 0;
+}
+
+static void *sg__pgz_work(void *cls) {
+  struct sg__pgz *pgz = cls;
+  struct sg__pgz_job *job;
+  z_stream *stream = NULL;
+  int errnum, ret;
+  errnum = sg__zpool_get(pgz->level, -MAX_WBITS, &stream);
+  pthread_mutex_lock(&pgz->mutex);
+  while (!pgz->stop) {
+    job = &pgz->jobs[pgz->next];
+    if (job->state != SG__PGZ_QUEUED) {
+      pthread_cond_wait(&pgz->work_cond, &pgz->mutex);
+      continue;
+    }
+    job->state = SG__PGZ_RUNNING;
+    pgz->next = (pgz->next + 1) % pgz->njobs;
+    pthread_mutex_unlock(&pgz->mutex);
+    ret = errnum == Z_OK ? sg__pgz_deflate(stream, job, pgz->out_size) : EIO;
+    pthread_mutex_lock(&pgz->mutex);
+    job->state = ret == 0 ? SG__PGZ_DONE : SG__PGZ_FAILED;
+    pthread_cond_signal(&pgz->done_cond);
+  }
+  pthread_mutex_unlock(&pgz->mutex);
+  sg__zpool_put(stream);
+  return NULL;
+}
+
+int sg__pgz_new(int level, unsigned int threads, struct sg__pgz **pgz) {
+  static const Bytef header[] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0,
+                                 0xff};
+  struct sg__pgz *p;
+  unsigned int i;
+  int errnum;
+  if ((threads == 0) || !pgz)
+    return EINVAL;
+  p = sg_alloc(sizeof(struct sg__pgz));
+  if (!p)
+    return ENOMEM;
+  errnum = pthread_mutex_init(&p->mutex, NULL);
+  if (errnum != 0)
+    goto error_mutex;
+  errnum = pthread_cond_init(&p->work_cond, NULL);
+  if (errnum != 0)
+    goto error_work_cond;
+  errnum = pthread_cond_init(&p->done_cond, NULL);
+  if (errnum != 0)
+    goto error_done_cond;
+  p->level = level;
+  p->njobs = threads * 2;
+  /* room for the sync flush marker */
+  p->out_size = compressBound(SG__PGZ_BLOCK_SIZE) + 16;
+  memcpy(p->wrap, header, sizeof(header));
+  if (level == Z_BEST_COMPRESSION)
+    p->wrap[8] = 2;
+  else if (level == Z_BEST_SPEED)
+    p->wrap[8] = 4;
+  p->wrap_len = sizeof(header);
+  p->crc = crc32(0L, Z_NULL, 0);
+  p->jobs = sg_alloc(p->njobs * sizeof(struct sg__pgz_job));
+  p->workers = sg_alloc(threads * sizeof(pthread_t));
+  if (!p->jobs || !p->workers) {
+    errnum = ENOMEM;
+    goto error;
+  }
+  for (i = 0; i < p->njobs; i++) {
+    p->jobs[i].in = sg_malloc(SG__PGZ_DICT_SIZE + SG__PGZ_BLOCK_SIZE);
+    p->jobs[i].out = sg_malloc(p->out_size);
+    if (!p->jobs[i].in || !p->jobs[i].out) {
+      errnum = ENOMEM;
+      goto error;
     }
-    have = SG__ZLIB_CHUNK - stream->avail_out;
-    *dest_size += have;
-    *dest = sg_realloc(*dest, *dest_size);
-    if (!*dest)
-      return ENOMEM;
-    memcpy(*dest + (*dest_size - have), zbuf, have);
-  } while (stream->avail_out == 0);
+  }
+  for (; p->nworkers < threads; p->nworkers++) {
+    errnum = pthread_create(&p->workers[p->nworkers], NULL, sg__pgz_work, p);
+    if (errnum != 0)
+      goto error;
+  }
+  *pgz = p;
+  return 0;
+error:
+  sg__pgz_free(p);
+  return errnum;
+error_done_cond:
+  pthread_cond_destroy(&p->work_cond);
+error_work_cond:
+  pthread_mutex_destroy(&p->mutex);
+error_mutex:
+  sg_free(p);
+  return errnum;
+}
+
+void sg__pgz_free(struct sg__pgz *pgz) {
+  unsigned int i;
+  if (!pgz)
+    return;
+  pthread_mutex_lock(&pgz->mutex);
+  pgz->stop = true;
+  pthread_cond_broadcast(&pgz->work_cond);
+  pthread_mutex_unlock(&pgz->mutex);
+  for (i = 0; i < pgz->nworkers; i++)
+    pthread_join(pgz->workers[i], NULL);
+  for (i = 0; pgz->jobs && (i < pgz->njobs); i++) {
+    sg_free(pgz->jobs[i].in);
+    sg_free(pgz->jobs[i].out);
+  }
+  sg_free(pgz->jobs);
+  sg_free(pgz->workers);
+  pthread_cond_destroy(&pgz->done_cond);
+  pthread_cond_destroy(&pgz->work_cond);
+  pthread_mutex_destroy(&pgz->mutex);
+  sg_free(pgz);
+}
+
+static enum sg__pgz_state sg__pgz_state(struct sg__pgz *pgz, unsigned int i) {
+  enum sg__pgz_state state;
+  pthread_mutex_lock(&pgz->mutex);
+  state = pgz->jobs[i].state;
+  pthread_mutex_unlock(&pgz->mutex);
+  return state;
+}
+
+/* Copies what fits of the pending `src` bytes, telling if all of them were
+   written. */
+static bool sg__pgz_copy(const Bytef *src, size_t *pos, size_t len,
+                         Bytef **dest, size_t *left) {
+  size_t n = len - *pos;
+  if (n > *left)
+    n = *left;
+  if (n > 0) {
+    memcpy(*dest, src + *pos, n);
+    *pos += n;
+    *dest += n;
+    *left -= n;
+  }
+  return *pos == len;
+}
+
+/* Moves input into the block being filled, priming a new block with the tail
+   of the previous one, and queues it once full or at the end. */
+static void sg__pgz_fill(struct sg__pgz *pgz, const Bytef **next_in,
+                         size_t *avail_in, bool finish) {
+  struct sg__pgz_job *job = &pgz->jobs[pgz->fill], *prev;
+  size_t n;
+  if (!pgz->filling) {
+    job->dict_len = 0;
+    job->in_len = 0;
+    if (pgz->started) {
+      prev = &pgz->jobs[(pgz->fill + pgz->njobs - 1) % pgz->njobs];
+      n = prev->dict_len + prev->in_len;
+      job->dict_len = n < SG__PGZ_DICT_SIZE ? n : SG__PGZ_DICT_SIZE;
+      memcpy(job->in, prev->in + n - job->dict_len, job->dict_len);
+    }
+    pgz->filling = true;
+  }
+  n = SG__PGZ_BLOCK_SIZE - job->in_len;
+  if (n > *avail_in)
+    n = *avail_in;
+  if (n > 0) {
+    memcpy(job->in + job->dict_len + job->in_len, *next_in, n);
+    job->in_len += n;
+    *next_in += n;
+    *avail_in -= n;
+  }
+  if ((job->in_len < SG__PGZ_BLOCK_SIZE) && (!finish || (*avail_in > 0)))
+    return;
+  job->last = finish && (*avail_in == 0);
+  pgz->queued_last = job->last;
+  pgz->filling = false;
+  pgz->started = true;
+  pgz->fill = (pgz->fill + 1) % pgz->njobs;
+  pthread_mutex_lock(&pgz->mutex);
+  job->state = SG__PGZ_QUEUED;
+  pthread_cond_signal(&pgz->work_cond);
+  pthread_mutex_unlock(&pgz->mutex);
+}
+
+/* Accounts the block whose output was written, releasing it. */
+static void sg__pgz_release(struct sg__pgz *pgz, struct sg__pgz_job *job) {
+  uLong val;
+  unsigned int i;
+  pgz->crc = crc32_combine(pgz->crc, job->crc, (z_off_t) job->in_len);
+  pgz->isize += (uLong) job->in_len;
+  if (job->last) {
+    for (i = 0, val = pgz->crc; i < 4; i++, val >>= 8)
+      pgz->wrap[i] = (Bytef) (val & 0xff);
+    for (val = pgz->isize; i < 8; i++, val >>= 8)
+      pgz->wrap[i] = (Bytef) (val & 0xff);
+    pgz->wrap_len = 8;
+    pgz->wrap_pos = 0;
+    pgz->ended = true;
+  }
+  pgz->head = (pgz->head + 1) % pgz->njobs;
+  pthread_mutex_lock(&pgz->mutex);
+  job->state = SG__PGZ_FREE;
+  pthread_mutex_unlock(&pgz->mutex);
+}
+
+int sg__pgz_encode(struct sg__pgz *pgz, const Bytef **next_in,
+                   size_t *avail_in, bool finish, Bytef *dest,
+                   size_t *dest_size, bool *finished) {
+  struct sg__pgz_job *job;
+  enum sg__pgz_state state;
+  size_t left = *dest_size;
+  *finished = false;
+  for (;;) {
+    if (!sg__pgz_copy(pgz->wrap, &pgz->wrap_pos, pgz->wrap_len, &dest, &left))
+      break;
+    if (pgz->ended) {
+      *finished = true;
+      break;
+    }
+    job = &pgz->jobs[pgz->head];
+    state = sg__pgz_state(pgz, pgz->head);
+    if (state == SG__PGZ_FAILED)
+      return EIO;
+    if (state == SG__PGZ_DONE) {
+      if (!sg__pgz_copy(job->out, &job->out_pos, job->out_len, &dest, &left))
+        break;
+      sg__pgz_release(pgz, job);
+      continue;
+    }
+    if (!pgz->queued_last && ((*avail_in > 0) || finish) &&
+        (sg__pgz_state(pgz, pgz->fill) == SG__PGZ_FREE)) {
+      sg__pgz_fill(pgz, next_in, avail_in, finish);
+      continue;
+    }
+    /* returns what was written or asks for more input, otherwise waits for
+       the oldest block */
+    if ((left < *dest_size) ||
+        (!pgz->queued_last && !finish && (*avail_in == 0)))
+      break;
+    pthread_mutex_lock(&pgz->mutex);
+    while ((job->state != SG__PGZ_DONE) && (job->state != SG__PGZ_FAILED))
+      pthread_cond_wait(&pgz->done_cond, &pgz->mutex);
+    pthread_mutex_unlock(&pgz->mutex);
+  }
+  *dest_size -= left;
+  return 0;
+}
+
+#undef SG__PGZ_DICT_SIZE /* SG__PGZ_DICT_SIZE */
+
+#ifdef SG_HTTP_BROTLI
+
+void *sg__bralloc(__SG_UNUSED void *opaque, size_t size) {
+  return sg_malloc(size);
+}
+
+void sg__brfree(__SG_UNUSED void *opaque, void *ptr) {
+  sg_free(ptr);
+}
+
+int sg__brcompress(const uint8_t *src, size_t src_size, uint8_t *dest,
+                   size_t *dest_size, int level) {
+  if (!src || !dest || !dest_size)
+    return EINVAL;
+  if (!BrotliEncoderCompress(SG__BRQUALITY(level), BROTLI_DEFAULT_WINDOW,
+                             BROTLI_MODE_GENERIC, src_size, src, dest_size,
+                             dest))
+    return ENOBUFS;
   return 0;
 }
 
+int sg__brencode(BrotliEncoderState *state, const Bytef **next_in,
+                 size_t *avail_in, bool finish, Bytef *dest, size_t *dest_size,
+                 bool *finished) {
+  size_t avail_out = *dest_size;
+  if (!BrotliEncoderCompressStream(
+        state, (finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS),
+        avail_in, next_in, &avail_out, &dest, NULL))
+    return EIO;
+  *dest_size -= avail_out;
+  *finished = BrotliEncoderIsFinished(state);
+  return 0;
+}
+
+#endif /* SG_HTTP_BROTLI */
+
+#ifdef SG_HTTP_ZSTD
+
+int sg__zstdcompress(const void *src, size_t src_size, void *dest,
+                     size_t *dest_size, int level) {
+  size_t ret;
+  if (!src || !dest || !dest_size)
+    return EINVAL;
+  ret = ZSTD_compress(dest, *dest_size, src, src_size, SG__ZSTDLEVEL(level));
+  if (ZSTD_isError(ret))
+    return ENOBUFS;
+  *dest_size = ret;
+  return 0;
+}
+
+int sg__zstdencode(ZSTD_CStream *stream, const Bytef **next_in,
+                   size_t *avail_in, bool finish, Bytef *dest,
+                   size_t *dest_size, bool *finished) {
+  ZSTD_inBuffer in;
+  ZSTD_outBuffer out;
+  size_t ret;
+  in.src = *next_in;
+  in.size = *avail_in;
+  in.pos = 0;
+  out.dst = dest;
+  out.size = *dest_size;
+  out.pos = 0;
+  ret = ZSTD_compressStream2(stream, &out, &in,
+                             (finish ? ZSTD_e_end : ZSTD_e_continue));
+  if (ZSTD_isError(ret))
+    return EIO;
+  *next_in += in.pos;
+  *avail_in -= in.pos;
+  *dest_size = out.pos;
+  *finished = finish && (ret == 0);
+  return 0;
+}
+
+#endif /* SG_HTTP_ZSTD */
+
 #endif /* SG_HTTP_COMPRESSION */
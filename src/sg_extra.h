@@ -29,7 +29,14 @@
 
 #include "sg_macros.h"
 #ifdef SG_HTTP_COMPRESSION
+#include <stdbool.h>
 #include "zlib.h"
+#ifdef SG_HTTP_BROTLI
+#include <brotli/encode.h>
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+#include "zstd.h"
+#endif /* SG_HTTP_ZSTD */
 #endif /* SG_HTTP_COMPRESSION */
 #include "microhttpd.h"
 #include "sg_strmap.h"
@@ -39,6 +46,10 @@ SG__EXTERN enum MHD_Result sg__convals_iter(void *cls,
                                             __SG_UNUSED enum MHD_ValueKind kind,
                                             const char *key, const char *val);
 
+SG__EXTERN struct sg_strmap *sg__convals_view(struct MHD_Connection *con,
+                                              enum MHD_ValueKind kind,
+                                              struct sg_strmap **map);
+
 SG__EXTERN int sg__strmap_iter(void *cls, struct sg_strmap *map);
 
 #ifdef SG_HTTP_COMPRESSION
@@ -48,12 +59,79 @@ SG__EXTERN voidpf sg__zalloc(__SG_UNUSED voidpf opaque, unsigned items,
 
 SG__EXTERN void sg__zfree(__SG_UNUSED voidpf opaque, voidpf ptr);
 
+/* Takes a deflate stream initialized with `level` and `wbits` from the pool
+   of the calling thread, or initializes a new one. Streams are created with
+   MAX_MEM_LEVEL and the default strategy. */
+SG__EXTERN int sg__zpool_get(int level, int wbits, z_stream **stream);
+
+/* Gives a stream taken by sg__zpool_get() back to the pool of the calling
+   thread, ending it when the pool is full. */
+SG__EXTERN void sg__zpool_put(z_stream *stream);
+
+/* Compresses `src` in one shot; `wbits` selects the format as in
+   deflateInit2(), e.g. -MAX_WBITS (raw), MAX_WBITS (zlib) or MAX_WBITS + 16
+   (gzip). */
 SG__EXTERN int sg__zcompress(z_const Bytef *src, uLong src_size, Bytef *dest,
-                             uLongf *dest_size, int level);
+                             uLongf *dest_size, int level, int wbits);
+
+/* Compresses the `avail_in` bytes at `next_in` into `dest`, whose capacity is
+   passed in `dest_size` and replaced by the bytes written, advancing the input
+   as it is consumed. Input and output that do not fit stay pending for the
+   next call; `finished` tells when the end of the stream has been written. */
+SG__EXTERN int sg__zdeflate(z_stream *stream, const Bytef **next_in,
+                            size_t *avail_in, bool finish, Bytef *dest,
+                            size_t *dest_size, bool *finished);
+
+/* Parallel gzip encoder: the input is split into blocks deflated by a pool of
+   workers, each one primed with the tail of the previous block, and the
+   output is stitched back in order. */
+struct sg__pgz;
+
+SG__EXTERN int sg__pgz_new(int level, unsigned int threads,
+                           struct sg__pgz **pgz);
+
+SG__EXTERN void sg__pgz_free(struct sg__pgz *pgz);
+
+/* Same as sg__zdeflate() for a parallel gzip encoder. It blocks only when
+   neither input can be queued nor output is ready. */
+SG__EXTERN int sg__pgz_encode(struct sg__pgz *pgz, const Bytef **next_in,
+                              size_t *avail_in, bool finish, Bytef *dest,
+                              size_t *dest_size, bool *finished);
+
+#ifdef SG_HTTP_BROTLI
+
+/* Maps a zlib compression level (-1..9) onto a brotli quality. */
+#define SG__BRQUALITY(level) ((level) < 0 ? 5 : (level))
+
+SG__EXTERN void *sg__bralloc(__SG_UNUSED void *opaque, size_t size);
+
+SG__EXTERN void sg__brfree(__SG_UNUSED void *opaque, void *ptr);
+
+SG__EXTERN int sg__brcompress(const uint8_t *src, size_t src_size,
+                              uint8_t *dest, size_t *dest_size, int level);
+
+/* Same as sg__zdeflate() for a brotli encoder. */
+SG__EXTERN int sg__brencode(BrotliEncoderState *state, const Bytef **next_in,
+                            size_t *avail_in, bool finish, Bytef *dest,
+                            size_t *dest_size, bool *finished);
+
+#endif /* SG_HTTP_BROTLI */
+
+#ifdef SG_HTTP_ZSTD
+
+/* Maps a zlib compression level (-1..9) onto a zstd level. */
+#define SG__ZSTDLEVEL(level)                                                   \
+  ((level) < 0 ? ZSTD_CLEVEL_DEFAULT : ((level) > 0 ? (level) : 1))
+
+SG__EXTERN int sg__zstdcompress(const void *src, size_t src_size, void *dest,
+                                size_t *dest_size, int level);
+
+/* Same as sg__zdeflate() for a zstd stream. */
+SG__EXTERN int sg__zstdencode(ZSTD_CStream *stream, const Bytef **next_in,
+                              size_t *avail_in, bool finish, Bytef *dest,
+                              size_t *dest_size, bool *finished);
 
-SG__EXTERN int sg__zdeflate(z_stream *stream, Bytef *zbuf, int flush,
-                            z_const Bytef *src, uInt src_size, Bytef **dest,
-                            z_size_t *dest_size);
+#endif /* SG_HTTP_ZSTD */
 
 #endif /* SG_HTTP_COMPRESSION */
 
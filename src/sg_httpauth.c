@@ -31,7 +31,6 @@
 #include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
-#include "sg_extra.h"
 #include "sg_strmap.h"
 #include "sg_httpauth.h"
 
@@ -63,7 +62,7 @@ bool sg__httpauth_dispatch(struct sg_httpauth *auth) {
     goto done;
   }
   if (auth->res->handle) {
-    sg_strmap_iter(auth->res->headers, sg__strmap_iter, auth->res->handle);
+    sg__httpres_headers(auth->res);
     if (auth->res->status == MHD_HTTP_UNAUTHORIZED)
       auth->res->ret = MHD_queue_basic_auth_fail_response(
         auth->res->con, auth->realm ? auth->realm : _("Sagui realm"),
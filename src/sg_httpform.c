@@ -0,0 +1,556 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif /* __AVX2__ */
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_utils.h"
+#include "sg_httpform.h"
+
+struct sg__httpform_slice {
+  const char *ptr;
+  size_t len;
+};
+
+static void sg__httpform_trim(struct sg__httpform_slice *slice) {
+  while ((slice->len > 0) && ((*slice->ptr == ' ') || (*slice->ptr == '\t'))) {
+    slice->ptr++;
+    slice->len--;
+  }
+  while ((slice->len > 0) && ((slice->ptr[slice->len - 1] == ' ') ||
+                              (slice->ptr[slice->len - 1] == '\t')))
+    slice->len--;
+}
+
+static bool sg__httpform_is(const struct sg__httpform_slice *slice,
+                            const char *str, size_t len) {
+  return (slice->len == len) && (sg__strncasecmp(slice->ptr, str, len) == 0);
+}
+
+bool sg__httpform_boundary(const char *content_type, const char **boundary,
+                           size_t *len) {
+  const char *end;
+  if (!content_type || !boundary || !len ||
+      (sg__strncasecmp(content_type, "multipart/form-data", 19) != 0))
+    return false;
+  content_type += 19;
+  while ((content_type = strchr(content_type, ';'))) {
+    content_type++;
+    while ((*content_type == ' ') || (*content_type == '\t'))
+      content_type++;
+    if (sg__strncasecmp(content_type, "boundary=", 9) != 0)
+      continue;
+    content_type += 9;
+    if (*content_type == '"') {
+      content_type++;
+      end = strchr(content_type, '"');
+      if (!end)
+        return false;
+    } else {
+      end = content_type;
+      while (*end && (*end != ';') && (*end != ' ') && (*end != '\t'))
+        end++;
+    }
+    if ((end == content_type) ||
+        ((size_t) (end - content_type) > SG__HTTPFORM_BOUNDARY_SIZE))
+      return false;
+    *boundary = content_type;
+    *len = (size_t) (end - content_type);
+    return true;
+  }
+  return false;
+}
+
+bool sg__httpform_is_urlencoded(const char *content_type) {
+  return content_type &&
+         (sg__strncasecmp(content_type, "application/x-www-form-urlencoded",
+                          33) == 0) &&
+         ((content_type[33] == '\0') || (content_type[33] == ';') ||
+          (content_type[33] == ' '));
+}
+
+static int sg__httpform_hex(char c) {
+  if ((c >= '0') && (c <= '9'))
+    return c - '0';
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F'))
+    return c - 'A' + 10;
+  return -1;
+}
+
+static size_t sg__httpform_urldecode(char *str, size_t len) {
+  const char *src = str, *end = str + len;
+  char *dst = str;
+  int hi, lo;
+  while (src < end) {
+    if (*src == '+') {
+      *dst++ = ' ';
+      src++;
+    } else if ((*src == '%') && (end - src > 2) &&
+               ((hi = sg__httpform_hex(src[1])) >= 0) &&
+               ((lo = sg__httpform_hex(src[2])) >= 0)) {
+      *dst++ = (char) ((hi << 4) | lo);
+      src += 3;
+    } else
+      *dst++ = *src++;
+  }
+  return (size_t) (dst - str);
+}
+
+/* Decodes the pairs in place, `buf` must have room for a trailing NUL. */
+int sg__httpform_urlencoded(char *buf, size_t len, sg__httpform_field_cb cb,
+                            void *cls) {
+  char *pair, *sep, *val, *end = buf + len;
+  size_t name_len, val_len;
+  int errnum;
+  if (!buf || !cb)
+    return EINVAL;
+  for (pair = buf; pair <= end; pair = sep + 1) {
+    sep = memchr(pair, '&', (size_t) (end - pair));
+    if (!sep)
+      sep = end;
+    val = memchr(pair, '=', (size_t) (sep - pair));
+    if (val) {
+      name_len = (size_t) (val++ - pair);
+      val_len = (size_t) (sep - val);
+    } else {
+      name_len = (size_t) (sep - pair);
+      val = sep;
+      val_len = 0;
+    }
+    name_len = sg__httpform_urldecode(pair, name_len);
+    pair[name_len] = '\0';
+    val_len = sg__httpform_urldecode(val, val_len);
+    val[val_len] = '\0';
+    if (name_len > 0) {
+      errnum = cb(cls, pair, val, val_len);
+      if (errnum != 0)
+        return errnum;
+    }
+  }
+  return 0;
+}
+
+/* Finds the needle comparing its first and last chars against whole SIMD
+   registers, checking the remaining chars only for the candidate positions. */
+const char *sg__httpform_memmem(const char *haystack, size_t haystack_len,
+                                const char *needle, size_t needle_len) {
+  const char *p, *end;
+  size_t i = 0;
+#if defined(__AVX2__)
+  __m256i first, last, blk_first, blk_last;
+  unsigned int mask;
+#elif defined(__SSE2__)
+  __m128i first, last, blk_first, blk_last;
+  unsigned int mask;
+#endif /* __AVX2__ */
+  if ((needle_len < 2) || (haystack_len < needle_len))
+    return needle_len == 1 ? memchr(haystack, *needle, haystack_len) : NULL;
+#if defined(__AVX2__)
+  first = _mm256_set1_epi8(needle[0]);
+  last = _mm256_set1_epi8(needle[needle_len - 1]);
+  for (; i + needle_len + 31 <= haystack_len; i += 32) {
+    blk_first = _mm256_loadu_si256((const __m256i *) (haystack + i));
+    blk_last =
+      _mm256_loadu_si256((const __m256i *) (haystack + i + needle_len - 1));
+    mask = (unsigned int) _mm256_movemask_epi8(_mm256_and_si256(
+      _mm256_cmpeq_epi8(first, blk_first), _mm256_cmpeq_epi8(last, blk_last)));
+    while (mask) {
+      p = haystack + i + __builtin_ctz(mask);
+      if (memcmp(p + 1, needle + 1, needle_len - 2) == 0)
+        return p;
+      mask &= mask - 1;
+    }
+  }
+#elif defined(__SSE2__)
+  first = _mm_set1_epi8(needle[0]);
+  last = _mm_set1_epi8(needle[needle_len - 1]);
+  for (; i + needle_len + 15 <= haystack_len; i += 16) {
+    blk_first = _mm_loadu_si128((const __m128i *) (haystack + i));
+    blk_last =
+      _mm_loadu_si128((const __m128i *) (haystack + i + needle_len - 1));
+    mask = (unsigned int) _mm_movemask_epi8(_mm_and_si128(
+      _mm_cmpeq_epi8(first, blk_first), _mm_cmpeq_epi8(last, blk_last)));
+    while (mask) {
+      p = haystack + i + __builtin_ctz(mask);
+      if (memcmp(p + 1, needle + 1, needle_len - 2) == 0)
+        return p;
+      mask &= mask - 1;
+    }
+  }
+#endif /* __AVX2__ */
+  end = haystack + haystack_len - needle_len;
+  for (p = haystack + i; p <= end; p++) {
+    p = memchr(p, *needle, (size_t) (end - p) + 1);
+    if (!p)
+      return NULL;
+    if (memcmp(p + 1, needle + 1, needle_len - 1) == 0)
+      return p;
+  }
+  return NULL;
+}
+
+/* Length of the longest suffix of `buf` that can start a delimiter. */
+static size_t sg__httpform_partial(struct sg__httpform *form, const char *buf,
+                                   size_t len) {
+  const char *p;
+  size_t i = len >= form->delim_len ? len - form->delim_len + 1 : 0;
+  while ((p = memchr(buf + i, '\r', len - i))) {
+    i = (size_t) (p - buf);
+    if (memcmp(p, form->delim, len - i) == 0)
+      return len - i;
+    i++;
+  }
+  return 0;
+}
+
+static int sg__httpform_append(struct sg__httpform *form, const char *buf,
+                               size_t size) {
+  char *val;
+  size_t val_size;
+  if ((form->val_limit > 0) && (form->val_len + size > form->val_limit))
+    return EMSGSIZE;
+  if (form->val_len + size >= form->val_size) {
+    val_size = form->val_size > 0 ? form->val_size : 256;
+    while (val_size <= form->val_len + size)
+      val_size <<= 1;
+    val = sg_realloc(form->val, val_size);
+    if (!val)
+      return ENOMEM;
+    form->val = val;
+    form->val_size = val_size;
+  }
+  memcpy(form->val + form->val_len, buf, size);
+  form->val_len += size;
+  form->val[form->val_len] = '\0';
+  return 0;
+}
+
+static int sg__httpform_emit(struct sg__httpform *form, const char *buf,
+                             size_t size) {
+  int errnum;
+  if ((form->state != SG__HTTPFORM_BODY) || (size == 0))
+    return 0;
+  if (form->filename) {
+    if (!form->started) {
+      errnum = form->file_cb(form->cls, form->name, form->filename, form->mime,
+                             form->encoding);
+      if (errnum != 0)
+        return errnum;
+      form->started = true;
+    }
+    return form->write_cb(form->cls, buf, size);
+  }
+  return form->name ? sg__httpform_append(form, buf, size) : 0;
+}
+
+static int sg__httpform_delimited(struct sg__httpform *form) {
+  int errnum = 0;
+  if ((form->state == SG__HTTPFORM_BODY) && form->name && !form->filename)
+    errnum = form->field_cb(form->cls, form->name,
+                            form->val_len > 0 ? form->val : "", form->val_len);
+  form->name = form->filename = form->mime = form->encoding = NULL;
+  form->started = false;
+  form->val_len = 0;
+  form->state = SG__HTTPFORM_DELIMITER;
+  return errnum;
+}
+
+static int sg__httpform_scan(struct sg__httpform *form, const char *buf,
+                             size_t size, size_t *consumed) {
+  const char *p;
+  size_t len, keep;
+  int errnum;
+  if (form->carry_len > 0) {
+    len = size < form->delim_len ? size : form->delim_len;
+    memcpy(form->carry + form->carry_len, buf, len);
+    len += form->carry_len;
+    p = sg__httpform_memmem(form->carry, len, form->delim, form->delim_len);
+    if (p) {
+      keep = (size_t) (p - form->carry);
+      *consumed = keep + form->delim_len - form->carry_len;
+      form->carry_len = 0;
+      errnum = sg__httpform_emit(form, form->carry, keep);
+      return errnum == 0 ? sg__httpform_delimited(form) : errnum;
+    }
+    if (size > form->delim_len) {
+      /* no delimiter starts in the carry, let the chunk be scanned */
+      *consumed = 0;
+      len = form->carry_len;
+      form->carry_len = 0;
+      return sg__httpform_emit(form, form->carry, len);
+    }
+    *consumed = size;
+    keep = sg__httpform_partial(form, form->carry, len);
+    errnum = sg__httpform_emit(form, form->carry, len - keep);
+    memmove(form->carry, form->carry + len - keep, keep);
+    form->carry_len = keep;
+    return errnum;
+  }
+  p = sg__httpform_memmem(buf, size, form->delim, form->delim_len);
+  if (p) {
+    *consumed = (size_t) (p - buf) + form->delim_len;
+    errnum = sg__httpform_emit(form, buf, (size_t) (p - buf));
+    return errnum == 0 ? sg__httpform_delimited(form) : errnum;
+  }
+  *consumed = size;
+  keep = sg__httpform_partial(form, buf, size);
+  memcpy(form->carry, buf + size - keep, keep);
+  form->carry_len = keep;
+  return sg__httpform_emit(form, buf, size - keep);
+}
+
+static int sg__httpform_delimiter(struct sg__httpform *form, const char *buf,
+                                  size_t size, size_t *consumed) {
+  size_t i;
+  for (i = 0; i < size; i++) {
+    switch (form->delim_ch) {
+      case '-':
+        if (buf[i] != '-')
+          return EINVAL;
+        form->state = SG__HTTPFORM_EPILOGUE;
+        break;
+      case '\r':
+        if (buf[i] != '\n')
+          return EINVAL;
+        form->state = SG__HTTPFORM_HEADERS;
+        break;
+      default:
+        if ((buf[i] == '-') || (buf[i] == '\r'))
+          form->delim_ch = buf[i];
+        else if ((buf[i] != ' ') && (buf[i] != '\t'))
+          return EINVAL;
+        continue;
+    }
+    form->delim_ch = '\0';
+    *consumed = i + 1;
+    return 0;
+  }
+  *consumed = size;
+  return 0;
+}
+
+static void sg__httpform_disposition(const struct sg__httpform_slice *val,
+                                     struct sg__httpform_slice *name,
+                                     struct sg__httpform_slice *filename) {
+  struct sg__httpform_slice key, param;
+  const char *p = val->ptr, *end = val->ptr + val->len;
+  while ((p = memchr(p, ';', (size_t) (end - p)))) {
+    key.ptr = ++p;
+    while ((p < end) && (*p != '=') && (*p != ';'))
+      p++;
+    if ((p == end) || (*p == ';'))
+      continue;
+    key.len = (size_t) (p - key.ptr);
+    sg__httpform_trim(&key);
+    p++;
+    while ((p < end) && ((*p == ' ') || (*p == '\t')))
+      p++;
+    if ((p < end) && (*p == '"')) {
+      param.ptr = ++p;
+      while ((p < end) && (*p != '"')) {
+        if ((*p == '\\') && (p + 1 < end))
+          p++;
+        p++;
+      }
+      param.len = (size_t) (p - param.ptr);
+    } else {
+      param.ptr = p;
+      while ((p < end) && (*p != ';'))
+        p++;
+      param.len = (size_t) (p - param.ptr);
+      sg__httpform_trim(&param);
+    }
+    if (sg__httpform_is(&key, "name", 4))
+      *name = param;
+    else if (sg__httpform_is(&key, "filename", 8))
+      *filename = param;
+  }
+}
+
+static char *sg__httpform_info(char **info,
+                               const struct sg__httpform_slice *slice) {
+  char *str;
+  if (!slice->ptr)
+    return NULL;
+  str = *info;
+  memcpy(str, slice->ptr, slice->len);
+  str[slice->len] = '\0';
+  *info += slice->len + 1;
+  return str;
+}
+
+static void sg__httpform_part(struct sg__httpform *form, const char *buf,
+                              size_t len) {
+  struct sg__httpform_slice hdr, val, name = {NULL, 0}, filename = {NULL, 0},
+                                      mime = {NULL, 0}, encoding = {NULL, 0};
+  const char *p, *end = buf + len;
+  char *info = form->info;
+  while (buf < end) {
+    p = memchr(buf, '\r', (size_t) (end - buf));
+    if (!p)
+      p = end;
+    hdr.ptr = buf;
+    buf = p + 2;
+    val.ptr = memchr(hdr.ptr, ':', (size_t) (p - hdr.ptr));
+    if (!val.ptr)
+      continue;
+    hdr.len = (size_t) (val.ptr - hdr.ptr);
+    val.ptr++;
+    val.len = (size_t) (p - val.ptr);
+    sg__httpform_trim(&hdr);
+    sg__httpform_trim(&val);
+    if (sg__httpform_is(&hdr, "Content-Disposition", 19))
+      sg__httpform_disposition(&val, &name, &filename);
+    else if (sg__httpform_is(&hdr, "Content-Type", 12))
+      mime = val;
+    else if (sg__httpform_is(&hdr, "Content-Transfer-Encoding", 25))
+      encoding = val;
+  }
+  form->name = sg__httpform_info(&info, &name);
+  form->filename = sg__httpform_info(&info, &filename);
+  form->mime = sg__httpform_info(&info, &mime);
+  form->encoding = sg__httpform_info(&info, &encoding);
+  form->state = SG__HTTPFORM_BODY;
+}
+
+/* Offset just after the blank line ending the part headers, or zero. */
+static size_t sg__httpform_hdrs_end(const char *buf, size_t len, size_t from) {
+  const char *p;
+  if ((len >= 2) && (buf[0] == '\r') && (buf[1] == '\n'))
+    return 2;
+  from = from > 3 ? from - 3 : 0;
+  p = sg__httpform_memmem(buf + from, len - from, "\r\n\r\n", 4);
+  return p ? (size_t) (p - buf) + 4 : 0;
+}
+
+static int sg__httpform_headers(struct sg__httpform *form, const char *buf,
+                                size_t size, size_t *consumed) {
+  size_t len, end;
+  if (form->hdrs_len == 0) {
+    end = sg__httpform_hdrs_end(buf, size, 0);
+    if (end > 0) {
+      if (end > SG__HTTPFORM_HDRS_SIZE)
+        return EMSGSIZE;
+      *consumed = end;
+      sg__httpform_part(form, buf, end - 2);
+      return 0;
+    }
+    if (!form->hdrs) {
+      form->hdrs = sg_malloc(SG__HTTPFORM_HDRS_SIZE);
+      if (!form->hdrs)
+        return ENOMEM;
+    }
+  }
+  len = SG__HTTPFORM_HDRS_SIZE - form->hdrs_len;
+  if (len == 0)
+    return EMSGSIZE;
+  if (len > size)
+    len = size;
+  memcpy(form->hdrs + form->hdrs_len, buf, len);
+  end = sg__httpform_hdrs_end(form->hdrs, form->hdrs_len + len, form->hdrs_len);
+  if (end == 0) {
+    form->hdrs_len += len;
+    *consumed = len;
+    return 0;
+  }
+  *consumed = end - form->hdrs_len;
+  form->hdrs_len = 0;
+  sg__httpform_part(form, form->hdrs, end - 2);
+  return 0;
+}
+
+struct sg__httpform *
+  sg__httpform_new(const char *boundary, size_t boundary_len, size_t val_limit,
+                   sg__httpform_file_cb file_cb, sg__httpform_write_cb write_cb,
+                   sg__httpform_field_cb field_cb, void *cls) {
+  struct sg__httpform *form;
+  if (!boundary || (boundary_len == 0) ||
+      (boundary_len > SG__HTTPFORM_BOUNDARY_SIZE) || !file_cb || !write_cb ||
+      !field_cb)
+    return NULL;
+  form = sg_alloc(sizeof(struct sg__httpform));
+  if (!form)
+    return NULL;
+  memcpy(form->delim, "\r\n--", 4);
+  memcpy(form->delim + 4, boundary, boundary_len);
+  form->delim_len = boundary_len + 4;
+  /* the first delimiter is allowed to come without the leading CRLF */
+  memcpy(form->carry, "\r\n", 2);
+  form->carry_len = 2;
+  form->val_limit = val_limit;
+  form->file_cb = file_cb;
+  form->write_cb = write_cb;
+  form->field_cb = field_cb;
+  form->cls = cls;
+  return form;
+}
+
+void sg__httpform_free(struct sg__httpform *form) {
+  if (!form)
+    return;
+  sg_free(form->hdrs);
+  sg_free(form->val);
+  sg_free(form);
+}
+
+int sg__httpform_process(struct sg__httpform *form, const char *buf,
+                         size_t size) {
+  size_t consumed;
+  int errnum;
+  if (!form || !buf)
+    return EINVAL;
+  while (size > 0) {
+    consumed = 0;
+    switch (form->state) {
+      case SG__HTTPFORM_PREAMBLE:
+      case SG__HTTPFORM_BODY:
+        errnum = sg__httpform_scan(form, buf, size, &consumed);
+        break;
+      case SG__HTTPFORM_DELIMITER:
+        errnum = sg__httpform_delimiter(form, buf, size, &consumed);
+        break;
+      case SG__HTTPFORM_HEADERS:
+        errnum = sg__httpform_headers(form, buf, size, &consumed);
+        break;
+      default:
+        return 0;
+    }
+    if (errnum != 0)
+      return errnum;
+    buf += consumed;
+    size -= consumed;
+  }
+  return 0;
+}
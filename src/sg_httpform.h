@@ -0,0 +1,112 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_HTTPFORM_H
+#define SG_HTTPFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "sg_macros.h"
+
+#ifndef SG__HTTPFORM_HDRS_SIZE
+#define SG__HTTPFORM_HDRS_SIZE 8192 /* 8k */
+#endif /* SG__HTTPFORM_HDRS_SIZE */
+
+#ifndef SG__HTTPFORM_BOUNDARY_SIZE
+#define SG__HTTPFORM_BOUNDARY_SIZE 70 /* RFC 2046 */
+#endif /* SG__HTTPFORM_BOUNDARY_SIZE */
+
+typedef int (*sg__httpform_file_cb)(void *cls, const char *field,
+                                    const char *name, const char *mime,
+                                    const char *encoding);
+
+typedef int (*sg__httpform_write_cb)(void *cls, const char *buf, size_t size);
+
+typedef int (*sg__httpform_field_cb)(void *cls, const char *name,
+                                     const char *val, size_t size);
+
+enum sg__httpform_state {
+  SG__HTTPFORM_PREAMBLE,
+  SG__HTTPFORM_DELIMITER,
+  SG__HTTPFORM_HEADERS,
+  SG__HTTPFORM_BODY,
+  SG__HTTPFORM_EPILOGUE
+};
+
+struct sg__httpform {
+  sg__httpform_file_cb file_cb;
+  sg__httpform_write_cb write_cb;
+  sg__httpform_field_cb field_cb;
+  void *cls;
+  enum sg__httpform_state state;
+  /* "\r\n--" followed by the boundary */
+  char delim[SG__HTTPFORM_BOUNDARY_SIZE + 4];
+  size_t delim_len;
+  char delim_ch;
+  /* tail of the previous chunk which can start a delimiter */
+  char carry[(SG__HTTPFORM_BOUNDARY_SIZE + 4) * 2];
+  size_t carry_len;
+  /* part headers split across chunks */
+  char *hdrs;
+  size_t hdrs_len;
+  /* NUL-terminated name, filename, mime and encoding of the current part */
+  char info[SG__HTTPFORM_HDRS_SIZE];
+  char *name;
+  char *filename;
+  char *mime;
+  char *encoding;
+  bool started;
+  /* value of the current non-file part */
+  char *val;
+  size_t val_len;
+  size_t val_size;
+  size_t val_limit;
+};
+
+SG__EXTERN bool sg__httpform_boundary(const char *content_type,
+                                      const char **boundary, size_t *len);
+
+SG__EXTERN bool sg__httpform_is_urlencoded(const char *content_type);
+
+SG__EXTERN int sg__httpform_urlencoded(char *buf, size_t len,
+                                       sg__httpform_field_cb cb, void *cls);
+
+SG__EXTERN const char *sg__httpform_memmem(const char *haystack,
+                                           size_t haystack_len,
+                                           const char *needle,
+                                           size_t needle_len);
+
+SG__EXTERN struct sg__httpform *
+  sg__httpform_new(const char *boundary, size_t boundary_len, size_t val_limit,
+                   sg__httpform_file_cb file_cb, sg__httpform_write_cb write_cb,
+                   sg__httpform_field_cb field_cb, void *cls);
+
+SG__EXTERN void sg__httpform_free(struct sg__httpform *form);
+
+SG__EXTERN int sg__httpform_process(struct sg__httpform *form, const char *buf,
+                                    size_t size);
+
+#endif /* SG_HTTPFORM_H */
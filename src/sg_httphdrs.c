@@ -0,0 +1,129 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_utils.h"
+#include "sg_httphdrs.h"
+
+/* Perfect hash of the well-known header names, folding ASCII case with 0x20
+   (header names are tokens, so letters, digits and '-' only). The factors
+   were searched offline to give no collisions in 64 slots; re-check them
+   when adding a name to `enum sg_hdr`. */
+#define SG__HTTPHDRS_HASH(name, len)                                           \
+  (((len) * 4 + ((unsigned char) (name)[0] | 0x20) * 5 +                       \
+    ((unsigned char) (name)[(len) - 1] | 0x20) * 29) &                         \
+   63)
+
+static const char *const sg__httphdrs_names[SG_HDR_COUNT] = {
+  [SG_HDR_ACCEPT] = "Accept",
+  [SG_HDR_ACCEPT_ENCODING] = "Accept-Encoding",
+  [SG_HDR_ACCEPT_LANGUAGE] = "Accept-Language",
+  [SG_HDR_ACCEPT_RANGES] = "Accept-Ranges",
+  [SG_HDR_AUTHORIZATION] = "Authorization",
+  [SG_HDR_CACHE_CONTROL] = "Cache-Control",
+  [SG_HDR_CONNECTION] = "Connection",
+  [SG_HDR_CONTENT_DISPOSITION] = "Content-Disposition",
+  [SG_HDR_CONTENT_ENCODING] = "Content-Encoding",
+  [SG_HDR_CONTENT_LENGTH] = "Content-Length",
+  [SG_HDR_CONTENT_RANGE] = "Content-Range",
+  [SG_HDR_CONTENT_TYPE] = "Content-Type",
+  [SG_HDR_COOKIE] = "Cookie",
+  [SG_HDR_ETAG] = "ETag",
+  [SG_HDR_EXPIRES] = "Expires",
+  [SG_HDR_HOST] = "Host",
+  [SG_HDR_IF_MATCH] = "If-Match",
+  [SG_HDR_IF_MODIFIED_SINCE] = "If-Modified-Since",
+  [SG_HDR_IF_NONE_MATCH] = "If-None-Match",
+  [SG_HDR_IF_RANGE] = "If-Range",
+  [SG_HDR_IF_UNMODIFIED_SINCE] = "If-Unmodified-Since",
+  [SG_HDR_LAST_MODIFIED] = "Last-Modified",
+  [SG_HDR_LOCATION] = "Location",
+  [SG_HDR_ORIGIN] = "Origin",
+  [SG_HDR_RANGE] = "Range",
+  [SG_HDR_REFERER] = "Referer",
+  [SG_HDR_SET_COOKIE] = "Set-Cookie",
+  [SG_HDR_TRANSFER_ENCODING] = "Transfer-Encoding",
+  [SG_HDR_USER_AGENT] = "User-Agent",
+  [SG_HDR_VARY] = "Vary",
+  [SG_HDR_WWW_AUTHENTICATE] = "WWW-Authenticate",
+  [SG_HDR_X_FORWARDED_FOR] = "X-Forwarded-For"
+};
+
+/* slot -> ID + 1, zero for an empty slot */
+static const unsigned char sg__httphdrs_slots[64] = {
+  [0] = SG_HDR_REFERER + 1,
+  [2] = SG_HDR_IF_MODIFIED_SINCE + 1,
+  [4] = SG_HDR_WWW_AUTHENTICATE + 1,
+  [9] = SG_HDR_IF_NONE_MATCH + 1,
+  [10] = SG_HDR_IF_UNMODIFIED_SINCE + 1,
+  [12] = SG_HDR_ACCEPT_ENCODING + 1,
+  [13] = SG_HDR_CONNECTION + 1,
+  [15] = SG_HDR_AUTHORIZATION + 1,
+  [16] = SG_HDR_CONTENT_TYPE + 1,
+  [18] = SG_HDR_ACCEPT_LANGUAGE + 1,
+  [19] = SG_HDR_VARY + 1,
+  [20] = SG_HDR_CONTENT_RANGE + 1,
+  [21] = SG_HDR_USER_AGENT + 1,
+  [24] = SG_HDR_SET_COOKIE + 1,
+  [26] = SG_HDR_CONTENT_ENCODING + 1,
+  [28] = SG_HDR_EXPIRES + 1,
+  [30] = SG_HDR_IF_RANGE + 1,
+  [31] = SG_HDR_CACHE_CONTROL + 1,
+  [32] = SG_HDR_ACCEPT_RANGES + 1,
+  [33] = SG_HDR_ACCEPT + 1,
+  [36] = SG_HDR_LAST_MODIFIED + 1,
+  [47] = SG_HDR_CONTENT_LENGTH + 1,
+  [49] = SG_HDR_CONTENT_DISPOSITION + 1,
+  [50] = SG_HDR_LOCATION + 1,
+  [51] = SG_HDR_TRANSFER_ENCODING + 1,
+  [52] = SG_HDR_ETAG + 1,
+  [53] = SG_HDR_IF_MATCH + 1,
+  [56] = SG_HDR_COOKIE + 1,
+  [57] = SG_HDR_ORIGIN + 1,
+  [60] = SG_HDR_HOST + 1,
+  [62] = SG_HDR_X_FORWARDED_FOR + 1,
+  [63] = SG_HDR_RANGE + 1
+};
+
+const char *sg__httphdrs_name(enum sg_hdr id) {
+  return sg__httphdrs_names[id];
+}
+
+int sg__httphdrs_id(const char *name, size_t len) {
+  const char *hdr;
+  int id;
+  if (len == 0)
+    return -1;
+  id = sg__httphdrs_slots[SG__HTTPHDRS_HASH(name, len)] - 1;
+  if (id < 0)
+    return -1;
+  hdr = sg__httphdrs_names[id];
+  if ((strlen(hdr) != len) || (sg__strncasecmp(hdr, name, len) != 0))
+    return -1;
+  return id;
+}
@@ -0,0 +1,40 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_HTTPHDRS_H
+#define SG_HTTPHDRS_H
+
+#include <stddef.h>
+#include "sg_macros.h"
+#include "sagui.h"
+
+/* Returns the canonical name of a well-known header. */
+SG__EXTERN const char *sg__httphdrs_name(enum sg_hdr id);
+
+/* Returns the ID of a well-known header name (case-insensitive) or -1. */
+SG__EXTERN int sg__httphdrs_id(const char *name, size_t len);
+
+#endif /* SG_HTTPHDRS_H */
@@ -24,12 +24,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <string.h>
 #include <errno.h>
 #include <pthread.h>
 #include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
 #include "sg_extra.h"
+#include "sg_httphdrs.h"
 #include "sg_httpreq.h"
 #include "sg_httpres.h"
 #include "sg_httpauth.h"
@@ -56,6 +58,8 @@ struct sg_httpreq *sg__httpreq_new(struct sg_httpsrv *srv,
   req->res = sg__httpres_new(con);
   if (!req->res)
     goto error;
+  req->res->srv = srv;
+  req->res->method = method;
   req->auth = sg__httpauth_new(req->res);
   if (!req->auth)
     goto error;
@@ -82,9 +86,15 @@ void sg__httpreq_free(struct sg_httpreq *req) {
   sg_strmap_cleanup(&req->headers);
   sg_strmap_cleanup(&req->cookies);
   sg_strmap_cleanup(&req->params);
+  sg_free(req->headers_pairs);
+  sg_free(req->cookies_pairs);
+  sg_free(req->params_pairs);
   sg_strmap_cleanup(&req->fields);
+  sg_free(req->fields_pairs);
+  sg_free(req->fields_buf);
   sg_str_free(req->payload);
   MHD_destroy_post_processor(req->pp);
+  sg__httpform_free(req->form);
   sg__httpres_free(req->res);
   sg__httpauth_free(req->auth);
   sg_free(req);
@@ -102,9 +112,9 @@ struct sg_strmap **sg_httpreq_headers(struct sg_httpreq *req) {
     errno = EINVAL;
     return NULL;
   }
-  if (!req->headers)
-    MHD_get_connection_values(req->con, MHD_HEADER_KIND, sg__convals_iter,
-                              &req->headers);
+  if (!req->headers_pairs)
+    req->headers_pairs =
+      sg__convals_view(req->con, MHD_HEADER_KIND, &req->headers);
   return &req->headers;
 }
 
@@ -113,9 +123,9 @@ struct sg_strmap **sg_httpreq_cookies(struct sg_httpreq *req) {
     errno = EINVAL;
     return NULL;
   }
-  if (!req->cookies)
-    MHD_get_connection_values(req->con, MHD_COOKIE_KIND, sg__convals_iter,
-                              &req->cookies);
+  if (!req->cookies_pairs)
+    req->cookies_pairs =
+      sg__convals_view(req->con, MHD_COOKIE_KIND, &req->cookies);
   return &req->cookies;
 }
 
@@ -124,12 +134,67 @@ struct sg_strmap **sg_httpreq_params(struct sg_httpreq *req) {
     errno = EINVAL;
     return NULL;
   }
-  if (!req->params)
-    MHD_get_connection_values(req->con, MHD_GET_ARGUMENT_KIND, sg__convals_iter,
-                              &req->params);
+  if (!req->params_pairs)
+    req->params_pairs =
+      sg__convals_view(req->con, MHD_GET_ARGUMENT_KIND, &req->params);
   return &req->params;
 }
 
+const char *sg_httpreq_get_header(struct sg_httpreq *req, const char *name) {
+  if (!req || !name) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return req->con ? MHD_lookup_connection_value(req->con, MHD_HEADER_KIND, name)
+                  : NULL;
+}
+
+static enum MHD_Result
+  sg__httpreq_hdrs_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind,
+                        const char *key, const char *val) {
+  struct sg_httpreq *req = cls;
+  int id;
+  if (key && val) {
+    id = sg__httphdrs_id(key, strlen(key));
+    if ((id >= 0) && !req->hdrs[id])
+      req->hdrs[id] = val;
+  }
+  return MHD_YES;
+}
+
+const char *sg_httpreq_header(struct sg_httpreq *req, enum sg_hdr id) {
+  if (!req || ((int) id < 0) || (id >= SG_HDR_COUNT)) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if (!req->hdrs_ready) {
+    if (req->con)
+      MHD_get_connection_values(req->con, MHD_HEADER_KIND,
+                                sg__httpreq_hdrs_iter, req);
+    req->hdrs_ready = true;
+  }
+  return req->hdrs[id];
+}
+
+const char *sg_httpreq_get_cookie(struct sg_httpreq *req, const char *name) {
+  if (!req || !name) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return req->con ? MHD_lookup_connection_value(req->con, MHD_COOKIE_KIND, name)
+                  : NULL;
+}
+
+const char *sg_httpreq_get_param(struct sg_httpreq *req, const char *name) {
+  if (!req || !name) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return req->con ? MHD_lookup_connection_value(req->con,
+                                                MHD_GET_ARGUMENT_KIND, name)
+                  : NULL;
+}
+
 struct sg_strmap **sg_httpreq_fields(struct sg_httpreq *req) {
   if (req)
     return &req->fields;
@@ -32,6 +32,7 @@
 #include "sg_macros.h"
 #include "microhttpd.h"
 #include "sagui.h"
+#include "sg_httpform.h"
 #include "sg_httpuplds.h"
 #include "sg_httpres.h"
 #include "sg_httpsrv.h"
@@ -40,6 +41,7 @@ struct sg_httpreq {
   struct sg_httpsrv *srv;
   struct MHD_Connection *con;
   struct MHD_PostProcessor *pp;
+  struct sg__httpform *form;
   struct sg_httpauth *auth;
   struct sg_httpres *res;
   struct sg_httpupld *uplds;
@@ -49,6 +51,18 @@ struct sg_httpreq {
   struct sg_strmap *cookies;
   struct sg_strmap *params;
   struct sg_strmap *fields;
+  /* blocks of the pairs borrowing the connection values */
+  struct sg_strmap *headers_pairs;
+  struct sg_strmap *cookies_pairs;
+  struct sg_strmap *params_pairs;
+  /* well-known headers, recorded on the first sg_httpreq_header() call */
+  const char *hdrs[SG_HDR_COUNT];
+  bool hdrs_ready;
+  /* url-encoded body and the pairs pointing into it */
+  char *fields_buf;
+  size_t fields_len;
+  size_t fields_size;
+  struct sg_strmap *fields_pairs;
   struct sg_str *payload;
   const char *version;
   const char *method;
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -42,7 +43,9 @@
 #include "sg_utils.h"
 #include "sg_strmap.h"
 #include "sg_extra.h"
+#include "sg_httphdrs.h"
 #include "sg_httpres.h"
+#include "sg_httpsrv.h"
 
 static void sg__httpres_openfile(struct sg_httpres *res, const char *filename,
                                  const char *disposition, uint64_t max_size,
@@ -105,171 +108,451 @@ error:
 #undef SG__HTTPRES_OPENFILE_ERROR /* SG__HTTPRES_OPENFILE_ERROR */
 }
 
+static const char *sg__httpres_reqhdr(struct sg_httpres *res,
+                                      const char *name) {
+  if (!res->con)
+    return NULL;
+  return MHD_lookup_connection_value(res->con, MHD_HEADER_KIND, name);
+}
+
+static const char *sg__httpres_ows(const char *p, const char *end) {
+  while ((p < end) && ((*p == ' ') || (*p == '\t')))
+    p++;
+  return p;
+}
+
 #ifdef SG_HTTP_COMPRESSION
 
+static const char *sg__httpres_zname(enum sg__httpres_zcoding coding) {
+  switch (coding) {
+  case SG__HTTPRES_ZGZIP:
+    return "gzip";
+  case SG__HTTPRES_ZBROTLI:
+    return "br";
+  case SG__HTTPRES_ZZSTD:
+    return "zstd";
+  default:
+    return "deflate";
+  }
+}
+
+static size_t sg__httpres_zbound(enum sg__httpres_zcoding coding,
+                                 size_t size) {
+#ifdef SG_HTTP_BROTLI
+  if (coding == SG__HTTPRES_ZBROTLI)
+    return BrotliEncoderMaxCompressedSize(size);
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  if (coding == SG__HTTPRES_ZZSTD)
+    return ZSTD_compressBound(size);
+#endif /* SG_HTTP_ZSTD */
+  /* the gzip wrapper is 12 bytes larger than the zlib one */
+  return compressBound(size) + (coding == SG__HTTPRES_ZGZIP ? 12 : 0);
+}
+
+/* Compresses `buf` into `zbuf`, whose capacity is passed in `zsize`. */
+static int sg__httpres_zcompress(enum sg__httpres_zcoding coding, int level,
+                                 void *buf, size_t size, void *zbuf,
+                                 size_t *zsize) {
+  uLongf len;
+  int ret;
+#ifdef SG_HTTP_BROTLI
+  if (coding == SG__HTTPRES_ZBROTLI)
+    return sg__brcompress(buf, size, zbuf, zsize, level);
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  if (coding == SG__HTTPRES_ZZSTD)
+    return sg__zstdcompress(buf, size, zbuf, zsize, level);
+#endif /* SG_HTTP_ZSTD */
+  len = (uLongf) *zsize;
+  ret = sg__zcompress(buf, size, zbuf, &len, level,
+                      (coding == SG__HTTPRES_ZGZIP ? MAX_WBITS + 16
+                                                   : MAX_WBITS));
+  *zsize = (size_t) len;
+  return ret;
+}
+
+static int sg__httpres_zinit(struct sg__httpres_zholder *holder, int level,
+                             unsigned int threads) {
+#ifdef SG_HTTP_BROTLI
+  if (holder->coding == SG__HTTPRES_ZBROTLI) {
+    holder->br = BrotliEncoderCreateInstance(sg__bralloc, sg__brfree, NULL);
+    if (!holder->br)
+      return ENOMEM;
+    BrotliEncoderSetParameter(holder->br, BROTLI_PARAM_QUALITY,
+                              (uint32_t) SG__BRQUALITY(level));
+    return 0;
+  }
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  if (holder->coding == SG__HTTPRES_ZZSTD) {
+    holder->zstd = ZSTD_createCStream();
+    if (!holder->zstd)
+      return ENOMEM;
+    ZSTD_CCtx_setParameter(holder->zstd, ZSTD_c_compressionLevel,
+                           SG__ZSTDLEVEL(level));
+    return 0;
+  }
+#endif /* SG_HTTP_ZSTD */
+  if ((holder->coding == SG__HTTPRES_ZGZIP) && (threads > 1))
+    return sg__pgz_new(level, threads, &holder->pgz);
+  return sg__zpool_get(level,
+                       (holder->coding == SG__HTTPRES_ZGZIP ? MAX_WBITS + 16
+                                                            : MAX_WBITS),
+                       &holder->stream);
+}
+
+static void sg__httpres_zend(struct sg__httpres_zholder *holder) {
+  if (holder->pgz) {
+    sg__pgz_free(holder->pgz);
+    return;
+  }
+#ifdef SG_HTTP_BROTLI
+  if (holder->coding == SG__HTTPRES_ZBROTLI) {
+    BrotliEncoderDestroyInstance(holder->br);
+    return;
+  }
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  if (holder->coding == SG__HTTPRES_ZZSTD) {
+    ZSTD_freeCStream(holder->zstd);
+    return;
+  }
+#endif /* SG_HTTP_ZSTD */
+  sg__zpool_put(holder->stream);
+}
+
+static int sg__httpres_zencode(struct sg__httpres_zholder *holder, bool finish,
+                               Bytef *dest, size_t *dest_size, bool *finished) {
+#ifdef SG_HTTP_BROTLI
+  if (holder->coding == SG__HTTPRES_ZBROTLI)
+    return sg__brencode(holder->br, &holder->next_in, &holder->avail_in,
+                        finish, dest, dest_size, finished);
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  if (holder->coding == SG__HTTPRES_ZZSTD)
+    return sg__zstdencode(holder->zstd, &holder->next_in, &holder->avail_in,
+                          finish, dest, dest_size, finished);
+#endif /* SG_HTTP_ZSTD */
+  if (holder->pgz)
+    return sg__pgz_encode(holder->pgz, &holder->next_in, &holder->avail_in,
+                          finish, dest, dest_size, finished);
+  return sg__zdeflate(holder->stream, &holder->next_in, &holder->avail_in,
+                      finish, dest, dest_size, finished);
+}
+
+/* Encodes straight into `mem`; a block the encoder could not fill yet is
+   completed with more input instead of being buffered aside. */
 static ssize_t sg__httpres_zread_cb(void *handle, __SG_UNUSED uint64_t offset,
                                     char *mem, size_t size) {
   struct sg__httpres_zholder *holder = handle;
-  z_size_t have;
-  int flush;
+  ssize_t have;
+  size_t out, chunk;
+  bool finished;
   if (holder->status == SG__HTTPRES_ZFINISHED)
     return MHD_CONTENT_READER_END_OF_STREAM;
-  if (holder->status != SG__HTTPRES_ZWRITING) {
-    have =
-      (z_size_t) holder->read_cb(holder->handle, holder->offset_in, mem, size);
-    if (have == (z_size_t) MHD_CONTENT_READER_END_WITH_ERROR)
-      return MHD_CONTENT_READER_END_WITH_ERROR;
-    if (have == (z_size_t) MHD_CONTENT_READER_END_OF_STREAM) {
-      holder->status = SG__HTTPRES_ZFINISHED;
-      have = 0;
-      flush = Z_FINISH;
-    } else {
-      holder->offset_in += have;
-      if ((holder->size_in > 0) && (holder->offset_in > holder->size_in)) {
-        holder->status = SG__HTTPRES_ZFINISHED;
-        holder->offset_in -= have;
-        have = 0;
-        flush = Z_FINISH;
-      } else
-        flush = Z_NO_FLUSH;
-    }
-    if (sg__zdeflate(&holder->stream, holder->buf_in, flush, (Bytef *) mem,
-                     (uInt) have, &holder->buf_out, &have) != 0)
-      return MHD_CONTENT_READER_END_WITH_ERROR;
-    if (have > size) {
-      holder->status = SG__HTTPRES_ZWRITING;
-      holder->size_out = have;
-      holder->offset_out = 0;
-      return 0;
-    } else
-      memcpy(mem, holder->buf_out, have);
-  } else {
-    have = size;
-    holder->offset_out += have;
-    if (holder->offset_out >= holder->size_out) {
-      holder->status = SG__HTTPRES_ZPROCESSING;
-      if (holder->offset_out > holder->size_out) {
-        holder->offset_out -= have;
-        have = holder->size_out - holder->offset_out;
-        memcpy(mem, holder->buf_out + holder->offset_out, have);
-        goto done;
+  do {
+    if ((holder->avail_in == 0) &&
+        (holder->status == SG__HTTPRES_ZPROCESSING)) {
+      chunk = SG__ZLIB_CHUNK;
+      if ((holder->size_in > 0) &&
+          (holder->size_in - holder->offset_in < chunk))
+        chunk = (size_t) (holder->size_in - holder->offset_in);
+      have = holder->read_cb(holder->handle, holder->offset_in,
+                             (char *) holder->buf_in, chunk);
+      if (have == MHD_CONTENT_READER_END_WITH_ERROR)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+      if (have == MHD_CONTENT_READER_END_OF_STREAM)
+        holder->status = SG__HTTPRES_ZFINISHING;
+      else if (have == 0)
+        return 0;
+      else {
+        holder->next_in = holder->buf_in;
+        holder->avail_in = (size_t) have;
+        holder->offset_in += (uint64_t) have;
+        if ((holder->size_in > 0) && (holder->offset_in >= holder->size_in))
+          holder->status = SG__HTTPRES_ZFINISHING;
       }
     }
-    memcpy(mem, holder->buf_out + (holder->offset_out - have), have);
-  }
-done:
-  if (holder->status != SG__HTTPRES_ZWRITING)
-    sg_free(holder->buf_out);
-  return have;
+    out = size;
+    if (sg__httpres_zencode(holder,
+                            holder->status == SG__HTTPRES_ZFINISHING,
+                            (Bytef *) mem, &out, &finished) != 0)
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    if (finished)
+      holder->status = SG__HTTPRES_ZFINISHED;
+  } while ((out == 0) && (holder->status != SG__HTTPRES_ZFINISHED));
+  return out > 0 ? (ssize_t) out : MHD_CONTENT_READER_END_OF_STREAM;
 }
 
 static void sg__httpres_zfree_cb(void *handle) {
   struct sg__httpres_zholder *holder = handle;
   if (!holder)
     return;
-  deflateEnd(&holder->stream);
+  sg__httpres_zend(holder);
   sg_free(holder->buf_in);
   if (holder->free_cb)
     holder->free_cb(holder->handle);
   sg_free(holder);
 }
 
-static ssize_t sg__httpres_gzread_cb(void *handle, __SG_UNUSED uint64_t offset,
+static ssize_t sg__httpres_fdread_cb(void *handle, __SG_UNUSED uint64_t offset,
                                      char *mem, size_t size) {
-  struct sg__httpres_gzholder *holder = handle;
-  z_size_t have;
-  int flush;
-  if (holder->status == SG__HTTPRES_GZNONE) {
-    holder->status = SG__HTTPRES_GZPROCESSING;
-    mem[0] = (char) 0x1f;
-    mem[1] = (char) 0x8b;
-    mem[2] = (char) 0x08;
-    mem[3] = (char) 0x00;
-    mem[4] = (char) 0x00;
-    mem[5] = (char) 0x00;
-    mem[6] = (char) 0x00;
-    mem[7] = (char) 0x00;
-    mem[8] = (char) 0x00;
-#ifdef _WIN32
-    mem[9] = (char) 0x0b;
-#else /* _WIN32 */
-    mem[9] = (char) 0x03;
-#endif /* _WIN32 */
-    holder->crc = crc32(0L, Z_NULL, 0);
-    return 10;
-  }
-  if (holder->status == SG__HTTPRES_GZFINISHING) {
-    holder->status = SG__HTTPRES_GZFINISHED;
-    mem[0] = (char) (holder->crc & 0xff);
-    mem[1] = (char) ((holder->crc >> 8) & 0xff);
-    mem[2] = (char) ((holder->crc >> 16) & 0xff);
-    mem[3] = (char) ((holder->crc >> 24) & 0xff);
-    mem[4] = (char) ((holder->offset_in) & 0xff);
-    mem[5] = (char) ((holder->offset_in >> 8) & 0xff);
-    mem[6] = (char) ((holder->offset_in >> 16) & 0xff);
-    mem[7] = (char) ((holder->offset_in >> 24) & 0xff);
-    return 8;
-  }
-  if (holder->status == SG__HTTPRES_GZFINISHED)
-    return MHD_CONTENT_READER_END_OF_STREAM;
-  if (holder->status != SG__HTTPRES_GZWRITING) {
-    have = (size_t) read(*holder->handle, mem, size);
-    if ((ssize_t) have < 0)
-      return MHD_CONTENT_READER_END_WITH_ERROR;
-    if (have == 0) {
-      holder->status = SG__HTTPRES_GZFINISHING;
-      flush = Z_FINISH;
-    } else {
-      holder->offset_in += have;
-      if ((holder->size_in > 0) && (holder->offset_in > holder->size_in)) {
-        holder->status = SG__HTTPRES_GZFINISHING;
-        holder->offset_in -= have;
-        have = 0;
-        flush = Z_FINISH;
-      } else {
-        holder->crc = crc32(holder->crc, (z_const Bytef *) mem, (uInt) have);
-        flush = Z_NO_FLUSH;
-      }
-    }
-    if (sg__zdeflate(&holder->stream, holder->buf_in, flush, (Bytef *) mem,
-                     (uInt) have, &holder->buf_out, &have) != 0)
-      return MHD_CONTENT_READER_END_WITH_ERROR;
-    if (have > size) {
-      holder->status = SG__HTTPRES_GZWRITING;
-      holder->size_out = have;
-      holder->offset_out = 0;
-      return 0;
-    } else
-      memcpy(mem, holder->buf_out, have);
-  } else {
-    have = size;
-    holder->offset_out += have;
-    if (holder->offset_out >= holder->size_out) {
-      holder->status = SG__HTTPRES_GZPROCESSING;
-      if (holder->offset_out > holder->size_out) {
-        holder->offset_out -= have;
-        have = holder->size_out - holder->offset_out;
-        memcpy(mem, holder->buf_out + holder->offset_out, have);
-        goto done;
-      }
+  ssize_t have = read(*(int *) handle, mem, size);
+  if (have < 0)
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  return have > 0 ? have : MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+static void sg__httpres_fdfree_cb(void *handle) {
+  close(*(int *) handle);
+  sg_free(handle);
+}
+
+/* Returns true if the comma-separated `list` contains `token`. */
+static bool sg__httpres_hastoken(const char *list, const char *token) {
+  size_t len = strlen(token), n;
+  while (*list) {
+    while ((*list == ' ') || (*list == '\t') || (*list == ','))
+      list++;
+    n = strcspn(list, ",; \t");
+    if ((n == len) && (sg__strncasecmp(list, token, len) == 0))
+      return true;
+    list += n;
+    list += strcspn(list, ",");
+  }
+  return false;
+}
+
+/* Parses a qvalue (RFC 7231, 5.3.1) into thousandths, or -1 if malformed. */
+static int sg__httpres_qvalue(const char *p, size_t len) {
+  int q, mul = 100;
+  size_t i;
+  if ((len == 0) || (len > 5) || ((*p != '0') && (*p != '1')))
+    return -1;
+  q = (*p - '0') * 1000;
+  if (len == 1)
+    return q;
+  if (p[1] != '.')
+    return -1;
+  for (i = 2; i < len; i++) {
+    if ((p[i] < '0') || (p[i] > '9'))
+      return -1;
+    q += (p[i] - '0') * mul;
+    mul /= 10;
+  }
+  return q > 1000 ? -1 : q;
+}
+
+/* Returns the `q` parameter of a list element, 1000 when it has none. */
+static int sg__httpres_qparam(const char *p, const char *end) {
+  const char *val;
+  while ((p = memchr(p, ';', (size_t) (end - p)))) {
+    p = sg__httpres_ows(p + 1, end);
+    if ((p == end) || ((*p != 'q') && (*p != 'Q')))
+      continue;
+    p = sg__httpres_ows(p + 1, end);
+    if ((p == end) || (*p != '='))
+      continue;
+    val = p = sg__httpres_ows(p + 1, end);
+    while ((p < end) && (*p != ';') && (*p != ' ') && (*p != '\t'))
+      p++;
+    return sg__httpres_qvalue(val, (size_t) (p - val));
+  }
+  return 1000;
+}
+
+/* Picks the coding of `codings` the client prefers, the first ones winning
+   on a q-value tie. */
+static enum sg__httpres_zcoding
+sg__httpres_zpick(const char *accept, enum sg__httpres_zcoding def,
+                  const enum sg__httpres_zcoding *codings, size_t count) {
+#define SG__ANY (SG__HTTPRES_ZZSTD + 1)
+  /* q-values in thousandths indexed by coding, -1 means not listed */
+  int q[SG__ANY + 1], id, val;
+  enum sg__httpres_zcoding best;
+  const char *end;
+  size_t len, i;
+  if (!accept)
+    return def;
+  for (id = 0; id <= SG__ANY; id++)
+    q[id] = -1;
+  while (*accept) {
+    while ((*accept == ' ') || (*accept == '\t') || (*accept == ','))
+      accept++;
+    len = strcspn(accept, ",; \t");
+    end = accept + len + strcspn(accept + len, ",");
+#define SG__IS(token)                                                          \
+  ((len == strlen(token)) && (sg__strncasecmp(accept, token, len) == 0))
+    if (SG__IS("gzip") || SG__IS("x-gzip"))
+      id = SG__HTTPRES_ZGZIP;
+    else if (SG__IS("deflate"))
+      id = SG__HTTPRES_ZDEFLATE;
+    else if (SG__IS("br"))
+      id = SG__HTTPRES_ZBROTLI;
+    else if (SG__IS("zstd"))
+      id = SG__HTTPRES_ZZSTD;
+    else if (SG__IS("identity"))
+      id = SG__HTTPRES_ZIDENTITY;
+    else if (SG__IS("*"))
+      id = SG__ANY;
+    else
+      id = -1;
+#undef SG__IS /* SG__IS */
+    if (id >= 0) {
+      val = sg__httpres_qparam(accept + len, end);
+      if (val > q[id])
+        q[id] = val;
     }
-    memcpy(mem, holder->buf_out + (holder->offset_out - have), have);
+    accept = end;
   }
-done:
-  if (holder->status != SG__HTTPRES_GZWRITING)
-    sg_free(holder->buf_out);
-  return have;
+  /* codings not listed take the "*" weight; identity is still used as the last
+     resort when nothing else is acceptable (RFC 7231, 5.3.4) */
+  for (id = 0; id < SG__ANY; id++)
+    if (q[id] < 0)
+      q[id] = q[SG__ANY] < 0 ? 0 : q[SG__ANY];
+  best = codings[0];
+  for (i = 1; i < count; i++)
+    if (q[codings[i]] > q[best])
+      best = codings[i];
+#undef SG__ANY /* SG__ANY */
+  if ((q[best] > 0) && (q[best] >= q[SG__HTTPRES_ZIDENTITY]))
+    return best;
+  return SG__HTTPRES_ZIDENTITY;
 }
 
-static void sg__httpres_gzfree_cb(void *handle) {
-  struct sg__httpres_gzholder *holder = handle;
-  if (!holder)
-    return;
-  deflateEnd(&holder->stream);
+enum sg__httpres_zcoding sg__httpres_zcoding(const char *accept,
+                                             enum sg__httpres_zcoding def) {
+  /* compressed codings built in, the preferred ones first */
+  static const enum sg__httpres_zcoding codings[] = {
+#ifdef SG_HTTP_BROTLI
+    SG__HTTPRES_ZBROTLI,
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+    SG__HTTPRES_ZZSTD,
+#endif /* SG_HTTP_ZSTD */
+    SG__HTTPRES_ZGZIP, SG__HTTPRES_ZDEFLATE};
+  return sg__httpres_zpick(accept, def, codings,
+                           sizeof(codings) / sizeof(codings[0]));
+}
+
+int sg__httpres_vary(struct sg_httpres *res) {
+  const char *vary = res->hdrs[SG_HDR_VARY];
+  char *str;
+  size_t len;
+  if (!vary)
+    vary = sg_strmap_get(res->headers, MHD_HTTP_HEADER_VARY);
+  if (!vary || (*vary == '\0'))
+    return sg_httpres_set_header(res, SG_HDR_VARY,
+                                 MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  if (sg__httpres_hastoken(vary, "*") ||
+      sg__httpres_hastoken(vary, MHD_HTTP_HEADER_ACCEPT_ENCODING))
+    return 0;
+  len = strlen(vary) + strlen(", " MHD_HTTP_HEADER_ACCEPT_ENCODING) + 1;
+  str = sg_malloc(len);
+  if (!str)
+    return ENOMEM;
+  snprintf(str, len, "%s, %s", vary, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  sg_free(res->hdrs[SG_HDR_VARY]);
+  res->hdrs[SG_HDR_VARY] = str;
+  return 0;
+}
+
+bool sg__httpres_ztype(const char *types, const char *type) {
+  size_t len, n;
+  type = sg__httpres_ows(type, type + strlen(type));
+  len = strcspn(type, "; \t");
+  if (len == 0)
+    return false;
+  while (*types) {
+    while ((*types == ' ') || (*types == '\t') || (*types == ','))
+      types++;
+    n = strcspn(types, ", \t");
+    if (((n == 1) && (*types == '*')) ||
+        ((n == 3) && (strncmp(types, "*/*", 3) == 0)))
+      return true;
+    if ((n > 2) && (types[n - 2] == '/') && (types[n - 1] == '*')) {
+      if ((len > n - 1) && (sg__strncasecmp(types, type, n - 1) == 0))
+        return true;
+    } else if ((n == len) && (sg__strncasecmp(types, type, n) == 0))
+      return true;
+    types += n;
+    types += strcspn(types, ",");
+  }
+  return false;
+}
+
+static const char *sg__httpres_accept(struct sg_httpres *res) {
+  return sg__httpres_reqhdr(res, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+}
+
+static enum sg__httpres_zcoding
+sg__httpres_negotiate(struct sg_httpres *res, enum sg__httpres_zcoding def) {
+  return sg__httpres_zcoding(sg__httpres_accept(res), def);
+}
+
+/* Workers of the parallel gzip encoder, which only pays off on large
+   bodies. */
+static unsigned int sg__httpres_zthreads(struct sg_httpres *res,
+                                         enum sg__httpres_zcoding coding,
+                                         uint64_t size) {
+  if (!res->srv || (coding != SG__HTTPRES_ZGZIP) || (size < SG__PGZ_MIN_SIZE))
+    return 0;
+  return res->srv->zthreads;
+}
+
+static int sg__httpres_zstream(struct sg_httpres *res, int level,
+                               enum sg__httpres_zcoding coding, uint64_t size,
+                               sg_read_cb read_cb, void *handle,
+                               sg_free_cb free_cb, unsigned int status) {
+  struct sg__httpres_zholder *holder;
+  int errnum;
+  holder = sg_alloc(sizeof(struct sg__httpres_zholder));
+  if (!holder) {
+    errnum = ENOMEM;
+    goto error;
+  }
+  holder->coding = coding;
+  errnum =
+    sg__httpres_zinit(holder, level, sg__httpres_zthreads(res, coding, size));
+  if (errnum != 0)
+    goto error_stream;
+  holder->buf_in = sg_malloc(SG__ZLIB_CHUNK);
+  if (!holder->buf_in) {
+    errnum = ENOMEM;
+    goto error_buf_in;
+  }
+  errnum = sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING,
+                         sg__httpres_zname(coding));
+  if (errnum != 0)
+    goto error_res;
+  holder->read_cb = read_cb;
+  holder->free_cb = free_cb;
+  holder->handle = handle;
+  holder->size_in = size;
+  res->handle = MHD_create_response_from_callback(
+    MHD_SIZE_UNKNOWN, SG__BLOCK_SIZE, sg__httpres_zread_cb, holder,
+    sg__httpres_zfree_cb);
+  if (!res->handle) {
+    errnum = ENOMEM;
+    goto error_res;
+  }
+  res->status = status;
+#ifdef SG_TESTING
+  errnum = 0;
+#else /* SG_TESTING */
+  return 0;
+#endif /* SG_TESTING */
+error_res:
   sg_free(holder->buf_in);
-  close(*holder->handle);
-  sg_free(holder->handle);
+error_buf_in:
+  sg__httpres_zend(holder);
+error_stream:
   sg_free(holder);
+error:
+  if (free_cb)
+    free_cb(handle);
+  return errnum;
 }
 
 #endif /* SG_HTTP_COMPRESSION */
@@ -283,16 +566,42 @@ struct sg_httpres *sg__httpres_new(struct MHD_Connection *con) {
   return res;
 }
 
+static void sg__httpres_hdrs_cleanup(struct sg_httpres *res) {
+  int id;
+  for (id = 0; id < SG_HDR_COUNT; id++) {
+    sg_free(res->hdrs[id]);
+    res->hdrs[id] = NULL;
+  }
+}
+
 void sg__httpres_free(struct sg_httpres *res) {
   if (!res)
     return;
   sg_strmap_cleanup(&res->headers);
+  sg__httpres_hdrs_cleanup(res);
   MHD_destroy_response(res->handle);
   sg_free(res);
 }
 
+static int sg__httpres_headers_iter(void *cls, struct sg_strmap *header) {
+  struct sg_httpres *res = cls;
+  int id = sg__httphdrs_id(header->name, strlen(header->name));
+  if ((id < 0) || !res->hdrs[id])
+    MHD_add_response_header(res->handle, header->name, header->val);
+  return 0;
+}
+
+void sg__httpres_headers(struct sg_httpres *res) {
+  int id;
+  for (id = 0; id < SG_HDR_COUNT; id++)
+    if (res->hdrs[id])
+      MHD_add_response_header(res->handle, sg__httphdrs_name(id),
+                              res->hdrs[id]);
+  sg_strmap_iter(res->headers, sg__httpres_headers_iter, res);
+}
+
 int sg__httpres_dispatch(struct sg_httpres *res) {
-  sg_strmap_iter(res->headers, sg__strmap_iter, res->handle);
+  sg__httpres_headers(res);
   res->ret = MHD_queue_response(res->con, res->status, res->handle);
   return res->ret;
 }
@@ -304,6 +613,21 @@ struct sg_strmap **sg_httpres_headers(struct sg_httpres *res) {
   return NULL;
 }
 
+int sg_httpres_set_header(struct sg_httpres *res, enum sg_hdr id,
+                          const char *val) {
+  char *dup;
+  /* a single value per ID, while each cookie needs its own header */
+  if (!res || ((int) id < 0) || (id >= SG_HDR_COUNT) ||
+      (id == SG_HDR_SET_COOKIE) || !val)
+    return EINVAL;
+  dup = strdup(val);
+  if (!dup)
+    return ENOMEM;
+  sg_free(res->hdrs[id]);
+  res->hdrs[id] = dup;
+  return 0;
+}
+
 int sg_httpres_set_cookie(struct sg_httpres *res, const char *name,
                           const char *val) {
   char *str;
@@ -322,13 +646,152 @@ int sg_httpres_set_cookie(struct sg_httpres *res, const char *name,
   return ret;
 }
 
-int sg_httpres_sendbinary(struct sg_httpres *res, void *buf, size_t size,
-                          const char *content_type, unsigned int status) {
-  int ret;
-  if (!res || !buf || ((ssize_t) size < 0) || (status < 100) || (status > 599))
+/* Gets a response header set by ID or by name. */
+static const char *sg__httpres_hdr(struct sg_httpres *res, enum sg_hdr id) {
+  if (res->hdrs[id])
+    return res->hdrs[id];
+  return sg_strmap_get(res->headers, sg__httphdrs_name(id));
+}
+
+/* Formats `t` as an IMF-fixdate (RFC 7231, 7.1.1.1), e.g.
+   `Sun, 06 Nov 1994 08:49:37 GMT`, into a buffer of at least 30 bytes. */
+static int sg__httpres_httpdate(time_t t, char *buf, size_t size) {
+  static const char days[7][4] = {"Sun", "Mon", "Tue", "Wed",
+                                  "Thu", "Fri", "Sat"};
+  static const char months[12][4] = {"Jan", "Feb", "Mar", "Apr",
+                                     "May", "Jun", "Jul", "Aug",
+                                     "Sep", "Oct", "Nov", "Dec"};
+  struct tm tm;
+#ifdef _WIN32
+  if (gmtime_s(&tm, &t) != 0)
     return EINVAL;
-  if (res->handle)
-    return EALREADY;
+#else /* _WIN32 */
+  if (!gmtime_r(&t, &tm))
+    return EINVAL;
+#endif /* _WIN32 */
+  snprintf(buf, size, "%s, %02d %s %04d %02d:%02d:%02d GMT", days[tm.tm_wday],
+           tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour,
+           tm.tm_min, tm.tm_sec);
+  return 0;
+}
+
+/* Parses an IMF-fixdate, the date format HTTP/1.1 senders must generate. */
+static int sg__httpres_parsedate(const char *val, time_t *t) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  const char *p;
+  char mon[4];
+  int64_t days;
+  int day, mm, year, hour, min, sec, len = 0;
+  if ((strlen(val) != 29) ||
+      (sscanf(val + 5, "%2d %3s %4d %2d:%2d:%2d GMT%n", &day, mon, &year,
+              &hour, &min, &sec, &len) != 6) ||
+      (len != 24) || (strlen(mon) != 3) || !(p = strstr(months, mon)) ||
+      (((p - months) % 3) != 0) || (day < 1) || (day > 31) || (year < 1970) ||
+      (hour > 23) || (min > 59) || (sec > 60))
+    return EINVAL;
+  /* days since the epoch of a proleptic Gregorian date starting the year in
+     March, so the leap day is the last one */
+  mm = (int) ((p - months) / 3);
+  if (mm < 2)
+    year--;
+  mm = (mm + 10) % 12;
+  days = (int64_t) year * 365 + year / 4 - year / 100 + year / 400 +
+         (153 * mm + 2) / 5 + day - 1 - 719468;
+  *t = (time_t) (days * 86400 + hour * 3600 + min * 60 + sec);
+  return 0;
+}
+
+/* Checks if an `If-None-Match` value is `*` or lists `etag`, comparing weakly,
+   i.e. regardless of the `W/` prefixes. */
+static bool sg__httpres_etagmatch(const char *val, const char *etag) {
+  const char *end = val + strlen(val), *p, *tag;
+  size_t len = 0;
+  p = sg__httpres_ows(val, end);
+  if ((*p == '*') && (sg__httpres_ows(p + 1, end) == end))
+    return true;
+  if (!etag)
+    return false;
+  if (strncmp(etag, "W/", 2) == 0)
+    etag += 2;
+  len = strlen(etag);
+  while (p < end) {
+    if (strncmp(p, "W/", 2) == 0)
+      p += 2;
+    tag = p;
+    if ((*p == '"') && (p = memchr(p + 1, '"', (size_t) (end - p - 1))))
+      p++;
+    if (!p)
+      return false;
+    if (((size_t) (p - tag) == len) && (memcmp(tag, etag, len) == 0))
+      return true;
+    while ((p < end) && (*p != ','))
+      p++;
+    if (p < end)
+      p = sg__httpres_ows(p + 1, end);
+  }
+  return false;
+}
+
+/* Evaluates the `If-None-Match` or else the `If-Modified-Since` condition of a
+   request (RFC 7232, 6) against the validators of the content. Returns false
+   if the content was not modified, so a 304 can be sent. */
+static bool sg__httpres_modified(const char *if_none_match,
+                                 const char *if_modified_since,
+                                 const char *etag, const time_t *mtime) {
+  time_t since;
+  if (if_none_match)
+    return !sg__httpres_etagmatch(if_none_match, etag);
+  if (!if_modified_since || !mtime ||
+      (sg__httpres_parsedate(if_modified_since, &since) != 0) ||
+      (since > time(NULL)))
+    return true;
+  return *mtime > since;
+}
+
+/* Checks if a GET or HEAD request already has the content, taking the
+   entity-tag set in the response. */
+static bool sg__httpres_cached(struct sg_httpres *res, const time_t *mtime) {
+  if (!res->method || ((strcmp(res->method, MHD_HTTP_METHOD_GET) != 0) &&
+                       (strcmp(res->method, MHD_HTTP_METHOD_HEAD) != 0)))
+    return false;
+  return !sg__httpres_modified(
+    sg__httpres_reqhdr(res, MHD_HTTP_HEADER_IF_NONE_MATCH),
+    sg__httpres_reqhdr(res, MHD_HTTP_HEADER_IF_MODIFIED_SINCE),
+    sg__httpres_hdr(res, SG_HDR_ETAG), mtime);
+}
+
+static int sg__httpres_sendnotmodified(struct sg_httpres *res) {
+  res->handle =
+    MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+  if (!res->handle)
+    return ENOMEM;
+  res->status = MHD_HTTP_NOT_MODIFIED;
+  return 0;
+}
+
+/* Adds the hash of the content as its entity-tag, weak since the compression
+   policy may encode the content, and answers 304 if the request matches it.
+   Returns ENOENT when the content must be sent. */
+static int sg__httpres_sendhashed(struct sg_httpres *res, const void *buf,
+                                  size_t size) {
+  char etag[24];
+  int errnum;
+  if (!sg__httpres_hdr(res, SG_HDR_ETAG)) {
+    snprintf(etag, sizeof(etag), "W/\"%016llx\"",
+             (unsigned long long) sg__xxh64(buf, size));
+    errnum = sg_httpres_set_header(res, SG_HDR_ETAG, etag);
+    if (errnum != 0)
+      return errnum;
+  }
+  if (!sg__httpres_cached(res, NULL))
+    return ENOENT;
+  return sg__httpres_sendnotmodified(res);
+}
+
+static int sg__httpres_sendbinary(struct sg_httpres *res, void *buf,
+                                  size_t size, const char *content_type,
+                                  unsigned int status) {
+  int ret;
   if (content_type) {
     ret =
       sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_TYPE, content_type);
@@ -343,6 +806,422 @@ int sg_httpres_sendbinary(struct sg_httpres *res, void *buf, size_t size,
   return 0;
 }
 
+#ifdef SG_HTTP_COMPRESSION
+
+/* Checks the content against the compression policy of the server, taking
+   the media type the response will be sent with. */
+static bool sg__httpres_zwanted(struct sg_httpres *res, size_t size,
+                                const char *content_type) {
+  struct sg_httpsrv *srv = res->srv;
+  const char *type;
+  if (!srv || !srv->ztypes || (size < srv->zmin_size) ||
+      res->hdrs[SG_HDR_CONTENT_ENCODING] ||
+      sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING))
+    return false;
+  type = res->hdrs[SG_HDR_CONTENT_TYPE];
+  if (!type)
+    type = content_type;
+  if (!type)
+    type = sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_TYPE);
+  return type && sg__httpres_ztype(srv->ztypes, type);
+}
+
+/* Compresses at the level of the policy, or at the fastest one while the
+   server is already compressing its maximum of contents. */
+static int sg__httpres_zpolicy(struct sg_httpres *res, void *buf, size_t size,
+                               const char *content_type, unsigned int status) {
+  struct sg_httpsrv *srv = res->srv;
+  int level, ret;
+  sg__httpsrv_lock(srv);
+  level = (srv->zmax_active > 0) && (srv->zactive >= srv->zmax_active)
+            ? Z_BEST_SPEED
+            : srv->zlevel;
+  srv->zactive++;
+  sg__httpsrv_unlock(srv);
+  ret = sg_httpres_zsendbinary2(res, level, buf, size, content_type, status);
+  sg__httpsrv_lock(srv);
+  srv->zactive--;
+  sg__httpsrv_unlock(srv);
+  return ret;
+}
+
+#endif /* SG_HTTP_COMPRESSION */
+
+int sg_httpres_sendbinary(struct sg_httpres *res, void *buf, size_t size,
+                          const char *content_type, unsigned int status) {
+  int errnum;
+  if (!res || !buf || ((ssize_t) size < 0) || (status < 100) || (status > 599))
+    return EINVAL;
+  if (res->handle)
+    return EALREADY;
+  if (res->srv && res->srv->etag && (status == MHD_HTTP_OK)) {
+    errnum = sg__httpres_sendhashed(res, buf, size);
+    if (errnum != ENOENT)
+      return errnum;
+  }
+#ifdef SG_HTTP_COMPRESSION
+  if (sg__httpres_zwanted(res, size, content_type))
+    return sg__httpres_zpolicy(res, buf, size, content_type, status);
+#endif /* SG_HTTP_COMPRESSION */
+  return sg__httpres_sendbinary(res, buf, size, content_type, status);
+}
+
+int sg_httpres_sendallowed(struct sg_httpres *res, unsigned int methods) {
+  char allow[64];
+  int ret;
+  if (!res || (methods == 0) || (methods & ~(unsigned int) SG_METHOD_ANY))
+    return EINVAL;
+  if (res->handle)
+    return EALREADY;
+  sg__methods_str(methods, allow, sizeof(allow));
+  ret = sg_strmap_set(&res->headers, MHD_HTTP_HEADER_ALLOW, allow);
+  if (ret != 0)
+    return ret;
+  return sg_httpres_send(res, "Method Not Allowed", "text/plain",
+                         MHD_HTTP_METHOD_NOT_ALLOWED);
+}
+
+/* Parses a decimal position, saturating on overflow since a huge position is
+   still valid, just not satisfiable. */
+static const char *sg__httpres_rangepos(const char *p, const char *end,
+                                        uint64_t *pos) {
+  const char *start = p;
+  *pos = 0;
+  for (; (p < end) && (*p >= '0') && (*p <= '9'); p++)
+    *pos = *pos > (UINT64_MAX - 9) / 10 ? UINT64_MAX
+                                        : *pos * 10 + (uint64_t) (*p - '0');
+  return p > start ? p : NULL;
+}
+
+int sg__httpres_ranges(const char *val, uint64_t size,
+                       struct sg__httpres_range *ranges, unsigned int *count) {
+  const char *end = val + strlen(val), *p;
+  uint64_t first, last;
+  unsigned int specs = 0;
+  bool suffix, bounded;
+  *count = 0;
+  if ((end - val < 6) || (sg__strncasecmp(val, "bytes", 5) != 0))
+    return EINVAL;
+  p = sg__httpres_ows(val + 5, end);
+  if ((p == end) || (*p++ != '='))
+    return EINVAL;
+  for (;;) {
+    p = sg__httpres_ows(p, end);
+    if ((p < end) && (*p == ','))
+      p++;
+    else if (p == end)
+      break;
+    else {
+      if (++specs > SG__HTTPRES_MAX_RANGES)
+        return EINVAL;
+      first = last = 0;
+      suffix = *p == '-';
+      if (!suffix && (!(p = sg__httpres_rangepos(p, end, &first)) ||
+                      (p == end) || (*p != '-')))
+        return EINVAL;
+      p++;
+      bounded = (p < end) && (*p >= '0') && (*p <= '9');
+      if (bounded)
+        p = sg__httpres_rangepos(p, end, &last);
+      if ((suffix && !bounded) || (!suffix && bounded && (last < first)))
+        return EINVAL;
+      p = sg__httpres_ows(p, end);
+      if ((p < end) && (*p != ','))
+        return EINVAL;
+      if (suffix) {
+        if ((last == 0) || (size == 0))
+          continue;
+        first = last < size ? size - last : 0;
+        last = size - 1;
+      } else {
+        if (first >= size)
+          continue;
+        if (!bounded || (last >= size))
+          last = size - 1;
+      }
+      ranges[*count].first = first;
+      ranges[(*count)++].last = last;
+    }
+  }
+  if (specs == 0)
+    return EINVAL;
+  return *count > 0 ? 0 : ERANGE;
+}
+
+/* Checks if the `If-Range` validator matches the file, so its ranges can be
+   sent. Entity-tags are compared strongly, so the weak ones generated for
+   files never match. */
+static bool sg__httpres_ifrange(struct sg_httpres *res, const char *val,
+                                const struct stat *sbuf) {
+  const char *etag;
+  char date[32];
+  if (strncmp(val, "W/", 2) == 0)
+    return false;
+  if (*val == '"') {
+    etag = sg__httpres_hdr(res, SG_HDR_ETAG);
+    return etag && (strcmp(val, etag) == 0);
+  }
+  return (sg__httpres_httpdate(sbuf->st_mtime, date, sizeof(date)) == 0) &&
+         (strcmp(val, date) == 0);
+}
+
+/* Body of a `multipart/byteranges` response. The head of the part `i` spans
+   `offs[i]..offs[i + 1]` in `heads`, which ends with the close delimiter. */
+struct sg__httpres_parts {
+  struct sg__httpres_range ranges[SG__HTTPRES_MAX_RANGES];
+  size_t offs[SG__HTTPRES_MAX_RANGES + 2];
+  char *heads;
+  unsigned int count;
+  int fd;
+};
+
+static ssize_t sg__httpres_parts_read_cb(void *handle, uint64_t offset,
+                                         char *mem, size_t size) {
+  struct sg__httpres_parts *parts = handle;
+  struct sg__httpres_range *range;
+  uint64_t len;
+  ssize_t have;
+  unsigned int i;
+  for (i = 0; i <= parts->count; i++) {
+    len = parts->offs[i + 1] - parts->offs[i];
+    if (offset < len) {
+      if (len - offset < size)
+        size = (size_t) (len - offset);
+      memcpy(mem, parts->heads + parts->offs[i] + offset, size);
+      return (ssize_t) size;
+    }
+    offset -= len;
+    if (i == parts->count)
+      break;
+    range = &parts->ranges[i];
+    len = range->last - range->first + 1;
+    if (offset < len) {
+      if (len - offset < size)
+        size = (size_t) (len - offset);
+      if (sg__lseek(parts->fd, (sg__off_t) (range->first + offset), SEEK_SET) <
+          0)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+      /* a file shrunk meanwhile can't fill its parts anymore */
+      have = read(parts->fd, mem, size);
+      return have > 0 ? have : MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    offset -= len;
+  }
+  return MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+static void sg__httpres_parts_free_cb(void *handle) {
+  struct sg__httpres_parts *parts = handle;
+  close(parts->fd);
+  sg_free(parts->heads);
+  sg_free(parts);
+}
+
+/* Writes the head of a part, or the close delimiter if `range` is null. */
+static size_t sg__httpres_parthead(char *buf, size_t size,
+                                   const char *boundary, const char *type,
+                                   const struct sg__httpres_range *range,
+                                   uint64_t total) {
+  if (!range)
+    return (size_t) snprintf(buf, size, "\r\n--%s--\r\n", boundary);
+  if (!type)
+    return (size_t) snprintf(
+      buf, size, "\r\n--%s\r\nContent-Range: bytes %llu-%llu/%llu\r\n\r\n",
+      boundary, (unsigned long long) range->first,
+      (unsigned long long) range->last, (unsigned long long) total);
+  return (size_t) snprintf(buf, size,
+                           "\r\n--%s\r\nContent-Type: %s\r\n"
+                           "Content-Range: bytes %llu-%llu/%llu\r\n\r\n",
+                           boundary, type, (unsigned long long) range->first,
+                           (unsigned long long) range->last,
+                           (unsigned long long) total);
+}
+
+/* Lays out the part heads of `ranges`, returning the size of the body. */
+static struct sg__httpres_parts *
+sg__httpres_parts_new(const char *boundary, const char *type,
+                      const struct sg__httpres_range *ranges,
+                      unsigned int count, uint64_t total, uint64_t *size) {
+  struct sg__httpres_parts *parts;
+  size_t len;
+  unsigned int i;
+  parts = sg_alloc(sizeof(struct sg__httpres_parts));
+  if (!parts)
+    return NULL;
+  memcpy(parts->ranges, ranges, count * sizeof(struct sg__httpres_range));
+  parts->count = count;
+  parts->fd = -1;
+  *size = 0;
+  for (i = 0; i <= count; i++) {
+    len = sg__httpres_parthead(NULL, 0, boundary, type,
+                               i < count ? &ranges[i] : NULL, total);
+    parts->offs[i + 1] = parts->offs[i] + len;
+    *size += len + (i < count ? ranges[i].last - ranges[i].first + 1 : 0);
+  }
+  parts->heads = sg_malloc(parts->offs[count + 1] + 1);
+  if (!parts->heads) {
+    sg_free(parts);
+    return NULL;
+  }
+  for (i = 0; i <= count; i++)
+    sg__httpres_parthead(parts->heads + parts->offs[i],
+                         parts->offs[i + 1] - parts->offs[i] + 1, boundary,
+                         type, i < count ? &ranges[i] : NULL, total);
+  return parts;
+}
+
+static int sg__httpres_sendparts(struct sg_httpres *res, int fd,
+                                 const struct stat *sbuf,
+                                 const struct sg__httpres_range *ranges,
+                                 unsigned int count) {
+  struct sg__httpres_parts *parts;
+  const char *type;
+  char boundary[40], *ctype;
+  uint64_t size;
+  size_t len;
+  int errnum;
+  snprintf(boundary, sizeof(boundary), "%016llx%08llx",
+           (unsigned long long) (uintptr_t) res,
+           (unsigned long long) time(NULL));
+  type = res->hdrs[SG_HDR_CONTENT_TYPE];
+  if (!type)
+    type = sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_TYPE);
+  parts = sg__httpres_parts_new(boundary, type, ranges, count,
+                                (uint64_t) sbuf->st_size, &size);
+  if (!parts)
+    return ENOMEM;
+  len = sizeof("multipart/byteranges; boundary=") + strlen(boundary);
+  ctype = sg_malloc(len);
+  if (!ctype) {
+    errnum = ENOMEM;
+    goto error;
+  }
+  snprintf(ctype, len, "multipart/byteranges; boundary=%s", boundary);
+  errnum = sg_httpres_set_header(res, SG_HDR_CONTENT_TYPE, ctype);
+  sg_free(ctype);
+  if (errnum != 0)
+    goto error;
+  res->handle = MHD_create_response_from_callback(
+    size, SG__BLOCK_SIZE, sg__httpres_parts_read_cb, parts,
+    sg__httpres_parts_free_cb);
+  if (!res->handle) {
+    errnum = ENOMEM;
+    goto error;
+  }
+  parts->fd = fd;
+  res->status = MHD_HTTP_PARTIAL_CONTENT;
+  return 0;
+error:
+  sg_free(parts->heads);
+  sg_free(parts);
+  return errnum;
+}
+
+/* Answers the `Range` request of the whole file open at `fd`, taking the
+   file. Returns ENOENT when the whole file must be sent instead, i.e. the
+   ranges are malformed or `If-Range` does not match. */
+static int sg__httpres_sendranges(struct sg_httpres *res, int fd,
+                                  const struct stat *sbuf, const char *range,
+                                  const char *if_range) {
+  struct sg__httpres_range ranges[SG__HTTPRES_MAX_RANGES];
+  char val[80];
+  unsigned int count;
+  int errnum;
+  if (!range || (if_range && !sg__httpres_ifrange(res, if_range, sbuf)))
+    return ENOENT;
+  errnum = sg__httpres_ranges(range, (uint64_t) sbuf->st_size, ranges, &count);
+  if (errnum == EINVAL)
+    return ENOENT;
+  if (errnum == ERANGE) {
+    snprintf(val, sizeof(val), "bytes */%llu",
+             (unsigned long long) sbuf->st_size);
+    errnum = sg_httpres_set_header(res, SG_HDR_CONTENT_RANGE, val);
+    if (errnum != 0)
+      return errnum;
+    res->handle =
+      MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+    if (!res->handle)
+      return ENOMEM;
+    close(fd);
+    res->status = MHD_HTTP_RANGE_NOT_SATISFIABLE;
+    return 0;
+  }
+  if (count > 1)
+    return sg__httpres_sendparts(res, fd, sbuf, ranges, count);
+  snprintf(val, sizeof(val), "bytes %llu-%llu/%llu",
+           (unsigned long long) ranges[0].first,
+           (unsigned long long) ranges[0].last,
+           (unsigned long long) sbuf->st_size);
+  errnum = sg_httpres_set_header(res, SG_HDR_CONTENT_RANGE, val);
+  if (errnum != 0)
+    return errnum;
+  res->handle = MHD_create_response_from_fd_at_offset64(
+    ranges[0].last - ranges[0].first + 1, fd, ranges[0].first);
+  if (!res->handle)
+    return ENOMEM;
+  res->status = MHD_HTTP_PARTIAL_CONTENT;
+  return 0;
+}
+
+/* Adds the validators of the whole file, a weak entity-tag and its
+   modification date, and answers 304 if the request matches them, taking the
+   file. Returns ENOENT when the file must be sent. */
+static int sg__httpres_sendvalidated(struct sg_httpres *res, int fd,
+                                     const struct stat *sbuf, uint64_t size,
+                                     uint64_t offset, unsigned int status) {
+  char val[64];
+  int errnum;
+  if ((size != 0) || (offset != 0) || (status != MHD_HTTP_OK))
+    return ENOENT;
+  if (!sg__httpres_hdr(res, SG_HDR_ETAG)) {
+    snprintf(val, sizeof(val), "W/\"%llx-%llx-%llx\"",
+             (unsigned long long) sbuf->st_ino,
+             (unsigned long long) sbuf->st_size,
+             (unsigned long long) sbuf->st_mtime);
+    errnum = sg_httpres_set_header(res, SG_HDR_ETAG, val);
+    if (errnum != 0)
+      return errnum;
+  }
+  if (!sg__httpres_hdr(res, SG_HDR_LAST_MODIFIED) &&
+      (sg__httpres_httpdate(sbuf->st_mtime, val, sizeof(val)) == 0)) {
+    errnum = sg_httpres_set_header(res, SG_HDR_LAST_MODIFIED, val);
+    if (errnum != 0)
+      return errnum;
+  }
+  if (!sg__httpres_cached(res, &sbuf->st_mtime))
+    return ENOENT;
+  errnum = sg__httpres_sendnotmodified(res);
+  if (errnum == 0)
+    close(fd);
+  return errnum;
+}
+
+/* Sends the file open at `fd`, taking it. A GET for the whole file with a 200
+   status gets the ranges asked in the request. */
+static int sg__httpres_sendfd(struct sg_httpres *res, int fd,
+                              const struct stat *sbuf, uint64_t size,
+                              uint64_t offset, unsigned int status) {
+  int errnum;
+  if ((size == 0) && (offset == 0) && (status == MHD_HTTP_OK) &&
+      res->method && (strcmp(res->method, MHD_HTTP_METHOD_GET) == 0)) {
+    errnum = sg_httpres_set_header(res, SG_HDR_ACCEPT_RANGES, "bytes");
+    if (errnum != 0)
+      return errnum;
+    errnum = sg__httpres_sendranges(
+      res, fd, sbuf, sg__httpres_reqhdr(res, MHD_HTTP_HEADER_RANGE),
+      sg__httpres_reqhdr(res, MHD_HTTP_HEADER_IF_RANGE));
+    if (errnum != ENOENT)
+      return errnum;
+  }
+  if (size == 0)
+    size = ((uint64_t) sbuf->st_size) - offset;
+  res->handle = MHD_create_response_from_fd_at_offset64(size, fd, offset);
+  if (!res->handle)
+    return ENOMEM;
+  res->status = status;
+  return 0;
+}
+
 int sg_httpres_sendfile2(struct sg_httpres *res, uint64_t size,
                          uint64_t max_size, uint64_t offset,
                          const char *filename, const char *disposition,
@@ -358,14 +1237,11 @@ int sg_httpres_sendfile2(struct sg_httpres *res, uint64_t size,
                        &errnum);
   if (errnum != 0)
     goto error;
-  if (size == 0)
-    size = ((uint64_t) sbuf.st_size) - offset;
-  res->handle = MHD_create_response_from_fd_at_offset64(size, fd, offset);
-  if (!res->handle) {
-    errnum = ENOMEM;
+  errnum = sg__httpres_sendvalidated(res, fd, &sbuf, size, offset, status);
+  if (errnum == ENOENT)
+    errnum = sg__httpres_sendfd(res, fd, &sbuf, size, offset, status);
+  if (errnum != 0)
     goto error;
-  }
-  res->status = status;
   return 0;
 error:
   if (fd != -1)
@@ -412,6 +1288,7 @@ error:
 int sg_httpres_zsendbinary2(struct sg_httpres *res, int level, void *buf,
                             size_t size, const char *content_type,
                             unsigned int status) {
+  enum sg__httpres_zcoding coding;
   size_t zsize;
   void *zbuf;
   int ret;
@@ -420,18 +1297,24 @@ int sg_httpres_zsendbinary2(struct sg_httpres *res, int level, void *buf,
     return EINVAL;
   if (res->handle)
     return EALREADY;
+  ret = sg__httpres_vary(res);
+  if (ret != 0)
+    return ret;
+  coding = sg__httpres_negotiate(res, SG__HTTPRES_ZDEFLATE);
+  if (coding == SG__HTTPRES_ZIDENTITY)
+    return sg__httpres_sendbinary(res, buf, size, content_type, status);
   if (size > 0) {
-    zsize = compressBound(size);
+    zsize = sg__httpres_zbound(coding, size);
     zbuf = sg_malloc(zsize);
     if (!zbuf)
       return ENOMEM;
-    if ((sg__zcompress(buf, size, zbuf, (uLongf *) &zsize, level) != Z_OK) ||
+    if ((sg__httpres_zcompress(coding, level, buf, size, zbuf, &zsize) != 0) ||
         (zsize >= size)) {
       zsize = size;
       memcpy(zbuf, buf, zsize);
     } else {
       ret = sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING,
-                          "deflate");
+                          sg__httpres_zname(coding));
       if (ret != 0)
         goto error;
     }
@@ -465,7 +1348,7 @@ int sg_httpres_zsendbinary(struct sg_httpres *res, void *buf, size_t size,
 int sg_httpres_zsendstream2(struct sg_httpres *res, int level, uint64_t size,
                             sg_read_cb read_cb, void *handle,
                             sg_free_cb free_cb, unsigned int status) {
-  struct sg__httpres_zholder *holder;
+  enum sg__httpres_zcoding coding;
   int errnum;
   if (!res || ((level < -1) || (level > 9)) || !read_cb ||
       ((int64_t) size < 0) || (status < 100) || (status > 599)) {
@@ -476,49 +1359,14 @@ int sg_httpres_zsendstream2(struct sg_httpres *res, int level, uint64_t size,
     errnum = EALREADY;
     goto error;
   }
-  holder = sg_alloc(sizeof(struct sg__httpres_zholder));
-  if (!holder) {
-    errnum = ENOMEM;
-    goto error;
-  }
-  holder->stream.zalloc = sg__zalloc;
-  holder->stream.zfree = sg__zfree;
-  errnum = deflateInit2(&holder->stream, level, Z_DEFLATED, MAX_WBITS,
-                        MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
-  if (errnum != Z_OK)
-    goto error_stream;
-  holder->buf_in = sg_malloc(SG__ZLIB_CHUNK);
-  if (!holder->buf_in) {
-    errnum = ENOMEM;
-    goto error_buf_in;
-  }
-  errnum =
-    sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING, "deflate");
+  errnum = sg__httpres_vary(res);
   if (errnum != 0)
-    goto error_res;
-  holder->read_cb = read_cb;
-  holder->free_cb = free_cb;
-  holder->handle = handle;
-  holder->size_in = size;
-  res->handle = MHD_create_response_from_callback(
-    MHD_SIZE_UNKNOWN, SG__BLOCK_SIZE, sg__httpres_zread_cb, holder,
-    sg__httpres_zfree_cb);
-  if (!res->handle) {
-    errnum = ENOMEM;
-    goto error_res;
-  }
-  res->status = status;
-#ifdef SG_TESTING
-  errnum = 0;
-#else /* SG_TESTING */
-  return 0;
-#endif /* SG_TESTING */
-error_res:
-  sg_free(holder->buf_in);
-error_buf_in:
-  deflateEnd(&holder->stream);
-error_stream:
-  sg_free(holder);
+    goto error;
+  coding = sg__httpres_negotiate(res, SG__HTTPRES_ZDEFLATE);
+  if (coding == SG__HTTPRES_ZIDENTITY)
+    return sg_httpres_sendstream(res, size, read_cb, handle, free_cb, status);
+  return sg__httpres_zstream(res, level, coding, size, read_cb, handle, free_cb,
+                             status);
 error:
   if (free_cb)
     free_cb(handle);
@@ -532,75 +1380,236 @@ int sg_httpres_zsendstream(struct sg_httpres *res, sg_read_cb read_cb,
                                  status);
 }
 
+static const char *sg__httpres_zext(enum sg__httpres_zcoding coding) {
+  switch (coding) {
+  case SG__HTTPRES_ZGZIP:
+    return ".gz";
+  case SG__HTTPRES_ZBROTLI:
+    return ".br";
+  case SG__HTTPRES_ZZSTD:
+    return ".zst";
+  default:
+    return ".zz";
+  }
+}
+
+/* Opens the precompressed sibling of the file the client prefers, e.g.
+   `app.js.br`, skipping the ones older than the file. Siblings are served even
+   for codings not built in, since nothing needs to be encoded. */
+static int sg__httpres_zsibling(struct sg_httpres *res, const char *filename,
+                                struct stat *sbuf,
+                                enum sg__httpres_zcoding *coding, int *zfd,
+                                struct stat *zsbuf) {
+#define SG__ZSIBLINGS 3
+  static const enum sg__httpres_zcoding codings[SG__ZSIBLINGS] = {
+    SG__HTTPRES_ZBROTLI, SG__HTTPRES_ZZSTD, SG__HTTPRES_ZGZIP};
+  enum sg__httpres_zcoding found[SG__ZSIBLINGS];
+  struct stat sbufs[SG__ZSIBLINGS];
+  int fds[SG__ZSIBLINGS], errnum;
+  size_t i, count = 0, len = strlen(filename) + sizeof(".zst");
+  char *path = sg_malloc(len);
+  if (!path)
+    return ENOMEM;
+  for (i = 0; i < SG__ZSIBLINGS; i++) {
+    snprintf(path, len, "%s%s", filename, sg__httpres_zext(codings[i]));
+    fds[count] = -1;
+    errnum = 0;
+    sg__httpres_openfile(res, path, NULL, 0, &fds[count], &sbufs[count],
+                         &errnum);
+    if ((errnum == 0) && (sbufs[count].st_mtime >= sbuf->st_mtime))
+      found[count++] = codings[i];
+    else if (fds[count] != -1)
+      close(fds[count]);
+  }
+  sg_free(path);
+  *coding = count > 0 ? sg__httpres_zpick(sg__httpres_accept(res),
+                                          SG__HTTPRES_ZGZIP, found, count)
+                      : SG__HTTPRES_ZIDENTITY;
+  errnum = ENOENT;
+  for (i = 0; i < count; i++)
+    if ((errnum != 0) && (found[i] == *coding)) {
+      *zfd = fds[i];
+      memcpy(zsbuf, &sbufs[i], sizeof(struct stat));
+      errnum = 0;
+    } else
+      close(fds[i]);
+  return errnum;
+#undef SG__ZSIBLINGS /* SG__ZSIBLINGS */
+}
+
+/* Compresses the file into `path` through a temporary file, so a concurrent
+   request never serves a partial copy. */
+static int sg__httpres_zwrite(const char *dir, int level,
+                              enum sg__httpres_zcoding coding,
+                              unsigned int threads, int fd, const char *path) {
+  struct sg__httpres_zholder holder;
+  char buf[SG__BLOCK_SIZE], *tmp;
+  ssize_t have;
+  int tfd, errnum;
+  tmp = sg__strjoin(PATH_SEP, dir, "sg_zcache_tmp_XXXXXX");
+  if (!tmp)
+    return ENOMEM;
+  tfd = mkstemp(tmp);
+  if (tfd == -1) {
+    errnum = errno;
+    goto error_tmp;
+  }
+  memset(&holder, 0, sizeof(struct sg__httpres_zholder));
+  holder.coding = coding;
+  errnum = sg__httpres_zinit(&holder, level, threads);
+  if (errnum != 0)
+    goto error_stream;
+  holder.buf_in = sg_malloc(SG__ZLIB_CHUNK);
+  if (!holder.buf_in) {
+    errnum = ENOMEM;
+    goto error_buf_in;
+  }
+  holder.read_cb = sg__httpres_fdread_cb;
+  holder.handle = &fd;
+  do {
+    have = sg__httpres_zread_cb(&holder, 0, buf, sizeof(buf));
+    if ((have == MHD_CONTENT_READER_END_WITH_ERROR) ||
+        ((have > 0) && (write(tfd, buf, (size_t) have) != have))) {
+      errnum = EIO;
+      break;
+    }
+  } while (have != MHD_CONTENT_READER_END_OF_STREAM);
+  sg_free(holder.buf_in);
+error_buf_in:
+  sg__httpres_zend(&holder);
+error_stream:
+  if ((close(tfd) != 0) && (errnum == 0))
+    errnum = errno;
+  if ((errnum == 0) && (sg__rename(tmp, path) != 0))
+    errnum = errno;
+  if (errnum != 0)
+    unlink(tmp);
+error_tmp:
+  sg_free(tmp);
+  return errnum;
+}
+
+/* Opens the copy of the file compressed into the cache directory, named after
+   its inode, mtime, size and the level, compressing it on the first use. */
+static int sg__httpres_zcached(struct sg_httpres *res, const char *dir,
+                               int level, enum sg__httpres_zcoding coding,
+                               int fd, const char *filename, struct stat *sbuf,
+                               int *zfd, struct stat *zsbuf) {
+  unsigned long long ino;
+  char name[96], *path;
+  int errnum = 0;
+#ifdef _WIN32
+  /* no inode numbers, so the path identifies the file */
+  ino = sg__strcasehash(filename, strlen(filename));
+#else /* _WIN32 */
+  (void) filename;
+  ino = (unsigned long long) sbuf->st_ino;
+#endif /* _WIN32 */
+  /* inode numbers are only unique within a device */
+  snprintf(name, sizeof(name), "%llx-%llx-%llx-%llx-%d%s",
+           (unsigned long long) sbuf->st_dev, ino,
+           (unsigned long long) sbuf->st_mtime,
+           (unsigned long long) sbuf->st_size, level, sg__httpres_zext(coding));
+  path = sg__strjoin(PATH_SEP, dir, name);
+  if (!path)
+    return ENOMEM;
+  *zfd = -1;
+  sg__httpres_openfile(res, path, NULL, 0, zfd, zsbuf, &errnum);
+  if (errnum == ENOENT) {
+    errnum = sg__httpres_zwrite(
+      dir, level, coding,
+      sg__httpres_zthreads(res, coding, (uint64_t) sbuf->st_size), fd, path);
+    if (errnum == 0)
+      sg__httpres_openfile(res, path, NULL, 0, zfd, zsbuf, &errnum);
+  }
+  if ((errnum != 0) && (*zfd != -1)) {
+    close(*zfd);
+    *zfd = -1;
+  }
+  sg_free(path);
+  return errnum;
+}
+
 int sg_httpres_zsendfile2(struct sg_httpres *res, int level, uint64_t size,
                           uint64_t max_size, uint64_t offset,
                           const char *filename, const char *disposition,
                           unsigned int status) {
-  struct sg__httpres_gzholder *holder;
-  struct stat sbuf;
-  int fd, errnum = 0;
+  enum sg__httpres_zcoding coding, zcoding = SG__HTTPRES_ZIDENTITY;
+  struct stat sbuf, zsbuf;
+  bool zstatic;
+  int *handle, fd = -1, zfd = -1, errnum = 0;
   if (!res || ((level < -1) || (level > 9)) || ((int64_t) size < 0) ||
       ((int64_t) max_size < 0) || ((int64_t) offset < 0) || !filename ||
       (status < 100) || (status > 599))
     return EINVAL;
   if (res->handle)
     return EALREADY;
+  errnum = sg__httpres_vary(res);
+  if (errnum != 0)
+    return errnum;
+  coding = sg__httpres_negotiate(res, SG__HTTPRES_ZGZIP);
+  zstatic = res->srv && res->srv->zstatic && (offset == 0);
+  if ((coding == SG__HTTPRES_ZIDENTITY) && !zstatic)
+    return sg_httpres_sendfile2(res, size, max_size, offset, filename,
+                                disposition, status);
   sg__httpres_openfile(res, filename, disposition, max_size, &fd, &sbuf,
                        &errnum);
   if (errnum != 0)
     goto error;
+  errnum = sg__httpres_sendvalidated(res, fd, &sbuf, size, offset, status);
+  if (errnum != ENOENT) {
+    if (errnum != 0)
+      goto error;
+    return 0;
+  }
+  errnum = 0;
+  if (zstatic && ((size == 0) || (size >= (uint64_t) sbuf.st_size))) {
+    /* serves a precompressed copy of the whole file by sendfile() */
+    errnum = sg__httpres_zsibling(res, filename, &sbuf, &zcoding, &zfd, &zsbuf);
+    if ((errnum != 0) && (coding != SG__HTTPRES_ZIDENTITY) &&
+        res->srv->zcache_dir) {
+      zcoding = coding;
+      errnum = sg__httpres_zcached(res, res->srv->zcache_dir, level, coding,
+                                   fd, filename, &sbuf, &zfd, &zsbuf);
+    }
+    if (errnum == 0) {
+      close(fd);
+      fd = zfd;
+      errnum = sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING,
+                             sg__httpres_zname(zcoding));
+      if (errnum != 0)
+        goto error;
+      res->handle = MHD_create_response_from_fd_at_offset64(
+        (uint64_t) zsbuf.st_size, fd, 0);
+      if (!res->handle) {
+        errnum = ENOMEM;
+        goto error;
+      }
+      res->status = status;
+      return 0;
+    }
+    errnum = 0;
+  }
+  if (coding == SG__HTTPRES_ZIDENTITY) {
+    errnum = sg__httpres_sendfd(res, fd, &sbuf, size, offset, status);
+    if (errnum != 0)
+      goto error;
+    return 0;
+  }
   if (sg__lseek(fd, offset, SEEK_SET) != (sg__off_t) offset) {
     errnum = errno;
     goto error;
   }
-  holder = sg_alloc(sizeof(struct sg__httpres_gzholder));
-  if (!holder) {
+  handle = sg_malloc(sizeof(int));
+  if (!handle) {
     errnum = ENOMEM;
     goto error;
   }
-  holder->stream.zalloc = sg__zalloc;
-  holder->stream.zfree = sg__zfree;
-  errnum = deflateInit2(&holder->stream, level, Z_DEFLATED, -MAX_WBITS, 8,
-                        Z_DEFAULT_STRATEGY);
-  if (errnum != Z_OK)
-    goto error_stream;
-  holder->buf_in = sg_malloc(SG__ZLIB_CHUNK);
-  if (!holder->buf_in) {
-    errnum = ENOMEM;
-    goto error_buf_in;
-  }
-  holder->handle = sg_malloc(sizeof(int));
-  if (!holder->handle) {
-    errnum = ENOMEM;
-    goto error_handle;
-  }
-  errnum =
-    sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
-  if (errnum != 0)
-    goto error_res;
-  *holder->handle = fd;
-  holder->size_in = size;
-  res->handle = MHD_create_response_from_callback(
-    MHD_SIZE_UNKNOWN, SG__BLOCK_SIZE, sg__httpres_gzread_cb, holder,
-    sg__httpres_gzfree_cb);
-  if (!res->handle) {
-    errnum = ENOMEM;
-    goto error_res;
-  }
-  res->status = status;
-#ifdef SG_TESTING
-  errnum = 0;
-#else /* SG_TESTING */
-  return 0;
-#endif /* SG_TESTING */
-error_res:
-  sg_free(holder->handle);
-error_handle:
-  sg_free(holder->buf_in);
-error_buf_in:
-  deflateEnd(&holder->stream);
-error_stream:
-  sg_free(holder);
+  *handle = fd;
+  if (size == 0)
+    size = ((uint64_t) sbuf.st_size) - offset;
+  return sg__httpres_zstream(res, level, coding, size, sg__httpres_fdread_cb,
+                             handle, sg__httpres_fdfree_cb, status);
 error:
   if (fd != -1)
     close(fd);
@@ -629,8 +1638,10 @@ int sg_httpres_reset(struct sg_httpres *res) {
 
 int sg_httpres_clear(struct sg_httpres *res) {
   int ret = sg_httpres_reset(res);
-  if (ret == 0)
+  if (ret == 0) {
     sg_strmap_cleanup(&res->headers);
+    sg__httpres_hdrs_cleanup(res);
+  }
   return ret;
 }
 
@@ -31,67 +31,110 @@
 #ifdef SG_HTTP_COMPRESSION
 #include <stdint.h>
 #include "zlib.h"
+#ifdef SG_HTTP_BROTLI
+#include <brotli/encode.h>
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+#include "zstd.h"
+#endif /* SG_HTTP_ZSTD */
 #endif /* SG_HTTP_COMPRESSION */
 #include "microhttpd.h"
 #include "sagui.h"
 
 struct sg_httpres {
+  /* server of the request, whose compression policy applies to the response */
+  struct sg_httpsrv *srv;
   struct MHD_Connection *con;
   struct MHD_Response *handle;
   struct sg_strmap *headers;
+  /* well-known headers set by ID, they override the same names in `headers` */
+  char *hdrs[SG_HDR_COUNT];
+  /* method of the request, ranges are only sent for a GET */
+  const char *method;
   unsigned int status;
   int ret;
 };
 
+/* Byte range of a file, both ends included. */
+struct sg__httpres_range {
+  uint64_t first;
+  uint64_t last;
+};
+
 #ifdef SG_HTTP_COMPRESSION
 
+enum sg__httpres_zcoding {
+  SG__HTTPRES_ZIDENTITY = 0,
+  SG__HTTPRES_ZDEFLATE = 1,
+  SG__HTTPRES_ZGZIP = 2,
+  SG__HTTPRES_ZBROTLI = 3,
+  SG__HTTPRES_ZZSTD = 4
+};
+
 enum sg__httpres_zstatus {
   SG__HTTPRES_ZPROCESSING = 0,
-  SG__HTTPRES_ZWRITING = 1,
+  SG__HTTPRES_ZFINISHING = 1,
   SG__HTTPRES_ZFINISHED = 2
 };
 
+/* Encodes straight into the buffer handed by the MHD content reader; input
+   and output not taken yet stay pending in `next_in` and the encoder. */
 struct sg__httpres_zholder {
-  z_stream stream;
+  /* taken from the deflate pool of the thread (see sg__zpool_get()) */
+  z_stream *stream;
+#ifdef SG_HTTP_BROTLI
+  BrotliEncoderState *br;
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  ZSTD_CStream *zstd;
+#endif /* SG_HTTP_ZSTD */
+  /* used instead of `stream` to gzip large bodies on several threads */
+  struct sg__pgz *pgz;
+  enum sg__httpres_zcoding coding;
   sg_read_cb read_cb;
   sg_free_cb free_cb;
   Bytef *buf_in;
-  Bytef *buf_out;
+  const Bytef *next_in;
+  size_t avail_in;
   uint64_t size_in;
-  uint64_t size_out;
   uint64_t offset_in;
-  uint64_t offset_out;
   void *handle;
   enum sg__httpres_zstatus status;
 };
 
-enum sg__httpres_gzstatus {
-  SG__HTTPRES_GZNONE = 0,
-  SG__HTTPRES_GZPROCESSING = 1,
-  SG__HTTPRES_GZWRITING = 2,
-  SG__HTTPRES_GZFINISHING = 3,
-  SG__HTTPRES_GZFINISHED = 4
-};
-
-struct sg__httpres_gzholder {
-  z_stream stream;
-  Bytef *buf_in;
-  Bytef *buf_out;
-  uint64_t size_in;
-  uint64_t size_out;
-  uint64_t offset_in;
-  uint64_t offset_out;
-  uLong crc;
-  int *handle;
-  enum sg__httpres_gzstatus status;
-};
-
 #endif /* SG_HTTP_COMPRESSION */
 
 SG__EXTERN struct sg_httpres *sg__httpres_new(struct MHD_Connection *con);
 
 SG__EXTERN void sg__httpres_free(struct sg_httpres *res);
 
+/* Adds the headers to the response handle. */
+SG__EXTERN void sg__httpres_headers(struct sg_httpres *res);
+
 SG__EXTERN int sg__httpres_dispatch(struct sg_httpres *res);
 
+/* Parses a `Range` value (RFC 7233) for a file of `size` bytes into its
+   satisfiable ranges. Returns EINVAL if the value is malformed or has more
+   than SG__HTTPRES_MAX_RANGES ranges, so it must be ignored, or ERANGE if no
+   range is satisfiable. */
+SG__EXTERN int sg__httpres_ranges(const char *val, uint64_t size,
+                                  struct sg__httpres_range *ranges,
+                                  unsigned int *count);
+
+#ifdef SG_HTTP_COMPRESSION
+
+/* Picks the content-coding to answer an `Accept-Encoding` value with, honoring
+   its q-values; returns `def` when the header is absent (NULL). */
+SG__EXTERN enum sg__httpres_zcoding
+sg__httpres_zcoding(const char *accept, enum sg__httpres_zcoding def);
+
+/* Adds `Accept-Encoding` to the response `Vary` header, if not listed yet. */
+SG__EXTERN int sg__httpres_vary(struct sg_httpres *res);
+
+/* Checks if the media type of `type`, parameters apart, is in the
+   comma-separated `types`, where a `*` subtype matches any subtype. */
+SG__EXTERN bool sg__httpres_ztype(const char *types, const char *type);
+
+#endif /* SG_HTTP_COMPRESSION */
+
 #endif /* SG_HTTPRES_H */
@@ -303,6 +303,10 @@ struct sg_httpsrv *sg_httpsrv_new2(sg_httpauth_cb auth_cb, sg_httpreq_cb req_cb,
   srv->payld_limit = 4194304; /* ~4 MB */
   srv->uplds_limit = 67108864; /* ~64 MB */
 #endif /* __arm__ */
+#ifdef SG_HTTP_COMPRESSION
+  srv->zmin_size = 1024; /* ~1 kB */
+  srv->zlevel = Z_BEST_SPEED;
+#endif /* SG_HTTP_COMPRESSION */
   return srv;
 }
 
@@ -340,6 +344,10 @@ void sg_httpsrv_free(struct sg_httpsrv *srv) {
   sg__httpsrv_unlock(srv);
   sg_httpsrv_shutdown(srv);
   sg_free(srv->uplds_dir);
+#ifdef SG_HTTP_COMPRESSION
+  sg_free(srv->ztypes);
+  sg_free(srv->zcache_dir);
+#endif /* SG_HTTP_COMPRESSION */
   pthread_mutex_destroy(&srv->mutex);
   sg_free(srv);
 }
@@ -553,6 +561,136 @@ unsigned int sg_httpsrv_con_limit(struct sg_httpsrv *srv) {
   return 0;
 }
 
+int sg_httpsrv_set_etag(struct sg_httpsrv *srv, bool enabled) {
+  if (!srv)
+    return EINVAL;
+  srv->etag = enabled;
+  return 0;
+}
+
+bool sg_httpsrv_etag(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->etag;
+  errno = EINVAL;
+  return false;
+}
+
+#ifdef SG_HTTP_COMPRESSION
+
+int sg_httpsrv_set_ztypes(struct sg_httpsrv *srv, const char *types) {
+  char *dup = NULL;
+  if (!srv)
+    return EINVAL;
+  if (types) {
+    dup = strdup(types);
+    if (!dup)
+      return ENOMEM;
+  }
+  sg_free(srv->ztypes);
+  srv->ztypes = dup;
+  return 0;
+}
+
+const char *sg_httpsrv_ztypes(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->ztypes;
+  errno = EINVAL;
+  return NULL;
+}
+
+int sg_httpsrv_set_zmin_size(struct sg_httpsrv *srv, size_t size) {
+  if (!srv)
+    return EINVAL;
+  srv->zmin_size = size;
+  return 0;
+}
+
+size_t sg_httpsrv_zmin_size(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zmin_size;
+  errno = EINVAL;
+  return 0;
+}
+
+int sg_httpsrv_set_zlevel(struct sg_httpsrv *srv, int level) {
+  if (!srv || (level < -1) || (level > 9))
+    return EINVAL;
+  srv->zlevel = level;
+  return 0;
+}
+
+int sg_httpsrv_zlevel(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zlevel;
+  errno = EINVAL;
+  return 0;
+}
+
+int sg_httpsrv_set_zmax_active(struct sg_httpsrv *srv, unsigned int max) {
+  if (!srv)
+    return EINVAL;
+  srv->zmax_active = max;
+  return 0;
+}
+
+unsigned int sg_httpsrv_zmax_active(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zmax_active;
+  errno = EINVAL;
+  return 0;
+}
+
+int sg_httpsrv_set_zstatic(struct sg_httpsrv *srv, bool enabled) {
+  if (!srv)
+    return EINVAL;
+  srv->zstatic = enabled;
+  return 0;
+}
+
+bool sg_httpsrv_zstatic(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zstatic;
+  errno = EINVAL;
+  return false;
+}
+
+int sg_httpsrv_set_zcache_dir(struct sg_httpsrv *srv, const char *dir) {
+  char *dup = NULL;
+  if (!srv)
+    return EINVAL;
+  if (dir) {
+    dup = strdup(dir);
+    if (!dup)
+      return ENOMEM;
+  }
+  sg_free(srv->zcache_dir);
+  srv->zcache_dir = dup;
+  return 0;
+}
+
+const char *sg_httpsrv_zcache_dir(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zcache_dir;
+  errno = EINVAL;
+  return NULL;
+}
+
+int sg_httpsrv_set_zthreads(struct sg_httpsrv *srv, unsigned int threads) {
+  if (!srv)
+    return EINVAL;
+  srv->zthreads = threads;
+  return 0;
+}
+
+unsigned int sg_httpsrv_zthreads(struct sg_httpsrv *srv) {
+  if (srv)
+    return srv->zthreads;
+  errno = EINVAL;
+  return 0;
+}
+
+#endif /* SG_HTTP_COMPRESSION */
+
 void *sg_httpsrv_handle(struct sg_httpsrv *srv) {
   if (srv)
     return srv->handle;
@@ -57,6 +57,22 @@ struct sg_httpsrv {
   unsigned int thr_pool_size;
   unsigned int con_timeout;
   unsigned int con_limit;
+  /* hashes the binary contents into an entity-tag */
+  bool etag;
+#ifdef SG_HTTP_COMPRESSION
+  /* compression policy of the binary contents, off while `ztypes` is null */
+  char *ztypes;
+  size_t zmin_size;
+  int zlevel;
+  unsigned int zmax_active;
+  /* contents being compressed by the policy, guarded by `mutex` */
+  unsigned int zactive;
+  /* precompressed copies served by the zsendfile functions */
+  char *zcache_dir;
+  bool zstatic;
+  /* workers of the parallel gzip of large files */
+  unsigned int zthreads;
+#endif /* SG_HTTP_COMPRESSION */
 };
 
 SG__EXTERN void sg__httpsrv_eprintf(struct sg_httpsrv *srv, const char *fmt,
@@ -28,11 +28,11 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include "sg_macros.h"
-#include "uthash.h"
 #include "sagui.h"
 #include "sg_utils.h"
 #include "sg_str.h"
 #include "sg_strmap.h"
+#include "sg_httpform.h"
 #include "sg_httpreq.h"
 #include "sg_httpsrv.h"
 
@@ -76,13 +76,39 @@ static void sg__httpuplds_free(struct sg_httpsrv *srv, struct sg_httpreq *req) {
   sg_free(req->curr_upld);
 }
 
+static int sg__httpuplds_write(struct sg_httpsrv *srv, struct sg_httpreq *req,
+                               uint64_t off, const char *data, size_t size) {
+  if (srv->upld_write_cb(req->curr_upld->handle, off, data, size) == -1)
+    return EIO;
+  req->curr_upld->size += size;
+  if (srv->uplds_limit > 0) {
+    req->total_uplds_size += size;
+    if (req->total_uplds_size > srv->uplds_limit) {
+      sg__httpsrv_eprintf(srv, _("Upload too large.\n"));
+      return EFBIG;
+    }
+  }
+  return 0;
+}
+
+static int sg__httpuplds_fields_size(struct sg_httpsrv *srv,
+                                     struct sg_httpreq *req, size_t size) {
+  if (srv->payld_limit > 0) {
+    req->total_fields_size += size;
+    if (req->total_fields_size > srv->payld_limit) {
+      srv->err_cb(srv->cls, _("Payload too large.\n"));
+      return EFBIG;
+    }
+  }
+  return 0;
+}
+
 static enum MHD_Result
   sg__httpuplds_iter(void *cls, __SG_UNUSED enum MHD_ValueKind kind,
                      const char *key, const char *filename,
                      const char *content_type, const char *transfer_encoding,
                      const char *data, uint64_t off, size_t size) {
   struct sg__httpupld_holder *holder;
-  char *val;
   if (/*kind == MHD_POSTDATA_KIND && */ size > 0) {
     holder = cls;
     if (filename) {
@@ -95,17 +121,8 @@ static enum MHD_Result
                                   content_type, transfer_encoding) != 0))
           return MHD_NO;
       }
-      if (holder->srv->upld_write_cb(holder->req->curr_upld->handle, off, data,
-                                     size) == -1)
+      if (sg__httpuplds_write(holder->srv, holder->req, off, data, size) != 0)
         return MHD_NO;
-      holder->req->curr_upld->size += size;
-      if (holder->srv->uplds_limit > 0) {
-        holder->req->total_uplds_size += size;
-        if (holder->req->total_uplds_size > holder->srv->uplds_limit) {
-          sg__httpsrv_eprintf(holder->srv, _("Upload too large.\n"));
-          return MHD_NO;
-        }
-      }
     } else {
       if (off == 0) {
         if (!key || !data)
@@ -113,54 +130,196 @@ static enum MHD_Result
         holder->req->curr_field = sg__strmap_new(key, data);
         if (!holder->req->curr_field)
           return MHD_NO;
-        HASH_ADD_STR(holder->req->fields, key, holder->req->curr_field);
-      } else {
-        val = sg_realloc(holder->req->curr_field->val, off + size + 1);
-        if (!val)
-          return MHD_NO;
-        holder->req->curr_field->val = val;
-        memcpy(holder->req->curr_field->val + off, data, size + 1);
-      }
-      if (holder->srv->payld_limit > 0) {
-        holder->req->total_fields_size += size;
-        if (holder->req->total_fields_size > holder->srv->payld_limit) {
-          holder->srv->err_cb(holder->srv->cls, _("Payload too large.\n"));
-          return MHD_NO;
-        }
-      }
+        sg__strmap_add(&holder->req->fields, holder->req->curr_field);
+      } else if (sg__strmap_cat(&holder->req->fields,
+                                &holder->req->curr_field, data, size) != 0)
+        return MHD_NO;
+      if (sg__httpuplds_fields_size(holder->srv, holder->req, size) != 0)
+        return MHD_NO;
     }
   }
   return MHD_YES;
 }
 
+#if SG__HTTPFORM_NATIVE
+
+static int sg__httpuplds_form_file_cb(void *cls, const char *field,
+                                      const char *name, const char *mime,
+                                      const char *encoding) {
+  struct sg_httpreq *req = cls;
+  int errnum;
+  errnum = sg__httpuplds_add(req->srv, req, field, name, mime, encoding);
+  if (errnum != 0)
+    return errnum;
+  return req->srv->upld_cb(req->srv->upld_cls, &req->curr_upld->handle,
+                           req->srv->uplds_dir, field, name, mime, encoding);
+}
+
+static int sg__httpuplds_form_write_cb(void *cls, const char *buf,
+                                       size_t size) {
+  struct sg_httpreq *req = cls;
+  return sg__httpuplds_write(req->srv, req, req->curr_upld->size, buf, size);
+}
+
+static int sg__httpuplds_form_field_cb(void *cls, const char *name,
+                                       const char *val, size_t size) {
+  struct sg_httpreq *req = cls;
+  if (size == 0)
+    return 0;
+  req->curr_field = sg__strmap_new(name, val);
+  if (!req->curr_field)
+    return ENOMEM;
+  sg__strmap_add(&req->fields, req->curr_field);
+  return sg__httpuplds_fields_size(req->srv, req, size);
+}
+
+static int sg__httpuplds_form_process(struct sg_httpsrv *srv,
+                                      struct sg_httpreq *req,
+                                      const char *upld_data,
+                                      size_t upld_data_size) {
+  int errnum;
+  errnum = sg__httpform_process(req->form, upld_data, upld_data_size);
+  if (errnum == 0)
+    return MHD_YES;
+  if (errnum == EMSGSIZE)
+    srv->err_cb(srv->cls, _("Payload too large.\n"));
+  return MHD_NO;
+}
+
+static int sg__httpuplds_urlenc_process(struct sg_httpsrv *srv,
+                                        struct sg_httpreq *req,
+                                        const char *upld_data,
+                                        size_t upld_data_size) {
+  if (upld_data_size > req->fields_size - req->fields_len) {
+    srv->err_cb(srv->cls, _("Payload too large.\n"));
+    return MHD_NO;
+  }
+  memcpy(req->fields_buf + req->fields_len, upld_data, upld_data_size);
+  req->fields_len += upld_data_size;
+  return MHD_YES;
+}
+
+struct sg__httpuplds_urlenc_holder {
+  struct sg_httpreq *req;
+  struct sg_strmap *pair;
+};
+
+static int sg__httpuplds_urlenc_field_cb(void *cls, const char *name,
+                                         const char *val, size_t size) {
+  struct sg__httpuplds_urlenc_holder *holder = cls;
+  if (size == 0)
+    return 0;
+  sg__strmap_borrow(&holder->req->fields, holder->pair++, name, val);
+  holder->req->total_fields_size += size;
+  return 0;
+}
+
+/* Builds the fields from slices of the body, keeping all pairs in a single
+   block. */
+static int sg__httpuplds_urlenc_parse(struct sg_httpreq *req) {
+  struct sg__httpuplds_urlenc_holder holder;
+  const char *p = req->fields_buf, *end = req->fields_buf + req->fields_len;
+  size_t count = 1;
+  while ((p = memchr(p, '&', (size_t) (end - p)))) {
+    p++;
+    count++;
+  }
+  req->fields_pairs = sg_alloc(count * sizeof(struct sg_strmap));
+  if (!req->fields_pairs)
+    return ENOMEM;
+  holder.req = req;
+  holder.pair = req->fields_pairs;
+  return sg__httpform_urlencoded(req->fields_buf, req->fields_len,
+                                 sg__httpuplds_urlenc_field_cb, &holder);
+}
+
+static void sg__httpuplds_prepare(struct sg_httpsrv *srv,
+                                  struct sg_httpreq *req,
+                                  struct MHD_Connection *con) {
+  const char *content_type, *content_length, *boundary;
+  size_t boundary_len;
+  unsigned long long len;
+  char *end;
+  if (!con)
+    return;
+  content_type = MHD_lookup_connection_value(con, MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_CONTENT_TYPE);
+  if (sg__httpform_boundary(content_type, &boundary, &boundary_len)) {
+    req->form = sg__httpform_new(
+      boundary, boundary_len, srv->payld_limit, sg__httpuplds_form_file_cb,
+      sg__httpuplds_form_write_cb, sg__httpuplds_form_field_cb, req);
+    return;
+  }
+  if ((srv->payld_limit == 0) || !sg__httpform_is_urlencoded(content_type))
+    return;
+  content_length = MHD_lookup_connection_value(con, MHD_HEADER_KIND,
+                                               MHD_HTTP_HEADER_CONTENT_LENGTH);
+  if (!content_length)
+    return;
+  errno = 0;
+  len = strtoull(content_length, &end, 10);
+  if ((errno != 0) || (end == content_length) || (*end != '\0') ||
+      (len > srv->payld_limit))
+    return;
+  req->fields_buf = sg_malloc((size_t) len + 1);
+  if (req->fields_buf)
+    req->fields_size = (size_t) len;
+}
+
+#endif /* SG__HTTPFORM_NATIVE */
+
+static int sg__httpuplds_pp_process(struct sg_httpsrv *srv,
+                                    struct sg_httpreq *req,
+                                    struct MHD_Connection *con,
+                                    struct sg__httpupld_holder *holder,
+                                    const char *upld_data,
+                                    size_t upld_data_size) {
+  if (!req->pp)
+    req->pp = MHD_create_post_processor(con, srv->post_buf_size,
+                                        sg__httpuplds_iter, holder);
+  if (req->pp)
+    return MHD_post_process(req->pp, upld_data, upld_data_size);
+  utstring_bincpy(req->payload->buf, upld_data, upld_data_size);
+  if ((srv->payld_limit > 0) &&
+      (utstring_len(req->payload->buf) > srv->payld_limit)) {
+    utstring_clear(req->payload->buf);
+    srv->err_cb(srv->cls, _("Payload too large.\n"));
+    return MHD_NO;
+  }
+  return MHD_YES;
+}
+
 bool sg__httpuplds_process(struct sg_httpsrv *srv, struct sg_httpreq *req,
                            struct MHD_Connection *con, const char *upld_data,
                            size_t *upld_data_size, int *ret) {
   struct sg__httpupld_holder holder = {srv, req};
   if (*upld_data_size > 0) {
+#if SG__HTTPFORM_NATIVE
+    if (!req->is_uploading)
+      sg__httpuplds_prepare(srv, req, con);
+#endif /* SG__HTTPFORM_NATIVE */
     req->is_uploading = true;
-    if (!req->pp)
-      req->pp = MHD_create_post_processor(con, srv->post_buf_size,
-                                          sg__httpuplds_iter, &holder);
-    if (req->pp) {
-      if (MHD_post_process(req->pp, upld_data, *upld_data_size) != MHD_YES) {
-        *ret = MHD_NO;
-        return true;
-      }
-    } else {
-      utstring_bincpy(req->payload->buf, upld_data, *upld_data_size);
-      if ((srv->payld_limit > 0) &&
-          (utstring_len(req->payload->buf) > srv->payld_limit)) {
-        *ret = MHD_NO;
-        utstring_clear(req->payload->buf);
-        srv->err_cb(srv->cls, _("Payload too large.\n"));
-        return true;
-      }
-    }
-    *upld_data_size = 0;
-    *ret = MHD_YES;
+#if SG__HTTPFORM_NATIVE
+    if (req->form)
+      *ret = sg__httpuplds_form_process(srv, req, upld_data, *upld_data_size);
+    else if (req->fields_buf)
+      *ret =
+        sg__httpuplds_urlenc_process(srv, req, upld_data, *upld_data_size);
+    else
+#endif /* SG__HTTPFORM_NATIVE */
+      *ret = sg__httpuplds_pp_process(srv, req, con, &holder, upld_data,
+                                      *upld_data_size);
+    if (*ret == MHD_YES)
+      *upld_data_size = 0;
+    return true;
+  }
+#if SG__HTTPFORM_NATIVE
+  if (req && req->fields_buf && !req->fields_pairs &&
+      (sg__httpuplds_urlenc_parse(req) != 0)) {
+    *ret = MHD_NO;
     return true;
   }
+#endif /* SG__HTTPFORM_NATIVE */
   return false;
 }
 
@@ -141,8 +141,33 @@
 #endif /* _WIN32 */
 #endif /* sg__lseek */
 
+/* set to 0 to parse all the forms by the MHD post processor */
+#ifndef SG__HTTPFORM_NATIVE
+#define SG__HTTPFORM_NATIVE 1
+#endif /* SG__HTTPFORM_NATIVE */
+
+/* ranges of a request beyond which its `Range` header is ignored */
+#ifndef SG__HTTPRES_MAX_RANGES
+#define SG__HTTPRES_MAX_RANGES 16
+#endif /* SG__HTTPRES_MAX_RANGES */
+
 #ifndef SG__ZLIB_CHUNK
 #define SG__ZLIB_CHUNK 16384 /* 16k */
 #endif /* SG__ZLIB_CHUNK */
 
+/* idle deflate streams kept per thread, each one holding ~400 KB of state */
+#ifndef SG__ZPOOL_SIZE
+#define SG__ZPOOL_SIZE 4
+#endif /* SG__ZPOOL_SIZE */
+
+/* input block deflated by each worker of the parallel gzip encoder */
+#ifndef SG__PGZ_BLOCK_SIZE
+#define SG__PGZ_BLOCK_SIZE 131072 /* 128k */
+#endif /* SG__PGZ_BLOCK_SIZE */
+
+/* smallest body worth spawning the parallel gzip workers for */
+#ifndef SG__PGZ_MIN_SIZE
+#define SG__PGZ_MIN_SIZE 1048576 /* ~1 MB */
+#endif /* SG__PGZ_MIN_SIZE */
+
 #endif /* SG_MACROS_H */
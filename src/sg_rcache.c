@@ -0,0 +1,189 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "sg_utils.h"
+#include "sg_routes.h"
+#include "sg_rcache.h"
+#include "sagui.h"
+
+struct sg__rcache *sg__rcache_new(unsigned int size) {
+  struct sg__rcache *cache;
+  unsigned int i;
+  int errnum;
+  cache = sg_alloc(sizeof(struct sg__rcache));
+  if (!cache)
+    return NULL;
+  cache->count = (size + SG__RCACHE_WAYS - 1) / SG__RCACHE_WAYS;
+  cache->sets = sg_alloc(cache->count * sizeof(struct sg__rcache_set));
+  if (!cache->sets) {
+    sg_free(cache);
+    return NULL;
+  }
+  for (i = 0; i < cache->count; i++) {
+    errnum = pthread_mutex_init(&cache->sets[i].mutex, NULL);
+    if (errnum != 0) {
+      cache->count = i;
+      sg__rcache_free(cache);
+      errno = errnum;
+      return NULL;
+    }
+  }
+  return cache;
+}
+
+void sg__rcache_free(struct sg__rcache *cache) {
+  unsigned int i, j;
+  if (!cache)
+    return;
+  for (i = 0; i < cache->count; i++) {
+    for (j = 0; j < SG__RCACHE_WAYS; j++)
+      sg_free(cache->sets[i].entries[j].path);
+    pthread_mutex_destroy(&cache->sets[i].mutex);
+  }
+  sg_free(cache->sets);
+  sg_free(cache);
+}
+
+static unsigned int sg__rcache_hash(unsigned int slot, const char *path,
+                                    size_t len) {
+  unsigned int hash = sg__strcasehash(path, len) ^ slot;
+  /* FNV low bits are weak, so mix them before taking the set */
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bU;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35U;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static struct sg__rcache_entry *sg__rcache_find(struct sg__rcache_set *set,
+                                                unsigned int hash,
+                                                unsigned int slot,
+                                                const char *path, size_t len) {
+  struct sg__rcache_entry *entry;
+  unsigned int i;
+  for (i = 0; i < SG__RCACHE_WAYS; i++) {
+    entry = &set->entries[i];
+    if (entry->used && (entry->hash == hash) && (entry->slot == slot) &&
+        (entry->len == len) && (memcmp(entry->path, path, len) == 0))
+      return entry;
+  }
+  return NULL;
+}
+
+bool sg__rcache_get(struct sg__rcache *cache, unsigned int slot,
+                    unsigned int gen, const char *path, size_t len,
+                    struct sg_route **route, PCRE2_SIZE *ovector, int *rc) {
+  struct sg__rcache_set *set;
+  struct sg__rcache_entry *entry;
+  unsigned int hash = sg__rcache_hash(slot, path, len);
+  set = &cache->sets[hash % cache->count];
+  if (pthread_mutex_lock(&set->mutex) != 0)
+    return false;
+  entry = sg__rcache_find(set, hash, slot, path, len);
+  if (entry && (entry->gen == gen)) {
+    entry->ref = true;
+    *route = entry->route;
+    *rc = entry->rc;
+    memcpy(ovector, entry->ovector,
+           (entry->route->ovec_count << 1) * sizeof(PCRE2_SIZE));
+    set->hits++;
+  } else {
+    entry = NULL;
+    set->misses++;
+  }
+  pthread_mutex_unlock(&set->mutex);
+  return entry != NULL;
+}
+
+void sg__rcache_put(struct sg__rcache *cache, unsigned int slot,
+                    unsigned int gen, const char *path, size_t len,
+                    struct sg_route *route, const PCRE2_SIZE *ovector,
+                    int rc) {
+  struct sg__rcache_set *set;
+  struct sg__rcache_entry *entry;
+  unsigned int hash;
+  char *tmp;
+  if ((route->ovec_count << 1) > SG__RCACHE_OVEC_SIZE)
+    return;
+  hash = sg__rcache_hash(slot, path, len);
+  set = &cache->sets[hash % cache->count];
+  if (pthread_mutex_lock(&set->mutex) != 0)
+    return;
+  entry = sg__rcache_find(set, hash, slot, path, len);
+  /* CLOCK: skips recently hit entries, clearing their reference bit */
+  while (!entry) {
+    entry = &set->entries[set->hand];
+    set->hand = (set->hand + 1) % SG__RCACHE_WAYS;
+    if (entry->used && entry->ref) {
+      entry->ref = false;
+      entry = NULL;
+    }
+  }
+  if (entry->size < len) {
+    tmp = sg_realloc(entry->path, len);
+    if (!tmp) {
+      entry->used = false;
+      goto done;
+    }
+    entry->path = tmp;
+    entry->size = len;
+  }
+  memcpy(entry->path, path, len);
+  entry->len = len;
+  entry->route = route;
+  entry->hash = hash;
+  entry->slot = slot;
+  entry->gen = gen;
+  entry->rc = rc;
+  memcpy(entry->ovector, ovector,
+         (route->ovec_count << 1) * sizeof(PCRE2_SIZE));
+  entry->used = true;
+  entry->ref = false;
+done:
+  pthread_mutex_unlock(&set->mutex);
+}
+
+void sg__rcache_stats(struct sg__rcache *cache, uint64_t *hits,
+                      uint64_t *misses) {
+  struct sg__rcache_set *set;
+  unsigned int i;
+  *hits = *misses = 0;
+  for (i = 0; i < cache->count; i++) {
+    set = &cache->sets[i];
+    if (pthread_mutex_lock(&set->mutex) != 0)
+      continue;
+    *hits += set->hits;
+    *misses += set->misses;
+    pthread_mutex_unlock(&set->mutex);
+  }
+}
@@ -0,0 +1,90 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_RCACHE_H
+#define SG_RCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "sg_routes.h"
+#include "sg_rtree.h"
+#include "sagui.h"
+
+#define SG__RCACHE_WAYS 8
+
+#define SG__RCACHE_OVEC_SIZE ((SG__RTREE_MAX_CAPS + 1) << 1)
+
+struct sg__rcache_entry {
+  char *path;
+  size_t len;
+  size_t size;
+  struct sg_route *route;
+  unsigned int hash;
+  unsigned int slot;
+  unsigned int gen;
+  int rc;
+  bool used;
+  bool ref;
+  PCRE2_SIZE ovector[SG__RCACHE_OVEC_SIZE];
+};
+
+/* Entries of a path hash, evicted by CLOCK under the set lock. */
+struct sg__rcache_set {
+  pthread_mutex_t mutex;
+  struct sg__rcache_entry entries[SG__RCACHE_WAYS];
+  unsigned int hand;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+/* Set-associative cache of dispatched paths to the winning route and its
+   capture offsets. Entries are keyed by the router index slot too, and
+   are ignored once the route list generation changes. */
+struct sg__rcache {
+  struct sg__rcache_set *sets;
+  unsigned int count;
+};
+
+SG__EXTERN struct sg__rcache *sg__rcache_new(unsigned int size);
+
+SG__EXTERN void sg__rcache_free(struct sg__rcache *cache);
+
+SG__EXTERN bool sg__rcache_get(struct sg__rcache *cache, unsigned int slot,
+                               unsigned int gen, const char *path, size_t len,
+                               struct sg_route **route, PCRE2_SIZE *ovector,
+                               int *rc);
+
+SG__EXTERN void sg__rcache_put(struct sg__rcache *cache, unsigned int slot,
+                               unsigned int gen, const char *path, size_t len,
+                               struct sg_route *route,
+                               const PCRE2_SIZE *ovector, int rc);
+
+SG__EXTERN void sg__rcache_stats(struct sg__rcache *cache, uint64_t *hits,
+                                 uint64_t *misses);
+
+#endif /* SG_RCACHE_H */
@@ -0,0 +1,132 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdbool.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "utlist.h"
+#include "sg_utils.h"
+#include "sg_rcu.h"
+
+static pthread_once_t sg__rcu_once = PTHREAD_ONCE_INIT;
+static pthread_key_t sg__rcu_key;
+static int sg__rcu_key_err;
+/* guards the registry of readers and serializes the grace periods */
+static pthread_mutex_t sg__rcu_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct sg__rcu_reader *sg__rcu_readers;
+static unsigned long sg__rcu_epoch = 1;
+
+static void sg__rcu_reader_free(void *cls) {
+  struct sg__rcu_reader *reader = cls;
+  pthread_mutex_lock(&sg__rcu_mutex);
+  DL_DELETE(sg__rcu_readers, reader);
+  pthread_mutex_unlock(&sg__rcu_mutex);
+  sg_free(reader);
+}
+
+static void sg__rcu_key_new(void) {
+  sg__rcu_key_err = pthread_key_create(&sg__rcu_key, sg__rcu_reader_free);
+}
+
+/* Gets the reader of the calling thread, registering it on first use. */
+static struct sg__rcu_reader *sg__rcu_reader(void) {
+  struct sg__rcu_reader *reader;
+  if ((pthread_once(&sg__rcu_once, sg__rcu_key_new) != 0) ||
+      (sg__rcu_key_err != 0))
+    return NULL;
+  reader = pthread_getspecific(sg__rcu_key);
+  if (reader)
+    return reader;
+  reader = sg_alloc(sizeof(struct sg__rcu_reader));
+  if (!reader)
+    return NULL;
+  if (pthread_mutex_lock(&sg__rcu_mutex) != 0) {
+    sg_free(reader);
+    return NULL;
+  }
+  DL_APPEND(sg__rcu_readers, reader);
+  pthread_mutex_unlock(&sg__rcu_mutex);
+  if (pthread_setspecific(sg__rcu_key, reader) != 0) {
+    sg__rcu_reader_free(reader);
+    return NULL;
+  }
+  return reader;
+}
+
+int sg__rcu_read_lock(void) {
+  struct sg__rcu_reader *reader = sg__rcu_reader();
+  if (!reader)
+    return ENOMEM;
+  if (reader->nesting++ == 0)
+    __atomic_store_n(&reader->epoch,
+                     __atomic_load_n(&sg__rcu_epoch, __ATOMIC_SEQ_CST),
+                     __ATOMIC_SEQ_CST);
+  return 0;
+}
+
+void sg__rcu_read_unlock(void) {
+  struct sg__rcu_reader *reader = pthread_getspecific(sg__rcu_key);
+  if (reader && (reader->nesting > 0) && (--reader->nesting == 0))
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+bool sg__rcu_reading(void) {
+  struct sg__rcu_reader *reader;
+  if ((pthread_once(&sg__rcu_once, sg__rcu_key_new) != 0) ||
+      (sg__rcu_key_err != 0))
+    return false;
+  reader = pthread_getspecific(sg__rcu_key);
+  return reader && (reader->nesting > 0);
+}
+
+int sg__rcu_sync_begin(void) {
+  if (sg__rcu_reading())
+    return EDEADLK;
+  return pthread_mutex_lock(&sg__rcu_mutex);
+}
+
+/* Starts a new epoch, then waits for the readers still in an older one. */
+void sg__rcu_sync_end(void) {
+  struct sg__rcu_reader *reader;
+  unsigned long epoch, seen;
+  epoch = __atomic_add_fetch(&sg__rcu_epoch, 1, __ATOMIC_SEQ_CST);
+  DL_FOREACH(sg__rcu_readers, reader) {
+    while (((seen = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST)) != 0) &&
+           (seen < epoch))
+      sched_yield();
+  }
+  pthread_mutex_unlock(&sg__rcu_mutex);
+}
+
+int sg__rcu_synchronize(void) {
+  int errnum = sg__rcu_sync_begin();
+  if (errnum != 0)
+    return errnum;
+  sg__rcu_sync_end();
+  return 0;
+}
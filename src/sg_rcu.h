@@ -0,0 +1,67 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_RCU_H
+#define SG_RCU_H
+
+#include <stdbool.h>
+#include "sg_macros.h"
+
+/* Reads and publishes pointers shared with read-side sections. */
+#define sg__rcu_dereference(ptr) __atomic_load_n(&(ptr), __ATOMIC_SEQ_CST)
+#define sg__rcu_assign(ptr, val)                                               \
+  __atomic_store_n(&(ptr), (val), __ATOMIC_SEQ_CST)
+
+/* Read-side state of a thread: the epoch seen when it entered the outermost
+   section, or zero outside sections. */
+struct sg__rcu_reader {
+  struct sg__rcu_reader *prev, *next;
+  unsigned long epoch;
+  unsigned int nesting;
+};
+
+/* Enters a read-side section, which never blocks once the thread is
+   registered. Sections can be nested. */
+SG__EXTERN int sg__rcu_read_lock(void);
+
+SG__EXTERN void sg__rcu_read_unlock(void);
+
+/* Indicates if the calling thread is inside a read-side section. */
+SG__EXTERN bool sg__rcu_reading(void);
+
+/* Waits for the read-side sections entered before the call, so the data
+   unpublished before it can be freed. Returns EDEADLK inside a section. */
+SG__EXTERN int sg__rcu_synchronize(void);
+
+/* Splits sg__rcu_synchronize() around a publication: the begin, the only part
+   that can fail, takes the writer side, and the end waits for the readers and
+   releases it. A pointer assigned between both cannot be left published by a
+   failed grace period. */
+SG__EXTERN int sg__rcu_sync_begin(void);
+
+SG__EXTERN void sg__rcu_sync_end(void);
+
+#endif /* SG_RCU_H */
@@ -24,15 +24,326 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <errno.h>
+#include <sched.h>
+#include <pthread.h>
 #include "sg_macros.h"
 #include "utlist.h"
 #include "sg_routes.h"
+#include "sg_rtree.h"
+#include "sg_rcache.h"
+#include "sg_rstats.h"
+#include "sg_rcu.h"
 #include "sg_router.h"
 #include "sagui.h"
 
+/* Match data reused by the dispatches of the calling thread. */
+struct sg__router_cache {
+  pcre2_match_data *match;
+  uint32_t size;
+  /* route stats shard of the thread */
+  unsigned int shard;
+  bool busy;
+};
+
+static pthread_once_t sg__router_once = PTHREAD_ONCE_INIT;
+static pthread_key_t sg__router_key;
+static int sg__router_key_err;
+/* guards the route stats, since routes can be shared by routers */
+static pthread_mutex_t sg__router_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int sg__router_shard;
+
+static void sg__router_cache_free(void *cls) {
+  struct sg__router_cache *cache = cls;
+  pcre2_match_data_free(cache->match);
+  sg_free(cache);
+}
+
+static void sg__router_key_new(void) {
+  sg__router_key_err =
+    pthread_key_create(&sg__router_key, sg__router_cache_free);
+}
+
+static struct sg__router_cache *sg__router_cache(void) {
+  struct sg__router_cache *cache;
+  if ((pthread_once(&sg__router_once, sg__router_key_new) != 0) ||
+      (sg__router_key_err != 0))
+    return NULL;
+  cache = pthread_getspecific(sg__router_key);
+  if (cache)
+    return cache;
+  cache = sg_alloc(sizeof(struct sg__router_cache));
+  if (!cache)
+    return NULL;
+  if (pthread_mutex_lock(&sg__router_stats_mutex) == 0) {
+    cache->shard = sg__router_shard++;
+    pthread_mutex_unlock(&sg__router_stats_mutex);
+  }
+  if (pthread_setspecific(sg__router_key, cache) != 0) {
+    sg_free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+/* Tells whether the calling thread is running a dispatch holding a snapshot,
+   e.g. from a route callback. */
+static bool sg__router_dispatching(void) {
+  struct sg__router_cache *cache;
+  if ((pthread_once(&sg__router_once, sg__router_key_new) != 0) ||
+      (sg__router_key_err != 0))
+    return false;
+  cache = pthread_getspecific(sg__router_key);
+  return cache && cache->busy;
+}
+
+static void sg__router_idx_free(struct sg__router_idx *idx) {
+  if (!idx)
+    return;
+  sg__rtree_free(idx->tree);
+  pcre2_code_free(idx->alt);
+  sg_free(idx->alts);
+  sg_free(idx->res);
+  sg_free(idx);
+}
+
+static void sg__router_unindex(struct sg__router_idx **idx) {
+  struct sg__router_idx *all = idx[SG__ROUTER_IDX_ALL];
+  unsigned int i;
+  for (i = 0; i < SG__ROUTER_IDX_ALL; i++) {
+    if (idx[i] != all)
+      sg__router_idx_free(idx[i]);
+    idx[i] = NULL;
+  }
+  sg__router_idx_free(all);
+  idx[SG__ROUTER_IDX_ALL] = NULL;
+}
+
+/* Checks if the route can be a branch of the combined pattern: it must be
+   anchored and must not refer to its groups (back-references, conditions,
+   recursion or calls), since they are renumbered inside the alternation. */
+static bool sg__router_combinable(struct sg_route *route) {
+  const char *p;
+  uint32_t opts, refs;
+  if (route->ovec_count > SG__RTREE_MAX_CAPS + 1)
+    return false;
+  pcre2_pattern_info(route->re, PCRE2_INFO_ALLOPTIONS, &opts);
+  pcre2_pattern_info(route->re, PCRE2_INFO_BACKREFMAX, &refs);
+  if (!(opts & PCRE2_ANCHORED) || (refs > 0))
+    return false;
+  for (p = route->pattern; *p; p++) {
+    if ((*p == '\\') && (p[1] == 'g'))
+      return false;
+    if ((*p != '(') || ((p[1] != '*') && (p[1] != '?')))
+      continue;
+    if (p[1] == '*')
+      return false;
+    p += 2;
+    if (*p == '-')
+      p++;
+    if (((*p >= '0') && (*p <= '9')) || strchr("+R&(", *p) ||
+        ((*p == 'P') && (p[1] == '>')))
+      return false;
+  }
+  return true;
+}
+
+/* Compiles the combined routes as `(*MARK:0)(?:^a$)|(*MARK:1)(?:^b$)|...`,
+   so the mark of a single match tells which route won. */
+static int sg__router_alt_compile(struct sg__router_idx *idx) {
+  char *pat, *p;
+  PCRE2_SIZE off;
+  size_t size = 0;
+  unsigned int i;
+  int errnum;
+  for (i = 0; i < idx->alts_count; i++)
+    size += strlen(idx->alts[i].route->pattern) + 24;
+  pat = sg_malloc(size);
+  if (!pat)
+    return ENOMEM;
+  p = pat;
+  for (i = 0; i < idx->alts_count; i++)
+    p += sprintf(p, "%s(*MARK:%u)(?:%s)", (i > 0) ? "|" : "", i,
+                 idx->alts[i].route->pattern);
+  idx->alt = pcre2_compile((PCRE2_SPTR) pat, PCRE2_ZERO_TERMINATED,
+                              PCRE2_CASELESS | PCRE2_DUPNAMES |
+                                PCRE2_ANCHORED,
+                              &errnum, &off, NULL);
+  sg_free(pat);
+  if (!idx->alt)
+    return EINVAL;
+#ifdef PCRE2_JIT_SUPPORT
+  if (pcre2_jit_compile(idx->alt, PCRE2_JIT_COMPLETE) < 0)
+    return EINVAL;
+#endif /* PCRE2_JIT_SUPPORT */
+  pcre2_pattern_info(idx->alt, PCRE2_INFO_CAPTURECOUNT,
+                     &idx->alt_ovec_count);
+  idx->alt_ovec_count++;
+  return 0;
+}
+
+static void sg__router_snap_free(struct sg__router_snap *snap) {
+  if (!snap)
+    return;
+  sg__router_unindex(snap->idx);
+  sg__rcache_free(snap->rcache);
+  sg_free(snap);
+}
+
+/* Indexes the routes serving all the methods in `mask`, in list order. */
+static struct sg__router_idx *sg__router_idx_new(struct sg_route *routes,
+                                                 unsigned int mask,
+                                                 bool combined, int *errnum) {
+  struct sg__router_idx *idx;
+  struct sg_route *route;
+  struct sg__router_re *re;
+  unsigned int count, order = 0;
+  uint32_t base = 0;
+  *errnum = ENOMEM;
+  idx = sg_alloc(sizeof(struct sg__router_idx));
+  if (!idx)
+    return NULL;
+  LL_COUNT(routes, route, count);
+  idx->res = sg_malloc(count * sizeof(struct sg__router_re));
+  if (!idx->res)
+    goto error;
+  if (combined) {
+    idx->alts = sg_malloc(count * sizeof(struct sg__router_re));
+    if (!idx->alts)
+      goto error;
+  }
+  idx->tree = sg__rtree_new();
+  if (!idx->tree)
+    goto error;
+  LL_FOREACH(routes, route) {
+    if ((route->methods & mask) != mask) {
+      order++;
+      continue;
+    }
+    *errnum = sg__rtree_add(idx->tree, route, order);
+    if (*errnum == ENOTSUP) {
+      if (combined && sg__router_combinable(route)) {
+        re = &idx->alts[idx->alts_count++];
+        re->base = base;
+        base += route->ovec_count - 1;
+      } else
+        re = &idx->res[idx->res_count++];
+      re->route = route;
+      re->order = order;
+    } else if (*errnum != 0)
+      goto error;
+    order++;
+  }
+  if (idx->alts_count > 0) {
+    *errnum = sg__router_alt_compile(idx);
+    /* e.g. too many groups in a single pattern, index without combining */
+    if (*errnum == EINVAL) {
+      sg__router_idx_free(idx);
+      return sg__router_idx_new(routes, mask, false, errnum);
+    }
+    if (*errnum != 0)
+      goto error;
+  }
+  *errnum = 0;
+  return idx;
+error:
+  sg__router_idx_free(idx);
+  return NULL;
+}
+
+/* Allocates the stats of the routes lacking them. */
+static int sg__router_stats_alloc(struct sg_route *routes) {
+  struct sg_route *route;
+  int errnum;
+  errnum = pthread_mutex_lock(&sg__router_stats_mutex);
+  if (errnum != 0)
+    return errnum;
+  LL_FOREACH(routes, route) {
+    if (route->stats)
+      continue;
+    __atomic_store_n(&route->stats, sg__rstats_new(), __ATOMIC_RELEASE);
+    if (!route->stats) {
+      errnum = ENOMEM;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&sg__router_stats_mutex);
+  return errnum;
+}
+
+/* Creates the index of all routes, plus one per method left out by any
+   route. */
+static int sg__router_build(struct sg_route *routes, bool combined,
+                            struct sg__router_idx **idx) {
+  struct sg__router_idx *all;
+  struct sg_route *route;
+  unsigned int i, mask;
+  int errnum;
+  all = sg__router_idx_new(routes, 0, combined, &errnum);
+  if (!all)
+    return errnum;
+  idx[SG__ROUTER_IDX_ALL] = all;
+  for (i = 0; i < SG__ROUTER_IDX_ALL; i++) {
+    mask = (i == SG__ROUTER_IDX_OTHER) ? SG_METHOD_ANY : 1U << i;
+    LL_FOREACH(routes, route) {
+      if ((route->methods & mask) != mask)
+        break;
+    }
+    if (!route) {
+      idx[i] = all;
+      continue;
+    }
+    idx[i] = sg__router_idx_new(routes, mask, combined, &errnum);
+    if (!idx[i]) {
+      sg__router_unindex(idx);
+      return errnum;
+    }
+  }
+  return 0;
+}
+
+static int sg__router_index(struct sg_router *router, bool combined) {
+  int errnum;
+  sg__router_unindex(router->idx);
+  if (router->stats) {
+    errnum = sg__router_stats_alloc(router->routes);
+    if (errnum != 0)
+      return errnum;
+  }
+  errnum = sg__router_build(router->routes, combined, router->idx);
+  if (errnum != 0)
+    return errnum;
+  router->gen = router->routes->gen;
+  router->stale = false;
+  return 0;
+}
+
+/* Rebuilds the index after the routes or the router options change. */
+static int sg__router_refresh(struct sg_router *router) {
+  int errnum;
+  if (!router->stale && (router->gen == router->routes->gen))
+    return 0;
+  errnum = pthread_mutex_lock(&router->mutex);
+  if (errnum != 0)
+    return errnum;
+  errnum = 0;
+  if (router->stale || (router->gen != router->routes->gen)) {
+    errnum = sg__router_index(router, router->combined);
+    if (errnum != 0)
+      sg__router_unindex(router->idx);
+  }
+  pthread_mutex_unlock(&router->mutex);
+  return errnum;
+}
+
 struct sg_router *sg_router_new(struct sg_route *routes) {
   struct sg_router *router;
+  int errnum;
   if (!routes) {
     errno = EINVAL;
     return NULL;
@@ -40,48 +351,580 @@ struct sg_router *sg_router_new(struct sg_route *routes) {
   router = sg_alloc(sizeof(struct sg_router));
   if (!router)
     return NULL;
+  errnum = pthread_mutex_init(&router->mutex, NULL);
+  if (errnum != 0) {
+    sg_free(router);
+    errno = errnum;
+    return NULL;
+  }
+  errnum = pthread_cond_init(&router->drained, NULL);
+  if (errnum != 0) {
+    pthread_mutex_destroy(&router->mutex);
+    sg_free(router);
+    errno = errnum;
+    return NULL;
+  }
   router->routes = routes;
+  errnum = sg__router_index(router, false);
+  if (errnum != 0) {
+    sg_router_free(router);
+    errno = errnum;
+    return NULL;
+  }
   return router;
 }
 
 void sg_router_free(struct sg_router *router) {
+  if (!router)
+    return;
+  sg__router_snap_free(router->snap);
+  sg__router_unindex(router->idx);
+  sg__rcache_free(router->rcache);
+  pthread_cond_destroy(&router->drained);
+  pthread_mutex_destroy(&router->mutex);
   sg_free(router);
 }
 
-int sg_router_dispatch2(struct sg_router *router, const char *path,
-                        void *user_data, sg_router_dispatch_cb dispatch_cb,
-                        void *cls, sg_router_match_cb match_cb) {
+/* Waits for the dispatches still running the routes of the retired snapshot,
+   which took it before it was unpublished. */
+static void sg__router_drain(struct sg_router *router,
+                             struct sg__router_snap *snap) {
+  if (__atomic_add_fetch(&snap->refs, SG__ROUTER_SNAP_RETIRED,
+                         __ATOMIC_SEQ_CST) == SG__ROUTER_SNAP_RETIRED)
+    return;
+  if (pthread_mutex_lock(&router->mutex) != 0) {
+    while (__atomic_load_n(&snap->refs, __ATOMIC_SEQ_CST) !=
+           SG__ROUTER_SNAP_RETIRED)
+      sched_yield();
+    return;
+  }
+  while (__atomic_load_n(&snap->refs, __ATOMIC_SEQ_CST) !=
+         SG__ROUTER_SNAP_RETIRED)
+    pthread_cond_wait(&router->drained, &router->mutex);
+  pthread_mutex_unlock(&router->mutex);
+}
+
+/* Indexes the routes aside and publishes them as the new snapshot, freeing
+   the previous one once no dispatch can be using it. */
+static int sg__router_publish(struct sg_router *router, struct sg_route *routes,
+                              bool combined, struct sg_route **old) {
+  struct sg__router_snap *snap, *prev;
+  int errnum;
+  /* it would wait for the dispatch running the caller */
+  if (sg__rcu_reading() || sg__router_dispatching())
+    return EDEADLK;
+  snap = sg_alloc(sizeof(struct sg__router_snap));
+  if (!snap)
+    return ENOMEM;
+  snap->routes = routes;
+  errnum = sg__router_build(routes, combined, snap->idx);
+  if (errnum != 0)
+    goto error;
+  /* a fresh cache, so no path is served by the previous routes */
+  if (router->cache_size > 0) {
+    snap->rcache = sg__rcache_new(router->cache_size);
+    if (!snap->rcache) {
+      errnum = errno;
+      goto error;
+    }
+  }
+  errnum = sg__rcu_sync_begin();
+  if (errnum != 0)
+    goto error;
+  prev = router->snap;
+  sg__rcu_assign(router->snap, snap);
+  sg__rcu_sync_end();
+  if (prev) {
+    sg__router_drain(router, prev);
+    *old = prev->routes;
+    sg__router_snap_free(prev);
+  } else {
+    *old = router->routes;
+    sg__router_unindex(router->idx);
+    sg__rcache_free(router->rcache);
+    router->rcache = NULL;
+  }
+  router->routes = routes;
+  return 0;
+error:
+  sg__router_snap_free(snap);
+  return errnum;
+}
+
+int sg_router_swap(struct sg_router *router, struct sg_route *routes,
+                   struct sg_route **old) {
+  int errnum;
+  if (!router || !routes || !old)
+    return EINVAL;
+  if (router->stats) {
+    errnum = sg__router_stats_alloc(routes);
+    if (errnum != 0)
+      return errnum;
+  }
+  return sg__router_publish(router, routes, router->combined, old);
+}
+
+int sg_router_set_cache(struct sg_router *router, unsigned int size) {
+  struct sg__rcache *rcache = NULL;
+  if (!router)
+    return EINVAL;
+  if (size > 0) {
+    rcache = sg__rcache_new(size);
+    if (!rcache)
+      return errno;
+  }
+  if (router->snap) {
+    sg__rcache_free(router->snap->rcache);
+    router->snap->rcache = rcache;
+  } else {
+    sg__rcache_free(router->rcache);
+    router->rcache = rcache;
+  }
+  router->cache_size = size;
+  return 0;
+}
+
+int sg_router_cache_stats(struct sg_router *router, uint64_t *hits,
+                          uint64_t *misses) {
+  struct sg__router_snap *snap;
+  struct sg__rcache *rcache;
+  int errnum;
+  if (!router || !hits || !misses)
+    return EINVAL;
+  errnum = sg__rcu_read_lock();
+  if (errnum != 0)
+    return errnum;
+  snap = sg__rcu_dereference(router->snap);
+  rcache = snap ? snap->rcache : router->rcache;
+  if (rcache)
+    sg__rcache_stats(rcache, hits, misses);
+  else
+    *hits = *misses = 0;
+  sg__rcu_read_unlock();
+  return 0;
+}
+
+int sg_router_set_stats(struct sg_router *router, bool enabled) {
+  int errnum;
+  if (!router)
+    return EINVAL;
+  if (enabled) {
+    errnum = sg__router_stats_alloc(router->routes);
+    if (errnum != 0)
+      return errnum;
+  }
+  router->stats = enabled;
+  return 0;
+}
+
+int sg_router_stats_iter(struct sg_router *router, sg_router_stats_iter_cb cb,
+                         void *cls) {
+  struct sg__router_snap *snap;
+  struct sg_route_stats stats;
   struct sg_route *route;
   int ret;
-  if (!router || !path || !router->routes)
+  if (!router || !cb)
     return EINVAL;
-  LL_FOREACH(router->routes, route) {
-    if (dispatch_cb) {
-      ret = dispatch_cb(cls, path, route);
-      if (ret != 0)
-        return ret;
+  ret = sg__rcu_read_lock();
+  if (ret != 0)
+    return ret;
+  snap = sg__rcu_dereference(router->snap);
+  LL_FOREACH(snap ? snap->routes : router->routes, route) {
+    sg_route_stats(route, &stats);
+    ret = cb(cls, route, &stats);
+    if (ret != 0)
+      break;
+  }
+  sg__rcu_read_unlock();
+  return ret;
+}
+
+int sg_router_set_combined(struct sg_router *router, bool combined) {
+  struct sg_route *old;
+  int errnum;
+  if (!router)
+    return EINVAL;
+  if (router->combined == combined)
+    return 0;
+  if (router->snap) {
+    /* the dispatches keep the current index until the new one is published */
+    errnum = sg__router_publish(router, router->routes, combined, &old);
+    if (errnum != 0)
+      return errnum;
+  } else
+    router->stale = true;
+  router->combined = combined;
+  return 0;
+}
+
+bool sg_router_combined(struct sg_router *router) {
+  if (router)
+    return router->combined;
+  errno = EINVAL;
+  return false;
+}
+
+static int sg__router_match(struct sg__router_cache *cache, pcre2_code *re,
+                            uint32_t ovec_count, const char *path, size_t len,
+                            int *rc) {
+  if (ovec_count > cache->size) {
+    pcre2_match_data_free(cache->match);
+    cache->match = pcre2_match_data_create(ovec_count, NULL);
+    if (!cache->match) {
+      cache->size = 0;
+      return ENOMEM;
     }
+    cache->size = ovec_count;
+  }
 #ifdef PCRE2_JIT_SUPPORT
 #define SG__PCRE2_MATCH pcre2_jit_match
 #else /* PCRE2_JIT_SUPPORT */
 #define SG__PCRE2_MATCH pcre2_match
 #endif /* PCRE2_JIT_SUPPORT */
-    route->rc = SG__PCRE2_MATCH(route->re, (PCRE2_SPTR) path, strlen(path), 0,
-                                0, route->match, NULL);
+  *rc = SG__PCRE2_MATCH(re, (PCRE2_SPTR) path, len, 0, 0, cache->match, NULL);
 #undef SG__PCRE2_MATCH
-    if (route->rc >= 0) {
-      route->path = path;
-      route->user_data = user_data;
-      if (match_cb) {
-        ret = match_cb(cls, route);
-        if (ret != 0)
-          return ret;
+  return 0;
+}
+
+/* Copies the groups of the combined branch `re` to `ovector`, numbering them
+   as in the route's own pattern. Returns the count PCRE2 would return. */
+static int sg__router_remap(const struct sg__router_re *re,
+                            pcre2_match_data *match, PCRE2_SIZE *ovector) {
+  const PCRE2_SIZE *src = pcre2_get_ovector_pointer(match);
+  uint32_t i, r;
+  int rc = 1;
+  ovector[0] = src[0];
+  ovector[1] = src[1];
+  for (i = 1; i < re->route->ovec_count; i++) {
+    r = (re->base + i) << 1;
+    ovector[i << 1] = src[r];
+    ovector[(i << 1) + 1] = src[r + 1];
+    if (src[r] != PCRE2_UNSET)
+      rc = (int) i + 1;
+  }
+  return rc;
+}
+
+/* Gets the thread cache, or `local` on nested dispatches and failures. */
+static struct sg__router_cache *sg__router_cache_acquire(
+  struct sg__router_cache *local) {
+  struct sg__router_cache *cache = sg__router_cache();
+  if (!cache || cache->busy) {
+    memset(local, 0, sizeof(struct sg__router_cache));
+    cache = local;
+  }
+  cache->busy = true;
+  return cache;
+}
+
+static void sg__router_cache_release(struct sg__router_cache *cache,
+                                     struct sg__router_cache *local) {
+  cache->busy = false;
+  if (cache == local)
+    pcre2_match_data_free(local->match);
+}
+
+/* Drops the snapshot taken by a dispatch. Once retired, it is dropped under
+   the lock, so the swap draining it returns, and can free the router, only
+   after being woken up. */
+static void sg__router_snap_put(struct sg_router *router,
+                                struct sg__router_snap *snap) {
+  unsigned int refs = __atomic_load_n(&snap->refs, __ATOMIC_SEQ_CST);
+  int errnum;
+  while (!(refs & SG__ROUTER_SNAP_RETIRED))
+    if (__atomic_compare_exchange_n(&snap->refs, &refs, refs - 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+      return;
+  errnum = pthread_mutex_lock(&router->mutex);
+  __atomic_sub_fetch(&snap->refs, 1, __ATOMIC_SEQ_CST);
+  if (errnum == 0) {
+    pthread_cond_broadcast(&router->drained);
+    pthread_mutex_unlock(&router->mutex);
+  }
+}
+
+static int sg__router_allowed(struct sg_route *routes,
+                              struct sg__router_cache *cache, const char *path,
+                              size_t len, unsigned int *methods) {
+  struct sg_route *route;
+  int rc, ret;
+  *methods = 0;
+  LL_FOREACH(routes, route) {
+    if ((route->methods & *methods) == route->methods)
+      continue;
+    ret = sg__router_match(cache, route->re, route->ovec_count, path, len,
+                           &rc);
+    if (ret != 0)
+      return ret;
+    if (rc >= 0)
+      *methods |= route->methods;
+  }
+  return 0;
+}
+
+/* Checks through the index of all routes if any route matches the path,
+   whatever its methods. */
+static int sg__router_any(const struct sg__router_idx *idx,
+                          struct sg__router_cache *cache, const char *path,
+                          size_t len, bool *any) {
+  struct sg__rtree_match found;
+  struct sg_route *route;
+  unsigned int i;
+  int rc, ret;
+  sg__rtree_find(idx->tree, path, len, &found);
+  *any = found.route != NULL;
+  if (!*any && idx->alt) {
+    ret = sg__router_match(cache, idx->alt, idx->alt_ovec_count, path, len,
+                           &rc);
+    if (ret != 0)
+      return ret;
+    *any = rc >= 0;
+  }
+  for (i = 0; !*any && (i < idx->res_count); i++) {
+    route = idx->res[i].route;
+    ret = sg__router_match(cache, route->re, route->ovec_count, path, len,
+                           &rc);
+    if (ret != 0)
+      return ret;
+    *any = rc >= 0;
+  }
+  return 0;
+}
+
+int sg_router_allowed(struct sg_router *router, const char *path,
+                      unsigned int *methods) {
+  struct sg__router_cache *cache, local;
+  struct sg__router_snap *snap;
+  struct sg_route *routes;
+  int ret;
+  if (!router || !path || !methods)
+    return EINVAL;
+  ret = sg__rcu_read_lock();
+  if (ret != 0)
+    return ret;
+  snap = sg__rcu_dereference(router->snap);
+  routes = snap ? snap->routes : router->routes;
+  if (routes) {
+    cache = sg__router_cache_acquire(&local);
+    ret = sg__router_allowed(routes, cache, path, strlen(path), methods);
+    sg__router_cache_release(cache, &local);
+  } else
+    ret = EINVAL;
+  sg__rcu_read_unlock();
+  return ret;
+}
+
+/* Gets the stats of the route, allocating them if it was added after they
+   were enabled and is dispatched without refreshing the index, e.g. through
+   a `dispatch_cb`. */
+static struct sg__rstats *sg__router_stats(struct sg_route *route) {
+  struct sg__rstats *stats = __atomic_load_n(&route->stats, __ATOMIC_ACQUIRE);
+  if (stats || (pthread_mutex_lock(&sg__router_stats_mutex) != 0))
+    return stats;
+  stats = route->stats;
+  if (!stats) {
+    stats = sg__rstats_new();
+    __atomic_store_n(&route->stats, stats, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&sg__router_stats_mutex);
+  return stats;
+}
+
+/* Calls the route, timing it if the stats are enabled. */
+static void sg__router_call(struct sg_router *router,
+                            struct sg__router_cache *cache,
+                            struct sg_route *route, struct sg_route *match,
+                            unsigned int misses) {
+  struct timespec start, end;
+  struct sg__rstats *stats;
+  if (!router->stats || !(stats = sg__router_stats(route))) {
+    route->cb(route->cls, match);
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  route->cb(route->cls, match);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sg__rstats_add(stats, cache->shard, misses,
+                 (uint64_t) (((end.tv_sec - start.tv_sec) * 1000000000LL) +
+                             (end.tv_nsec - start.tv_nsec)));
+}
+
+int sg_router_dispatch3(struct sg_router *router, const char *method,
+                        const char *path, void *user_data,
+                        sg_router_dispatch_cb dispatch_cb, void *cls,
+                        sg_router_match_cb match_cb) {
+  PCRE2_SIZE ovector[(SG__RTREE_MAX_CAPS + 1) << 1];
+  struct sg__router_cache *cache, local;
+  struct sg__rtree_match found;
+  struct sg__router_snap *snap;
+  struct sg__rcache *rcache;
+  const struct sg__router_idx *idx = NULL, *all = NULL;
+  const struct sg__router_re *re;
+  struct sg_route *routes, *route, *hit, match;
+  unsigned int i, j, mask, order, gen, misses = 0;
+  size_t len;
+  int rc, hit_rc = 0, ret;
+  bool any, held = false;
+  if (!router || !path)
+    return EINVAL;
+  /* the snapshot is not freed before the section ends */
+  ret = sg__rcu_read_lock();
+  if (ret != 0)
+    return ret;
+  snap = sg__rcu_dereference(router->snap);
+  routes = snap ? snap->routes : router->routes;
+  if (!routes) {
+    sg__rcu_read_unlock();
+    return EINVAL;
+  }
+  i = SG__ROUTER_IDX_ALL;
+  mask = 0;
+  if (method) {
+    mask = sg__method_mask(method);
+    for (i = 0; (i < SG__METHOD_COUNT) && (mask != (1U << i)); i++)
+      ;
+    if (mask == 0)
+      mask = SG_METHOD_ANY;
+  }
+  cache = sg__router_cache_acquire(&local);
+  /* a reference keeps the snapshot alive from here, so the section does not
+     span the callbacks and the swaps wait only for the dispatches of their
+     router; dispatches without the thread cache, nested or out of memory, keep
+     the section, so the swaps called by their callbacks are still refused */
+  if (snap && (cache != &local)) {
+    __atomic_add_fetch(&snap->refs, 1, __ATOMIC_SEQ_CST);
+    sg__rcu_read_unlock();
+    held = true;
+  }
+  len = strlen(path);
+  /* `$` also matches before a trailing newline, leave it to PCRE2 */
+  if (!dispatch_cb && !memchr(path, '\n', len) &&
+      (snap || (sg__router_refresh(router) == 0))) {
+    if (snap) {
+      rcache = snap->rcache;
+      idx = snap->idx[i];
+      all = snap->idx[SG__ROUTER_IDX_ALL];
+      gen = routes->gen;
+    } else {
+      rcache = router->rcache;
+      idx = router->idx[i];
+      all = router->idx[SG__ROUTER_IDX_ALL];
+      gen = router->gen;
+    }
+    if (rcache &&
+        sg__rcache_get(rcache, i, gen, path, len, &route, ovector, &rc))
+      goto cached;
+    sg__rtree_find(idx->tree, path, len, &found);
+    hit = NULL;
+    order = found.order;
+    if (idx->alt && (idx->alts[0].order < order)) {
+      ret = sg__router_match(cache, idx->alt, idx->alt_ovec_count, path, len,
+                             &rc);
+      if (ret != 0)
+        goto done;
+      if (rc >= 0) {
+        re = &idx->alts[strtoul((const char *) pcre2_get_mark(cache->match),
+                                NULL, 10)];
+        if (re->order < order) {
+          hit = re->route;
+          order = re->order;
+          hit_rc = sg__router_remap(re, cache->match, ovector);
+        }
+      }
+      if (!hit)
+        misses++;
+    }
+    if (!hit && found.route) {
+      hit = found.route;
+      ovector[0] = 0;
+      ovector[1] = len;
+      for (j = 0; j < (found.caps_count << 1); j++)
+        ovector[j + 2] = found.caps[j];
+      hit_rc = (int) found.caps_count + 1;
+    }
+    for (j = 0; (j < idx->res_count) && (idx->res[j].order < order); j++) {
+      route = idx->res[j].route;
+      ret = sg__router_match(cache, route->re, route->ovec_count, path, len,
+                             &rc);
+      if (ret != 0)
+        goto done;
+      if (rc >= 0) {
+        if (rcache)
+          sg__rcache_put(rcache, i, gen, path, len, route,
+                         pcre2_get_ovector_pointer(cache->match), rc);
+        goto matched;
       }
-      route->cb(route->cls, route);
-      return 0;
+      misses++;
     }
+    if (!hit)
+      goto notfound;
+    route = hit;
+    rc = hit_rc;
+    if (rcache)
+      sg__rcache_put(rcache, i, gen, path, len, route, ovector, rc);
+  cached:
+    match = *route;
+    match.match = NULL;
+    match.ovector = ovector;
+    match.rc = rc;
+    goto call;
   }
-  return ENOENT;
+  LL_FOREACH(routes, route) {
+    if ((route->methods & mask) != mask)
+      continue;
+    if (dispatch_cb) {
+      ret = dispatch_cb(cls, path, route);
+      if (ret != 0)
+        goto done;
+    }
+    ret = sg__router_match(cache, route->re, route->ovec_count, path, len,
+                           &rc);
+    if (ret != 0)
+      goto done;
+    if (rc >= 0)
+      goto matched;
+    misses++;
+  }
+notfound:
+  ret = ENOENT;
+  /* tells a path served only by other methods apart from an unknown path,
+     rejecting the unknown ones through the index of all routes */
+  if (!method ||
+      (all && ((all == idx) ||
+               (sg__router_any(all, cache, path, len, &any) != 0) || !any)))
+    goto done;
+  if ((sg__router_allowed(routes, cache, path, len, &i) == 0) && (i != 0))
+    ret = ENOTSUP;
+  goto done;
+matched:
+  match = *route;
+  match.match = cache->match;
+  match.ovector = pcre2_get_ovector_pointer(cache->match);
+  match.rc = rc;
+call:
+  match.path = path;
+  match.user_data = user_data;
+  ret = 0;
+  if (match_cb)
+    ret = match_cb(cls, &match);
+  if (ret == 0)
+    sg__router_call(router, cache, route, &match, misses);
+  if (match.match && (match.match != cache->match))
+    pcre2_match_data_free(match.match);
+done:
+  sg__router_cache_release(cache, &local);
+  if (held)
+    sg__router_snap_put(router, snap);
+  else
+    sg__rcu_read_unlock();
+  return ret;
+}
+
+int sg_router_dispatch2(struct sg_router *router, const char *path,
+                        void *user_data, sg_router_dispatch_cb dispatch_cb,
+                        void *cls, sg_router_match_cb match_cb) {
+  return sg_router_dispatch3(router, NULL, path, user_data, dispatch_cb, cls,
+                             match_cb);
 }
 
 int sg_router_dispatch(struct sg_router *router, const char *path,
@@ -27,11 +27,66 @@
 #ifndef SG_ROUTER_H
 #define SG_ROUTER_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "sg_routes.h"
+#include "sg_utils.h"
+#include "sg_rtree.h"
+#include "sg_rcache.h"
+#include "sg_rstats.h"
 #include "sagui.h"
 
+struct sg__router_re {
+  struct sg_route *route;
+  unsigned int order;
+  /* first capture of the route inside the combined pattern */
+  uint32_t base;
+};
+
+/* Routes index: simple paths in the tree, anchored regexes in a single
+   alternation when combined, and the others matched in order. */
+struct sg__router_idx {
+  struct sg__rtree *tree;
+  pcre2_code *alt;
+  struct sg__router_re *alts;
+  unsigned int alts_count;
+  uint32_t alt_ovec_count;
+  struct sg__router_re *res;
+  unsigned int res_count;
+};
+
+/* one index per known method, one for other methods and one for all */
+#define SG__ROUTER_IDX_OTHER SG__METHOD_COUNT
+#define SG__ROUTER_IDX_ALL (SG__METHOD_COUNT + 1)
+
+#define SG__ROUTER_SNAP_RETIRED (1U << 31)
+
+/* Immutable routes and index published by #sg_router_swap(). */
+struct sg__router_snap {
+  struct sg_route *routes;
+  struct sg__router_idx *idx[SG__ROUTER_IDX_ALL + 1];
+  struct sg__rcache *rcache;
+  /* dispatches still running the routes outside the read-side section, plus
+     #SG__ROUTER_SNAP_RETIRED once unpublished */
+  unsigned int refs;
+};
+
 struct sg_router {
+  /* once set, dispatches use it instead of the routes, index and cache */
+  struct sg__router_snap *snap;
   struct sg_route *routes;
+  /* methods served by every route share the index of all routes */
+  struct sg__router_idx *idx[SG__ROUTER_IDX_ALL + 1];
+  struct sg__rcache *rcache;
+  unsigned int cache_size;
+  pthread_mutex_t mutex;
+  /* signaled once a retired snapshot is no longer referenced */
+  pthread_cond_t drained;
+  unsigned int gen;
+  bool combined;
+  bool stale;
+  bool stats;
 };
 
 #endif /* SG_ROUTER_H */
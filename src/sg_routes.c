@@ -24,6 +24,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
@@ -38,9 +40,12 @@
 
 static void sg__route_free(struct sg_route *route);
 
-static struct sg_route *sg__route_new(const char *pattern, char *errmsg,
-                                      size_t errlen, int *errnum,
-                                      sg_route_cb cb, void *cls) {
+/* Creates a route compiling its pattern, or taking the already compiled code
+   `re` (e.g. loaded by #sg_routes_load()), which is freed on errors. */
+static struct sg_route *sg__route_new2(const char *pattern, pcre2_code *re,
+                                       char *errmsg, size_t errlen,
+                                       int *errnum, sg_route_cb cb,
+                                       void *cls) {
   struct sg_route *route;
   PCRE2_UCHAR err[SG_ERR_SIZE >> 1];
   size_t off;
@@ -48,13 +53,16 @@ static struct sg_route *sg__route_new(const char *pattern, char *errmsg,
   if (strstr(pattern, "\\K")) {
     strncpy(errmsg, _("\\K is not not allowed.\n"), errlen);
     *errnum = EINVAL;
+    pcre2_code_free(re);
     return NULL;
   }
   route = sg_alloc(sizeof(struct sg_route));
   if (!route) {
     *errnum = ENOMEM;
+    pcre2_code_free(re);
     return NULL;
   }
+  route->re = re;
   off = strlen(pattern) + 3;
   route->pattern = sg_malloc(off);
   if (!route->pattern) {
@@ -62,10 +70,13 @@ static struct sg_route *sg__route_new(const char *pattern, char *errmsg,
     goto error;
   }
   snprintf(route->pattern, off, ((*pattern == '(') ? "%s" : "^%s$"), pattern);
-  route->re = pcre2_compile((PCRE2_SPTR) route->pattern, PCRE2_ZERO_TERMINATED,
-                            PCRE2_CASELESS, errnum, &off, NULL);
-  if (route->re)
-    *errnum = 0;
+  if (!route->re) {
+    route->re =
+      pcre2_compile((PCRE2_SPTR) route->pattern, PCRE2_ZERO_TERMINATED,
+                    PCRE2_CASELESS, errnum, &off, NULL);
+    if (route->re)
+      *errnum = 0;
+  }
   if (!route->re) {
     pcre2_get_error_message(*errnum, err, sizeof(err));
     snprintf(errmsg, errlen,
@@ -83,13 +94,9 @@ static struct sg_route *sg__route_new(const char *pattern, char *errmsg,
     goto error;
   }
 #endif /* PCRE2_JIT_SUPPORT */
-  route->match = pcre2_match_data_create_from_pattern(route->re, NULL);
-  if (!route->match) {
-    strncpy(errmsg, _("Cannot allocate match data from the pattern.\n"),
-            errlen);
-    *errnum = EINVAL;
-    goto error;
-  }
+  pcre2_pattern_info(route->re, PCRE2_INFO_CAPTURECOUNT, &route->ovec_count);
+  route->ovec_count++;
+  route->methods = SG_METHOD_ANY;
   route->cb = cb;
   route->cls = cls;
   return route;
@@ -98,8 +105,14 @@ error:
   return NULL;
 }
 
+static struct sg_route *sg__route_new(const char *pattern, char *errmsg,
+                                      size_t errlen, int *errnum,
+                                      sg_route_cb cb, void *cls) {
+  return sg__route_new2(pattern, NULL, errmsg, errlen, errnum, cb, cls);
+}
+
 static void sg__route_free(struct sg_route *route) {
-  pcre2_match_data_free(route->match);
+  sg__rstats_free(route->stats);
   pcre2_code_free(route->re);
   sg_free(route->pattern);
   sg_free(route);
@@ -113,10 +126,18 @@ void *sg_route_handle(struct sg_route *route) {
 }
 
 void *sg_route_match(struct sg_route *route) {
-  if (route)
-    return route->match;
-  errno = EINVAL;
-  return NULL;
+  if (!route) {
+    errno = EINVAL;
+    return NULL;
+  }
+  /* routes matched without PCRE2 get their match data on demand */
+  if (!route->match && route->path) {
+    route->match = pcre2_match_data_create(route->ovec_count, NULL);
+    if (route->match)
+      pcre2_match(route->re, (PCRE2_SPTR) route->path, strlen(route->path), 0,
+                  0, route->match, NULL);
+  }
+  return route->match;
 }
 
 const char *sg_route_rawpattern(struct sg_route *route) {
@@ -151,64 +172,146 @@ const char *sg_route_path(struct sg_route *route) {
   return NULL;
 }
 
-int sg_route_segments_iter(struct sg_route *route, sg_segments_iter_cb cb,
-                           void *cls) {
-  char *segment;
-  size_t off;
-  int r;
+/* Gets the offsets of the group `n` in the path, failing if it is unset. */
+static bool sg__route_group(struct sg_route *route, int n, const char **val,
+                            size_t *len) {
+  PCRE2_SIZE off;
+  if ((n >= route->rc) || !route->path)
+    return false;
+  if (!route->ovector) {
+    if (!route->match)
+      return false;
+    route->ovector = pcre2_get_ovector_pointer(route->match);
+  }
+  off = route->ovector[n << 1];
+  if (off == PCRE2_UNSET)
+    return false;
+  *val = route->path + off;
+  *len = route->ovector[(n << 1) + 1] - off;
+  return true;
+}
+
+int sg_route_segment(struct sg_route *route, unsigned int index,
+                     const char **segment, size_t *len) {
+  if (!route || !segment || !len)
+    return EINVAL;
+  if ((route->rc <= 0) || (index >= (unsigned int) route->rc - 1) ||
+      !sg__route_group(route, (int) index + 1, segment, len))
+    return ENOENT;
+  return 0;
+}
+
+int sg_route_var(struct sg_route *route, const char *name, const char **val,
+                 size_t *len) {
+  int n;
+  if (!route || !name || !val || !len)
+    return EINVAL;
+  n = pcre2_substring_number_from_name(route->re, (PCRE2_SPTR) name);
+  if ((n < 0) || !sg__route_group(route, n, val, len))
+    return ENOENT;
+  return 0;
+}
+
+int sg_route_segments_iter2(struct sg_route *route, sg_segments_iter2_cb cb,
+                            void *cls) {
+  const char *segment;
+  size_t len;
+  int ret;
   if (!route || !cb)
     return EINVAL;
-  if (route->rc < 0)
-    return 0;
-  route->ovector = pcre2_get_ovector_pointer(route->match);
   for (int i = 1; i < route->rc; i++) {
-    r = i << 1;
-    off = route->ovector[r];
-    segment = strdup(route->path + off);
-    if (!segment)
-      return ENOMEM;
-    segment[route->ovector[r + 1] - off] = '\0';
-    r = cb(cls, (unsigned int) i - 1, segment);
-    sg_free(segment);
-    if (r != 0)
-      return r;
+    if (!sg__route_group(route, i, &segment, &len)) {
+      segment = NULL;
+      len = 0;
+    }
+    ret = cb(cls, (unsigned int) i - 1, segment, len);
+    if (ret != 0)
+      return ret;
   }
   return 0;
 }
 
-int sg_route_vars_iter(struct sg_route *route, sg_vars_iter_cb cb, void *cls) {
+int sg_route_vars_iter2(struct sg_route *route, sg_vars_iter2_cb cb,
+                        void *cls) {
   PCRE2_SPTR tbl, rec;
-  char *val;
-  size_t off;
-  uint32_t cnt, len;
-  int n, r;
+  const char *val;
+  size_t len;
+  uint32_t cnt, size;
+  int ret;
   if (!route || !cb)
     return EINVAL;
   if (route->rc < 0)
     return 0;
-  route->ovector = pcre2_get_ovector_pointer(route->match);
   pcre2_pattern_info(route->re, PCRE2_INFO_NAMECOUNT, &cnt);
   if (cnt == 0)
     return 0;
   pcre2_pattern_info(route->re, PCRE2_INFO_NAMETABLE, &tbl);
-  pcre2_pattern_info(route->re, PCRE2_INFO_NAMEENTRYSIZE, &len);
+  pcre2_pattern_info(route->re, PCRE2_INFO_NAMEENTRYSIZE, &size);
   rec = tbl;
   for (uint32_t i = 0; i < cnt; i++) {
-    n = (rec[0] << 8) | rec[1];
-    r = n << 1;
-    off = route->ovector[r];
-    val = strndup(route->path + off, route->ovector[r + 1] - off);
-    if (!val)
-      return ENOMEM;
-    r = cb(cls, (const char *) rec + 2, val);
-    sg_free(val);
-    if (r != 0)
-      return r;
-    rec += len;
+    if (!sg__route_group(route, (rec[0] << 8) | rec[1], &val, &len)) {
+      val = NULL;
+      len = 0;
+    }
+    ret = cb(cls, (const char *) rec + 2, val, len);
+    if (ret != 0)
+      return ret;
+    rec += size;
   }
   return 0;
 }
 
+struct sg__route_iter_holder {
+  sg_segments_iter_cb segments_cb;
+  sg_vars_iter_cb vars_cb;
+  void *cls;
+};
+
+static int sg__route_segments_iter_cb(void *cls, unsigned int index,
+                                      const char *segment, size_t len) {
+  struct sg__route_iter_holder *holder = cls;
+  char *str;
+  int ret;
+  str = strndup(segment ? segment : "", len);
+  if (!str)
+    return ENOMEM;
+  ret = holder->segments_cb(holder->cls, index, str);
+  sg_free(str);
+  return ret;
+}
+
+int sg_route_segments_iter(struct sg_route *route, sg_segments_iter_cb cb,
+                           void *cls) {
+  struct sg__route_iter_holder holder;
+  if (!route || !cb)
+    return EINVAL;
+  holder.segments_cb = cb;
+  holder.cls = cls;
+  return sg_route_segments_iter2(route, sg__route_segments_iter_cb, &holder);
+}
+
+static int sg__route_vars_iter_cb(void *cls, const char *name,
+                                  const char *val, size_t len) {
+  struct sg__route_iter_holder *holder = cls;
+  char *str;
+  int ret;
+  str = strndup(val ? val : "", len);
+  if (!str)
+    return ENOMEM;
+  ret = holder->vars_cb(holder->cls, name, str);
+  sg_free(str);
+  return ret;
+}
+
+int sg_route_vars_iter(struct sg_route *route, sg_vars_iter_cb cb, void *cls) {
+  struct sg__route_iter_holder holder;
+  if (!route || !cb)
+    return EINVAL;
+  holder.vars_cb = cb;
+  holder.cls = cls;
+  return sg_route_vars_iter2(route, sg__route_vars_iter_cb, &holder);
+}
+
 void *sg_route_user_data(struct sg_route *route) {
   if (route)
     return route->user_data;
@@ -216,23 +319,53 @@ void *sg_route_user_data(struct sg_route *route) {
   return NULL;
 }
 
-int sg_routes_add2(struct sg_route **routes, struct sg_route **route,
-                   const char *pattern, char *errmsg, size_t errlen,
-                   sg_route_cb cb, void *cls) {
+unsigned int sg_route_methods(struct sg_route *route) {
+  if (route)
+    return route->methods;
+  errno = EINVAL;
+  return 0;
+}
+
+int sg_route_stats(struct sg_route *route, struct sg_route_stats *stats) {
+  if (!route || !stats)
+    return EINVAL;
+  /* they may be allocated by a concurrent dispatch */
+  if (__atomic_load_n(&route->stats, __ATOMIC_ACQUIRE))
+    sg__rstats_sum(route->stats, stats);
+  else
+    memset(stats, 0, sizeof(struct sg_route_stats));
+  return 0;
+}
+
+int sg_routes_add3(struct sg_route **routes, struct sg_route **route,
+                   const char *pattern, unsigned int methods, char *errmsg,
+                   size_t errlen, sg_route_cb cb, void *cls) {
   int errnum;
-  if (!routes || !route || !pattern || !errmsg || (errlen < 1) || !cb)
+  if (!routes || !route || !pattern || (methods == 0) ||
+      (methods & ~(unsigned int) SG_METHOD_ANY) || !errmsg || (errlen < 1) ||
+      !cb)
     return EINVAL;
   LL_FOREACH(*routes, *route) {
-    if (strncmp(pattern, (*route)->pattern + 1, strlen(pattern)) == 0)
+    if ((strncmp(pattern, (*route)->pattern + 1, strlen(pattern)) == 0) &&
+        ((*route)->methods & methods))
       return EALREADY;
   }
   *route = sg__route_new(pattern, errmsg, errlen, &errnum, cb, cls);
   if (errnum != 0)
     return errnum;
+  (*route)->methods = methods;
   LL_APPEND(*routes, *route);
+  (*routes)->gen++;
   return 0;
 }
 
+int sg_routes_add2(struct sg_route **routes, struct sg_route **route,
+                   const char *pattern, char *errmsg, size_t errlen,
+                   sg_route_cb cb, void *cls) {
+  return sg_routes_add3(routes, route, pattern, SG_METHOD_ANY, errmsg, errlen,
+                        cb, cls);
+}
+
 bool sg_routes_add(struct sg_route **routes, const char *pattern,
                    sg_route_cb cb, void *cls) {
   struct sg_route *route;
@@ -249,15 +382,326 @@ bool sg_routes_add(struct sg_route **routes, const char *pattern,
   return false;
 }
 
+/* Open-addressing set of the patterns (as given by the user) being added in
+   bulk, merging the methods of routes sharing a pattern. */
+struct sg__routes_key {
+  const char *pattern;
+  size_t len;
+  unsigned int methods;
+};
+
+struct sg__routes_set {
+  struct sg__routes_key *keys;
+  size_t mask;
+};
+
+/* Gets the user pattern back from the raw one. */
+static void sg__route_userpattern(const char *raw, const char **pattern,
+                                  size_t *len) {
+  *len = strlen(raw);
+  if (*raw == '(') {
+    *pattern = raw;
+    return;
+  }
+  *pattern = raw + 1;
+  *len -= 2;
+}
+
+static bool sg__routes_set_add(struct sg__routes_set *set, const char *pattern,
+                               size_t len, unsigned int methods) {
+  struct sg__routes_key *key;
+  size_t i = sg__strcasehash(pattern, len) & set->mask;
+  for (;;) {
+    key = &set->keys[i];
+    if (!key->pattern) {
+      key->pattern = pattern;
+      key->len = len;
+      key->methods = methods;
+      return true;
+    }
+    if ((key->len == len) && (memcmp(key->pattern, pattern, len) == 0)) {
+      if (key->methods & methods)
+        return false;
+      key->methods |= methods;
+      return true;
+    }
+    i = (i + 1) & set->mask;
+  }
+}
+
+/* Adds all the entries or none, taking the compiled code of each one from
+   `codes` when it is given. */
+static int sg__routes_add_many(struct sg_route **routes,
+                               const struct sg_route_entry *entries,
+                               unsigned int count, pcre2_code **codes,
+                               char *errmsg, size_t errlen) {
+  struct sg__routes_set set;
+  struct sg_route *list = NULL, *last = NULL, *route, *tmp;
+  const char *pattern;
+  size_t len, size = 2;
+  unsigned int i;
+  int errnum = 0;
+  if (!routes || (!entries && (count > 0)) || !errmsg || (errlen < 1))
+    return EINVAL;
+  for (i = 0; i < count; i++)
+    if (!entries[i].pattern || !entries[i].cb || (entries[i].methods == 0) ||
+        (entries[i].methods & ~(unsigned int) SG_METHOD_ANY))
+      return EINVAL;
+  if (count == 0)
+    return 0;
+  while (size < ((size_t) sg_routes_count(*routes) + count) << 1)
+    size <<= 1;
+  set.keys = sg_alloc(size * sizeof(struct sg__routes_key));
+  if (!set.keys)
+    return ENOMEM;
+  set.mask = size - 1;
+  LL_FOREACH(*routes, route) {
+    sg__route_userpattern(route->pattern, &pattern, &len);
+    sg__routes_set_add(&set, pattern, len, route->methods);
+  }
+  for (i = 0; i < count; i++) {
+    if (!sg__routes_set_add(&set, entries[i].pattern,
+                            strlen(entries[i].pattern), entries[i].methods)) {
+      snprintf(errmsg, errlen, _("Route already added: %s.\n"),
+               entries[i].pattern);
+      errnum = EALREADY;
+      goto done;
+    }
+  }
+  for (i = 0; i < count; i++) {
+    route = sg__route_new2(entries[i].pattern, codes ? codes[i] : NULL, errmsg,
+                           errlen, &errnum, entries[i].cb, entries[i].cls);
+    if (codes)
+      codes[i] = NULL;
+    if (errnum != 0)
+      goto done;
+    route->methods = entries[i].methods;
+    if (last)
+      last->next = route;
+    else
+      list = route;
+    last = route;
+  }
+  LL_CONCAT(*routes, list);
+  (*routes)->gen++;
+  list = NULL;
+done:
+  LL_FOREACH_SAFE(list, route, tmp) {
+    sg__route_free(route);
+  }
+  sg_free(set.keys);
+  return errnum;
+}
+
+int sg_routes_add_many(struct sg_route **routes,
+                       const struct sg_route_entry *entries, unsigned int count,
+                       char *errmsg, size_t errlen) {
+  return sg__routes_add_many(routes, entries, count, NULL, errmsg, errlen);
+}
+
+#define SG__ROUTES_MAGIC 0x53475254U /* "SGRT" */
+#define SG__ROUTES_VERSION 1
+
+/* File layout (native byte order): magic, version and count as `uint32_t`,
+   then methods and raw pattern length as `uint32_t` followed by the raw
+   pattern for each route, and lastly the `uint64_t` size of the codes
+   serialized by PCRE2 followed by them. */
+
+static bool sg__routes_write(FILE *file, const void *buf, size_t size) {
+  return fwrite(buf, 1, size, file) == size;
+}
+
+static bool sg__routes_read(const uint8_t **cur, const uint8_t *end, void *buf,
+                            size_t size) {
+  if ((size_t) (end - *cur) < size)
+    return false;
+  memcpy(buf, *cur, size);
+  *cur += size;
+  return true;
+}
+
+int sg_routes_save(struct sg_route *routes, const char *path) {
+  const pcre2_code **codes;
+  struct sg_route *route;
+  FILE *file;
+  uint8_t *bytes;
+  PCRE2_SIZE size;
+  uint64_t size64;
+  uint32_t hdr[3], rec[2];
+  unsigned int count, i = 0;
+  int ret;
+  if (!routes || !path)
+    return EINVAL;
+  count = sg_routes_count(routes);
+  codes = sg_malloc(count * sizeof(pcre2_code *));
+  if (!codes)
+    return ENOMEM;
+  LL_FOREACH(routes, route) {
+    codes[i++] = route->re;
+  }
+  ret = pcre2_serialize_encode(codes, (int32_t) count, &bytes, &size, NULL);
+  sg_free(codes);
+  if (ret < 0)
+    return (ret == PCRE2_ERROR_NOMEMORY) ? ENOMEM : EINVAL;
+  file = fopen(path, "wb");
+  if (!file) {
+    ret = errno;
+    goto done;
+  }
+  ret = 0;
+  hdr[0] = SG__ROUTES_MAGIC;
+  hdr[1] = SG__ROUTES_VERSION;
+  hdr[2] = count;
+  if (!sg__routes_write(file, hdr, sizeof(hdr)))
+    ret = EIO;
+  LL_FOREACH(routes, route) {
+    if (ret != 0)
+      break;
+    rec[0] = route->methods;
+    rec[1] = (uint32_t) strlen(route->pattern);
+    if (!sg__routes_write(file, rec, sizeof(rec)) ||
+        !sg__routes_write(file, route->pattern, rec[1]))
+      ret = EIO;
+  }
+  size64 = size;
+  if ((ret == 0) && (!sg__routes_write(file, &size64, sizeof(size64)) ||
+                     !sg__routes_write(file, bytes, size)))
+    ret = EIO;
+  if ((fclose(file) != 0) && (ret == 0))
+    ret = errno;
+  if (ret != 0)
+    remove(path);
+done:
+  pcre2_serialize_free(bytes);
+  return ret;
+}
+
+/* Reads the whole file into a new buffer. */
+static int sg__routes_readfile(const char *path, uint8_t **buf, size_t *size) {
+  FILE *file;
+  long len;
+  int ret = 0;
+  file = fopen(path, "rb");
+  if (!file)
+    return errno;
+  if ((fseek(file, 0, SEEK_END) != 0) || ((len = ftell(file)) < 0) ||
+      (fseek(file, 0, SEEK_SET) != 0)) {
+    ret = EIO;
+    goto done;
+  }
+  *size = (size_t) len;
+  *buf = sg_malloc(*size + 1);
+  if (!*buf) {
+    ret = ENOMEM;
+    goto done;
+  }
+  if (fread(*buf, 1, *size, file) != *size) {
+    sg_free(*buf);
+    ret = EIO;
+  }
+done:
+  fclose(file);
+  return ret;
+}
+
+int sg_routes_load(struct sg_route **routes, const char *path,
+                   const struct sg_route_entry *entries, unsigned int count,
+                   char *errmsg, size_t errlen) {
+  PCRE2_UCHAR err[SG_ERR_SIZE >> 1];
+  pcre2_code **codes = NULL;
+  const uint8_t *cur, *end;
+  uint8_t *buf = NULL;
+  const char *pattern;
+  uint64_t size64;
+  size_t size = 0, len;
+  uint32_t hdr[3], rec[2];
+  unsigned int i;
+  int ret;
+  if (!routes || !path || !entries || (count == 0) || !errmsg || (errlen < 1))
+    return EINVAL;
+  ret = sg__routes_readfile(path, &buf, &size);
+  if (ret != 0)
+    return ret;
+  cur = buf;
+  end = buf + size;
+  if (!sg__routes_read(&cur, end, hdr, sizeof(hdr)) ||
+      (hdr[0] != SG__ROUTES_MAGIC) || (hdr[1] != SG__ROUTES_VERSION) ||
+      (hdr[2] != count))
+    goto mismatch;
+  for (i = 0; i < count; i++) {
+    if (!sg__routes_read(&cur, end, rec, sizeof(rec)) ||
+        (rec[0] != entries[i].methods) || (rec[1] < 1) ||
+        ((size_t) (end - cur) < rec[1]))
+      goto mismatch;
+    pattern = (const char *) cur;
+    len = rec[1];
+    if (*pattern != '(') {
+      if ((len < 2) || (*pattern != '^') || (pattern[len - 1] != '$'))
+        goto mismatch;
+      pattern++;
+      len -= 2;
+    }
+    if ((strlen(entries[i].pattern) != len) ||
+        (memcmp(entries[i].pattern, pattern, len) != 0))
+      goto mismatch;
+    cur += rec[1];
+  }
+  /* PCRE2 reads its magic, version, config and count as `uint32_t` */
+  if (!sg__routes_read(&cur, end, &size64, sizeof(size64)) ||
+      ((uint64_t) (end - cur) != size64) ||
+      (size64 < (sizeof(uint32_t) << 2)))
+    goto mismatch;
+  /* the block follows patterns of any length, so it is moved to the start of
+     the buffer, aligned by the allocator, before PCRE2 casts it */
+  memmove(buf, cur, (size_t) size64);
+  cur = buf;
+  ret = pcre2_serialize_get_number_of_codes(cur);
+  if ((ret >= 0) && ((unsigned int) ret != count))
+    goto mismatch;
+  if (ret >= 0) {
+    codes = sg_alloc(count * sizeof(pcre2_code *));
+    if (!codes) {
+      ret = ENOMEM;
+      goto done;
+    }
+    ret = pcre2_serialize_decode(codes, (int32_t) count, cur, NULL);
+  }
+  if (ret < 0) {
+    pcre2_get_error_message(ret, err, sizeof(err));
+    snprintf(errmsg, errlen, _("Routes decoding failed: %s.\n"), err);
+    ret = (ret == PCRE2_ERROR_NOMEMORY) ? ENOMEM : EINVAL;
+    goto done;
+  }
+  ret = sg__routes_add_many(routes, entries, count, codes, errmsg, errlen);
+  goto done;
+mismatch:
+  strncpy(errmsg, _("Routes file does not match the route entries.\n"),
+          errlen);
+  ret = EINVAL;
+done:
+  if (codes) {
+    for (i = 0; i < count; i++)
+      pcre2_code_free(codes[i]);
+    sg_free(codes);
+  }
+  sg_free(buf);
+  return ret;
+}
+
 int sg_routes_rm(struct sg_route **routes, const char *pattern) {
   struct sg_route *route, *tmp;
+  unsigned int gen;
   if (!routes || !pattern)
     return EINVAL;
   LL_FOREACH_SAFE(*routes, route, tmp) {
     if (strncmp(pattern, route->pattern + 1, strlen(pattern)) != 0)
       continue;
+    gen = (*routes)->gen;
     LL_DELETE(*routes, route);
     sg__route_free(route);
+    /* the head may change, so carry on its counter */
+    if (*routes)
+      (*routes)->gen = gen + 1;
     return 0;
   }
   return ENOENT;
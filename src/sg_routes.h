@@ -27,10 +27,15 @@
 #ifndef SG_ROUTES_H
 #define SG_ROUTES_H
 
+#include <stdint.h>
 #include "sg_macros.h"
 #include "pcre2.h"
+#include "sg_rstats.h"
 #include "sagui.h"
 
+/* The match state (`match`, `ovector`, `path`, `user_data` and `rc`) is only
+   set in the per-dispatch copy of the route passed to the callbacks, so
+   routes can be shared by concurrent dispatches. */
 struct sg_route {
   struct sg_route *next;
   pcre2_code *re;
@@ -40,6 +45,12 @@ struct sg_route {
   void *cls, *user_data;
   const char *path;
   char *pattern;
+  uint32_t ovec_count;
+  unsigned int methods;
+  /* allocated once a router enables the route stats */
+  struct sg__rstats *stats;
+  /* bumped in the list head on changes, so routers can see stale indexes */
+  unsigned int gen;
   int rc;
 };
 
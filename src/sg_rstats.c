@@ -0,0 +1,102 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "sg_utils.h"
+#include "sg_rstats.h"
+#include "sagui.h"
+
+struct sg__rstats *sg__rstats_new(void) {
+  struct sg__rstats *stats;
+  unsigned int i;
+  int errnum;
+  stats = sg_alloc(sizeof(struct sg__rstats));
+  if (!stats)
+    return NULL;
+  for (i = 0; i < SG__RSTATS_SHARDS; i++) {
+    errnum = pthread_mutex_init(&stats->shards[i].mutex, NULL);
+    if (errnum != 0) {
+      while (i-- > 0)
+        pthread_mutex_destroy(&stats->shards[i].mutex);
+      sg_free(stats);
+      errno = errnum;
+      return NULL;
+    }
+  }
+  return stats;
+}
+
+void sg__rstats_free(struct sg__rstats *stats) {
+  unsigned int i;
+  if (!stats)
+    return;
+  for (i = 0; i < SG__RSTATS_SHARDS; i++)
+    pthread_mutex_destroy(&stats->shards[i].mutex);
+  sg_free(stats);
+}
+
+/* Bucket `i` holds times in [2^i, 2^(i+1)) ns, the first and last buckets
+   also hold the smaller and larger ones. */
+static unsigned int sg__rstats_bucket(uint64_t time) {
+  unsigned int bucket = 0;
+  while ((time >>= 1) > 0)
+    bucket++;
+  return (bucket < SG_ROUTE_STATS_BUCKETS) ? bucket
+                                           : SG_ROUTE_STATS_BUCKETS - 1;
+}
+
+void sg__rstats_add(struct sg__rstats *stats, unsigned int shard,
+                    unsigned int misses, uint64_t time) {
+  struct sg__rstats_shard *s = &stats->shards[shard % SG__RSTATS_SHARDS];
+  if (pthread_mutex_lock(&s->mutex) != 0)
+    return;
+  s->hits++;
+  s->misses += misses;
+  s->time += time;
+  s->buckets[sg__rstats_bucket(time)]++;
+  pthread_mutex_unlock(&s->mutex);
+}
+
+void sg__rstats_sum(struct sg__rstats *stats, struct sg_route_stats *sum) {
+  struct sg__rstats_shard *s;
+  unsigned int i, j;
+  memset(sum, 0, sizeof(struct sg_route_stats));
+  for (i = 0; i < SG__RSTATS_SHARDS; i++) {
+    s = &stats->shards[i];
+    if (pthread_mutex_lock(&s->mutex) != 0)
+      continue;
+    sum->hits += s->hits;
+    sum->misses += s->misses;
+    sum->time += s->time;
+    for (j = 0; j < SG_ROUTE_STATS_BUCKETS; j++)
+      sum->buckets[j] += s->buckets[j];
+    pthread_mutex_unlock(&s->mutex);
+  }
+}
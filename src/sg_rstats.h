@@ -0,0 +1,63 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_RSTATS_H
+#define SG_RSTATS_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "sg_macros.h"
+#include "sagui.h"
+
+#define SG__RSTATS_SHARDS 8
+
+struct sg__rstats_shard {
+  pthread_mutex_t mutex;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t time;
+  uint64_t buckets[SG_ROUTE_STATS_BUCKETS];
+};
+
+/* Counters of a route, split in shards picked by the dispatching thread so
+   concurrent dispatches rarely share a lock. */
+struct sg__rstats {
+  struct sg__rstats_shard shards[SG__RSTATS_SHARDS];
+};
+
+SG__EXTERN struct sg__rstats *sg__rstats_new(void);
+
+SG__EXTERN void sg__rstats_free(struct sg__rstats *stats);
+
+/* Records a handler call taking `time` nanoseconds after `misses` failed
+   matches of other routes. */
+SG__EXTERN void sg__rstats_add(struct sg__rstats *stats, unsigned int shard,
+                               unsigned int misses, uint64_t time);
+
+SG__EXTERN void sg__rstats_sum(struct sg__rstats *stats,
+                               struct sg_route_stats *sum);
+
+#endif /* SG_RSTATS_H */
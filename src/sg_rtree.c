@@ -0,0 +1,316 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include "sg_macros.h"
+#include "sagui.h"
+#include "sg_routes.h"
+#include "sg_rtree.h"
+
+#define SG__RTREE_LOWER(c) (((c) >= 'A' && (c) <= 'Z') ? ((c) | 0x20) : (c))
+
+enum sg__rtree_type { SG__RTREE_LITERAL, SG__RTREE_PARAM, SG__RTREE_REST };
+
+struct sg__rtree_token {
+  enum sg__rtree_type type;
+  size_t off;
+  size_t len;
+};
+
+static struct sg__rtree *sg__rtree_node_new(const char *label, size_t len) {
+  struct sg__rtree *node = sg_alloc(sizeof(struct sg__rtree));
+  if (!node)
+    return NULL;
+  if (len > 0) {
+    node->label = sg_malloc(len);
+    if (!node->label) {
+      sg_free(node);
+      return NULL;
+    }
+    memcpy(node->label, label, len);
+  }
+  node->len = len;
+  node->order = node->rest_order = node->min_order = UINT_MAX;
+  return node;
+}
+
+struct sg__rtree *sg__rtree_new(void) {
+  return sg__rtree_node_new(NULL, 0);
+}
+
+void sg__rtree_free(struct sg__rtree *tree) {
+  struct sg__rtree *child, *tmp;
+  if (!tree)
+    return;
+  child = tree->children;
+  while (child) {
+    tmp = child->next;
+    sg__rtree_free(child);
+    child = tmp;
+  }
+  sg__rtree_free(tree->param);
+  sg_free(tree->label);
+  sg_free(tree);
+}
+
+/* Parses a capture group at `pat`, returning its length or 0. */
+static size_t sg__rtree_parse_group(const char *pat, size_t len,
+                                    enum sg__rtree_type *type) {
+  size_t i = 1, name;
+  if ((i < len) && (pat[i] == '?')) {
+    if ((++i < len) && (pat[i] == 'P'))
+      i++;
+    if ((i >= len) || (pat[i] != '<'))
+      return 0;
+    name = ++i;
+    while ((i < len) && (((pat[i] >= 'a') && (pat[i] <= 'z')) ||
+                         ((pat[i] >= 'A') && (pat[i] <= 'Z')) ||
+                         ((pat[i] >= '0') && (pat[i] <= '9')) ||
+                         (pat[i] == '_')))
+      i++;
+    if ((i == name) || (i >= len) || (pat[i] != '>'))
+      return 0;
+    i++;
+  }
+  if ((len - i >= 6) && (memcmp(pat + i, "[^/]+)", 6) == 0)) {
+    *type = SG__RTREE_PARAM;
+    return i + 6;
+  }
+  if ((len - i >= 3) && (memcmp(pat + i, ".*)", 3) == 0)) {
+    *type = SG__RTREE_REST;
+    return i + 3;
+  }
+  return 0;
+}
+
+/* Splits the route pattern into lower-cased literals (into `buf`) and
+   captures, failing on any other regex construct. */
+static int sg__rtree_parse(const struct sg_route *route, char *buf,
+                           struct sg__rtree_token *tokens,
+                           unsigned int *count) {
+  const char *pat = route->pattern + 1;
+  size_t len = strlen(route->pattern), i = 0, off = 0, size;
+  unsigned int caps = 0;
+  enum sg__rtree_type type;
+  char c;
+  if ((len < 2) || (route->pattern[0] != '^') ||
+      (route->pattern[len - 1] != '$'))
+    return ENOTSUP;
+  len -= 2;
+  *count = 0;
+  while (i < len) {
+    c = pat[i];
+    if (c == '(') {
+      size = sg__rtree_parse_group(pat + i, len - i, &type);
+      if ((size == 0) || (caps == SG__RTREE_MAX_CAPS))
+        return ENOTSUP;
+      i += size;
+      if ((type == SG__RTREE_PARAM) ? ((i < len) && (pat[i] != '/'))
+                                    : (i < len))
+        return ENOTSUP;
+      tokens[*count].type = type;
+      (*count)++;
+      caps++;
+      continue;
+    }
+    if (c == '\\') {
+      if (++i == len)
+        return ENOTSUP;
+      c = pat[i];
+      if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+          ((c >= '0') && (c <= '9')))
+        return ENOTSUP;
+    } else if (strchr("^$.|?*+)[]{}", c))
+      return ENOTSUP;
+    if ((*count == 0) || (tokens[*count - 1].type != SG__RTREE_LITERAL)) {
+      tokens[*count].type = SG__RTREE_LITERAL;
+      tokens[*count].off = off;
+      tokens[*count].len = 0;
+      (*count)++;
+    }
+    buf[off++] = (char) SG__RTREE_LOWER(c);
+    tokens[*count - 1].len++;
+    i++;
+  }
+  if (caps + 1 != route->ovec_count)
+    return ENOTSUP;
+  return 0;
+}
+
+static struct sg__rtree *sg__rtree_add_literal(struct sg__rtree *node,
+                                               const char *str, size_t len,
+                                               unsigned int order) {
+  struct sg__rtree **link, *child, *mid;
+  size_t i;
+  while (len > 0) {
+    link = &node->children;
+    while (*link && ((*link)->label[0] != *str))
+      link = &(*link)->next;
+    if (!*link) {
+      child = sg__rtree_node_new(str, len);
+      if (!child)
+        return NULL;
+      child->min_order = order;
+      *link = child;
+      return child;
+    }
+    child = *link;
+    for (i = 1; (i < len) && (i < child->len); i++)
+      if (child->label[i] != str[i])
+        break;
+    if (i < child->len) {
+      mid = sg__rtree_node_new(child->label, i);
+      if (!mid)
+        return NULL;
+      memmove(child->label, child->label + i, child->len - i);
+      child->len -= i;
+      mid->min_order = child->min_order;
+      mid->next = child->next;
+      mid->children = child;
+      child->next = NULL;
+      *link = child = mid;
+    }
+    if (order < child->min_order)
+      child->min_order = order;
+    node = child;
+    str += i;
+    len -= i;
+  }
+  return node;
+}
+
+int sg__rtree_add(struct sg__rtree *tree, struct sg_route *route,
+                  unsigned int order) {
+  struct sg__rtree_token tokens[(SG__RTREE_MAX_CAPS << 1) + 1];
+  struct sg__rtree *node = tree;
+  char *buf;
+  unsigned int count, i;
+  int errnum;
+  buf = sg_malloc(strlen(route->pattern) + 1);
+  if (!buf)
+    return ENOMEM;
+  errnum = sg__rtree_parse(route, buf, tokens, &count);
+  if (errnum != 0)
+    goto done;
+  if (order < node->min_order)
+    node->min_order = order;
+  for (i = 0; i < count; i++) {
+    if (tokens[i].type == SG__RTREE_LITERAL) {
+      node = sg__rtree_add_literal(node, buf + tokens[i].off, tokens[i].len,
+                                   order);
+      if (!node) {
+        errnum = ENOMEM;
+        goto done;
+      }
+    } else if (tokens[i].type == SG__RTREE_PARAM) {
+      if (!node->param) {
+        node->param = sg__rtree_node_new(NULL, 0);
+        if (!node->param) {
+          errnum = ENOMEM;
+          goto done;
+        }
+      }
+      node = node->param;
+      if (order < node->min_order)
+        node->min_order = order;
+    } else {
+      if (order < node->rest_order) {
+        node->rest = route;
+        node->rest_order = order;
+      }
+      goto done;
+    }
+  }
+  if (order < node->order) {
+    node->route = route;
+    node->order = order;
+  }
+done:
+  sg_free(buf);
+  return errnum;
+}
+
+static void sg__rtree_search(const struct sg__rtree *node, const char *path,
+                             size_t pos, size_t len, size_t *caps,
+                             unsigned int caps_count,
+                             struct sg__rtree_match *match) {
+  const struct sg__rtree *child;
+  size_t i, end;
+  if (node->min_order >= match->order)
+    return;
+  if ((pos == len) && (node->order < match->order)) {
+    match->route = node->route;
+    match->order = node->order;
+    match->caps_count = caps_count;
+    memcpy(match->caps, caps, (caps_count << 1) * sizeof(size_t));
+  }
+  if (node->rest_order < match->order) {
+    match->route = node->rest;
+    match->order = node->rest_order;
+    match->caps_count = caps_count + 1;
+    memcpy(match->caps, caps, (caps_count << 1) * sizeof(size_t));
+    match->caps[caps_count << 1] = pos;
+    match->caps[(caps_count << 1) + 1] = len;
+  }
+  if (pos == len)
+    return;
+  for (child = node->children; child; child = child->next) {
+    if (child->label[0] != SG__RTREE_LOWER(path[pos]))
+      continue;
+    if (child->len > len - pos)
+      break;
+    for (i = 1; i < child->len; i++)
+      if (child->label[i] != SG__RTREE_LOWER(path[pos + i]))
+        break;
+    if (i == child->len)
+      sg__rtree_search(child, path, pos + i, len, caps, caps_count, match);
+    break;
+  }
+  if (node->param && (caps_count < SG__RTREE_MAX_CAPS)) {
+    end = pos;
+    while ((end < len) && (path[end] != '/'))
+      end++;
+    if (end > pos) {
+      caps[caps_count << 1] = pos;
+      caps[(caps_count << 1) + 1] = end;
+      sg__rtree_search(node->param, path, end, len, caps, caps_count + 1,
+                       match);
+    }
+  }
+}
+
+bool sg__rtree_find(struct sg__rtree *tree, const char *path, size_t len,
+                    struct sg__rtree_match *match) {
+  size_t caps[SG__RTREE_MAX_CAPS << 1];
+  match->route = NULL;
+  match->order = UINT_MAX;
+  match->caps_count = 0;
+  sg__rtree_search(tree, path, 0, len, caps, 0, match);
+  return match->route != NULL;
+}
@@ -0,0 +1,75 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SG_RTREE_H
+#define SG_RTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "sg_macros.h"
+#include "sagui.h"
+
+#ifndef SG__RTREE_MAX_CAPS
+#define SG__RTREE_MAX_CAPS 16
+#endif /* SG__RTREE_MAX_CAPS */
+
+/* Compressed radix tree node. The edge label leading to the node is stored
+   lower-cased, since routes are matched ignoring case. */
+struct sg__rtree {
+  struct sg__rtree *next;
+  struct sg__rtree *children;
+  struct sg__rtree *param;
+  struct sg_route *route;
+  struct sg_route *rest;
+  char *label;
+  size_t len;
+  unsigned int order;
+  unsigned int rest_order;
+  unsigned int min_order;
+};
+
+struct sg__rtree_match {
+  struct sg_route *route;
+  unsigned int order;
+  unsigned int caps_count;
+  size_t caps[SG__RTREE_MAX_CAPS << 1];
+};
+
+SG__EXTERN struct sg__rtree *sg__rtree_new(void);
+
+SG__EXTERN void sg__rtree_free(struct sg__rtree *tree);
+
+/* Adds a route whose pattern is made of literals, `([^/]+)` segments and an
+   optional trailing `(.*)`, named or not. Returns ENOTSUP for any other
+   pattern, which must be matched by PCRE2. */
+SG__EXTERN int sg__rtree_add(struct sg__rtree *tree, struct sg_route *route,
+                             unsigned int order);
+
+/* Finds the route with the lowest order matching the whole path. */
+SG__EXTERN bool sg__rtree_find(struct sg__rtree *tree, const char *path,
+                               size_t len, struct sg__rtree_match *match);
+
+#endif /* SG_RTREE_H */
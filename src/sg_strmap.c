@@ -28,37 +28,66 @@
 #include "sg_macros.h"
 #include "sagui.h"
 #include "sg_utils.h"
+/* case-insensitive keys, so lookups need no lower-cased copy of the name;
+   defined before uthash.h to apply to the string map only */
+#define HASH_FUNCTION(keyptr, keylen, hashv)                                   \
+  ((hashv) = sg__strcasehash((keyptr), (keylen)))
+#define HASH_KEYCMP(a, b, n) sg__strncasecmp((a), (b), (n))
 #include "sg_strmap.h"
 
+/* Allocates the pair with its name and value inline after the node. */
 struct sg_strmap *sg__strmap_new(const char *name, const char *val) {
-  struct sg_strmap *pair = sg_alloc(sizeof(struct sg_strmap));
+  struct sg_strmap *pair;
+  size_t name_len = strlen(name) + 1, val_len = strlen(val) + 1;
+  pair = sg_malloc(sizeof(struct sg_strmap) + name_len + val_len);
   if (!pair)
     return NULL;
-  pair->key = strdup(name);
-  if (!pair->key)
-    goto error;
-  pair->name = strdup(name);
-  if (!pair->name)
-    goto error;
-  pair->val = strdup(val);
-  if (!pair->val)
-    goto error;
-  sg__toasciilower(pair->key);
+  memset(pair, 0, sizeof(struct sg_strmap));
+  pair->name = memcpy(pair + 1, name, name_len);
+  pair->val = memcpy(pair->name + name_len, val, val_len);
   return pair;
-error:
-  sg__strmap_free(pair);
-  return NULL;
 }
 
 void sg__strmap_free(struct sg_strmap *pair) {
-  if (!pair)
+  if (!pair || pair->borrowed)
     return;
-  sg_free(pair->key);
-  sg_free(pair->name);
-  sg_free(pair->val);
   sg_free(pair);
 }
 
+void sg__strmap_add(struct sg_strmap **map, struct sg_strmap *pair) {
+  HASH_ADD_STR(*map, name, pair);
+}
+
+void sg__strmap_borrow(struct sg_strmap **map, struct sg_strmap *pair,
+                       const char *name, const char *val) {
+  pair->name = (char *) name;
+  pair->val = (char *) val;
+  pair->borrowed = true;
+  HASH_ADD_STR(*map, name, pair);
+}
+
+int sg__strmap_cat(struct sg_strmap **map, struct sg_strmap **pair,
+                   const char *val, size_t len) {
+  struct sg_strmap *tmp;
+  size_t name_len, val_len;
+  name_len = strlen((*pair)->name) + 1;
+  val_len = strlen((*pair)->val);
+  HASH_DELETE(hh, *map, *pair);
+  tmp = sg_realloc(*pair, sizeof(struct sg_strmap) + name_len + val_len +
+                            len + 1);
+  if (!tmp) {
+    HASH_ADD_STR(*map, name, *pair);
+    return ENOMEM;
+  }
+  tmp->name = (char *) (tmp + 1);
+  tmp->val = tmp->name + name_len;
+  memcpy(tmp->val + val_len, val, len);
+  tmp->val[val_len + len] = '\0';
+  HASH_ADD_STR(*map, name, tmp);
+  *pair = tmp;
+  return 0;
+}
+
 const char *sg_strmap_name(struct sg_strmap *pair) {
   if (!pair) {
     errno = EINVAL;
@@ -82,7 +111,7 @@ int sg_strmap_add(struct sg_strmap **map, const char *name, const char *val) {
   pair = sg__strmap_new(name, val);
   if (!pair)
     return ENOMEM;
-  HASH_ADD_STR(*map, key, pair);
+  HASH_ADD_STR(*map, name, pair);
   return 0;
 }
 
@@ -93,51 +122,34 @@ int sg_strmap_set(struct sg_strmap **map, const char *name, const char *val) {
   pair = sg__strmap_new(name, val);
   if (!pair)
     return ENOMEM;
-  HASH_REPLACE_STR(*map, key, pair, tmp);
+  HASH_REPLACE_STR(*map, name, pair, tmp);
   sg__strmap_free(tmp);
   return 0;
 }
 
 int sg_strmap_find(struct sg_strmap *map, const char *name,
                    struct sg_strmap **pair) {
-  char *key;
   if (!map || !pair || !name)
     return EINVAL;
-  key = strdup(name);
-  if (!key)
-    return ENOMEM;
-  sg__toasciilower(key);
-  HASH_FIND_STR(map, key, *pair);
-  if (!*pair) {
-    sg_free(key);
-    return ENOENT;
-  }
-  sg_free(key);
-  return 0;
+  HASH_FIND_STR(map, name, *pair);
+  return *pair ? 0 : ENOENT;
 }
 
 const char *sg_strmap_get(struct sg_strmap *map, const char *name) {
   struct sg_strmap *pair;
   if (!map || !name)
     return NULL;
-  return sg_strmap_find(map, name, &pair) == 0 ? pair->val : NULL;
+  HASH_FIND_STR(map, name, pair);
+  return pair ? pair->val : NULL;
 }
 
 int sg_strmap_rm(struct sg_strmap **map, const char *name) {
   struct sg_strmap *pair;
-  char *key;
   if (!map || !name)
     return EINVAL;
-  key = strdup(name);
-  if (!key)
-    return ENOMEM;
-  sg__toasciilower(key);
-  HASH_FIND_STR(*map, key, pair);
-  if (!pair) {
-    sg_free(key);
+  HASH_FIND_STR(*map, name, pair);
+  if (!pair)
     return ENOENT;
-  }
-  sg_free(key);
   HASH_DELETE_HH(hh, *map, &pair->hh);
   sg__strmap_free(pair);
   return 0;
@@ -27,16 +27,34 @@
 #ifndef SG_STRMAP_H
 #define SG_STRMAP_H
 
+#include <stdbool.h>
 #include "sg_macros.h"
+#include "sg_utils.h"
 #include "uthash.h"
 
+/* Keys are hashed and compared ignoring case (see HASH_FUNCTION in
+   sg_strmap.c). */
 struct sg_strmap {
-  char *key, *name, *val;
+  char *name, *val;
   UT_hash_handle hh;
+  /* strings and node are owned by someone else, e.g. a request buffer */
+  bool borrowed;
 };
 
 SG__EXTERN struct sg_strmap *sg__strmap_new(const char *name, const char *val);
 
 SG__EXTERN void sg__strmap_free(struct sg_strmap *pair);
 
+SG__EXTERN void sg__strmap_add(struct sg_strmap **map, struct sg_strmap *pair);
+
+/* Adds a borrowed pair pointing to `name` and `val`. */
+SG__EXTERN void sg__strmap_borrow(struct sg_strmap **map,
+                                  struct sg_strmap *pair, const char *name,
+                                  const char *val);
+
+/* Appends `len` bytes of `val` to the pair value, re-adding the possibly moved
+   pair to the map. */
+SG__EXTERN int sg__strmap_cat(struct sg_strmap **map, struct sg_strmap **pair,
+                              const char *val, size_t len);
+
 #endif /* SG_STRMAP_H */
@@ -45,6 +45,8 @@
 #define SG__VERSION_STR                                                        \
   xstr(SG_VERSION_MAJOR) "." xstr(SG_VERSION_MINOR) "." xstr(SG_VERSION_PATCH)
 
+#define SG__ASCIILOWER(c) (((c) >= 'A' && (c) <= 'Z') ? (c) | 0x20 : (c))
+
 /* Platform. */
 
 #ifdef _WIN32
@@ -155,6 +157,135 @@ void sg__toasciilower(char *str) {
   }
 }
 
+int sg__strncasecmp(const char *s1, const char *s2, size_t len) {
+  int c1, c2;
+  while (len-- > 0) {
+    c1 = (unsigned char) *s1++;
+    c2 = (unsigned char) *s2++;
+    c1 = SG__ASCIILOWER(c1);
+    c2 = SG__ASCIILOWER(c2);
+    if ((c1 != c2) || (c1 == '\0'))
+      return c1 - c2;
+  }
+  return 0;
+}
+
+unsigned int sg__strcasehash(const void *key, size_t len) {
+  const unsigned char *p = key;
+  unsigned int hash = 2166136261U, c;
+  while (len-- > 0) {
+    c = *p++;
+    hash ^= SG__ASCIILOWER(c);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+#define SG__XXH64_P1 UINT64_C(0x9E3779B185EBCA87)
+#define SG__XXH64_P2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define SG__XXH64_P3 UINT64_C(0x165667B19E3779F9)
+#define SG__XXH64_P4 UINT64_C(0x85EBCA77C2B2AE63)
+#define SG__XXH64_P5 UINT64_C(0x27D4EB2F165667C5)
+#define SG__XXH64_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t sg__xxh64_read(const unsigned char *p, unsigned int len) {
+  uint64_t val = 0;
+  while (len-- > 0)
+    val = (val << 8) | p[len];
+  return val;
+}
+
+static uint64_t sg__xxh64_round(uint64_t acc, uint64_t val) {
+  acc += val * SG__XXH64_P2;
+  acc = SG__XXH64_ROTL(acc, 31);
+  return acc * SG__XXH64_P1;
+}
+
+static uint64_t sg__xxh64_merge(uint64_t acc, uint64_t val) {
+  acc ^= sg__xxh64_round(0, val);
+  return acc * SG__XXH64_P1 + SG__XXH64_P4;
+}
+
+uint64_t sg__xxh64(const void *buf, size_t len) {
+  const unsigned char *p = buf, *end = p + len;
+  uint64_t v1, v2, v3, v4, hash;
+  if (len >= 32) {
+    v1 = SG__XXH64_P1 + SG__XXH64_P2;
+    v2 = SG__XXH64_P2;
+    v3 = 0;
+    v4 = -SG__XXH64_P1;
+    do {
+      v1 = sg__xxh64_round(v1, sg__xxh64_read(p, 8));
+      v2 = sg__xxh64_round(v2, sg__xxh64_read(p + 8, 8));
+      v3 = sg__xxh64_round(v3, sg__xxh64_read(p + 16, 8));
+      v4 = sg__xxh64_round(v4, sg__xxh64_read(p + 24, 8));
+      p += 32;
+    } while (end - p >= 32);
+    hash = SG__XXH64_ROTL(v1, 1) + SG__XXH64_ROTL(v2, 7) +
+           SG__XXH64_ROTL(v3, 12) + SG__XXH64_ROTL(v4, 18);
+    hash = sg__xxh64_merge(hash, v1);
+    hash = sg__xxh64_merge(hash, v2);
+    hash = sg__xxh64_merge(hash, v3);
+    hash = sg__xxh64_merge(hash, v4);
+  } else
+    hash = SG__XXH64_P5;
+  hash += (uint64_t) len;
+  for (; end - p >= 8; p += 8) {
+    hash ^= sg__xxh64_round(0, sg__xxh64_read(p, 8));
+    hash = SG__XXH64_ROTL(hash, 27) * SG__XXH64_P1 + SG__XXH64_P4;
+  }
+  if (end - p >= 4) {
+    hash ^= sg__xxh64_read(p, 4) * SG__XXH64_P1;
+    hash = SG__XXH64_ROTL(hash, 23) * SG__XXH64_P2 + SG__XXH64_P3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * SG__XXH64_P5;
+    hash = SG__XXH64_ROTL(hash, 11) * SG__XXH64_P1;
+  }
+  hash ^= hash >> 33;
+  hash *= SG__XXH64_P2;
+  hash ^= hash >> 29;
+  hash *= SG__XXH64_P3;
+  return hash ^ (hash >> 32);
+}
+
+#undef SG__XXH64_ROTL /* SG__XXH64_ROTL */
+#undef SG__XXH64_P5 /* SG__XXH64_P5 */
+#undef SG__XXH64_P4 /* SG__XXH64_P4 */
+#undef SG__XXH64_P3 /* SG__XXH64_P3 */
+#undef SG__XXH64_P2 /* SG__XXH64_P2 */
+#undef SG__XXH64_P1 /* SG__XXH64_P1 */
+
+static const char *sg__methods[SG__METHOD_COUNT] = {
+  "GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE",
+  "PATCH"};
+
+unsigned int sg__method_mask(const char *method) {
+  unsigned int i;
+  for (i = 0; i < SG__METHOD_COUNT; i++)
+    if (strcmp(method, sg__methods[i]) == 0)
+      return 1U << i;
+  return 0;
+}
+
+size_t sg__methods_str(unsigned int methods, char *buf, size_t size) {
+  size_t len = 0;
+  unsigned int i;
+  int ret;
+  if (size > 0)
+    *buf = '\0';
+  for (i = 0; i < SG__METHOD_COUNT; i++) {
+    if (!(methods & (1U << i)))
+      continue;
+    ret = snprintf((len < size) ? buf + len : NULL,
+                   (len < size) ? size - len : 0, "%s%s",
+                   (len > 0) ? ", " : "", sg__methods[i]);
+    len += (size_t) ret;
+  }
+  return len;
+}
+
 char *sg__strjoin(char sep, const char *a, const char *b) {
   char *str;
   size_t len;
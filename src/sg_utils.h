@@ -85,8 +85,26 @@ SG__EXTERN double sg__fmod(double x, double y);
 /* Converts US-ASCII string to lower case. */
 SG__EXTERN void sg__toasciilower(char *str);
 
+/* Compares at most `len` chars of two US-ASCII strings ignoring case. */
+SG__EXTERN int sg__strncasecmp(const char *s1, const char *s2, size_t len);
+
+/* FNV-1a hash of `len` bytes of a US-ASCII string ignoring case. */
+SG__EXTERN unsigned int sg__strcasehash(const void *key, size_t len);
+
+/* XXH64 hash of `len` bytes, seed 0. */
+SG__EXTERN uint64_t sg__xxh64(const void *buf, size_t len);
+
 SG__EXTERN char *sg__strjoin(char sep, const char *a, const char *b);
 
+#define SG__METHOD_COUNT 9
+
+/* Returns the #sg_method flag of the method name, or 0 if it is unknown. */
+SG__EXTERN unsigned int sg__method_mask(const char *method);
+
+/* Writes the method names of the mask separated by ", ", as in `Allow`. */
+SG__EXTERN size_t sg__methods_str(unsigned int methods, char *buf,
+                                  size_t size);
+
 SG__EXTERN bool sg__is_cookie_name(const char *name);
 
 SG__EXTERN bool sg__is_cookie_val(const char *val);
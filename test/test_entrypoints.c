@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include "sg_macros.h"
 #include "sg_entrypoint.h"
 #include "sg_entrypoints.c"
@@ -134,23 +135,21 @@ static void test__entrypoints_rm(struct sg_entrypoints *entrypoints) {
 static void test__entrypoints_find(struct sg_entrypoints *entrypoints) {
   struct sg_entrypoint entrypoint, *item;
   sg_entrypoints_clear(entrypoints);
-  entrypoint.name = strdup("foo");
-  ASSERT(sg__entrypoints_find(entrypoints, &entrypoint, &item) == ENOENT);
-  sg_free(entrypoint.name);
-  entrypoint.name = strdup("bar");
-  ASSERT(sg__entrypoints_find(entrypoints, &entrypoint, &item) == ENOENT);
-  sg_free(entrypoint.name);
+  ASSERT(sg__entrypoints_find(entrypoints, "foo", 3, &item) == ENOENT);
+  ASSERT(!item);
+  ASSERT(sg__entrypoints_find(entrypoints, "bar", 3, &item) == ENOENT);
 
-  entrypoint.name = strdup("foo");
+  entrypoint.name = strdup("/foo");
   ASSERT(sg__entrypoints_add(entrypoints, &entrypoint, NULL) == 0);
-  entrypoint.name = strdup("bar");
+  entrypoint.name = strdup("/bar");
   ASSERT(sg__entrypoints_add(entrypoints, &entrypoint, NULL) == 0);
-  entrypoint.name = strdup("foo");
-  ASSERT(sg__entrypoints_find(entrypoints, &entrypoint, &item) == 0);
-  sg_free(entrypoint.name);
-  entrypoint.name = strdup("bar");
-  ASSERT(sg__entrypoints_find(entrypoints, &entrypoint, &item) == 0);
-  sg_free(entrypoint.name);
+  ASSERT(sg__entrypoints_find(entrypoints, "foo", 3, &item) == 0);
+  ASSERT(strcmp(item->name, "/foo") == 0);
+  ASSERT(sg__entrypoints_find(entrypoints, "bar/", 3, &item) == 0);
+  ASSERT(strcmp(item->name, "/bar") == 0);
+  ASSERT(sg__entrypoints_find(entrypoints, "fo", 2, &item) == ENOENT);
+  ASSERT(sg__entrypoints_find(entrypoints, "fooo", 4, &item) == ENOENT);
+  ASSERT(!item);
 }
 
 static void test_entrypoints_add(struct sg_entrypoints *entrypoints) {
@@ -175,6 +174,58 @@ static void test_entrypoints_add(struct sg_entrypoints *entrypoints) {
   ASSERT(sg_entrypoints_find(entrypoints, &item, "foobar") == 0);
 }
 
+static void test_entrypoints_add_many(struct sg_entrypoints *entrypoints) {
+  struct sg_entrypoint_entry entries[] = {
+    {"/foo/bar", "foo"}, {"baz", "baz"}, {"/abc", "abc"}};
+  struct sg_entrypoint_entry dup[] = {{"/x", NULL}, {"y", NULL}, {"/x/", NULL}};
+  struct sg_entrypoint_entry bad[] = {{"/x", NULL}, {NULL, NULL}};
+  struct sg_entrypoint_entry many[1000];
+  struct sg_entrypoint *item;
+  char names[1000][16];
+  unsigned int i;
+  sg_entrypoints_clear(entrypoints);
+  ASSERT(sg_entrypoints_add_many(NULL, entries, 3) == EINVAL);
+  ASSERT(sg_entrypoints_add_many(entrypoints, NULL, 3) == EINVAL);
+  ASSERT(sg_entrypoints_add_many(entrypoints, bad, 2) == EINVAL);
+  ASSERT(sg_entrypoints_add_many(entrypoints, entries, 0) == 0);
+  ASSERT(entrypoints->count == 0);
+
+  ASSERT(sg_entrypoints_add(entrypoints, "/def", "def") == 0);
+  ASSERT(sg_entrypoints_add_many(entrypoints, entries, 3) == 0);
+  ASSERT(entrypoints->count == 4);
+  ASSERT(entrypoints->size == 8);
+  ASSERT(strcmp(entrypoints->list[0].name, "/abc") == 0);
+  ASSERT(strcmp(entrypoints->list[1].name, "/baz") == 0);
+  ASSERT(strcmp(entrypoints->list[2].name, "/def") == 0);
+  ASSERT(strcmp(entrypoints->list[3].name, "/foo") == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/foo/x") == 0);
+  ASSERT(strcmp(item->user_data, "foo") == 0);
+
+  ASSERT(sg_entrypoints_add_many(entrypoints, dup, 3) == EALREADY);
+  ASSERT(sg_entrypoints_add_many(entrypoints, entries + 2, 1) == EALREADY);
+  ASSERT(entrypoints->count == 4);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/y") == ENOENT);
+
+  for (i = 0; i < 1000; i++) {
+    snprintf(names[i], sizeof(names[i]), "/t%u", 999 - i);
+    many[i].path = names[i];
+    many[i].user_data = names[i];
+  }
+  ASSERT(sg_entrypoints_add_many(entrypoints, many, 1000) == 0);
+  ASSERT(entrypoints->count == 1004);
+  ASSERT(entrypoints->size == 1024);
+  for (i = 1; i < entrypoints->count; i++)
+    ASSERT(strcmp(entrypoints->list[i - 1].name, entrypoints->list[i].name) <
+           0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/t500/x") == 0);
+  ASSERT(strcmp(item->user_data, "/t500") == 0);
+  ASSERT(sg_entrypoints_rm(entrypoints, "/t500") == 0);
+  ASSERT(entrypoints->size == 1024);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/t500") == ENOENT);
+  sg_entrypoints_clear(entrypoints);
+  ASSERT(entrypoints->size == 0);
+}
+
 static void test_entrypoints_rm(struct sg_entrypoints *entrypoints) {
   struct sg_entrypoint *item;
   ASSERT(sg_entrypoints_rm(NULL, "") == EINVAL);
@@ -262,6 +313,129 @@ static void test_entrypoints_find(struct sg_entrypoints *entrypoints) {
   ASSERT(!item);
 }
 
+static void test_entrypoints_freeze(struct sg_entrypoints *entrypoints) {
+  struct sg_entrypoint *item;
+  char name[32];
+  unsigned int i;
+  ASSERT(sg_entrypoints_freeze(NULL) == EINVAL);
+
+  ASSERT(sg_entrypoints_clear(entrypoints) == 0);
+  ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+  ASSERT(!entrypoints->slots);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "foo") == ENOENT);
+
+  for (i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "/tenant%u", i);
+    ASSERT(sg_entrypoints_add(entrypoints, name, NULL) == 0);
+  }
+  ASSERT(sg_entrypoints_add(entrypoints, "/", "root") == 0);
+  ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+  ASSERT(entrypoints->slots);
+  for (i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "//tenant%u/foo/bar", i);
+    ASSERT(sg_entrypoints_find(entrypoints, &item, name) == 0);
+    ASSERT(strncmp(item->name, name + 1, strlen(item->name)) == 0);
+  }
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant1000") == ENOENT);
+  ASSERT(!item);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant") == ENOENT);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/") == 0);
+  ASSERT(strcmp(item->user_data, "root") == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "") == 0);
+  ASSERT(strcmp(item->name, "/") == 0);
+
+  ASSERT(sg_entrypoints_rm(entrypoints, "/tenant1") == 0);
+  ASSERT(!entrypoints->slots);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant1") == ENOENT);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant2") == 0);
+  ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant1") == ENOENT);
+  ASSERT(sg_entrypoints_add(entrypoints, "/tenant1", NULL) == 0);
+  ASSERT(!entrypoints->slots);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant1") == 0);
+  ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+  ASSERT(sg_entrypoints_clear(entrypoints) == 0);
+  ASSERT(!entrypoints->slots);
+}
+
+static bool entrypoints_snapshots_done;
+
+static int
+  entrypoints_iter_count(void *cls,
+                         __SG_UNUSED struct sg_entrypoint *entrypoint) {
+  (*(unsigned int *) cls)++;
+  return 0;
+}
+
+static void *entrypoints_snapshots_find_cb(void *arg) {
+  struct sg_entrypoints *entrypoints = arg;
+  struct sg_entrypoint *item;
+  unsigned int count;
+  while (!__atomic_load_n(&entrypoints_snapshots_done, __ATOMIC_SEQ_CST)) {
+    ASSERT(sg_entrypoints_read_lock(entrypoints) == 0);
+    ASSERT(sg_entrypoints_find(entrypoints, &item, "/api/foo") == 0);
+    ASSERT(strcmp(item->name, "/api") == 0);
+    ASSERT(strcmp(item->user_data, "api") == 0);
+    if (sg_entrypoints_find(entrypoints, &item, "/tmp") == 0)
+      ASSERT(strcmp(item->name, "/tmp") == 0);
+    ASSERT(sg_entrypoints_read_unlock(entrypoints) == 0);
+    count = 0;
+    ASSERT(sg_entrypoints_iter(entrypoints, entrypoints_iter_count, &count) ==
+           0);
+    ASSERT(count > 0);
+  }
+  return NULL;
+}
+
+static void test_entrypoints_snapshots(struct sg_entrypoints *entrypoints) {
+  struct sg_entrypoint *item;
+  pthread_t threads[4];
+  char name[32];
+  unsigned int i;
+  ASSERT(sg_entrypoints_set_snapshots(NULL, true) == EINVAL);
+  ASSERT(sg_entrypoints_read_lock(NULL) == EINVAL);
+  ASSERT(sg_entrypoints_read_unlock(NULL) == EINVAL);
+
+  ASSERT(sg_entrypoints_clear(entrypoints) == 0);
+  ASSERT(sg_entrypoints_add(entrypoints, "/api", "api") == 0);
+  ASSERT(sg_entrypoints_set_snapshots(entrypoints, true) == 0);
+  ASSERT(sg_entrypoints_set_snapshots(entrypoints, true) == 0);
+  ASSERT(entrypoints->snap && (entrypoints->snap->count == 1));
+  ASSERT(entrypoints->snap->list[0].name != entrypoints->list[0].name);
+  for (i = 0; i < 4; i++)
+    ASSERT(pthread_create(&threads[i], NULL, entrypoints_snapshots_find_cb,
+                          entrypoints) == 0);
+  for (i = 0; i < 100; i++) {
+    snprintf(name, sizeof(name), "/tenant%u", i);
+    ASSERT(sg_entrypoints_add(entrypoints, name, NULL) == 0);
+    ASSERT(sg_entrypoints_add(entrypoints, "/tmp", NULL) == 0);
+    if (i % 10 == 0)
+      ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+    ASSERT(sg_entrypoints_rm(entrypoints, "/tmp") == 0);
+  }
+  ASSERT(sg_entrypoints_freeze(entrypoints) == 0);
+  ASSERT(entrypoints->snap->slots);
+  __atomic_store_n(&entrypoints_snapshots_done, true, __ATOMIC_SEQ_CST);
+  for (i = 0; i < 4; i++)
+    ASSERT(pthread_join(threads[i], NULL) == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant99") == 0);
+  ASSERT(item >= entrypoints->snap->list);
+  ASSERT(item < entrypoints->snap->list + entrypoints->snap->count);
+
+  ASSERT(sg_entrypoints_read_lock(entrypoints) == 0);
+  ASSERT(sg_entrypoints_add(entrypoints, "/tmp", NULL) == EDEADLK);
+  ASSERT(sg_entrypoints_read_unlock(entrypoints) == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tmp") == ENOENT);
+  ASSERT(sg_entrypoints_rm(entrypoints, "/tenant1") == 0);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tmp") == 0);
+
+  ASSERT(sg_entrypoints_set_snapshots(entrypoints, false) == 0);
+  ASSERT(!entrypoints->snap);
+  ASSERT(sg_entrypoints_find(entrypoints, &item, "/tenant99") == 0);
+  ASSERT(item >= entrypoints->list);
+  ASSERT(sg_entrypoints_set_snapshots(entrypoints, true) == 0);
+}
+
 int main(void) {
   struct sg_entrypoints *entrypoints = sg_entrypoints_new();
   ASSERT(entrypoints != NULL);
@@ -269,10 +443,13 @@ int main(void) {
   test__entrypoints_rm(entrypoints);
   test__entrypoints_find(entrypoints);
   test_entrypoints_add(entrypoints);
+  test_entrypoints_add_many(entrypoints);
   test_entrypoints_rm(entrypoints);
   test_entrypoints_iter(entrypoints);
   test_entrypoints_clear(entrypoints);
   test_entrypoints_find(entrypoints);
+  test_entrypoints_freeze(entrypoints);
+  test_entrypoints_snapshots(entrypoints);
   sg_entrypoints_free(entrypoints);
   return EXIT_SUCCESS;
 }
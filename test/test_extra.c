@@ -30,6 +30,12 @@
 #include <microhttpd.h>
 #ifdef SG_HTTP_COMPRESSION
 #include "zlib.h"
+#ifdef SG_HTTP_BROTLI
+#include <brotli/decode.h>
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+#include "zstd.h"
+#endif /* SG_HTTP_ZSTD */
 #endif /* SG_HTTP_COMPRESSION */
 #include "sg_macros.h"
 #include "sg_strmap.h"
@@ -46,6 +52,16 @@ static void test__convals_iter(void) {
   sg_strmap_cleanup(&map);
 }
 
+static void test__convals_view(void) {
+  struct sg_strmap *map = NULL;
+  struct MHD_Connection *con = sg_alloc(256);
+  ASSERT(!sg__convals_view(NULL, MHD_HEADER_KIND, &map));
+  ASSERT(!sg__convals_view(con, MHD_HEADER_KIND, NULL));
+  ASSERT(!sg__convals_view(con, MHD_HEADER_KIND, &map));
+  ASSERT(!map);
+  sg_free(con);
+}
+
 static void test__strmap_iter(void) {
   struct sg_strmap *header = sg_alloc(sizeof(struct sg_strmap));
   struct MHD_Response *res = sg_alloc(64);
@@ -113,6 +129,31 @@ static int sg__uncompress2(Bytef *dest, uLongf *destLen, const Bytef *source,
                                                                   err;
 }
 
+static void test__zpool(void) {
+  z_stream *streams[SG__ZPOOL_SIZE + 1], *stream, *other;
+  unsigned int i;
+  ASSERT(sg__zpool_get(-10, MAX_WBITS, &stream) == Z_STREAM_ERROR);
+  ASSERT(sg__zpool_get(1, MAX_WBITS, &stream) == Z_OK);
+  ASSERT(stream);
+  sg__zpool_put(stream);
+  ASSERT(sg__zpool_get(1, MAX_WBITS, &other) == Z_OK);
+  ASSERT(other == stream);
+  ASSERT(sg__zpool_get(1, MAX_WBITS + 16, &stream) == Z_OK);
+  ASSERT(stream != other);
+  sg__zpool_put(stream);
+  sg__zpool_put(other);
+  ASSERT(sg__zpool_get(Z_DEFAULT_COMPRESSION, MAX_WBITS, &stream) == Z_OK);
+  sg__zpool_put(stream);
+  ASSERT(sg__zpool_get(6, MAX_WBITS, &other) == Z_OK);
+  ASSERT(other == stream);
+  sg__zpool_put(other);
+  for (i = 0; i < SG__ZPOOL_SIZE + 1; i++)
+    ASSERT(sg__zpool_get(9, -MAX_WBITS, &streams[i]) == Z_OK);
+  for (i = 0; i < SG__ZPOOL_SIZE + 1; i++)
+    sg__zpool_put(streams[i]);
+  sg__zpool_put(NULL);
+}
+
 static void test__zcompress(void) {
   const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
   char src[100], dest[100];
@@ -121,10 +162,16 @@ static void test__zcompress(void) {
   src_size = strlen(src);
   dest_size = compressBound(src_size);
   ASSERT(sg__zcompress(NULL, src_size, (Bytef *) dest, (uLong *) &dest_size,
-                       -10) != Z_OK);
+                       -10, -MAX_WBITS) != Z_OK);
+  dest_size = compressBound(src_size);
+  ASSERT(sg__zcompress((Bytef *) src, src_size, (Bytef *) dest,
+                       (uLong *) &dest_size, 9, MAX_WBITS + 16) == Z_OK);
+  ASSERT(dest_size == 33);
+  ASSERT(((unsigned char) dest[0] == 0x1f) &&
+         ((unsigned char) dest[1] == 0x8b));
   dest_size = compressBound(src_size);
   ASSERT(sg__zcompress((Bytef *) src, src_size, (Bytef *) dest,
-                       (uLong *) &dest_size, 9) == Z_OK);
+                       (uLong *) &dest_size, 9, -MAX_WBITS) == Z_OK);
   ASSERT(dest_size == 15);
   memset(src, 0, sizeof(src));
   memcpy(src, dest, dest_size);
@@ -141,71 +188,275 @@ static void test__zcompress(void) {
 static void test__zdeflate(void) {
   const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
   z_stream stream;
-  char src[100], zbuf[SG__ZLIB_CHUNK];
-  char *dest;
-  size_t src_size, dest_size;
+  const Bytef *next_in;
+  char src[100], dest[100];
+  size_t avail_in, src_size, dest_size;
+  bool finished;
   memset(&stream, 0, sizeof(z_stream));
   ASSERT(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
                       MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK);
-  sprintf(src, "%s", text);
-  src_size = strlen(src);
-  ASSERT(sg__zdeflate(&stream, (Bytef *) zbuf, Z_FINISH, (Bytef *) src,
-                      (uInt) src_size, (Bytef **) &dest, &dest_size) == Z_OK);
+  next_in = (const Bytef *) text;
+  avail_in = strlen(text);
+  dest_size = sizeof(src);
+  ASSERT(sg__zdeflate(&stream, &next_in, &avail_in, true, (Bytef *) src,
+                      &dest_size, &finished) == 0);
   ASSERT(deflateEnd(&stream) == Z_OK);
+  ASSERT(finished);
+  ASSERT(avail_in == 0);
   ASSERT(dest_size == 15);
-  memset(src, 0, sizeof(src));
-  memcpy(src, dest, dest_size);
-  free(dest);
-  dest = malloc(100);
   src_size = dest_size;
-  dest_size = 100;
+  dest_size = sizeof(dest);
   ASSERT(sg__uncompress2((Bytef *) dest, (uLongf *) &dest_size, (Bytef *) src,
                          (uLong *) &src_size) == Z_OK);
   ASSERT(dest_size == 50);
-  if (dest) {
-    dest[dest_size] = '\0';
-    ASSERT(strcmp(dest, text) == 0);
-  }
-  free(dest);
+  dest[dest_size] = '\0';
+  ASSERT(strcmp(dest, text) == 0);
 
   memset(&stream, 0, sizeof(z_stream));
   ASSERT(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
                       Z_DEFAULT_STRATEGY) == Z_OK);
-  sprintf(src, "%s", text);
-  src_size = strlen(src);
-  ASSERT(sg__zdeflate(&stream, (Bytef *) zbuf, Z_NO_FLUSH, (Bytef *) src,
-                      (uInt) src_size, (Bytef **) &dest, &dest_size) == Z_OK);
-  free(dest);
+  next_in = (const Bytef *) text;
+  avail_in = strlen(text);
+  dest_size = sizeof(src);
+  ASSERT(sg__zdeflate(&stream, &next_in, &avail_in, false, (Bytef *) src,
+                      &dest_size, &finished) == 0);
+  ASSERT(!finished);
+  ASSERT(avail_in == 0);
   ASSERT(dest_size == 0);
-  ASSERT(sg__zdeflate(&stream, (Bytef *) zbuf, Z_FINISH, (Bytef *) src, 0,
-                      (Bytef **) &dest, &dest_size) == Z_OK);
+  /* drains the pending output through a tiny buffer */
+  src_size = 0;
+  do {
+    dest_size = 4;
+    ASSERT(sg__zdeflate(&stream, &next_in, &avail_in, true,
+                        (Bytef *) src + src_size, &dest_size, &finished) == 0);
+    ASSERT(dest_size <= 4);
+    src_size += dest_size;
+  } while (!finished);
   ASSERT(deflateEnd(&stream) == Z_OK);
-  ASSERT(dest_size == 15);
-  memset(src, 0, sizeof(src));
-  memcpy(src, dest, dest_size);
-  free(dest);
-  dest = malloc(100);
-  src_size = dest_size;
-  dest_size = 100;
+  ASSERT(src_size == 15);
+  dest_size = sizeof(dest);
   ASSERT(sg__uncompress2((Bytef *) dest, (uLongf *) &dest_size, (Bytef *) src,
                          (uLong *) &src_size) == Z_OK);
   ASSERT(dest_size == 50);
-  if (dest) {
-    dest[dest_size] = '\0';
-    ASSERT(strcmp(dest, text) == 0);
+  dest[dest_size] = '\0';
+  ASSERT(strcmp(dest, text) == 0);
+}
+
+/* Gzips `size` bytes of `src` feeding `chunk` bytes at a time and draining the
+   output through a buffer of `out` bytes, then checks the gunzipped copy. */
+static size_t test__pgz_run(unsigned int threads, const Bytef *src,
+                            size_t size, size_t chunk, size_t out) {
+  struct sg__pgz *pgz;
+  z_stream stream;
+  const Bytef *next_in;
+  Bytef *zbuf, *dest;
+  size_t zsize = 0, avail_in = 0, offset = 0, dest_size, zcap;
+  bool finished = false;
+  zcap = compressBound((uLong) size) + 1024 * (size / 131072 + 1);
+  zbuf = sg_malloc(zcap);
+  dest = sg_malloc(size + 1);
+  ASSERT(zbuf && dest);
+  ASSERT(sg__pgz_new(Z_BEST_SPEED, threads, &pgz) == 0);
+  next_in = src;
+  while (!finished) {
+    if ((avail_in == 0) && (offset < size)) {
+      avail_in = size - offset < chunk ? size - offset : chunk;
+      next_in = src + offset;
+      offset += avail_in;
+    }
+    ASSERT(zsize < zcap);
+    dest_size = zcap - zsize < out ? zcap - zsize : out;
+    ASSERT(sg__pgz_encode(pgz, &next_in, &avail_in, offset == size,
+                          zbuf + zsize, &dest_size, &finished) == 0);
+    ASSERT(dest_size <= out);
+    zsize += dest_size;
+  }
+  sg__pgz_free(pgz);
+  ASSERT(avail_in == 0);
+  memset(&stream, 0, sizeof(z_stream));
+  ASSERT(inflateInit2(&stream, MAX_WBITS + 16) == Z_OK);
+  stream.next_in = zbuf;
+  stream.avail_in = (uInt) zsize;
+  stream.next_out = dest;
+  stream.avail_out = (uInt) size + 1;
+  ASSERT(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+  ASSERT(stream.avail_in == 0);
+  ASSERT(stream.total_out == size);
+  ASSERT(inflateEnd(&stream) == Z_OK);
+  ASSERT(memcmp(dest, src, size) == 0);
+  sg_free(dest);
+  sg_free(zbuf);
+  return zsize;
+}
+
+static void test__pgz(void) {
+  struct sg__pgz *pgz;
+  Bytef *src, *zbuf;
+  uLongf len;
+  size_t i, size = 3 * 131072 + 1000, zsize;
+  uint32_t seed = 1;
+  pgz = NULL;
+  ASSERT(sg__pgz_new(Z_BEST_SPEED, 0, &pgz) == EINVAL);
+  ASSERT(!pgz);
+  ASSERT(sg__pgz_new(Z_BEST_SPEED, 1, NULL) == EINVAL);
+  sg__pgz_free(NULL);
+
+  src = sg_malloc(size);
+  ASSERT(src);
+  /* 4 kB of noise repeated, only compressible through back-references, also
+     across the blocks when the dictionaries are set */
+  for (i = 0; i < 4096; i++) {
+    seed = seed * 1103515245 + 12345;
+    src[i] = (Bytef) (seed >> 16);
   }
-  free(dest);
+  for (; i < size; i++)
+    src[i] = src[i - 4096];
+
+  ASSERT(test__pgz_run(1, src, 0, 1, 7) == 20);
+  ASSERT(test__pgz_run(2, src, 100, 7, 7) > 0);
+  ASSERT(test__pgz_run(3, src, 131072, 131072, 4096) > 0);
+  zsize = test__pgz_run(4, src, size, 16384, 4096);
+  /* without the dictionaries, each block would repeat the noise */
+  len = compressBound((uLong) size);
+  zbuf = sg_malloc(len);
+  ASSERT(zbuf);
+  ASSERT(sg__zcompress(src, (uLong) size, zbuf, &len, Z_BEST_SPEED,
+                       MAX_WBITS + 16) == Z_OK);
+  sg_free(zbuf);
+  ASSERT(zsize < len + 1024);
+  ASSERT(test__pgz_run(2, src, size, 100000, 7) == zsize);
+  ASSERT(test__pgz_run(8, src, size, size, size) == zsize);
+  sg_free(src);
+}
+
+#ifdef SG_HTTP_BROTLI
+
+static void test__brcompress(void) {
+  const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
+  uint8_t dest[100], out[100];
+  size_t dest_size = sizeof(dest), out_size = sizeof(out);
+  ASSERT(sg__brcompress(NULL, strlen(text), dest, &dest_size, 9) == EINVAL);
+  ASSERT(sg__brcompress((const uint8_t *) text, strlen(text), dest, NULL,
+                        9) == EINVAL);
+  dest_size = 1;
+  ASSERT(sg__brcompress((const uint8_t *) text, strlen(text), dest, &dest_size,
+                        9) == ENOBUFS);
+  dest_size = sizeof(dest);
+  ASSERT(sg__brcompress((const uint8_t *) text, strlen(text), dest, &dest_size,
+                        -1) == 0);
+  ASSERT(dest_size < strlen(text));
+  ASSERT(BrotliDecoderDecompress(dest_size, dest, &out_size, out) ==
+         BROTLI_DECODER_RESULT_SUCCESS);
+  ASSERT(out_size == strlen(text));
+  ASSERT(memcmp(out, text, out_size) == 0);
+}
+
+static void test__brencode(void) {
+  const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
+  BrotliEncoderState *state;
+  const Bytef *next_in;
+  uint8_t src[100], out[100];
+  size_t avail_in, dest_size, src_size = 0, out_size = sizeof(out);
+  bool finished;
+  state = BrotliEncoderCreateInstance(sg__bralloc, sg__brfree, NULL);
+  ASSERT(state);
+  next_in = (const Bytef *) text;
+  avail_in = 20;
+  dest_size = sizeof(src);
+  ASSERT(sg__brencode(state, &next_in, &avail_in, false, src, &dest_size,
+                      &finished) == 0);
+  ASSERT(!finished);
+  ASSERT(avail_in == 0);
+  src_size = dest_size;
+  avail_in = strlen(text) - 20;
+  do {
+    dest_size = 4;
+    ASSERT(sg__brencode(state, &next_in, &avail_in, true, src + src_size,
+                        &dest_size, &finished) == 0);
+    ASSERT(dest_size <= 4);
+    src_size += dest_size;
+  } while (!finished);
+  ASSERT(BrotliEncoderIsFinished(state));
+  BrotliEncoderDestroyInstance(state);
+  ASSERT(BrotliDecoderDecompress(src_size, src, &out_size, out) ==
+         BROTLI_DECODER_RESULT_SUCCESS);
+  ASSERT(out_size == strlen(text));
+  ASSERT(memcmp(out, text, out_size) == 0);
 }
 
+#endif /* SG_HTTP_BROTLI */
+
+#ifdef SG_HTTP_ZSTD
+
+static void test__zstdcompress(void) {
+  const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
+  char dest[100], out[100];
+  size_t dest_size = sizeof(dest);
+  ASSERT(sg__zstdcompress(NULL, strlen(text), dest, &dest_size, 9) == EINVAL);
+  ASSERT(sg__zstdcompress(text, strlen(text), NULL, &dest_size, 9) == EINVAL);
+  dest_size = 1;
+  ASSERT(sg__zstdcompress(text, strlen(text), dest, &dest_size, 9) ==
+         ENOBUFS);
+  dest_size = sizeof(dest);
+  ASSERT(sg__zstdcompress(text, strlen(text), dest, &dest_size, -1) == 0);
+  ASSERT(dest_size < strlen(text));
+  ASSERT(ZSTD_decompress(out, sizeof(out), dest, dest_size) == strlen(text));
+  ASSERT(memcmp(out, text, strlen(text)) == 0);
+}
+
+static void test__zstdencode(void) {
+  const char *text = "ffffffffffoooooooooobbbbbbbbbbaaaaaaaaaarrrrrrrrrr";
+  ZSTD_CStream *stream;
+  const Bytef *next_in;
+  Bytef src[100];
+  char out[100];
+  size_t avail_in, dest_size, src_size = 0;
+  bool finished;
+  stream = ZSTD_createCStream();
+  ASSERT(stream);
+  next_in = (const Bytef *) text;
+  avail_in = 20;
+  dest_size = sizeof(src);
+  ASSERT(sg__zstdencode(stream, &next_in, &avail_in, false, src, &dest_size,
+                        &finished) == 0);
+  ASSERT(!finished);
+  ASSERT(avail_in == 0);
+  src_size = dest_size;
+  avail_in = strlen(text) - 20;
+  do {
+    dest_size = 4;
+    ASSERT(sg__zstdencode(stream, &next_in, &avail_in, true, src + src_size,
+                          &dest_size, &finished) == 0);
+    ASSERT(dest_size <= 4);
+    src_size += dest_size;
+  } while (!finished);
+  ZSTD_freeCStream(stream);
+  ASSERT(ZSTD_decompress(out, sizeof(out), src, src_size) == strlen(text));
+  ASSERT(memcmp(out, text, strlen(text)) == 0);
+}
+
+#endif /* SG_HTTP_ZSTD */
+
 #endif /* SG_HTTP_COMPRESSION */
 
 int main(void) {
   test__convals_iter();
+  test__convals_view();
   test__strmap_iter();
   test_eor();
 #ifdef SG_HTTP_COMPRESSION
+  test__zpool();
   test__zcompress();
   test__zdeflate();
+  test__pgz();
+#ifdef SG_HTTP_BROTLI
+  test__brcompress();
+  test__brencode();
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  test__zstdcompress();
+  test__zstdencode();
+#endif /* SG_HTTP_ZSTD */
 #endif /* SG_HTTP_COMPRESSION */
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,305 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <string.h>
+#include <sagui.h>
+#include "sg_httpform.c"
+
+#define TEST_HTTPFORM_BOUNDARY "----sagui1234"
+
+#define TEST_HTTPFORM_BODY                                                     \
+  "preamble\r\n"                                                               \
+  "------sagui1234\r\n"                                                        \
+  "Content-Disposition: form-data; name=\"foo\"\r\n"                           \
+  "\r\n"                                                                       \
+  "bar\r\n"                                                                    \
+  "------sagui1234  \r\n"                                                      \
+  "content-disposition: form-data; name=abc; filename=\"a;b.txt\"\r\n"         \
+  "Content-Type: text/plain\r\n"                                               \
+  "Content-Transfer-Encoding: binary\r\n"                                      \
+  "\r\n"                                                                       \
+  "123\r\n--\r\n------sagui123\r\r\n"                                          \
+  "------sagui1234\r\n"                                                        \
+  "Content-Disposition: form-data; name=\"empty\"; filename=\"\"\r\n"          \
+  "\r\n"                                                                       \
+  "\r\n"                                                                       \
+  "------sagui1234\r\n"                                                        \
+  "\r\n"                                                                       \
+  "anonymous\r\n"                                                              \
+  "------sagui1234\r\n"                                                        \
+  "Content-Disposition: form-data; name=\"\xc3\xa7\"\r\n"                      \
+  "\r\n"                                                                       \
+  "\r\n"                                                                       \
+  "------sagui1234--\r\n"                                                      \
+  "epilogue\r\n------sagui1234\r\n"
+
+#define TEST_HTTPFORM_LOG                                                      \
+  "[foo=bar]"                                                                  \
+  "{abc:a;b.txt:text/plain:binary}123\r\n--\r\n------sagui123\r"               \
+  "[\xc3\xa7=]"
+
+struct test_httpform_holder {
+  char log[1024];
+  int errnum;
+};
+
+static int dummy_httpform_file_cb(void *cls, const char *field,
+                                  const char *name, const char *mime,
+                                  const char *encoding) {
+  struct test_httpform_holder *holder = cls;
+  size_t len = strlen(holder->log);
+  snprintf(holder->log + len, sizeof(holder->log) - len, "{%s:%s:%s:%s}",
+           field, name, mime, encoding);
+  return holder->errnum;
+}
+
+static int dummy_httpform_write_cb(void *cls, const char *buf, size_t size) {
+  struct test_httpform_holder *holder = cls;
+  size_t len = strlen(holder->log);
+  ASSERT(len + size < sizeof(holder->log));
+  memcpy(holder->log + len, buf, size);
+  holder->log[len + size] = '\0';
+  return holder->errnum;
+}
+
+static int dummy_httpform_field_cb(void *cls, const char *name,
+                                   const char *val, size_t size) {
+  struct test_httpform_holder *holder = cls;
+  size_t len = strlen(holder->log);
+  ASSERT(strlen(val) == size);
+  snprintf(holder->log + len, sizeof(holder->log) - len, "[%s=%s]", name, val);
+  return holder->errnum;
+}
+
+static struct sg__httpform *test_httpform_new(
+  struct test_httpform_holder *holder, size_t val_limit) {
+  memset(holder, 0, sizeof(struct test_httpform_holder));
+  return sg__httpform_new(TEST_HTTPFORM_BOUNDARY,
+                          strlen(TEST_HTTPFORM_BOUNDARY), val_limit,
+                          dummy_httpform_file_cb, dummy_httpform_write_cb,
+                          dummy_httpform_field_cb, holder);
+}
+
+static void test__httpform_boundary(void) {
+  const char *boundary = NULL;
+  size_t len = 0;
+  ASSERT(!sg__httpform_boundary(NULL, &boundary, &len));
+  ASSERT(!sg__httpform_boundary("multipart/form-data; boundary=abc", NULL,
+                                &len));
+  ASSERT(!sg__httpform_boundary("multipart/form-data; boundary=abc", &boundary,
+                                NULL));
+  ASSERT(!sg__httpform_boundary("application/x-www-form-urlencoded",
+                                &boundary, &len));
+  ASSERT(!sg__httpform_boundary("multipart/form-data", &boundary, &len));
+  ASSERT(!sg__httpform_boundary("multipart/form-data; boundary=", &boundary,
+                                &len));
+  ASSERT(!sg__httpform_boundary("multipart/form-data; boundary=\"abc",
+                                &boundary, &len));
+  ASSERT(!sg__httpform_boundary(
+    "multipart/form-data; boundary="
+    "12345678901234567890123456789012345678901234567890123456789012345678901",
+    &boundary, &len));
+
+  ASSERT(sg__httpform_boundary("multipart/form-data; boundary=abc", &boundary,
+                               &len));
+  ASSERT(len == 3 && strncmp(boundary, "abc", len) == 0);
+  ASSERT(sg__httpform_boundary("Multipart/Form-Data;charset=utf-8;"
+                               "BOUNDARY=\"a b;c\"",
+                               &boundary, &len));
+  ASSERT(len == 5 && strncmp(boundary, "a b;c", len) == 0);
+  ASSERT(sg__httpform_boundary("multipart/form-data; boundary=abc ; x=y",
+                               &boundary, &len));
+  ASSERT(len == 3 && strncmp(boundary, "abc", len) == 0);
+}
+
+static void test__httpform_is_urlencoded(void) {
+  ASSERT(!sg__httpform_is_urlencoded(NULL));
+  ASSERT(!sg__httpform_is_urlencoded(""));
+  ASSERT(!sg__httpform_is_urlencoded("multipart/form-data; boundary=abc"));
+  ASSERT(!sg__httpform_is_urlencoded("application/x-www-form-urlencodedx"));
+  ASSERT(sg__httpform_is_urlencoded("application/x-www-form-urlencoded"));
+  ASSERT(sg__httpform_is_urlencoded("Application/X-WWW-Form-Urlencoded"));
+  ASSERT(sg__httpform_is_urlencoded(
+    "application/x-www-form-urlencoded; charset=UTF-8"));
+}
+
+static void test__httpform_urlencoded(void) {
+  struct test_httpform_holder holder;
+  char buf[100];
+  memset(&holder, 0, sizeof(struct test_httpform_holder));
+  ASSERT(sg__httpform_urlencoded(NULL, 0, dummy_httpform_field_cb, &holder) ==
+         EINVAL);
+  ASSERT(sg__httpform_urlencoded(buf, 0, NULL, &holder) == EINVAL);
+
+  strcpy(buf, "");
+  ASSERT(sg__httpform_urlencoded(buf, strlen(buf), dummy_httpform_field_cb,
+                                 &holder) == 0);
+  ASSERT(strcmp(holder.log, "") == 0);
+
+  strcpy(buf, "a=1&b+c=2+3&%41%62=%zz%4&&d&=4&e=%C3%A7");
+  ASSERT(sg__httpform_urlencoded(buf, strlen(buf), dummy_httpform_field_cb,
+                                 &holder) == 0);
+  ASSERT(strcmp(holder.log,
+                "[a=1][b c=2 3][Ab=%zz%4][d=][e=\xc3\xa7]") == 0);
+
+  memset(&holder, 0, sizeof(struct test_httpform_holder));
+  holder.errnum = E2BIG;
+  strcpy(buf, "a=1&b=2");
+  ASSERT(sg__httpform_urlencoded(buf, strlen(buf), dummy_httpform_field_cb,
+                                 &holder) == E2BIG);
+  ASSERT(strcmp(holder.log, "[a=1]") == 0);
+}
+
+static void test__httpform_memmem(void) {
+  char buf[256];
+  size_t i;
+  ASSERT(!sg__httpform_memmem("", 0, "abc", 3));
+  ASSERT(!sg__httpform_memmem("ab", 2, "abc", 3));
+  ASSERT(!sg__httpform_memmem("abd", 3, "abc", 3));
+  ASSERT(!sg__httpform_memmem("abc", 3, "", 0));
+  ASSERT(strcmp(sg__httpform_memmem("xyzabc", 6, "b", 1), "bc") == 0);
+  ASSERT(strcmp(sg__httpform_memmem("abc", 3, "abc", 3), "abc") == 0);
+  ASSERT(strcmp(sg__httpform_memmem("aababc", 6, "abc", 3), "abc") == 0);
+  memset(buf, 'a', sizeof(buf));
+  ASSERT(!sg__httpform_memmem(buf, sizeof(buf), "ab", 2));
+  for (i = 0; i < sizeof(buf) - 1; i++) {
+    memset(buf, 'a', sizeof(buf));
+    buf[i] = '\r';
+    buf[i + 1] = 'b';
+    ASSERT(sg__httpform_memmem(buf, sizeof(buf), "\rb", 2) == buf + i);
+    ASSERT(sg__httpform_memmem(buf, i + 1, "\rb", 2) == NULL);
+  }
+  for (i = 0; i < sizeof(buf) - 5; i++) {
+    memset(buf, '-', sizeof(buf));
+    memcpy(buf + i, "\r\n--x", 5);
+    ASSERT(sg__httpform_memmem(buf, sizeof(buf), "\r\n--x", 5) == buf + i);
+    ASSERT(sg__httpform_memmem(buf, sizeof(buf), "\r\n--y", 5) == NULL);
+  }
+}
+
+static void test__httpform_new(void) {
+  struct test_httpform_holder holder;
+  struct sg__httpform *form;
+  ASSERT(!sg__httpform_new(NULL, 1, 0, dummy_httpform_file_cb,
+                           dummy_httpform_write_cb, dummy_httpform_field_cb,
+                           NULL));
+  ASSERT(!sg__httpform_new("a", 0, 0, dummy_httpform_file_cb,
+                           dummy_httpform_write_cb, dummy_httpform_field_cb,
+                           NULL));
+  ASSERT(!sg__httpform_new("a", SG__HTTPFORM_BOUNDARY_SIZE + 1, 0,
+                           dummy_httpform_file_cb, dummy_httpform_write_cb,
+                           dummy_httpform_field_cb, NULL));
+  ASSERT(!sg__httpform_new("a", 1, 0, NULL, dummy_httpform_write_cb,
+                           dummy_httpform_field_cb, NULL));
+  ASSERT(!sg__httpform_new("a", 1, 0, dummy_httpform_file_cb, NULL,
+                           dummy_httpform_field_cb, NULL));
+  ASSERT(!sg__httpform_new("a", 1, 0, dummy_httpform_file_cb,
+                           dummy_httpform_write_cb, NULL, NULL));
+
+  form = test_httpform_new(&holder, 0);
+  ASSERT(form);
+  ASSERT(form->state == SG__HTTPFORM_PREAMBLE);
+  ASSERT(form->delim_len == strlen(TEST_HTTPFORM_BOUNDARY) + 4);
+  ASSERT(memcmp(form->delim, "\r\n--" TEST_HTTPFORM_BOUNDARY,
+                form->delim_len) == 0);
+  ASSERT(form->cls == &holder);
+  sg__httpform_free(form);
+}
+
+static void test__httpform_free(void) {
+  sg__httpform_free(NULL);
+}
+
+static void test__httpform_process(void) {
+  const char *body = TEST_HTTPFORM_BODY;
+  struct test_httpform_holder holder;
+  struct sg__httpform *form;
+  size_t len = strlen(body), i, size;
+
+  ASSERT(sg__httpform_process(NULL, body, len) == EINVAL);
+  form = test_httpform_new(&holder, 0);
+  ASSERT(sg__httpform_process(form, NULL, len) == EINVAL);
+  ASSERT(sg__httpform_process(form, body, 0) == 0);
+  ASSERT(strlen(holder.log) == 0);
+  sg__httpform_free(form);
+
+  for (size = 1; size <= len; size++) {
+    form = test_httpform_new(&holder, 0);
+    ASSERT(form);
+    for (i = 0; i < len; i += size)
+      ASSERT(sg__httpform_process(form, body + i,
+                                  len - i < size ? len - i : size) == 0);
+    ASSERT(form->state == SG__HTTPFORM_EPILOGUE);
+    ASSERT(strcmp(holder.log, TEST_HTTPFORM_LOG) == 0);
+    sg__httpform_free(form);
+  }
+
+  form = test_httpform_new(&holder, 2);
+  ASSERT(sg__httpform_process(form, body, len) == EMSGSIZE);
+  sg__httpform_free(form);
+
+  form = test_httpform_new(&holder, 0);
+  holder.errnum = E2BIG;
+  ASSERT(sg__httpform_process(form, body, len) == E2BIG);
+  ASSERT(strcmp(holder.log, "[foo=bar]") == 0);
+  sg__httpform_free(form);
+
+  form = test_httpform_new(&holder, 0);
+  body = "--" TEST_HTTPFORM_BOUNDARY "\r\n\r\n\r\n--" TEST_HTTPFORM_BOUNDARY
+         "x";
+  ASSERT(sg__httpform_process(form, body, strlen(body)) == EINVAL);
+  sg__httpform_free(form);
+
+  form = test_httpform_new(&holder, 0);
+  body = "--" TEST_HTTPFORM_BOUNDARY "-x";
+  ASSERT(sg__httpform_process(form, body, strlen(body)) == EINVAL);
+  sg__httpform_free(form);
+
+  form = test_httpform_new(&holder, 0);
+  body = "--" TEST_HTTPFORM_BOUNDARY "\r\nContent-Type: text/plain\r\n";
+  ASSERT(sg__httpform_process(form, body, strlen(body)) == 0);
+  for (i = 0; i < SG__HTTPFORM_HDRS_SIZE; i++)
+    if (sg__httpform_process(form, "x", 1) != 0)
+      break;
+  ASSERT(i < SG__HTTPFORM_HDRS_SIZE);
+  ASSERT(sg__httpform_process(form, "x", 1) == EMSGSIZE);
+  sg__httpform_free(form);
+}
+
+int main(void) {
+  test__httpform_boundary();
+  test__httpform_is_urlencoded();
+  test__httpform_urlencoded();
+  test__httpform_memmem();
+  test__httpform_new();
+  test__httpform_free();
+  test__httpform_process();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <string.h>
+#include <sagui.h>
+#include "sg_httphdrs.c"
+
+static void test__httphdrs_name(void) {
+  ASSERT(strcmp(sg__httphdrs_name(SG_HDR_ACCEPT), "Accept") == 0);
+  ASSERT(strcmp(sg__httphdrs_name(SG_HDR_CONTENT_TYPE), "Content-Type") == 0);
+  ASSERT(strcmp(sg__httphdrs_name(SG_HDR_X_FORWARDED_FOR),
+                "X-Forwarded-For") == 0);
+}
+
+static void test__httphdrs_id(void) {
+  char name[32];
+  size_t i, len;
+  int id;
+  ASSERT(sg__httphdrs_id("", 0) == -1);
+  ASSERT(sg__httphdrs_id("foo", 3) == -1);
+  ASSERT(sg__httphdrs_id("Hosts", 5) == -1);
+  ASSERT(sg__httphdrs_id("Hast", 4) == -1);
+  ASSERT(sg__httphdrs_id("Content-Typo", 12) == -1);
+  ASSERT(sg__httphdrs_id("Host", 3) == -1);
+  ASSERT(sg__httphdrs_id("host", 4) == SG_HDR_HOST);
+  ASSERT(sg__httphdrs_id("ACCEPT-ENCODING", 15) == SG_HDR_ACCEPT_ENCODING);
+  ASSERT(sg__httphdrs_id("If-None-Match", 13) == SG_HDR_IF_NONE_MATCH);
+  for (id = 0; id < SG_HDR_COUNT; id++) {
+    len = strlen(sg__httphdrs_name(id));
+    memcpy(name, sg__httphdrs_name(id), len + 1);
+    ASSERT(sg__httphdrs_id(name, len) == id);
+    for (i = 0; i < len; i++)
+      if ((name[i] >= 'A') && (name[i] <= 'Z'))
+        name[i] = (char) (name[i] + 32);
+    ASSERT(sg__httphdrs_id(name, len) == id);
+  }
+}
+
+int main(void) {
+  test__httphdrs_name();
+  test__httphdrs_id();
+  return EXIT_SUCCESS;
+}
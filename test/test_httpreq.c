@@ -133,6 +133,63 @@ static void test_httpreq_params(struct sg_httpreq *req) {
   ASSERT(strcmp(sg_strmap_get(*params, "abc"), "123") == 0);
 }
 
+static void test_httpreq_get_header(struct sg_httpreq *req) {
+  errno = 0;
+  ASSERT(!sg_httpreq_get_header(NULL, "foo"));
+  ASSERT(errno == EINVAL);
+  errno = 0;
+  ASSERT(!sg_httpreq_get_header(req, NULL));
+  ASSERT(errno == EINVAL);
+
+  errno = 0;
+  ASSERT(!sg_httpreq_get_header(req, "foo"));
+  ASSERT(errno == 0);
+}
+
+static void test_httpreq_header(struct sg_httpreq *req) {
+  errno = 0;
+  ASSERT(!sg_httpreq_header(NULL, SG_HDR_HOST));
+  ASSERT(errno == EINVAL);
+  errno = 0;
+  ASSERT(!sg_httpreq_header(req, SG_HDR_COUNT));
+  ASSERT(errno == EINVAL);
+
+  errno = 0;
+  req->hdrs_ready = false;
+  ASSERT(!sg_httpreq_header(req, SG_HDR_HOST));
+  ASSERT(errno == 0);
+  ASSERT(req->hdrs_ready);
+  req->hdrs[SG_HDR_HOST] = "localhost";
+  ASSERT(strcmp(sg_httpreq_header(req, SG_HDR_HOST), "localhost") == 0);
+  req->hdrs[SG_HDR_HOST] = NULL;
+}
+
+static void test_httpreq_get_cookie(struct sg_httpreq *req) {
+  errno = 0;
+  ASSERT(!sg_httpreq_get_cookie(NULL, "foo"));
+  ASSERT(errno == EINVAL);
+  errno = 0;
+  ASSERT(!sg_httpreq_get_cookie(req, NULL));
+  ASSERT(errno == EINVAL);
+
+  errno = 0;
+  ASSERT(!sg_httpreq_get_cookie(req, "foo"));
+  ASSERT(errno == 0);
+}
+
+static void test_httpreq_get_param(struct sg_httpreq *req) {
+  errno = 0;
+  ASSERT(!sg_httpreq_get_param(NULL, "foo"));
+  ASSERT(errno == EINVAL);
+  errno = 0;
+  ASSERT(!sg_httpreq_get_param(req, NULL));
+  ASSERT(errno == EINVAL);
+
+  errno = 0;
+  ASSERT(!sg_httpreq_get_param(req, "foo"));
+  ASSERT(errno == 0);
+}
+
 static void test_httpreq_fields(struct sg_httpreq *req) {
   struct sg_strmap **fields;
   errno = 0;
@@ -315,6 +372,10 @@ int main(void) {
   test_httpreq_headers(req);
   test_httpreq_cookies(req);
   test_httpreq_params(req);
+  test_httpreq_get_header(req);
+  test_httpreq_header(req);
+  test_httpreq_get_cookie(req);
+  test_httpreq_get_param(req);
   test_httpreq_fields(req);
   test_httpreq_version(req);
   test_httpreq_method(req);
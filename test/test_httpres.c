@@ -29,6 +29,9 @@
 #include "sg_assert.h"
 
 #include <string.h>
+#ifndef _WIN32
+#include <utime.h>
+#endif /* _WIN32 */
 #include "sg_httpres.c"
 #include <sagui.h>
 
@@ -92,6 +95,21 @@ static void test_httpres_headers(struct sg_httpres *res) {
   ASSERT(strcmp(sg_strmap_get(*headers, "abc"), "123") == 0);
 }
 
+static void test_httpres_set_header(struct sg_httpres *res) {
+  ASSERT(sg_httpres_set_header(NULL, SG_HDR_VARY, "foo") == EINVAL);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_COUNT, "foo") == EINVAL);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, NULL) == EINVAL);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_SET_COOKIE, "a=b") == EINVAL);
+
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, "foo") == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "foo") == 0);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, "Accept-Encoding") == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
+  ASSERT(sg_strmap_add(&res->headers, "vary", "bar") == 0);
+  sg__httpres_headers(res);
+  ASSERT(sg_strmap_rm(&res->headers, "Vary") == 0);
+}
+
 static void test_httpres_set_cookie(struct sg_httpres *res) {
   struct sg_strmap **fields;
   ASSERT(sg_httpres_set_cookie(NULL, "foo", "bar") == EINVAL);
@@ -184,6 +202,22 @@ static void test_httpres_sendbinary(struct sg_httpres *res) {
   res->handle = NULL;
 }
 
+static void test_httpres_sendallowed(struct sg_httpres *res) {
+  ASSERT(sg_httpres_sendallowed(NULL, SG_METHOD_GET) == EINVAL);
+  ASSERT(sg_httpres_sendallowed(res, 0) == EINVAL);
+  ASSERT(sg_httpres_sendallowed(res, SG_METHOD_ANY + 1) == EINVAL);
+
+  res->status = 0;
+  ASSERT(sg_httpres_sendallowed(res, SG_METHOD_GET | SG_METHOD_POST) == 0);
+  ASSERT(res->status == 405);
+  ASSERT(strcmp(sg_strmap_get(*sg_httpres_headers(res), "Allow"),
+                "GET, POST") == 0);
+  ASSERT(sg_httpres_sendallowed(res, SG_METHOD_GET) == EALREADY);
+  MHD_destroy_response(res->handle);
+  res->handle = NULL;
+  sg_strmap_cleanup(sg_httpres_headers(res));
+}
+
 static void test_httpres_download(struct sg_httpres *res) {
 #define FILENAME "foo.txt"
 #define PATH TEST_HTTPRES_BASE_PATH FILENAME
@@ -254,6 +288,345 @@ static void test_httpres_render(struct sg_httpres *res) {
   res->handle = NULL;
 }
 
+static void test__httpres_httpdate(void) {
+  char date[32];
+  ASSERT(sg__httpres_httpdate(784111777, date, sizeof(date)) == 0);
+  ASSERT(strcmp(date, "Sun, 06 Nov 1994 08:49:37 GMT") == 0);
+  ASSERT(sg__httpres_httpdate(0, date, sizeof(date)) == 0);
+  ASSERT(strcmp(date, "Thu, 01 Jan 1970 00:00:00 GMT") == 0);
+}
+
+static void test__httpres_parsedate(void) {
+  const time_t times[] = {0, 784111777, 946684800, 951782400, 1709337599};
+  char date[32];
+  time_t t;
+  size_t i;
+  ASSERT(sg__httpres_parsedate("Sun, 06 Nov 1994 08:49:37 GMT", &t) == 0);
+  ASSERT(t == 784111777);
+  for (i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    ASSERT(sg__httpres_httpdate(times[i], date, sizeof(date)) == 0);
+    ASSERT(sg__httpres_parsedate(date, &t) == 0);
+    ASSERT(t == times[i]);
+  }
+  ASSERT(sg__httpres_parsedate("", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sunday, 06-Nov-94 08:49:37 GMT", &t) ==
+         EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun Nov  6 08:49:37 1994", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun, 06 Xyz 1994 08:49:37 GMT", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun, 06 ovD 1994 08:49:37 GMT", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun, 32 Nov 1994 08:49:37 GMT", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun, 06 Nov 1994 24:49:37 GMT", &t) == EINVAL);
+  ASSERT(sg__httpres_parsedate("Sun, 06 Nov 1994 08:49:37 UTC", &t) == EINVAL);
+}
+
+static void test__httpres_etagmatch(void) {
+  ASSERT(sg__httpres_etagmatch("*", NULL));
+  ASSERT(sg__httpres_etagmatch(" * ", "\"a\""));
+  ASSERT(!sg__httpres_etagmatch("\"a\"", NULL));
+  ASSERT(sg__httpres_etagmatch("\"a\"", "\"a\""));
+  ASSERT(sg__httpres_etagmatch("W/\"a\"", "\"a\""));
+  ASSERT(sg__httpres_etagmatch("\"a\"", "W/\"a\""));
+  ASSERT(!sg__httpres_etagmatch("\"a\"", "\"ab\""));
+  ASSERT(!sg__httpres_etagmatch("\"ab\"", "\"a\""));
+  ASSERT(sg__httpres_etagmatch("\"x\", W/\"y\" ,\"a\"", "W/\"a\""));
+  ASSERT(sg__httpres_etagmatch("\"x,y\", \"a\"", "\"a\""));
+  ASSERT(!sg__httpres_etagmatch("\"x\", *", "\"a\""));
+  ASSERT(!sg__httpres_etagmatch("\"a", "\"a\""));
+  ASSERT(!sg__httpres_etagmatch("a", "\"a\""));
+  ASSERT(!sg__httpres_etagmatch("", "\"a\""));
+}
+
+static void test__httpres_modified(void) {
+  const char *date = "Sun, 06 Nov 1994 08:49:37 GMT";
+  time_t mtime = 784111777;
+  ASSERT(sg__httpres_modified(NULL, NULL, "\"a\"", &mtime));
+  ASSERT(!sg__httpres_modified("\"a\"", NULL, "\"a\"", &mtime));
+  ASSERT(sg__httpres_modified("\"b\"", NULL, "\"a\"", &mtime));
+  /* If-None-Match takes precedence over If-Modified-Since */
+  ASSERT(sg__httpres_modified("\"b\"", date, "\"a\"", &mtime));
+  ASSERT(!sg__httpres_modified(NULL, date, "\"a\"", &mtime));
+  ASSERT(sg__httpres_modified(NULL, date, "\"a\"", NULL));
+  mtime++;
+  ASSERT(sg__httpres_modified(NULL, date, NULL, &mtime));
+  mtime -= 2;
+  ASSERT(!sg__httpres_modified(NULL, date, NULL, &mtime));
+  ASSERT(sg__httpres_modified(NULL, "foo", NULL, &mtime));
+  ASSERT(sg__httpres_modified(NULL, "Fri, 31 Dec 9999 23:59:59 GMT", NULL,
+                              &mtime));
+}
+
+static void test__httpres_sendhashed(struct sg_httpres *res) {
+  struct sg_httpsrv srv;
+  char etag[24];
+  snprintf(etag, sizeof(etag), "W/\"%016llx\"",
+           (unsigned long long) sg__xxh64("foo", 3));
+  ASSERT(sg_httpres_clear(res) == 0);
+  res->method = "GET";
+  ASSERT(sg__httpres_sendhashed(res, "foo", 3) == ENOENT);
+  ASSERT(!res->handle);
+  ASSERT(strcmp(res->hdrs[SG_HDR_ETAG], etag) == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(sg_strmap_set(&res->headers, "etag", "\"v1\"") == 0);
+  ASSERT(sg__httpres_sendhashed(res, "foo", 3) == ENOENT);
+  ASSERT(!res->hdrs[SG_HDR_ETAG]);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg__httpres_sendnotmodified(res) == 0);
+  ASSERT(res->handle);
+  ASSERT(res->status == 304);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  memset(&srv, 0, sizeof(struct sg_httpsrv));
+  res->srv = &srv;
+  ASSERT(sg_httpres_sendbinary(res, "foo", 3, "text/plain", 200) == 0);
+  ASSERT(!res->hdrs[SG_HDR_ETAG]);
+  ASSERT(sg_httpres_clear(res) == 0);
+  srv.etag = true;
+  ASSERT(sg_httpres_sendbinary(res, "foo", 3, "text/plain", 201) == 0);
+  ASSERT(!res->hdrs[SG_HDR_ETAG]);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(sg_httpres_sendbinary(res, "foo", 3, "text/plain", 200) == 0);
+  ASSERT(res->status == 200);
+  ASSERT(strcmp(res->hdrs[SG_HDR_ETAG], etag) == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  res->srv = NULL;
+  res->method = NULL;
+}
+
+static void test__httpres_ranges(void) {
+  struct sg__httpres_range ranges[SG__HTTPRES_MAX_RANGES];
+  char val[200];
+  unsigned int count, i;
+
+  ASSERT(sg__httpres_ranges("", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes= , ", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("items=0-1", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=a-1", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=1", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=-", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=5-2", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=0-1x", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=0-1;2-3", 10, ranges, &count) == EINVAL);
+  ASSERT(sg__httpres_ranges("bytes=0-1, 2-3, foo", 10, ranges, &count) ==
+         EINVAL);
+
+  ASSERT(sg__httpres_ranges("bytes=10-", 10, ranges, &count) == ERANGE);
+  ASSERT(sg__httpres_ranges("bytes=-0", 10, ranges, &count) == ERANGE);
+  ASSERT(sg__httpres_ranges("bytes=0-", 0, ranges, &count) == ERANGE);
+  ASSERT(sg__httpres_ranges("bytes=-5", 0, ranges, &count) == ERANGE);
+  ASSERT(sg__httpres_ranges("bytes=99999999999999999999999-", 10, ranges,
+                            &count) == ERANGE);
+  ASSERT(count == 0);
+
+  ASSERT(sg__httpres_ranges("bytes=2-4", 10, ranges, &count) == 0);
+  ASSERT(count == 1);
+  ASSERT((ranges[0].first == 2) && (ranges[0].last == 4));
+  ASSERT(sg__httpres_ranges("Bytes = 7-", 10, ranges, &count) == 0);
+  ASSERT(count == 1);
+  ASSERT((ranges[0].first == 7) && (ranges[0].last == 9));
+  ASSERT(sg__httpres_ranges("bytes=5-99999999999999999999999", 10, ranges,
+                            &count) == 0);
+  ASSERT((ranges[0].first == 5) && (ranges[0].last == 9));
+  ASSERT(sg__httpres_ranges("bytes=-3", 10, ranges, &count) == 0);
+  ASSERT((ranges[0].first == 7) && (ranges[0].last == 9));
+  ASSERT(sg__httpres_ranges("bytes=-30", 10, ranges, &count) == 0);
+  ASSERT((ranges[0].first == 0) && (ranges[0].last == 9));
+  ASSERT(sg__httpres_ranges("bytes=0-0, 20-30 ,, -1 ,", 10, ranges, &count) ==
+         0);
+  ASSERT(count == 2);
+  ASSERT((ranges[0].first == 0) && (ranges[0].last == 0));
+  ASSERT((ranges[1].first == 9) && (ranges[1].last == 9));
+
+  strcpy(val, "bytes=0-0");
+  for (i = 1; i < SG__HTTPRES_MAX_RANGES; i++)
+    strcat(val, ",1-1");
+  ASSERT(sg__httpres_ranges(val, 10, ranges, &count) == 0);
+  ASSERT(count == SG__HTTPRES_MAX_RANGES);
+  strcat(val, ",1-1");
+  ASSERT(sg__httpres_ranges(val, 10, ranges, &count) == EINVAL);
+}
+
+static void test__httpres_parts(void) {
+#define PATH TEST_HTTPRES_BASE_PATH "foo.txt"
+  struct sg__httpres_range ranges[2] = {{0, 1}, {7, 9}};
+  const char *body = "\r\n--b\r\nContent-Type: text/plain\r\n"
+                     "Content-Range: bytes 0-1/10\r\n\r\n01"
+                     "\r\n--b\r\nContent-Type: text/plain\r\n"
+                     "Content-Range: bytes 7-9/10\r\n\r\n789"
+                     "\r\n--b--\r\n";
+  struct sg__httpres_parts *parts;
+  char buf[300];
+  uint64_t size, offset = 0;
+  ssize_t have;
+  FILE *file;
+  file = fopen(PATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite("0123456789", 1, 10, file) == 10);
+  ASSERT(fclose(file) == 0);
+
+  parts = sg__httpres_parts_new("b", "text/plain", ranges, 2, 10, &size);
+  ASSERT(parts);
+  ASSERT(size == strlen(body));
+  parts->fd = open(PATH, O_RDONLY);
+  ASSERT(parts->fd != -1);
+  /* reads through a tiny buffer to cross the part bounds */
+  while ((have = sg__httpres_parts_read_cb(parts, offset, buf + offset, 4)) !=
+         MHD_CONTENT_READER_END_OF_STREAM) {
+    ASSERT((have > 0) && (have <= 4));
+    offset += (uint64_t) have;
+  }
+  ASSERT(offset == size);
+  ASSERT(memcmp(buf, body, (size_t) size) == 0);
+  ASSERT(sg__httpres_parts_read_cb(parts, 5, buf, sizeof(buf)) ==
+         (ssize_t) parts->offs[1] - 5);
+  ASSERT(sg__httpres_parts_read_cb(parts, parts->offs[1], buf, sizeof(buf)) ==
+         2);
+  ASSERT(memcmp(buf, "01", 2) == 0);
+  ASSERT(sg__httpres_parts_read_cb(parts, size, buf, sizeof(buf)) ==
+         MHD_CONTENT_READER_END_OF_STREAM);
+  sg__httpres_parts_free_cb(parts);
+
+  parts = sg__httpres_parts_new("b", NULL, ranges, 1, 10, &size);
+  ASSERT(parts);
+  ASSERT(strcmp(parts->heads, "\r\n--b\r\nContent-Range: bytes 0-1/10\r\n\r\n"
+                              "\r\n--b--\r\n") == 0);
+  ASSERT(size == strlen(parts->heads) + 2);
+  sg__httpres_parts_free_cb(parts);
+  ASSERT(unlink(PATH) == 0);
+#undef PATH
+}
+
+static void test__httpres_sendranges(struct sg_httpres *res) {
+#define PATH TEST_HTTPRES_BASE_PATH "foo.txt"
+  struct stat sbuf;
+  char date[32];
+  FILE *file;
+  int fd;
+  file = fopen(PATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite("0123456789", 1, 10, file) == 10);
+  ASSERT(fclose(file) == 0);
+  ASSERT(stat(PATH, &sbuf) == 0);
+  ASSERT(sg__httpres_httpdate(sbuf.st_mtime, date, sizeof(date)) == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, NULL, NULL) == ENOENT);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "foo", NULL) == ENOENT);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=0-1", "\"abc\"") ==
+         ENOENT);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=0-1", "W/\"abc\"") ==
+         ENOENT);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=0-1",
+                                "Thu, 01 Jan 1970 00:00:00 GMT") == ENOENT);
+  ASSERT(!res->handle);
+
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=2-4", date) == 0);
+  ASSERT(res->handle);
+  ASSERT(res->status == 206);
+  ASSERT(strcmp(res->hdrs[SG_HDR_CONTENT_RANGE], "bytes 2-4/10") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=10-", NULL) == 0);
+  ASSERT(res->status == 416);
+  ASSERT(strcmp(res->hdrs[SG_HDR_CONTENT_RANGE], "bytes */10") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_CONTENT_TYPE, "text/plain") == 0);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=0-1,-3", NULL) == 0);
+  ASSERT(res->status == 206);
+  ASSERT(!res->hdrs[SG_HDR_CONTENT_RANGE]);
+  ASSERT(strncmp(res->hdrs[SG_HDR_CONTENT_TYPE],
+                 "multipart/byteranges; boundary=", 31) == 0);
+  ASSERT(strlen(res->hdrs[SG_HDR_CONTENT_TYPE]) > 31);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  res->method = "HEAD";
+  ASSERT(sg__httpres_sendfd(res, fd, &sbuf, 0, 0, 200) == 0);
+  ASSERT(!res->hdrs[SG_HDR_ACCEPT_RANGES]);
+  ASSERT(res->status == 200);
+  ASSERT(sg_httpres_clear(res) == 0);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  res->method = "GET";
+  ASSERT(sg__httpres_sendfd(res, fd, &sbuf, 0, 0, 200) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_ACCEPT_RANGES], "bytes") == 0);
+  ASSERT(res->status == 200);
+  ASSERT(sg_httpres_clear(res) == 0);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(sg__httpres_sendfd(res, fd, &sbuf, 0, 1, 200) == 0);
+  ASSERT(!res->hdrs[SG_HDR_ACCEPT_RANGES]);
+  ASSERT(sg_httpres_clear(res) == 0);
+  res->method = NULL;
+
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_ETAG, "\"abc\"") == 0);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=2-4", "\"abd\"") ==
+         ENOENT);
+  ASSERT(sg__httpres_sendranges(res, fd, &sbuf, "bytes=2-4", "\"abc\"") ==
+         0);
+  ASSERT(res->status == 206);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(unlink(PATH) == 0);
+#undef PATH
+}
+
+static void test__httpres_sendvalidated(struct sg_httpres *res) {
+#define PATH TEST_HTTPRES_BASE_PATH "foo.txt"
+  struct stat sbuf;
+  char val[64];
+  FILE *file;
+  int fd;
+  file = fopen(PATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite("0123456789", 1, 10, file) == 10);
+  ASSERT(fclose(file) == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(fstat(fd, &sbuf) == 0);
+
+  ASSERT(sg__httpres_sendvalidated(res, fd, &sbuf, 1, 0, 200) == ENOENT);
+  ASSERT(sg__httpres_sendvalidated(res, fd, &sbuf, 0, 1, 200) == ENOENT);
+  ASSERT(sg__httpres_sendvalidated(res, fd, &sbuf, 0, 0, 201) == ENOENT);
+  ASSERT(!res->hdrs[SG_HDR_ETAG]);
+  ASSERT(!res->hdrs[SG_HDR_LAST_MODIFIED]);
+
+  res->method = "GET";
+  ASSERT(sg__httpres_sendvalidated(res, fd, &sbuf, 0, 0, 200) == ENOENT);
+  ASSERT(!res->handle);
+  snprintf(val, sizeof(val), "W/\"%llx-a-%llx\"",
+           (unsigned long long) sbuf.st_ino,
+           (unsigned long long) sbuf.st_mtime);
+  ASSERT(strcmp(res->hdrs[SG_HDR_ETAG], val) == 0);
+  ASSERT(sg__httpres_httpdate(sbuf.st_mtime, val, sizeof(val)) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_LAST_MODIFIED], val) == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg_httpres_set_header(res, SG_HDR_ETAG, "\"v1\"") == 0);
+  ASSERT(sg_strmap_set(&res->headers, MHD_HTTP_HEADER_LAST_MODIFIED,
+                       "Sun, 06 Nov 1994 08:49:37 GMT") == 0);
+  ASSERT(sg__httpres_sendvalidated(res, fd, &sbuf, 0, 0, 200) == ENOENT);
+  ASSERT(strcmp(res->hdrs[SG_HDR_ETAG], "\"v1\"") == 0);
+  ASSERT(!res->hdrs[SG_HDR_LAST_MODIFIED]);
+  ASSERT(sg_httpres_clear(res) == 0);
+  res->method = NULL;
+  ASSERT(close(fd) == 0);
+  ASSERT(unlink(PATH) == 0);
+#undef PATH
+}
+
 static void test_httpres_sendfile2(struct sg_httpres *res) {
 #define FILENAME "foo.txt"
 #define PATH TEST_HTTPRES_BASE_PATH FILENAME
@@ -437,6 +810,346 @@ static void test_httpres_sendstream(struct sg_httpres *res) {
 
 #ifdef SG_HTTP_COMPRESSION
 
+static void test__httpres_zcoding(void) {
+  ASSERT(sg__httpres_zcoding(NULL, SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZDEFLATE);
+  ASSERT(sg__httpres_zcoding(NULL, SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("", SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("compress", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip, deflate", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("deflate", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZDEFLATE);
+  ASSERT(sg__httpres_zcoding(" X-GZIP ", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("gzip;q=0.5, deflate", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZDEFLATE);
+  ASSERT(sg__httpres_zcoding("gzip ; Q = 0.8,deflate;q=0.75",
+                             SG__HTTPRES_ZDEFLATE) == SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("gzip;q=0, deflate;q=0", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip;q=0.5, identity", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip;q=0.5, identity;q=0.5",
+                             SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("gzip;q=0.001", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("gzip;q=0.5, identity;q=0.6",
+                             SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("*, br;q=0, zstd;q=0", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("*;q=0", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip;q=0, *, br;q=0, zstd;q=0",
+                             SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZDEFLATE);
+  ASSERT(sg__httpres_zcoding("gzip;q=2", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip;q=1.001", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+  ASSERT(sg__httpres_zcoding("gzip;q=abc, deflate;q=0.1",
+                             SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZDEFLATE);
+  ASSERT(sg__httpres_zcoding("gzip;level=1;q=1.0", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding(",, ,gzip,,", SG__HTTPRES_ZDEFLATE) ==
+         SG__HTTPRES_ZGZIP);
+#ifdef SG_HTTP_BROTLI
+  ASSERT(sg__httpres_zcoding("gzip, deflate, br", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZBROTLI);
+  ASSERT(sg__httpres_zcoding("br;q=0.5, gzip", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZGZIP);
+  ASSERT(sg__httpres_zcoding("*", SG__HTTPRES_ZGZIP) == SG__HTTPRES_ZBROTLI);
+#else /* SG_HTTP_BROTLI */
+  ASSERT(sg__httpres_zcoding("br", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+#endif /* SG_HTTP_BROTLI */
+#ifdef SG_HTTP_ZSTD
+  ASSERT(sg__httpres_zcoding("gzip, zstd", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZZSTD);
+  ASSERT(sg__httpres_zcoding("zstd;q=0.9, gzip;q=0.8", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZZSTD);
+#else /* SG_HTTP_ZSTD */
+  ASSERT(sg__httpres_zcoding("zstd", SG__HTTPRES_ZGZIP) ==
+         SG__HTTPRES_ZIDENTITY);
+#endif /* SG_HTTP_ZSTD */
+}
+
+static void test__httpres_vary(struct sg_httpres *res) {
+  sg_strmap_cleanup(&res->headers);
+  sg__httpres_hdrs_cleanup(res);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
+
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, "Origin") == 0);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Origin, Accept-Encoding") == 0);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, "origin, accept-encoding") ==
+         0);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "origin, accept-encoding") == 0);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_VARY, "*") == 0);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "*") == 0);
+  sg__httpres_hdrs_cleanup(res);
+
+  ASSERT(sg_strmap_set(&res->headers, "vary", "Cookie") == 0);
+  ASSERT(sg__httpres_vary(res) == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Cookie, Accept-Encoding") == 0);
+  sg__httpres_hdrs_cleanup(res);
+  sg_strmap_cleanup(&res->headers);
+}
+
+static void test__httpres_ztype(void) {
+  ASSERT(sg__httpres_ztype("text/html", "text/html"));
+  ASSERT(sg__httpres_ztype("text/html", "TEXT/HTML; charset=utf-8"));
+  ASSERT(sg__httpres_ztype("text/html", " text/html ;q=1"));
+  ASSERT(!sg__httpres_ztype("text/html", "text/htm"));
+  ASSERT(!sg__httpres_ztype("text/htm", "text/html"));
+  ASSERT(!sg__httpres_ztype("text/html", ""));
+  ASSERT(!sg__httpres_ztype("", "text/html"));
+  ASSERT(sg__httpres_ztype("image/svg+xml, application/json",
+                           "application/json"));
+  ASSERT(sg__httpres_ztype("text/*", "text/css"));
+  ASSERT(!sg__httpres_ztype("text/*", "text"));
+  ASSERT(!sg__httpres_ztype("text/*", "textual/css"));
+  ASSERT(!sg__httpres_ztype("text/*, application/json", "image/png"));
+  ASSERT(sg__httpres_ztype("*/*", "image/png"));
+  ASSERT(sg__httpres_ztype(" , *", "image/png"));
+}
+
+static void test__httpres_zpolicy(struct sg_httpres *res) {
+  struct sg_httpsrv srv;
+  char str[2000];
+  memset(&srv, 0, sizeof(struct sg_httpsrv));
+  ASSERT(pthread_mutex_init(&srv.mutex, NULL) == 0);
+  srv.ztypes = "text/*, application/json";
+  srv.zmin_size = 1024;
+  srv.zlevel = Z_BEST_SPEED;
+  memset(str, 'a', sizeof(str));
+  sg_strmap_cleanup(&res->headers);
+  sg__httpres_hdrs_cleanup(res);
+  res->srv = &srv;
+
+  ASSERT(sg_httpres_sendbinary(res, str, sizeof(str), "text/html", 200) == 0);
+  ASSERT(res->handle);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "deflate") == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
+  ASSERT(srv.zactive == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg_httpres_sendbinary(res, str, sizeof(str), "image/png", 200) == 0);
+  ASSERT(!sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING));
+  ASSERT(!res->hdrs[SG_HDR_VARY]);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg_httpres_sendbinary(res, str, 1023, "text/html", 200) == 0);
+  ASSERT(!sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING));
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg_strmap_set(&res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING, "br") ==
+         0);
+  ASSERT(sg_httpres_sendbinary(res, str, sizeof(str), "text/html", 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "br") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(sg_httpres_set_header(res, SG_HDR_CONTENT_TYPE,
+                               "application/json; charset=utf-8") == 0);
+  srv.zmax_active = 1;
+  srv.zactive = 1;
+  ASSERT(sg_httpres_sendbinary(res, str, sizeof(str), NULL, 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "deflate") == 0);
+  ASSERT(srv.zactive == 1);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  srv.ztypes = NULL;
+  ASSERT(sg_httpres_sendbinary(res, str, sizeof(str), "text/html", 200) == 0);
+  ASSERT(!sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING));
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  res->srv = NULL;
+  pthread_mutex_destroy(&srv.mutex);
+}
+
+static void test__httpres_zstatic(struct sg_httpres *res) {
+#define PATH TEST_HTTPRES_BASE_PATH "foo.txt"
+#define ZPATH PATH ".gz"
+  enum sg__httpres_zcoding coding;
+  struct sg_httpsrv srv;
+  struct stat sbuf, zsbuf;
+  unsigned char magic[2];
+  char str[2000], name[96], *dir, *path;
+  FILE *file;
+  int fd, zfd = -1;
+  memset(&srv, 0, sizeof(struct sg_httpsrv));
+  memset(str, 'a', sizeof(str));
+  unlink(ZPATH);
+  file = fopen(PATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite(str, 1, sizeof(str), file) == sizeof(str));
+  ASSERT(fclose(file) == 0);
+  ASSERT(stat(PATH, &sbuf) == 0);
+  sg_strmap_cleanup(&res->headers);
+  res->srv = &srv;
+
+  ASSERT(sg__httpres_zsibling(res, PATH, &sbuf, &coding, &zfd, &zsbuf) ==
+         ENOENT);
+  ASSERT(zfd == -1);
+  file = fopen(ZPATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite("gz", 1, 2, file) == 2);
+  ASSERT(fclose(file) == 0);
+  ASSERT(sg__httpres_zsibling(res, PATH, &sbuf, &coding, &zfd, &zsbuf) == 0);
+  ASSERT(coding == SG__HTTPRES_ZGZIP);
+  ASSERT(zfd != -1);
+  ASSERT(zsbuf.st_size == 2);
+  close(zfd);
+  zfd = -1;
+#ifndef _WIN32
+  {
+    struct utimbuf times;
+    times.actime = sbuf.st_atime;
+    times.modtime = sbuf.st_mtime - 10;
+    ASSERT(utime(ZPATH, &times) == 0);
+    ASSERT(sg__httpres_zsibling(res, PATH, &sbuf, &coding, &zfd, &zsbuf) ==
+           ENOENT);
+    ASSERT(zfd == -1);
+    times.modtime = sbuf.st_mtime;
+    ASSERT(utime(ZPATH, &times) == 0);
+  }
+#endif /* _WIN32 */
+
+  srv.zstatic = true;
+  ASSERT(sg_httpres_zsendfile2(res, 1, 0, 0, 0, PATH, NULL, 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "gzip") == 0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(unlink(ZPATH) == 0);
+
+  dir = sg_tmpdir();
+  ASSERT(dir);
+  snprintf(name, sizeof(name), "%llx-%llx-%llx-%llx-%d%s",
+           (unsigned long long) sbuf.st_dev,
+#ifdef _WIN32
+           (unsigned long long) sg__strcasehash(PATH, strlen(PATH)),
+#else /* _WIN32 */
+           (unsigned long long) sbuf.st_ino,
+#endif /* _WIN32 */
+           (unsigned long long) sbuf.st_mtime,
+           (unsigned long long) sbuf.st_size, 1, ".gz");
+  path = sg__strjoin(PATH_SEP, dir, name);
+  ASSERT(path);
+  unlink(path);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  ASSERT(sg__httpres_zcached(res, dir, 1, SG__HTTPRES_ZGZIP, fd, PATH, &sbuf,
+                             &zfd, &zsbuf) == 0);
+  ASSERT(zfd != -1);
+  ASSERT(zsbuf.st_size > 0);
+  ASSERT(zsbuf.st_size < (sg__off_t) sizeof(str));
+  ASSERT(read(zfd, magic, sizeof(magic)) == sizeof(magic));
+  ASSERT((magic[0] == 0x1f) && (magic[1] == 0x8b));
+  close(zfd);
+  close(fd);
+  ASSERT(access(path, F_OK) == 0);
+
+  srv.zcache_dir = dir;
+  ASSERT(sg_httpres_zsendfile2(res, 1, 0, 0, 0, PATH, NULL, 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "gzip") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(sg_httpres_zsendfile2(res, 1, 10, 0, 0, PATH, NULL, 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "gzip") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+  ASSERT(unlink(path) == 0);
+  sg_free(path);
+  sg_free(dir);
+  ASSERT(unlink(PATH) == 0);
+
+  res->srv = NULL;
+#undef ZPATH
+#undef PATH
+}
+
+static void test__httpres_zthreads(struct sg_httpres *res) {
+#define PATH TEST_HTTPRES_BASE_PATH "foo.txt"
+  struct sg_httpsrv srv;
+  struct stat zsbuf;
+  z_stream stream;
+  Bytef *buf, *zbuf, *dest;
+  const size_t size = SG__PGZ_MIN_SIZE + 12345;
+  size_t i;
+  char *dir, *path;
+  FILE *file;
+  int fd, zfd;
+  memset(&srv, 0, sizeof(struct sg_httpsrv));
+  ASSERT(sg__httpres_zthreads(res, SG__HTTPRES_ZGZIP, size) == 0);
+  res->srv = &srv;
+  srv.zthreads = 4;
+  ASSERT(sg__httpres_zthreads(res, SG__HTTPRES_ZGZIP, size) == 4);
+  ASSERT(sg__httpres_zthreads(res, SG__HTTPRES_ZGZIP, SG__PGZ_MIN_SIZE - 1) ==
+         0);
+  ASSERT(sg__httpres_zthreads(res, SG__HTTPRES_ZDEFLATE, size) == 0);
+
+  buf = sg_malloc(size);
+  dest = sg_malloc(size);
+  ASSERT(buf && dest);
+  for (i = 0; i < size; i++)
+    buf[i] = (Bytef) ((i % 251) ^ (i / 4096));
+  file = fopen(PATH, "w");
+  ASSERT(file);
+  ASSERT(fwrite(buf, 1, size, file) == size);
+  ASSERT(fclose(file) == 0);
+  dir = sg_tmpdir();
+  ASSERT(dir);
+  fd = open(PATH, O_RDONLY);
+  ASSERT(fd != -1);
+  path = sg__strjoin(PATH_SEP, dir, "foo.txt.gz");
+  ASSERT(path);
+  ASSERT(sg__httpres_zwrite(dir, 1, SG__HTTPRES_ZGZIP,
+                            sg__httpres_zthreads(res, SG__HTTPRES_ZGZIP, size),
+                            fd, path) == 0);
+  close(fd);
+  zfd = open(path, O_RDONLY);
+  ASSERT(zfd != -1);
+  ASSERT(fstat(zfd, &zsbuf) == 0);
+  zbuf = sg_malloc((size_t) zsbuf.st_size);
+  ASSERT(zbuf);
+  ASSERT(read(zfd, zbuf, (size_t) zsbuf.st_size) == zsbuf.st_size);
+  close(zfd);
+  memset(&stream, 0, sizeof(z_stream));
+  ASSERT(inflateInit2(&stream, MAX_WBITS + 16) == Z_OK);
+  stream.next_in = zbuf;
+  stream.avail_in = (uInt) zsbuf.st_size;
+  stream.next_out = dest;
+  stream.avail_out = (uInt) size;
+  ASSERT(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+  ASSERT(inflateEnd(&stream) == Z_OK);
+  ASSERT(stream.total_out == size);
+  ASSERT(memcmp(dest, buf, size) == 0);
+  sg_free(zbuf);
+  sg_free(dest);
+  sg_free(buf);
+
+  ASSERT(sg_httpres_zsendfile2(res, 1, 0, 0, 0, PATH, NULL, 200) == 0);
+  ASSERT(strcmp(sg_strmap_get(res->headers, MHD_HTTP_HEADER_CONTENT_ENCODING),
+                "gzip") == 0);
+  ASSERT(sg_httpres_clear(res) == 0);
+
+  ASSERT(unlink(path) == 0);
+  sg_free(path);
+  sg_free(dir);
+  ASSERT(unlink(PATH) == 0);
+  res->srv = NULL;
+#undef PATH
+}
+
 static void test_httpres_zsend(struct sg_httpres *res) {
   char *str = "foo";
 
@@ -528,6 +1241,7 @@ static void test_httpres_zsendbinary2(struct sg_httpres *res) {
   ASSERT(sg_httpres_zsendbinary2(res, -1, str, len, "text/plain", 200) == 0);
   ASSERT(strcmp(sg_strmap_get(res->headers, "Content-Encoding"), "deflate") ==
          0);
+  ASSERT(strcmp(res->hdrs[SG_HDR_VARY], "Accept-Encoding") == 0);
   ASSERT(strcmp(sg_strmap_get(res->headers, "Content-Type"), "text/plain") ==
          0);
   ASSERT(res->status == 200);
@@ -945,6 +1659,7 @@ static void test_httpres_reset(struct sg_httpres *res) {
   ASSERT(sg_strmap_add(headers, "foo", "bar") == 0);
   ASSERT(sg_strmap_add(headers, "lorem", "ipsum") == 0);
   ASSERT(sg_httpres_set_cookie(res, "my", "cookie") == 0);
+  ASSERT(sg_httpres_set_header(res, SG_HDR_ETAG, "\"1\"") == 0);
   ASSERT(sg_httpres_send(res, "", "", 200) == 0);
 
   ASSERT(res->handle);
@@ -986,6 +1701,7 @@ static void test_httpres_clear(struct sg_httpres *res) {
   ASSERT(!sg_strmap_get(*headers, "foo"));
   ASSERT(!sg_strmap_get(*headers, "lorem"));
   ASSERT(!sg_strmap_get(*headers, "Set-Cookie"));
+  ASSERT(!res->hdrs[SG_HDR_ETAG]);
   ASSERT(res->status == 500);
 }
 
@@ -1011,15 +1727,32 @@ int main(void) {
   test__httpres_free();
   test__httpres_dispatch(res);
   test_httpres_headers(res);
+  test_httpres_set_header(res);
   test_httpres_set_cookie(res);
   test_httpres_send(res);
   test_httpres_sendbinary(res);
+  test_httpres_sendallowed(res);
   test_httpres_download(res);
   test_httpres_render(res);
+  test__httpres_httpdate();
+  test__httpres_parsedate();
+  test__httpres_etagmatch();
+  test__httpres_modified();
+  test__httpres_sendhashed(res);
+  test__httpres_ranges();
+  test__httpres_parts();
+  test__httpres_sendranges(res);
+  test__httpres_sendvalidated(res);
   test_httpres_sendfile2(res);
   test_httpres_sendfile(res);
   test_httpres_sendstream(res);
 #ifdef SG_HTTP_COMPRESSION
+  test__httpres_zcoding();
+  test__httpres_vary(res);
+  test__httpres_ztype();
+  test__httpres_zpolicy(res);
+  test__httpres_zstatic(res);
+  test__httpres_zthreads(res);
   test_httpres_zsend(res);
   test_httpres_zsendbinary2(res);
   test_httpres_zsendbinary(res);
@@ -822,6 +822,164 @@ static void test_httpsrv_con_limit(struct sg_httpsrv *srv) {
   ASSERT(errno == 0);
 }
 
+static void test_httpsrv_set_etag(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_etag(NULL, true) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_etag(srv, false) == 0);
+  ASSERT(sg_httpsrv_set_etag(srv, true) == 0);
+}
+
+static void test_httpsrv_etag(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(!sg_httpsrv_etag(NULL));
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_etag(srv, false) == 0);
+  errno = 0;
+  ASSERT(!sg_httpsrv_etag(srv));
+  ASSERT(errno == 0);
+  ASSERT(sg_httpsrv_set_etag(srv, true) == 0);
+  ASSERT(sg_httpsrv_etag(srv));
+}
+
+#ifdef SG_HTTP_COMPRESSION
+
+static void test_httpsrv_set_ztypes(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_ztypes(NULL, "text/*") == EINVAL);
+
+  ASSERT(sg_httpsrv_set_ztypes(srv, "text/*") == 0);
+  ASSERT(sg_httpsrv_set_ztypes(srv, NULL) == 0);
+}
+
+static void test_httpsrv_ztypes(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(!sg_httpsrv_ztypes(NULL));
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_ztypes(srv, NULL) == 0);
+  errno = 0;
+  ASSERT(!sg_httpsrv_ztypes(srv));
+  ASSERT(errno == 0);
+  ASSERT(sg_httpsrv_set_ztypes(srv, "text/*, application/json") == 0);
+  ASSERT(strcmp(sg_httpsrv_ztypes(srv), "text/*, application/json") == 0);
+}
+
+static void test_httpsrv_set_zmin_size(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zmin_size(NULL, 123) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zmin_size(srv, 0) == 0);
+  ASSERT(sg_httpsrv_set_zmin_size(srv, 123) == 0);
+}
+
+static void test_httpsrv_zmin_size(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(sg_httpsrv_zmin_size(NULL) == 0);
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zmin_size(srv, 123) == 0);
+  errno = 0;
+  ASSERT(sg_httpsrv_zmin_size(srv) == 123);
+  ASSERT(errno == 0);
+}
+
+static void test_httpsrv_set_zlevel(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zlevel(NULL, 1) == EINVAL);
+  ASSERT(sg_httpsrv_set_zlevel(srv, -2) == EINVAL);
+  ASSERT(sg_httpsrv_set_zlevel(srv, 10) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zlevel(srv, -1) == 0);
+  ASSERT(sg_httpsrv_set_zlevel(srv, 9) == 0);
+}
+
+static void test_httpsrv_zlevel(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(sg_httpsrv_zlevel(NULL) == 0);
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zlevel(srv, 6) == 0);
+  errno = 0;
+  ASSERT(sg_httpsrv_zlevel(srv) == 6);
+  ASSERT(errno == 0);
+}
+
+static void test_httpsrv_set_zmax_active(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zmax_active(NULL, 123) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zmax_active(srv, 0) == 0);
+  ASSERT(sg_httpsrv_set_zmax_active(srv, 123) == 0);
+}
+
+static void test_httpsrv_zmax_active(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(sg_httpsrv_zmax_active(NULL) == 0);
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zmax_active(srv, 123) == 0);
+  errno = 0;
+  ASSERT(sg_httpsrv_zmax_active(srv) == 123);
+  ASSERT(errno == 0);
+}
+
+static void test_httpsrv_set_zstatic(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zstatic(NULL, true) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zstatic(srv, false) == 0);
+  ASSERT(sg_httpsrv_set_zstatic(srv, true) == 0);
+}
+
+static void test_httpsrv_zstatic(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(!sg_httpsrv_zstatic(NULL));
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zstatic(srv, false) == 0);
+  errno = 0;
+  ASSERT(!sg_httpsrv_zstatic(srv));
+  ASSERT(errno == 0);
+  ASSERT(sg_httpsrv_set_zstatic(srv, true) == 0);
+  ASSERT(sg_httpsrv_zstatic(srv));
+}
+
+static void test_httpsrv_set_zcache_dir(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zcache_dir(NULL, "/tmp") == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zcache_dir(srv, "/tmp") == 0);
+  ASSERT(sg_httpsrv_set_zcache_dir(srv, NULL) == 0);
+}
+
+static void test_httpsrv_zcache_dir(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(!sg_httpsrv_zcache_dir(NULL));
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zcache_dir(srv, NULL) == 0);
+  errno = 0;
+  ASSERT(!sg_httpsrv_zcache_dir(srv));
+  ASSERT(errno == 0);
+  ASSERT(sg_httpsrv_set_zcache_dir(srv, "/tmp") == 0);
+  ASSERT(strcmp(sg_httpsrv_zcache_dir(srv), "/tmp") == 0);
+}
+
+static void test_httpsrv_set_zthreads(struct sg_httpsrv *srv) {
+  ASSERT(sg_httpsrv_set_zthreads(NULL, 4) == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zthreads(srv, 0) == 0);
+  ASSERT(sg_httpsrv_set_zthreads(srv, 4) == 0);
+}
+
+static void test_httpsrv_zthreads(struct sg_httpsrv *srv) {
+  errno = 0;
+  ASSERT(sg_httpsrv_zthreads(NULL) == 0);
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_httpsrv_set_zthreads(srv, 4) == 0);
+  errno = 0;
+  ASSERT(sg_httpsrv_zthreads(srv) == 4);
+  ASSERT(errno == 0);
+}
+
+#endif /* SG_HTTP_COMPRESSION */
+
 static void test_httpsrv_handle(struct sg_httpsrv *srv) {
   void *fake_handle = (void *) 123;
   void *old_handle;
@@ -877,6 +1035,24 @@ int main(void) {
   test_httpsrv_con_timeout(srv);
   test_httpsrv_set_con_limit(srv);
   test_httpsrv_con_limit(srv);
+  test_httpsrv_set_etag(srv);
+  test_httpsrv_etag(srv);
+#ifdef SG_HTTP_COMPRESSION
+  test_httpsrv_set_ztypes(srv);
+  test_httpsrv_ztypes(srv);
+  test_httpsrv_set_zmin_size(srv);
+  test_httpsrv_zmin_size(srv);
+  test_httpsrv_set_zlevel(srv);
+  test_httpsrv_zlevel(srv);
+  test_httpsrv_set_zmax_active(srv);
+  test_httpsrv_zmax_active(srv);
+  test_httpsrv_set_zstatic(srv);
+  test_httpsrv_zstatic(srv);
+  test_httpsrv_set_zcache_dir(srv);
+  test_httpsrv_zcache_dir(srv);
+  test_httpsrv_set_zthreads(srv);
+  test_httpsrv_zthreads(srv);
+#endif /* SG_HTTP_COMPRESSION */
   test_httpsrv_handle(srv);
   sg_httpsrv_free(srv);
   return EXIT_SUCCESS;
@@ -200,6 +200,106 @@ static void test__httpuplds_iter(struct MHD_Connection *con) {
   sg_httpsrv_free(srv);
 }
 
+#if SG__HTTPFORM_NATIVE
+
+static void test__httpuplds_form_process(struct MHD_Connection *con) {
+  const char *body = "--abc\r\n"
+                     "Content-Disposition: form-data; name=\"foo\"\r\n"
+                     "\r\n"
+                     "bar\r\n"
+                     "--abc\r\n"
+                     "Content-Disposition: form-data; name=\"file\"; "
+                     "filename=\"foo.txt\"\r\n"
+                     "Content-Type: text/plain\r\n"
+                     "\r\n"
+                     "123\r\n"
+                     "--abc--\r\n";
+  char err[256], str[256];
+  struct sg_httpsrv *srv =
+    sg_httpsrv_new2(NULL, dummy_httpreq_cb, dummy_err_cb, err);
+  struct sg_httpreq *req = sg__httpreq_new(srv, con, "", "", "");
+  ASSERT(srv);
+  ASSERT(req);
+
+  req->form = sg__httpform_new("abc", 3, srv->payld_limit,
+                               sg__httpuplds_form_file_cb,
+                               sg__httpuplds_form_write_cb,
+                               sg__httpuplds_form_field_cb, req);
+  ASSERT(req->form);
+  ASSERT(sg__httpuplds_form_process(srv, req, body, strlen(body)) == MHD_YES);
+  ASSERT(strcmp(sg_strmap_get(req->fields, "foo"), "bar") == 0);
+  ASSERT(sg_httpuplds_count(req->uplds) == 1);
+  ASSERT(strcmp(sg_httpupld_field(req->uplds), "file") == 0);
+  ASSERT(strcmp(sg_httpupld_name(req->uplds), "foo.txt") == 0);
+  ASSERT(strcmp(sg_httpupld_mime(req->uplds), "text/plain") == 0);
+  ASSERT(sg_httpupld_size(req->uplds) == 3);
+  ASSERT(req->total_fields_size == 3);
+  ASSERT(req->total_uplds_size == 3);
+  sg__httpuplds_cleanup(srv, req);
+  sg__httpform_free(req->form);
+  sg_strmap_cleanup(&req->fields);
+
+  req->form = sg__httpform_new("abc", 3, 2, sg__httpuplds_form_file_cb,
+                               sg__httpuplds_form_write_cb,
+                               sg__httpuplds_form_field_cb, req);
+  memset(err, 0, sizeof(err));
+  ASSERT(sg__httpuplds_form_process(srv, req, body, strlen(body)) == MHD_NO);
+  memset(str, 0, sizeof(str));
+  snprintf(str, sizeof(str), _("Payload too large.\n"));
+  ASSERT(strcmp(err, str) == 0);
+
+  sg__httpuplds_cleanup(srv, req);
+  sg__httpreq_free(req);
+  sg_httpsrv_free(srv);
+}
+
+static void test__httpuplds_urlenc_process(struct MHD_Connection *con) {
+  const char *body = "user=foo%40bar&pass=a+b&remember=";
+  char err[256], str[256];
+  struct sg_httpsrv *srv =
+    sg_httpsrv_new2(NULL, dummy_httpreq_cb, dummy_err_cb, err);
+  struct sg_httpreq *req = sg__httpreq_new(srv, con, "", "", "");
+  size_t size;
+  int ret = MHD_NO;
+  ASSERT(srv);
+  ASSERT(req);
+
+  req->is_uploading = true;
+  req->fields_size = strlen(body);
+  req->fields_buf = sg_malloc(req->fields_size + 1);
+  ASSERT(req->fields_buf);
+  size = 10;
+  ASSERT(sg__httpuplds_process(srv, req, con, body, &size, &ret));
+  ASSERT(ret == MHD_YES);
+  ASSERT(size == 0);
+  size = strlen(body) - 10;
+  ASSERT(sg__httpuplds_process(srv, req, con, body + 10, &size, &ret));
+  ASSERT(ret == MHD_YES);
+  ASSERT(!req->fields);
+  ASSERT(!sg__httpuplds_process(srv, req, con, NULL, &size, &ret));
+  ASSERT(sg_strmap_count(req->fields) == 2);
+  ASSERT(strcmp(sg_strmap_get(req->fields, "USER"), "foo@bar") == 0);
+  ASSERT(strcmp(sg_strmap_get(req->fields, "pass"), "a b") == 0);
+  ASSERT(!sg_strmap_get(req->fields, "remember"));
+  ASSERT(req->total_fields_size == 10);
+  ASSERT(sg_strmap_rm(&req->fields, "user") == 0);
+  ASSERT(sg_strmap_set(&req->fields, "pass", "c") == 0);
+  ASSERT(strcmp(sg_strmap_get(req->fields, "pass"), "c") == 0);
+
+  size = 1;
+  memset(err, 0, sizeof(err));
+  ASSERT(sg__httpuplds_process(srv, req, con, body, &size, &ret));
+  ASSERT(ret == MHD_NO);
+  memset(str, 0, sizeof(str));
+  snprintf(str, sizeof(str), _("Payload too large.\n"));
+  ASSERT(strcmp(err, str) == 0);
+
+  sg__httpreq_free(req);
+  sg_httpsrv_free(srv);
+}
+
+#endif /* SG__HTTPFORM_NATIVE */
+
 static void test__httpuplds_process(struct MHD_Connection *con) {
   const size_t len = 3;
   char err[256], str[256];
@@ -681,6 +781,10 @@ int main(void) {
   test__httpuplds_add(con);
   test__httpuplds_free();
   test__httpuplds_iter(con);
+#if SG__HTTPFORM_NATIVE
+  test__httpuplds_form_process(con);
+  test__httpuplds_urlenc_process(con);
+#endif /* SG__HTTPFORM_NATIVE */
   test__httpuplds_process(con);
   test__httpuplds_cleanup(con);
   test__httpupld_cb();
@@ -0,0 +1,119 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "sg_rcache.c"
+#include <sagui.h>
+
+static void test__rcache_new(void) {
+  struct sg__rcache *cache = sg__rcache_new(1);
+  ASSERT(cache);
+  ASSERT(cache->count == 1);
+  sg__rcache_free(cache);
+  cache = sg__rcache_new(SG__RCACHE_WAYS * 4 + 1);
+  ASSERT(cache);
+  ASSERT(cache->count == 5);
+  ASSERT(!cache->sets[4].entries[0].used);
+  sg__rcache_free(cache);
+}
+
+static void test__rcache_free(void) {
+  sg__rcache_free(NULL);
+}
+
+static void test__rcache_get(void) {
+  struct sg__rcache *cache = sg__rcache_new(SG__RCACHE_WAYS);
+  struct sg_route route, *found;
+  PCRE2_SIZE ovector[SG__RCACHE_OVEC_SIZE] = {0, 7, 4, 7};
+  uint64_t hits, misses;
+  int rc;
+  memset(&route, 0, sizeof(struct sg_route));
+  route.ovec_count = 2;
+  ASSERT(!sg__rcache_get(cache, 0, 1, "/foo/bar", 8, &found, ovector, &rc));
+  sg__rcache_put(cache, 0, 1, "/foo/bar", 8, &route, ovector, 2);
+  memset(ovector, 0, sizeof(ovector));
+  found = NULL;
+  rc = 0;
+  ASSERT(sg__rcache_get(cache, 0, 1, "/foo/bar", 8, &found, ovector, &rc));
+  ASSERT(found == &route);
+  ASSERT(rc == 2);
+  ASSERT(ovector[1] == 7 && ovector[2] == 4 && ovector[3] == 7);
+  ASSERT(!sg__rcache_get(cache, 0, 1, "/foo/baR", 8, &found, ovector, &rc));
+  ASSERT(!sg__rcache_get(cache, 0, 1, "/foo/ba", 7, &found, ovector, &rc));
+  ASSERT(!sg__rcache_get(cache, 1, 1, "/foo/bar", 8, &found, ovector, &rc));
+  ASSERT(!sg__rcache_get(cache, 0, 2, "/foo/bar", 8, &found, ovector, &rc));
+  sg__rcache_stats(cache, &hits, &misses);
+  ASSERT(hits == 1);
+  ASSERT(misses == 5);
+  sg__rcache_free(cache);
+}
+
+static void test__rcache_put(void) {
+  struct sg__rcache *cache = sg__rcache_new(SG__RCACHE_WAYS);
+  struct sg_route route, *found;
+  PCRE2_SIZE ovector[SG__RCACHE_OVEC_SIZE] = {0};
+  char path[16];
+  unsigned int i;
+  int rc;
+  memset(&route, 0, sizeof(struct sg_route));
+  route.ovec_count = 1;
+  for (i = 0; i < SG__RCACHE_WAYS; i++) {
+    snprintf(path, sizeof(path), "/%u", i);
+    sg__rcache_put(cache, 0, 0, path, strlen(path), &route, ovector, 1);
+  }
+  /* references "/0", so CLOCK evicts "/1" */
+  ASSERT(sg__rcache_get(cache, 0, 0, "/0", 2, &found, ovector, &rc));
+  sg__rcache_put(cache, 0, 0, "/new", 4, &route, ovector, 1);
+  ASSERT(sg__rcache_get(cache, 0, 0, "/new", 4, &found, ovector, &rc));
+  ASSERT(sg__rcache_get(cache, 0, 0, "/0", 2, &found, ovector, &rc));
+  ASSERT(!sg__rcache_get(cache, 0, 0, "/1", 2, &found, ovector, &rc));
+  ASSERT(sg__rcache_get(cache, 0, 0, "/2", 2, &found, ovector, &rc));
+
+  /* replaces the entry in place */
+  sg__rcache_put(cache, 0, 1, "/new", 4, &route, ovector, 1);
+  ASSERT(!sg__rcache_get(cache, 0, 0, "/new", 4, &found, ovector, &rc));
+  ASSERT(sg__rcache_get(cache, 0, 1, "/new", 4, &found, ovector, &rc));
+
+  route.ovec_count = SG__RTREE_MAX_CAPS + 2;
+  sg__rcache_put(cache, 0, 0, "/big", 4, &route, ovector, 1);
+  ASSERT(!sg__rcache_get(cache, 0, 0, "/big", 4, &found, ovector, &rc));
+  sg__rcache_free(cache);
+}
+
+int main(void) {
+  test__rcache_new();
+  test__rcache_free();
+  test__rcache_get();
+  test__rcache_put();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "sg_rcu.c"
+
+static int reader_state;
+
+static void *reader_cb(__SG_UNUSED void *arg) {
+  ASSERT(sg__rcu_read_lock() == 0);
+  __atomic_store_n(&reader_state, 1, __ATOMIC_SEQ_CST);
+  usleep(50000);
+  __atomic_store_n(&reader_state, 2, __ATOMIC_SEQ_CST);
+  sg__rcu_read_unlock();
+  return NULL;
+}
+
+static void test__rcu_read_lock(void) {
+  ASSERT(!sg__rcu_reading());
+  ASSERT(sg__rcu_read_lock() == 0);
+  ASSERT(sg__rcu_reading());
+  ASSERT(sg__rcu_readers);
+  ASSERT(sg__rcu_readers->epoch == sg__rcu_epoch);
+  ASSERT(sg__rcu_read_lock() == 0);
+  ASSERT(sg__rcu_readers->nesting == 2);
+  sg__rcu_read_unlock();
+  ASSERT(sg__rcu_reading());
+  sg__rcu_read_unlock();
+  ASSERT(!sg__rcu_reading());
+  ASSERT(sg__rcu_readers->epoch == 0);
+  sg__rcu_read_unlock();
+  ASSERT(sg__rcu_readers->nesting == 0);
+}
+
+static void test__rcu_synchronize(void) {
+  pthread_t thread;
+  unsigned long epoch = sg__rcu_epoch;
+  ASSERT(sg__rcu_synchronize() == 0);
+  ASSERT(sg__rcu_epoch == epoch + 1);
+  ASSERT(sg__rcu_read_lock() == 0);
+  ASSERT(sg__rcu_synchronize() == EDEADLK);
+  ASSERT(sg__rcu_sync_begin() == EDEADLK);
+  sg__rcu_read_unlock();
+  epoch = sg__rcu_epoch;
+  ASSERT(sg__rcu_sync_begin() == 0);
+  ASSERT(sg__rcu_epoch == epoch);
+  sg__rcu_sync_end();
+  ASSERT(sg__rcu_epoch == epoch + 1);
+
+  ASSERT(pthread_create(&thread, NULL, reader_cb, NULL) == 0);
+  while (__atomic_load_n(&reader_state, __ATOMIC_SEQ_CST) == 0)
+    sched_yield();
+  ASSERT(sg__rcu_synchronize() == 0);
+  ASSERT(__atomic_load_n(&reader_state, __ATOMIC_SEQ_CST) == 2);
+  ASSERT(pthread_join(thread, NULL) == 0);
+  /* the record of the finished thread is unregistered */
+  ASSERT(sg__rcu_readers && !sg__rcu_readers->next);
+}
+
+int main(void) {
+  test__rcu_read_lock();
+  test__rcu_synchronize();
+  return EXIT_SUCCESS;
+}
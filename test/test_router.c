@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include "sg_router.h"
 #include <sagui.h>
 
@@ -42,6 +43,13 @@ static void route_cb(void *cls, struct sg_route *route) {
   strcat(cls, sg_route_user_data(route));
 }
 
+static void route_nested_cb(void *cls, struct sg_route *route) {
+  struct sg_router *router = cls;
+  ASSERT(sg_router_dispatch(router, "/abc", "nested") == 0);
+  ASSERT(strcmp(sg_route_path(route), "/nested") == 0);
+  ASSERT(strcmp(sg_route_user_data(route), "outer") == 0);
+}
+
 static int router_dispatch_empty_cb(__SG_UNUSED void *cls,
                                     __SG_UNUSED const char *path,
                                     __SG_UNUSED struct sg_route *route) {
@@ -95,6 +103,7 @@ static void test_router_dispatch2(struct sg_router *router,
                              "foobar", router_match_empty_cb) == EINVAL);
   ASSERT(sg_router_dispatch2(router, NULL, "bar", router_dispatch_empty_cb,
                              "foobar", router_match_empty_cb) == EINVAL);
+  dummy_router.snap = NULL;
   dummy_router.routes = NULL;
   ASSERT(sg_router_dispatch2(&dummy_router, "foo", "bar",
                              router_dispatch_empty_cb, "foobar",
@@ -114,12 +123,566 @@ static void test_router_dispatch2(struct sg_router *router,
   ASSERT(sg_router_dispatch2(router, "/abc", "foo", router_dispatch_empty_cb,
                              "bar", router_match_empty_cb) == 0);
   ASSERT(strcmp(str, "/abc^/abc$foo") == 0);
+  ASSERT(!(*routes)->next->next->path);
+  ASSERT(!(*routes)->next->next->user_data);
+  ASSERT(!(*routes)->next->next->match);
+}
+
+static void test_router_dispatch2_nested(struct sg_router *router,
+                                         struct sg_route **routes) {
+  struct sg_route *route = (*routes)->next->next;
+  char str[100];
+  memset(str, 0, sizeof(str));
+  route->cls = str;
+  ASSERT(sg_routes_add(routes, "/nested", route_nested_cb, router));
+  ASSERT(sg_router_dispatch(router, "/nested", "outer") == 0);
+  ASSERT(strcmp(str, "/abc^/abc$nested") == 0);
+}
+
+static int route_segments_concat_cb(void *cls, __SG_UNUSED unsigned int index,
+                                    const char *segment) {
+  strcat(cls, "[");
+  strcat(cls, segment);
+  strcat(cls, "]");
+  return 0;
+}
+
+static int route_vars_concat_cb(void *cls, const char *name, const char *val) {
+  strcat(cls, name);
+  strcat(cls, "=");
+  strcat(cls, val);
+  strcat(cls, ";");
+  return 0;
+}
+
+static void route_tree_cb(void *cls, struct sg_route *route) {
+  strcat(cls, sg_route_rawpattern(route));
+  strcat(cls, ":");
+  ASSERT(sg_route_segments_iter(route, route_segments_concat_cb, cls) == 0);
+  ASSERT(sg_route_vars_iter(route, route_vars_concat_cb, cls) == 0);
+}
+
+static void route_tree_match_cb(void *cls, struct sg_route *route) {
+  PCRE2_SIZE *ovector;
+  route_tree_cb(cls, route);
+  ASSERT(sg_route_match(route));
+  ASSERT(pcre2_get_ovector_count(sg_route_match(route)) >= 2);
+  ovector = pcre2_get_ovector_pointer(sg_route_match(route));
+  ASSERT(ovector[2] == 7);
+  ASSERT(ovector[3] == 9);
+}
+
+static void test_router_tree(void) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  char str[100];
+  ASSERT(sg_routes_add(&routes, "/users/(?<id>[^/]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/posts/[0-9]+", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/posts/(?<slug>[^/]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/files/(.*)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/match/([^/]+)", route_tree_match_cb, str));
+  ASSERT(sg_routes_add(&routes, "/about", route_tree_cb, str));
+  router = sg_router_new(routes);
+  ASSERT(router);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->tree);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->res_count == 1);
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/users/123", NULL) == 0);
+  ASSERT(strcmp(str, "^/users/(?<id>[^/]+)$:[123]id=123;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/USERS/abc", NULL) == 0);
+  ASSERT(strcmp(str, "^/users/(?<id>[^/]+)$:[abc]id=abc;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/users/1/2", NULL) == ENOENT);
+  ASSERT(sg_router_dispatch(router, "/users/", NULL) == ENOENT);
+  ASSERT(sg_router_dispatch(router, "/users/123\n", NULL) == 0);
+  ASSERT(strcmp(str, "^/users/(?<id>[^/]+)$:[123\n]id=123\n;") == 0);
+  ASSERT(strlen(str) > 0);
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/posts/42", NULL) == 0);
+  ASSERT(strcmp(str, "^/posts/[0-9]+$:") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/posts/hello", NULL) == 0);
+  ASSERT(strcmp(str, "^/posts/(?<slug>[^/]+)$:[hello]slug=hello;") == 0);
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/files/a/b.txt", NULL) == 0);
+  ASSERT(strcmp(str, "^/files/(.*)$:[a/b.txt]") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/match/ab", NULL) == 0);
+  ASSERT(strcmp(str, "^/match/([^/]+)$:[ab]") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/about", NULL) == 0);
+  ASSERT(strcmp(str, "^/about$:") == 0);
+  ASSERT(sg_router_dispatch(router, "/about/", NULL) == ENOENT);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/about\n", NULL) == 0);
+  ASSERT(strcmp(str, "^/about$:") == 0);
+
+  ASSERT(sg_routes_add(&routes, "/new", route_tree_cb, str));
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/new", NULL) == 0);
+  ASSERT(strcmp(str, "^/new$:") == 0);
+
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+}
+
+static void test_router_set_combined(struct sg_router *router) {
+  ASSERT(sg_router_set_combined(NULL, true) == EINVAL);
+  ASSERT(!router->combined);
+  ASSERT(sg_router_set_combined(router, true) == 0);
+  ASSERT(router->combined);
+  ASSERT(router->stale);
+  ASSERT(sg_router_set_combined(router, false) == 0);
+  ASSERT(!router->combined);
+}
+
+static void test_router_combined(void) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  char str[100];
+  errno = 0;
+  ASSERT(!sg_router_combined(NULL));
+  ASSERT(errno == EINVAL);
+
+  ASSERT(sg_routes_add(&routes, "/a/(?<id>[0-9]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/a/([^/]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/b/(x)?(?<id>[a-z]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/c/(x)\\1", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/d/(?<n>.)(?(1)y|z)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "(/e/[0-9]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/e/(?<id>[0-9]+)", route_tree_cb, str));
+  router = sg_router_new(routes);
+  ASSERT(router);
+  ASSERT(!sg_router_combined(router));
+  ASSERT(!router->idx[SG__ROUTER_IDX_ALL]->alt);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->res_count == 6);
+  ASSERT(sg_router_set_combined(router, true) == 0);
+  ASSERT(sg_router_combined(router));
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/a/123", NULL) == 0);
+  ASSERT(!router->stale);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alt);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alts_count == 3);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->res_count == 3);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alts[1].base == 1);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alts[2].base == 3);
+  ASSERT(strcmp(str, "^/a/(?<id>[0-9]+)$:[123]id=123;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/A/abc", NULL) == 0);
+  ASSERT(strcmp(str, "^/a/([^/]+)$:[abc]") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/b/xabc", NULL) == 0);
+  ASSERT(strcmp(str, "^/b/(x)?(?<id>[a-z]+)$:[x][abc]id=abc;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/c/xx", NULL) == 0);
+  ASSERT(strcmp(str, "^/c/(x)\\1$:[x]") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/d/ay", NULL) == 0);
+  ASSERT(strcmp(str, "^/d/(?<n>.)(?(1)y|z)$:[a]n=a;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/x/e/1", NULL) == 0);
+  ASSERT(strcmp(str, "(/e/[0-9]+):[/e/1]") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/e/1", NULL) == 0);
+  ASSERT(strcmp(str, "(/e/[0-9]+):[/e/1]") == 0);
+  ASSERT(sg_router_dispatch(router, "/b/1", NULL) == ENOENT);
+
+  ASSERT(sg_routes_add(&routes, "/f/(?<id>[0-9]+)", route_tree_cb, str));
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/f/7", NULL) == 0);
+  ASSERT(strcmp(str, "^/f/(?<id>[0-9]+)$:[7]id=7;") == 0);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alts_count == 4);
+  ASSERT(sg_routes_rm(&routes, "/a/(?<id>[0-9]+)") == 0);
+  router->routes = routes;
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/a/123", NULL) == 0);
+  ASSERT(strcmp(str, "^/a/([^/]+)$:[123]") == 0);
+  ASSERT(router->idx[SG__ROUTER_IDX_ALL]->alts_count == 3);
+
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+}
+
+static void route_method_cb(void *cls, struct sg_route *route) {
+  strcat(cls, sg_route_user_data(route));
+  strcat(cls, ":");
+  strcat(cls, sg_route_rawpattern(route));
+}
+
+static struct sg_route *router_add3(struct sg_route **routes,
+                                    const char *pattern, unsigned int methods,
+                                    char *str) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  ASSERT(sg_routes_add3(routes, &route, pattern, methods, err, sizeof(err),
+                        route_method_cb, str) == 0);
+  return route;
+}
+
+static void test_router_dispatch3(void) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  unsigned int methods;
+  char str[100];
+  router_add3(&routes, "/items", SG_METHOD_GET | SG_METHOD_HEAD, str);
+  router_add3(&routes, "/items", SG_METHOD_POST, str);
+  router_add3(&routes, "/items/([^/]+)", SG_METHOD_DELETE, str);
+  router_add3(&routes, "/items/([0-9]+)", SG_METHOD_PUT, str);
+  router_add3(&routes, "/any/([^/]+)", SG_METHOD_ANY, str);
+  router = sg_router_new(routes);
+  ASSERT(router);
+  ASSERT(router->idx[0] != router->idx[SG__ROUTER_IDX_ALL]);
+  ASSERT(router->idx[SG__ROUTER_IDX_OTHER] !=
+         router->idx[SG__ROUTER_IDX_ALL]);
+
+  ASSERT(sg_router_dispatch3(NULL, "GET", "/items", "x", NULL, NULL, NULL) ==
+         EINVAL);
+  ASSERT(sg_router_dispatch3(router, "GET", NULL, "x", NULL, NULL, NULL) ==
+         EINVAL);
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "GET", "/items", "get", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "get:^/items$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "POST", "/items", "post", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "post:^/items$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "PUT", "/items/1", "put", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "put:^/items/([0-9]+)$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "DELETE", "/items/1", "del", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "del:^/items/([^/]+)$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "PROPFIND", "/any/1", "pf", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "pf:^/any/([^/]+)$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, NULL, "/items/1", "none", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "none:^/items/([^/]+)$") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "POST", "/items\n", "nl", NULL, NULL,
+                             NULL) == 0);
+  ASSERT(strcmp(str, "nl:^/items$") == 0);
+
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "PUT", "/items", "put", NULL, NULL,
+                             NULL) == ENOTSUP);
+  ASSERT(sg_router_dispatch3(router, "PUT", "/items/a", "put", NULL, NULL,
+                             NULL) == ENOTSUP);
+  ASSERT(sg_router_dispatch3(router, "PROPFIND", "/items", "pf", NULL, NULL,
+                             NULL) == ENOTSUP);
+  ASSERT(sg_router_dispatch3(router, "GET", "/foo", "get", NULL, NULL, NULL) ==
+         ENOENT);
+  ASSERT(sg_router_dispatch3(router, NULL, "/foo", "none", NULL, NULL, NULL) ==
+         ENOENT);
+  ASSERT(strlen(str) == 0);
+
+  ASSERT(sg_router_allowed(NULL, "/items", &methods) == EINVAL);
+  ASSERT(sg_router_allowed(router, NULL, &methods) == EINVAL);
+  ASSERT(sg_router_allowed(router, "/items", NULL) == EINVAL);
+  ASSERT(sg_router_allowed(router, "/items", &methods) == 0);
+  ASSERT(methods == (SG_METHOD_GET | SG_METHOD_HEAD | SG_METHOD_POST));
+  ASSERT(sg_router_allowed(router, "/items/1", &methods) == 0);
+  ASSERT(methods == (SG_METHOD_DELETE | SG_METHOD_PUT));
+  ASSERT(sg_router_allowed(router, "/any/1", &methods) == 0);
+  ASSERT(methods == SG_METHOD_ANY);
+  ASSERT(sg_router_allowed(router, "/foo", &methods) == 0);
+  ASSERT(methods == 0);
+
+  ASSERT(sg_router_set_combined(router, true) == 0);
+  ASSERT(sg_router_dispatch3(router, "PUT", "/items/a", "put", NULL, NULL,
+                             NULL) == ENOTSUP);
+  ASSERT(sg_router_dispatch3(router, "GET", "/foo", "get", NULL, NULL, NULL) ==
+         ENOENT);
+  ASSERT(strlen(str) == 0);
+
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+
+  router_add3(&routes, "/a", SG_METHOD_ANY, str);
+  router = sg_router_new(routes);
+  ASSERT(router->idx[0] == router->idx[SG__ROUTER_IDX_ALL]);
+  ASSERT(router->idx[SG__ROUTER_IDX_OTHER] ==
+         router->idx[SG__ROUTER_IDX_ALL]);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch3(router, "GET", "/a", "get", NULL, NULL, NULL) ==
+         0);
+  ASSERT(strcmp(str, "get:^/a$") == 0);
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+}
+
+static void test_router_cache(void) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  uint64_t hits, misses;
+  char str[100];
+  ASSERT(sg_routes_add(&routes, "/users/(?<id>[0-9]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/files/(.*)", route_tree_cb, str));
+  router = sg_router_new(routes);
+  ASSERT(sg_router_set_cache(NULL, 10) == EINVAL);
+  ASSERT(sg_router_cache_stats(NULL, &hits, &misses) == EINVAL);
+  ASSERT(sg_router_cache_stats(router, NULL, &misses) == EINVAL);
+  ASSERT(sg_router_cache_stats(router, &hits, NULL) == EINVAL);
+  ASSERT(sg_router_cache_stats(router, &hits, &misses) == 0);
+  ASSERT(hits == 0 && misses == 0);
+
+  ASSERT(sg_router_set_cache(router, 64) == 0);
+  ASSERT(router->rcache);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/users/12", NULL) == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/users/12", NULL) == 0);
+  ASSERT(strcmp(str, "^/users/(?<id>[0-9]+)$:[12]id=12;") == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/files/a/b", NULL) == 0);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/files/a/b", NULL) == 0);
+  ASSERT(strcmp(str, "^/files/(.*)$:[a/b]") == 0);
+  ASSERT(sg_router_dispatch(router, "/users/ab", NULL) == ENOENT);
+  ASSERT(sg_router_dispatch(router, "/users/ab", NULL) == ENOENT);
+  ASSERT(sg_router_cache_stats(router, &hits, &misses) == 0);
+  ASSERT(hits == 2);
+  ASSERT(misses == 4);
+
+  ASSERT(sg_routes_add(&routes, "/users/(?<name>[0-9]+x?)", route_tree_cb,
+                       str));
+  ASSERT(sg_routes_rm(&routes, "/users/(?<id>[0-9]+)") == 0);
+  router->routes = routes;
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_dispatch(router, "/users/12", NULL) == 0);
+  ASSERT(strcmp(str, "^/users/(?<name>[0-9]+x?)$:[12]name=12;") == 0);
+  ASSERT(sg_router_cache_stats(router, &hits, &misses) == 0);
+  ASSERT(hits == 2);
+  ASSERT(misses == 5);
+
+  ASSERT(sg_router_set_cache(router, 0) == 0);
+  ASSERT(!router->rcache);
+  ASSERT(sg_router_cache_stats(router, &hits, &misses) == 0);
+  ASSERT(hits == 0 && misses == 0);
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+}
+
+static int router_stats_iter_cb(void *cls, struct sg_route *route,
+                                const struct sg_route_stats *stats) {
+  char *str = cls;
+  sprintf(str + strlen(str), "%s=%llu/%llu;", sg_route_rawpattern(route),
+          (unsigned long long) stats->hits,
+          (unsigned long long) stats->misses);
+  return 0;
+}
+
+static int router_stats_iter_123_cb(__SG_UNUSED void *cls,
+                                    __SG_UNUSED struct sg_route *route,
+                                    __SG_UNUSED const struct sg_route_stats
+                                      *stats) {
+  return 123;
+}
+
+static void test_router_stats(void) {
+  struct sg_router *router;
+  struct sg_route *routes = NULL;
+  struct sg_route_stats stats;
+  char str[200];
+  uint64_t count;
+  unsigned int i;
+  ASSERT(sg_routes_add(&routes, "/users/(?<id>[0-9]+)", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/about", route_tree_cb, str));
+  ASSERT(sg_routes_add(&routes, "/a(b|c)+", route_tree_cb, str));
+  router = sg_router_new(routes);
+  ASSERT(sg_router_set_stats(NULL, true) == EINVAL);
+  ASSERT(sg_router_stats_iter(NULL, router_stats_iter_cb, str) == EINVAL);
+  ASSERT(sg_router_stats_iter(router, NULL, str) == EINVAL);
+
+  ASSERT(sg_router_dispatch(router, "/about", NULL) == 0);
+  ASSERT(!routes->stats);
+  ASSERT(sg_router_set_stats(router, true) == 0);
+  ASSERT(routes->stats && routes->next->stats && routes->next->next->stats);
+  ASSERT(sg_router_dispatch(router, "/about", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/users/1", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/acb", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/acb", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/foo", NULL) == ENOENT);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_router_stats_iter(router, router_stats_iter_123_cb, str) == 123);
+  ASSERT(sg_router_stats_iter(router, router_stats_iter_cb, str) == 0);
+  /* the regex route precedes the tree ones, so it is tried first */
+  ASSERT(strcmp(str, "^/users/(?<id>[0-9]+)$=1/0;^/about$=1/1;"
+                     "^/a(b|c)+$=2/2;") == 0);
+  /* the linear dispatch tries all the preceding routes */
+  ASSERT(sg_router_dispatch(router, "/acb\n", NULL) == 0);
+  ASSERT(sg_route_stats(routes->next->next, &stats) == 0);
+  ASSERT(stats.hits == 3);
+  ASSERT(stats.misses == 4);
+  for (count = 0, i = 0; i < SG_ROUTE_STATS_BUCKETS; i++)
+    count += stats.buckets[i];
+  ASSERT(count == 3);
+
+  /* routes added later are tracked once indexed */
+  ASSERT(sg_routes_add(&routes, "/new", route_tree_cb, str));
+  router->routes = routes;
+  ASSERT(sg_router_dispatch(router, "/new", NULL) == 0);
+  ASSERT(sg_route_stats(routes->next->next->next, &stats) == 0);
+  ASSERT(stats.hits == 1);
+  /* and also by the linear dispatch, which does not refresh the index */
+  ASSERT(sg_routes_add(&routes, "/late", route_tree_cb, str));
+  ASSERT(sg_router_dispatch(router, "/late\n", NULL) == 0);
+  ASSERT(sg_route_stats(routes->next->next->next->next, &stats) == 0);
+  ASSERT(stats.hits == 1);
+
+  ASSERT(sg_router_set_stats(router, false) == 0);
+  ASSERT(sg_router_dispatch(router, "/new", NULL) == 0);
+  ASSERT(sg_route_stats(routes->next->next->next, &stats) == 0);
+  ASSERT(stats.hits == 1);
+  sg_routes_cleanup(&routes);
+  sg_router_free(router);
+}
+
+static void route_swap_cb(void *cls, struct sg_route *route) {
+  ASSERT(strcmp(sg_route_rawpattern(route), cls) == 0);
+}
+
+static bool router_swap_done;
+
+static void *router_swap_dispatch_cb(void *arg) {
+  struct sg_router *router = arg;
+  int ret;
+  while (!__atomic_load_n(&router_swap_done, __ATOMIC_SEQ_CST)) {
+    ret = sg_router_dispatch(router, "/v1/users/1", NULL);
+    ASSERT(ret == 0 || ret == ENOENT);
+    ASSERT(sg_router_dispatch(router, "/health", NULL) == 0);
+  }
+  return NULL;
+}
+
+static void route_swap_nested_cb(void *cls, struct sg_route *route) {
+  struct sg_route *old = NULL;
+  ASSERT(sg_router_swap(cls, route, &old) == EDEADLK);
+  ASSERT(!old);
+  ASSERT(sg_router_set_combined(cls, !sg_router_combined(cls)) == EDEADLK);
+}
+
+static bool router_swap_entered, router_swap_released;
+
+static void route_swap_slow_cb(void *cls, struct sg_route *route) {
+  (void) cls;
+  (void) route;
+  __atomic_store_n(&router_swap_entered, true, __ATOMIC_SEQ_CST);
+  while (!__atomic_load_n(&router_swap_released, __ATOMIC_SEQ_CST))
+    ;
+}
+
+static void *router_swap_slow_cb(void *arg) {
+  ASSERT(sg_router_dispatch(arg, "/slow", NULL) == 0);
+  return NULL;
+}
+
+static void test_router_swap(void) {
+  struct sg_router *router, *other;
+  struct sg_route *routes = NULL, *next, *old = NULL;
+  pthread_t threads[4];
+  unsigned int i;
+  uint64_t hits, misses, count;
+  ASSERT(sg_routes_add(&routes, "/health", route_swap_cb, "^/health$"));
+  router = sg_router_new(routes);
+  ASSERT(sg_router_swap(NULL, routes, &old) == EINVAL);
+  ASSERT(sg_router_swap(router, NULL, &old) == EINVAL);
+  ASSERT(sg_router_swap(router, routes, NULL) == EINVAL);
+  ASSERT(sg_router_set_cache(router, 16) == 0);
+  ASSERT(sg_router_set_combined(router, true) == 0);
+  ASSERT(sg_router_dispatch(router, "/health", NULL) == 0);
+
+  for (i = 0; i < 4; i++)
+    ASSERT(pthread_create(&threads[i], NULL, router_swap_dispatch_cb,
+                          router) == 0);
+  for (i = 0; i < 50; i++) {
+    next = NULL;
+    ASSERT(sg_routes_add(&next, "/health", route_swap_cb, "^/health$"));
+    if (i % 2 == 0)
+      ASSERT(sg_routes_add(&next, "/v1/users/([0-9]+)", route_swap_cb,
+                           "^/v1/users/([0-9]+)$"));
+    if (i > 0)
+      ASSERT(sg_routes_add(&next, "/v1/a(b|c)+", route_swap_cb,
+                           "^/v1/a(b|c)+$"));
+    ASSERT(sg_router_swap(router, next, &old) == 0);
+    ASSERT(router->snap && router->snap->routes == next);
+    ASSERT(router->snap->rcache);
+    ASSERT(old);
+    sg_routes_cleanup(&old);
+    /* the index of the other matching mode is published like new routes */
+    ASSERT(sg_router_set_combined(router, i % 3 != 0) == 0);
+    ASSERT(router->snap->routes == next);
+  }
+  __atomic_store_n(&router_swap_done, true, __ATOMIC_SEQ_CST);
+  for (i = 0; i < 4; i++)
+    ASSERT(pthread_join(threads[i], NULL) == 0);
+  ASSERT(!router->rcache);
+  ASSERT(!router->idx[SG__ROUTER_IDX_ALL]);
+  ASSERT(router->routes == next);
+  ASSERT(sg_router_cache_stats(router, &hits, &misses) == 0);
+  ASSERT(sg_router_dispatch(router, "/v1/users/1", NULL) == ENOENT);
+  ASSERT(sg_router_dispatch(router, "/v1/acb", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/v1/acb", NULL) == 0);
+  ASSERT(sg_router_cache_stats(router, &count, &misses) == 0);
+  ASSERT(count == hits + 1);
+
+  routes = NULL;
+  ASSERT(sg_routes_add(&routes, "/nested", route_swap_nested_cb, router));
+  ASSERT(sg_router_swap(router, routes, &old) == 0);
+  ASSERT(old == next);
+  sg_routes_cleanup(&old);
+  ASSERT(sg_router_dispatch(router, "/nested", NULL) == 0);
+  ASSERT(sg_router_dispatch(router, "/health", NULL) == ENOENT);
+  sg_router_free(router);
+  sg_routes_cleanup(&routes);
+
+  /* a route callback in flight only holds the swaps of its own router */
+  routes = NULL;
+  ASSERT(sg_routes_add(&routes, "/slow", route_swap_slow_cb, NULL));
+  router = sg_router_new(routes);
+  next = NULL;
+  ASSERT(sg_routes_add(&next, "/slow", route_swap_slow_cb, NULL));
+  ASSERT(sg_router_swap(router, next, &old) == 0);
+  sg_routes_cleanup(&old);
+  ASSERT(pthread_create(&threads[0], NULL, router_swap_slow_cb, router) == 0);
+  while (!__atomic_load_n(&router_swap_entered, __ATOMIC_SEQ_CST))
+    ;
+  routes = NULL;
+  ASSERT(sg_routes_add(&routes, "/other", route_swap_cb, "^/other$"));
+  other = sg_router_new(routes);
+  next = NULL;
+  ASSERT(sg_routes_add(&next, "/other", route_swap_cb, "^/other$"));
+  ASSERT(sg_router_swap(other, next, &old) == 0);
+  sg_routes_cleanup(&old);
+  ASSERT(sg_router_dispatch(other, "/other", NULL) == 0);
+  __atomic_store_n(&router_swap_released, true, __ATOMIC_SEQ_CST);
+  routes = NULL;
+  ASSERT(sg_routes_add(&routes, "/slow", route_swap_slow_cb, NULL));
+  ASSERT(sg_router_swap(router, routes, &old) == 0);
+  sg_routes_cleanup(&old);
+  ASSERT(pthread_join(threads[0], NULL) == 0);
+  sg_router_free(other);
+  sg_routes_cleanup(&next);
+  sg_router_free(router);
+  sg_routes_cleanup(&routes);
 }
 
 static void test_router_dispatch(struct sg_router *router) {
   struct sg_router dummy_router;
   ASSERT(sg_router_dispatch(NULL, "foo", "bar") == EINVAL);
   ASSERT(sg_router_dispatch(router, NULL, "bar") == EINVAL);
+  dummy_router.snap = NULL;
   dummy_router.routes = NULL;
   ASSERT(sg_router_dispatch(&dummy_router, "foo", "bar") == EINVAL);
 
@@ -138,7 +701,15 @@ int main(void) {
   router = sg_router_new(routes);
 
   test_router_dispatch2(router, &routes);
+  test_router_dispatch2_nested(router, &routes);
   test_router_dispatch(router);
+  test_router_set_combined(router);
+  test_router_tree();
+  test_router_combined();
+  test_router_dispatch3();
+  test_router_cache();
+  test_router_stats();
+  test_router_swap();
 
   sg_routes_cleanup(&routes);
   sg_router_free(router);
@@ -81,6 +81,33 @@ static int route_vars_concat_iter_cb(void *cls, const char *name,
   return 0;
 }
 
+static int route_segments_concat_iter2_cb(void *cls, unsigned int index,
+                                          const char *segment, size_t len) {
+  char *str = cls;
+  if (segment)
+    sprintf(str + strlen(str), "%d%.*s", index, (int) len, segment);
+  else
+    sprintf(str + strlen(str), "%d-", index);
+  return 0;
+}
+
+static int route_vars_concat_iter2_cb(void *cls, const char *name,
+                                      const char *val, size_t len) {
+  char *str = cls;
+  if (val)
+    sprintf(str + strlen(str), "%s%.*s", name, (int) len, val);
+  else
+    sprintf(str + strlen(str), "%s-", name);
+  return 0;
+}
+
+static int route_iter2_123_cb(__SG_UNUSED void *cls,
+                              __SG_UNUSED const char *name,
+                              __SG_UNUSED const char *val,
+                              __SG_UNUSED size_t len) {
+  return 123;
+}
+
 static int routes_iter_empty_cb(__SG_UNUSED void *cls,
                                 __SG_UNUSED struct sg_route *route) {
   return 0;
@@ -228,6 +255,7 @@ static void test_route_segments_iter(void) {
     sg__route_new("/(foo)/(bar)", err, sizeof(err), &errnum, route_cb, "foo");
   ASSERT(sg_route_segments_iter(route, NULL, "foo") == EINVAL);
 
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
   route->path = "/foo/bar";
   route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
                           strlen(route->path), 0, 0, route->match, NULL);
@@ -240,6 +268,7 @@ static void test_route_segments_iter(void) {
          0);
   ASSERT(strcmp(str, "0foo1bar") == 0);
 
+  pcre2_match_data_free(route->match);
   sg__route_free(route);
 }
 
@@ -253,6 +282,7 @@ static void test_route_vars_iter(void) {
                         &errnum, route_cb, "foo");
   ASSERT(sg_route_vars_iter(route, NULL, "foo") == EINVAL);
 
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
   route->path = "/abc/123";
   route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
                           strlen(route->path), 0, 0, route->match, NULL);
@@ -263,6 +293,135 @@ static void test_route_vars_iter(void) {
   ASSERT(sg_route_vars_iter(route, route_vars_concat_iter_cb, str) == 0);
   ASSERT(strcmp(str, "var1abcvar2123") == 0);
 
+  pcre2_match_data_free(route->match);
+  sg__route_free(route);
+}
+
+static void test_route_segments_iter2(void) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  char str[100];
+  int errnum;
+  ASSERT(sg_route_segments_iter2(NULL, route_segments_concat_iter2_cb, str) ==
+         EINVAL);
+  route = sg__route_new("/(foo)?/(bar)", err, sizeof(err), &errnum, route_cb,
+                        "foo");
+  ASSERT(sg_route_segments_iter2(route, NULL, str) == EINVAL);
+
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
+  route->path = "/foo/bar";
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_route_segments_iter2(route, route_segments_concat_iter2_cb, str) ==
+         0);
+  ASSERT(strcmp(str, "0foo1bar") == 0);
+
+  route->path = "//bar";
+  route->ovector = NULL;
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_route_segments_iter2(route, route_segments_concat_iter2_cb, str) ==
+         0);
+  ASSERT(strcmp(str, "0-1bar") == 0);
+
+  pcre2_match_data_free(route->match);
+  sg__route_free(route);
+}
+
+static void test_route_vars_iter2(void) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  char str[100];
+  int errnum;
+  ASSERT(sg_route_vars_iter2(NULL, route_vars_concat_iter2_cb, str) == EINVAL);
+  route = sg__route_new("/(?<var1>[a-z]+)/(?<var2>[0-9]+)", err, sizeof(err),
+                        &errnum, route_cb, "foo");
+  ASSERT(sg_route_vars_iter2(route, NULL, str) == EINVAL);
+
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
+  route->path = "/abc/123";
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  ASSERT(sg_route_vars_iter2(route, route_iter2_123_cb, NULL) == 123);
+  memset(str, 0, sizeof(str));
+  ASSERT(sg_route_vars_iter2(route, route_vars_concat_iter2_cb, str) == 0);
+  ASSERT(strcmp(str, "var1abcvar2123") == 0);
+
+  pcre2_match_data_free(route->match);
+  sg__route_free(route);
+}
+
+static void test_route_segment(void) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  const char *segment;
+  size_t len;
+  int errnum;
+  route = sg__route_new("/(foo)?/(bar)", err, sizeof(err), &errnum, route_cb,
+                        "foo");
+  ASSERT(sg_route_segment(NULL, 0, &segment, &len) == EINVAL);
+  ASSERT(sg_route_segment(route, 0, NULL, &len) == EINVAL);
+  ASSERT(sg_route_segment(route, 0, &segment, NULL) == EINVAL);
+  route->rc = -1;
+  ASSERT(sg_route_segment(route, 0, &segment, &len) == ENOENT);
+
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
+  route->path = "/foo/bar";
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  ASSERT(sg_route_segment(route, 0, &segment, &len) == 0);
+  ASSERT(segment == route->path + 1);
+  ASSERT(len == 3);
+  ASSERT(sg_route_segment(route, 1, &segment, &len) == 0);
+  ASSERT(strncmp(segment, "bar", len) == 0);
+  ASSERT(sg_route_segment(route, 2, &segment, &len) == ENOENT);
+  ASSERT(sg_route_segment(route, (unsigned int) -1, &segment, &len) == ENOENT);
+
+  route->path = "//bar";
+  route->ovector = NULL;
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  ASSERT(sg_route_segment(route, 0, &segment, &len) == ENOENT);
+  ASSERT(sg_route_segment(route, 1, &segment, &len) == 0);
+  ASSERT(strncmp(segment, "bar", len) == 0);
+
+  pcre2_match_data_free(route->match);
+  sg__route_free(route);
+}
+
+static void test_route_var(void) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  const char *val;
+  size_t len;
+  int errnum;
+  route = sg__route_new("/(?<var1>[a-z]+)/(?<var2>[0-9]+)?", err, sizeof(err),
+                        &errnum, route_cb, "foo");
+  ASSERT(sg_route_var(NULL, "var1", &val, &len) == EINVAL);
+  ASSERT(sg_route_var(route, NULL, &val, &len) == EINVAL);
+  ASSERT(sg_route_var(route, "var1", NULL, &len) == EINVAL);
+  ASSERT(sg_route_var(route, "var1", &val, NULL) == EINVAL);
+
+  route->match = pcre2_match_data_create(route->ovec_count, NULL);
+  route->path = "/abc/123";
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  ASSERT(sg_route_var(route, "var1", &val, &len) == 0);
+  ASSERT(val == route->path + 1);
+  ASSERT(len == 3);
+  ASSERT(sg_route_var(route, "var2", &val, &len) == 0);
+  ASSERT(strncmp(val, "123", len) == 0);
+  ASSERT(sg_route_var(route, "var3", &val, &len) == ENOENT);
+
+  route->path = "/abc/";
+  route->ovector = NULL;
+  route->rc = pcre2_match(route->re, (PCRE2_SPTR) route->path,
+                          strlen(route->path), 0, 0, route->match, NULL);
+  ASSERT(sg_route_var(route, "var2", &val, &len) == ENOENT);
+
+  pcre2_match_data_free(route->match);
   sg__route_free(route);
 }
 
@@ -283,6 +442,69 @@ static void test_route_user_data(void) {
   ASSERT(errno == 0);
 }
 
+static void test_route_methods(void) {
+  struct sg_route route;
+  errno = 0;
+  ASSERT(sg_route_methods(NULL) == 0);
+  ASSERT(errno == EINVAL);
+
+  route.methods = SG_METHOD_GET | SG_METHOD_HEAD;
+  errno = 0;
+  ASSERT(sg_route_methods(&route) == (SG_METHOD_GET | SG_METHOD_HEAD));
+  ASSERT(errno == 0);
+}
+
+static void test_route_stats(void) {
+  struct sg_route route;
+  struct sg_route_stats stats;
+  memset(&route, 0, sizeof(struct sg_route));
+  ASSERT(sg_route_stats(NULL, &stats) == EINVAL);
+  ASSERT(sg_route_stats(&route, NULL) == EINVAL);
+
+  memset(&stats, 1, sizeof(struct sg_route_stats));
+  ASSERT(sg_route_stats(&route, &stats) == 0);
+  ASSERT(stats.hits == 0 && stats.misses == 0 && stats.time == 0);
+
+  route.stats = sg__rstats_new();
+  sg__rstats_add(route.stats, 0, 3, 10);
+  sg__rstats_add(route.stats, 1, 0, 20);
+  ASSERT(sg_route_stats(&route, &stats) == 0);
+  ASSERT(stats.hits == 2);
+  ASSERT(stats.misses == 3);
+  ASSERT(stats.time == 30);
+  ASSERT(stats.buckets[3] == 1 && stats.buckets[4] == 1);
+  sg__rstats_free(route.stats);
+}
+
+static void test_routes_add3(void) {
+  struct sg_route *routes = NULL;
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  ASSERT(sg_routes_add3(NULL, &route, "/foo", SG_METHOD_GET, err, sizeof(err),
+                        route_cb, "foo") == EINVAL);
+  ASSERT(sg_routes_add3(&routes, &route, "/foo", 0, err, sizeof(err),
+                        route_cb, "foo") == EINVAL);
+  ASSERT(sg_routes_add3(&routes, &route, "/foo", SG_METHOD_ANY + 1, err,
+                        sizeof(err), route_cb, "foo") == EINVAL);
+
+  ASSERT(sg_routes_add3(&routes, &route, "/foo", SG_METHOD_GET | SG_METHOD_HEAD,
+                        err, sizeof(err), route_cb, "get") == 0);
+  ASSERT(route->methods == (SG_METHOD_GET | SG_METHOD_HEAD));
+  ASSERT(sg_routes_add3(&routes, &route, "/foo", SG_METHOD_POST, err,
+                        sizeof(err), route_cb, "post") == 0);
+  ASSERT(route->methods == SG_METHOD_POST);
+  ASSERT(strcmp(route->cls, "post") == 0);
+  ASSERT(sg_routes_add3(&routes, &route, "/foo", SG_METHOD_HEAD, err,
+                        sizeof(err), route_cb, "head") == EALREADY);
+  ASSERT(sg_routes_add2(&routes, &route, "/foo", err, sizeof(err), route_cb,
+                        "any") == EALREADY);
+  ASSERT(sg_routes_add2(&routes, &route, "/bar", err, sizeof(err), route_cb,
+                        "any") == 0);
+  ASSERT(route->methods == SG_METHOD_ANY);
+  ASSERT(sg_routes_count(routes) == 3);
+  sg_routes_cleanup(&routes);
+}
+
 static void test_routes_add2(void) {
   struct sg_route *routes = NULL;
   struct sg_route *route;
@@ -362,6 +584,143 @@ static void test_routes_add(void) {
   sg_routes_cleanup(&routes);
 }
 
+static void test_routes_add_many(void) {
+  struct sg_route_entry entries[] = {
+    {"/foo", SG_METHOD_ANY, route_cb, "foo"},
+    {"/bar", SG_METHOD_GET, route_cb, "bar"},
+    {"/bar", SG_METHOD_POST, route_cb, "bar2"},
+    {"(/baz)", SG_METHOD_ANY, route_cb, "baz"},
+  };
+  struct sg_route_entry entry = {"/foo", SG_METHOD_GET, route_cb, NULL};
+  struct sg_route *routes = NULL, *route;
+  char err[SG_ERR_SIZE];
+  unsigned int gen;
+  ASSERT(sg_routes_add_many(NULL, entries, 4, err, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_add_many(&routes, NULL, 4, err, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_add_many(&routes, entries, 4, NULL, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_add_many(&routes, entries, 4, err, 0) == EINVAL);
+  entry.methods = 0;
+  ASSERT(sg_routes_add_many(&routes, &entry, 1, err, sizeof(err)) == EINVAL);
+  entry.methods = SG_METHOD_GET;
+  entry.cb = NULL;
+  ASSERT(sg_routes_add_many(&routes, &entry, 1, err, sizeof(err)) == EINVAL);
+  entry.cb = route_cb;
+  ASSERT(sg_routes_add_many(&routes, entries, 0, err, sizeof(err)) == 0);
+  ASSERT(!routes);
+
+  ASSERT(sg_routes_add_many(&routes, entries, 4, err, sizeof(err)) == 0);
+  ASSERT(sg_routes_count(routes) == 4);
+  route = routes;
+  ASSERT(strcmp(sg_route_rawpattern(route), "^/foo$") == 0);
+  sg_routes_next(&route);
+  ASSERT(sg_route_methods(route) == SG_METHOD_GET);
+  ASSERT(strcmp(route->cls, "bar") == 0);
+  sg_routes_next(&route);
+  ASSERT(sg_route_methods(route) == SG_METHOD_POST);
+  sg_routes_next(&route);
+  ASSERT(strcmp(sg_route_rawpattern(route), "(/baz)") == 0);
+
+  gen = routes->gen;
+  memset(err, 0, sizeof(err));
+  ASSERT(sg_routes_add_many(&routes, &entry, 1, err, sizeof(err)) ==
+         EALREADY);
+  ASSERT(strcmp(err, "Route already added: /foo.\n") == 0);
+  ASSERT(sg_routes_add_many(&routes, entries + 1, 1, err, sizeof(err)) ==
+         EALREADY);
+  ASSERT(routes->gen == gen);
+  ASSERT(sg_routes_count(routes) == 4);
+  sg_routes_cleanup(&routes);
+
+  entry.methods = SG_METHOD_ANY;
+  ASSERT(sg_routes_add_many(&routes, &entry, 1, err, sizeof(err)) == 0);
+  ASSERT(sg_routes_add_many(&routes, entries, 4, err, sizeof(err)) ==
+         EALREADY);
+  ASSERT(sg_routes_count(routes) == 1);
+  sg_routes_cleanup(&routes);
+
+  entry.pattern = "/foo/(";
+  ASSERT(sg_routes_add_many(&routes, entries, 1, err, sizeof(err)) == 0);
+  ASSERT(sg_routes_add_many(&routes, &entry, 1, err, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_count(routes) == 1);
+  ASSERT(routes->gen == 1);
+  sg_routes_cleanup(&routes);
+}
+
+static void test_routes_save_load(void) {
+  struct sg_route_entry entries[] = {
+    {"/foo", SG_METHOD_ANY, route_cb, "foo"},
+    {"/bar/(?<id>[0-9]+)", SG_METHOD_GET | SG_METHOD_HEAD, route_cb, "bar"},
+    {"(/baz)", SG_METHOD_POST, route_cb, "baz"},
+  };
+  struct sg_route_entry entry;
+  struct sg_route *routes = NULL, *route;
+  char err[SG_ERR_SIZE], path[PATH_MAX], *dir;
+  FILE *file;
+  dir = sg_tmpdir();
+  ASSERT(dir);
+  snprintf(path, sizeof(path), "%s/test_routes.bin", dir);
+  sg_free(dir);
+  remove(path);
+
+  ASSERT(sg_routes_save(NULL, path) == EINVAL);
+  ASSERT(sg_routes_load(NULL, path, entries, 3, err, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_load(&routes, NULL, entries, 3, err, sizeof(err)) ==
+         EINVAL);
+  ASSERT(sg_routes_load(&routes, path, NULL, 3, err, sizeof(err)) == EINVAL);
+  ASSERT(sg_routes_load(&routes, path, entries, 0, err, sizeof(err)) ==
+         EINVAL);
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) ==
+         ENOENT);
+
+  ASSERT(sg_routes_add_many(&routes, entries, 3, err, sizeof(err)) == 0);
+  ASSERT(sg_routes_save(routes, NULL) == EINVAL);
+  ASSERT(sg_routes_save(routes, path) == 0);
+  sg_routes_cleanup(&routes);
+
+  ASSERT(sg_routes_load(&routes, path, entries, 2, err, sizeof(err)) ==
+         EINVAL);
+  ASSERT(strcmp(err, "Routes file does not match the route entries.\n") == 0);
+  entry = entries[1];
+  entries[1].pattern = "/bar/(?<id>[0-9]*)";
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) ==
+         EINVAL);
+  entries[1] = entry;
+  entries[1].methods = SG_METHOD_GET;
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) ==
+         EINVAL);
+  entries[1] = entry;
+  ASSERT(!routes);
+
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) == 0);
+  ASSERT(sg_routes_count(routes) == 3);
+  route = routes;
+  ASSERT(strcmp(sg_route_rawpattern(route), "^/foo$") == 0);
+  sg_routes_next(&route);
+  ASSERT(strcmp(sg_route_rawpattern(route), "^/bar/(?<id>[0-9]+)$") == 0);
+  ASSERT(sg_route_methods(route) == (SG_METHOD_GET | SG_METHOD_HEAD));
+  ASSERT(strcmp(route->cls, "bar") == 0);
+  ASSERT(route->ovec_count == 2);
+  ASSERT(pcre2_substring_number_from_name(route->re, (PCRE2_SPTR) "id") == 1);
+  sg_routes_next(&route);
+  ASSERT(strcmp(sg_route_rawpattern(route), "(/baz)") == 0);
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) ==
+         EALREADY);
+  ASSERT(sg_routes_count(routes) == 3);
+  sg_routes_cleanup(&routes);
+
+  file = fopen(path, "r+b");
+  ASSERT(file);
+  ASSERT(fseek(file, -8, SEEK_END) == 0);
+  ASSERT(fputc('x', file) != EOF);
+  ASSERT(fseek(file, 0, SEEK_END) == 0);
+  ASSERT(fputc('x', file) != EOF);
+  ASSERT(fclose(file) == 0);
+  ASSERT(sg_routes_load(&routes, path, entries, 3, err, sizeof(err)) ==
+         EINVAL);
+  ASSERT(!routes);
+  remove(path);
+}
+
 static void test_routes_rm(void) {
   struct sg_route *routes = NULL;
   struct sg_route *route;
@@ -450,9 +809,18 @@ int main(void) {
   test_route_path();
   test_route_segments_iter();
   test_route_vars_iter();
+  test_route_segments_iter2();
+  test_route_vars_iter2();
+  test_route_segment();
+  test_route_var();
   test_route_user_data();
+  test_route_methods();
+  test_route_stats();
+  test_routes_add3();
   test_routes_add2();
   test_routes_add();
+  test_routes_add_many();
+  test_routes_save_load();
   test_routes_rm();
   test_routes_iter();
   test_routes_next();
@@ -0,0 +1,101 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "sg_rstats.c"
+#include <sagui.h>
+
+static void test__rstats_new(void) {
+  struct sg__rstats *stats = sg__rstats_new();
+  ASSERT(stats);
+  ASSERT(stats->shards[0].hits == 0);
+  ASSERT(stats->shards[SG__RSTATS_SHARDS - 1].buckets[0] == 0);
+  sg__rstats_free(stats);
+}
+
+static void test__rstats_free(void) {
+  sg__rstats_free(NULL);
+}
+
+static void test__rstats_bucket(void) {
+  ASSERT(sg__rstats_bucket(0) == 0);
+  ASSERT(sg__rstats_bucket(1) == 0);
+  ASSERT(sg__rstats_bucket(2) == 1);
+  ASSERT(sg__rstats_bucket(3) == 1);
+  ASSERT(sg__rstats_bucket(1024) == 10);
+  ASSERT(sg__rstats_bucket(2047) == 10);
+  ASSERT(sg__rstats_bucket(UINT64_MAX) == SG_ROUTE_STATS_BUCKETS - 1);
+}
+
+static void test__rstats_add(void) {
+  struct sg__rstats *stats = sg__rstats_new();
+  sg__rstats_add(stats, 0, 2, 100);
+  sg__rstats_add(stats, 0, 0, 120);
+  ASSERT(stats->shards[0].hits == 2);
+  ASSERT(stats->shards[0].misses == 2);
+  ASSERT(stats->shards[0].time == 220);
+  ASSERT(stats->shards[0].buckets[6] == 2);
+  sg__rstats_add(stats, SG__RSTATS_SHARDS + 1, 1, 1);
+  ASSERT(stats->shards[1].hits == 1);
+  sg__rstats_free(stats);
+}
+
+static void test__rstats_sum(void) {
+  struct sg__rstats *stats = sg__rstats_new();
+  struct sg_route_stats sum;
+  unsigned int i;
+  memset(&sum, 1, sizeof(struct sg_route_stats));
+  sg__rstats_sum(stats, &sum);
+  ASSERT(sum.hits == 0);
+  ASSERT(sum.misses == 0);
+  ASSERT(sum.time == 0);
+  for (i = 0; i < SG_ROUTE_STATS_BUCKETS; i++)
+    ASSERT(sum.buckets[i] == 0);
+  for (i = 0; i < SG__RSTATS_SHARDS; i++)
+    sg__rstats_add(stats, i, i, 1000);
+  sg__rstats_add(stats, 3, 0, 5000000000ULL);
+  sg__rstats_sum(stats, &sum);
+  ASSERT(sum.hits == SG__RSTATS_SHARDS + 1);
+  ASSERT(sum.misses == (SG__RSTATS_SHARDS * (SG__RSTATS_SHARDS - 1)) / 2);
+  ASSERT(sum.time == (SG__RSTATS_SHARDS * 1000) + 5000000000ULL);
+  ASSERT(sum.buckets[9] == SG__RSTATS_SHARDS);
+  ASSERT(sum.buckets[SG_ROUTE_STATS_BUCKETS - 1] == 1);
+  sg__rstats_free(stats);
+}
+
+int main(void) {
+  test__rstats_new();
+  test__rstats_free();
+  test__rstats_bucket();
+  test__rstats_add();
+  test__rstats_sum();
+  return EXIT_SUCCESS;
+}
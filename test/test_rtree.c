@@ -0,0 +1,163 @@
+/*                         _
+ *   ___  __ _  __ _ _   _(_)
+ *  / __|/ _` |/ _` | | | | |
+ *  \__ \ (_| | (_| | |_| | |
+ *  |___/\__,_|\__, |\__,_|_|
+ *             |___/
+ *
+ * Cross-platform library which helps to develop web servers or frameworks.
+ *
+ * Copyright (C) 2016-2025 Silvio Clecio <silvioprog@gmail.com>
+ *
+ * Sagui library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Sagui library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Sagui library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define SG_EXTERN
+
+#include "sg_assert.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "sg_routes.c"
+#include "sg_rtree.c"
+#include <sagui.h>
+
+static void route_cb(__SG_UNUSED void *cls,
+                     __SG_UNUSED struct sg_route *route) {
+}
+
+static struct sg_route *route_new(struct sg_route **routes,
+                                  const char *pattern) {
+  struct sg_route *route;
+  char err[SG_ERR_SIZE];
+  int errnum;
+  ASSERT((route = sg__route_new(pattern, err, sizeof(err), &errnum, route_cb,
+                                NULL)));
+  LL_APPEND(*routes, route);
+  return route;
+}
+
+static void test__rtree_new(void) {
+  struct sg__rtree *tree = sg__rtree_new();
+  ASSERT(tree);
+  ASSERT(!tree->label);
+  ASSERT(tree->len == 0);
+  ASSERT(tree->min_order == UINT_MAX);
+  sg__rtree_free(tree);
+}
+
+static void test__rtree_free(void) {
+  sg__rtree_free(NULL);
+}
+
+static void test__rtree_add(void) {
+  struct sg__rtree *tree = sg__rtree_new();
+  struct sg_route *routes = NULL;
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/foo"), 0) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/foo\\.txt"), 1) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/a/([^/]+)"), 2) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/b/(?<id>[^/]+)/c"), 3) ==
+         0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/c/(?P<id>[^/]+)"), 4) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/d/(.*)"), 5) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/e/(?<rest>.*)"), 6) == 0);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/f/([^/]+)x"), 7) ==
+         ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/g/(.*)/h"), 8) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/h/[0-9]+"), 9) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/i/\\d"), 10) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/j.txt"), 11) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/k|/l"), 12) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "(/m)"), 13) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/n/(?:[^/]+)"), 14) ==
+         ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/o/(?<=x)"), 15) == ENOTSUP);
+  ASSERT(sg__rtree_add(tree, route_new(&routes, "/p/([^/]*)"), 16) ==
+         ENOTSUP);
+  ASSERT(tree->min_order == 0);
+  sg__rtree_free(tree);
+  sg_routes_cleanup(&routes);
+}
+
+static void test__rtree_find(void) {
+  struct sg__rtree *tree = sg__rtree_new();
+  struct sg__rtree_match match;
+  struct sg_route *routes = NULL, *r[8];
+  r[0] = route_new(&routes, "/users/([^/]+)");
+  r[1] = route_new(&routes, "/users/me");
+  r[2] = route_new(&routes, "/users");
+  r[3] = route_new(&routes, "/user/(?<id>[^/]+)/posts/(?<post>[^/]+)");
+  r[4] = route_new(&routes, "/static/(.*)");
+  r[5] = route_new(&routes, "/static/index\\.html");
+  r[6] = route_new(&routes, "/Upper/Case");
+  r[7] = route_new(&routes, "/");
+  for (unsigned int i = 0; i < 8; i++)
+    ASSERT(sg__rtree_add(tree, r[i], i) == 0);
+
+  ASSERT(!sg__rtree_find(tree, "", 0, &match));
+  ASSERT(!match.route);
+  ASSERT(match.order == UINT_MAX);
+  ASSERT(!sg__rtree_find(tree, "/foo", 4, &match));
+  ASSERT(!sg__rtree_find(tree, "/users/", 7, &match));
+  ASSERT(!sg__rtree_find(tree, "/users/a/", 9, &match));
+  ASSERT(!sg__rtree_find(tree, "/static", 7, &match));
+
+  ASSERT(sg__rtree_find(tree, "/", 1, &match));
+  ASSERT(match.route == r[7]);
+  ASSERT(sg__rtree_find(tree, "/users", 6, &match));
+  ASSERT(match.route == r[2]);
+  ASSERT(match.caps_count == 0);
+  ASSERT(sg__rtree_find(tree, "/users/me", 9, &match));
+  ASSERT(match.route == r[0]);
+  ASSERT(match.order == 0);
+  ASSERT(match.caps_count == 1);
+  ASSERT(match.caps[0] == 7 && match.caps[1] == 9);
+  ASSERT(sg__rtree_find(tree, "/USERS/abc", 10, &match));
+  ASSERT(match.route == r[0]);
+  ASSERT(sg__rtree_find(tree, "/user/1/posts/23", 16, &match));
+  ASSERT(match.route == r[3]);
+  ASSERT(match.caps_count == 2);
+  ASSERT(match.caps[0] == 6 && match.caps[1] == 7);
+  ASSERT(match.caps[2] == 14 && match.caps[3] == 16);
+  ASSERT(!sg__rtree_find(tree, "/user/1/posts", 13, &match));
+  ASSERT(sg__rtree_find(tree, "/static/", 8, &match));
+  ASSERT(match.route == r[4]);
+  ASSERT(match.caps[0] == 8 && match.caps[1] == 8);
+  ASSERT(sg__rtree_find(tree, "/static/index.html", 18, &match));
+  ASSERT(match.route == r[4]);
+  ASSERT(match.caps[0] == 8 && match.caps[1] == 18);
+  ASSERT(sg__rtree_find(tree, "/upper/case", 11, &match));
+  ASSERT(match.route == r[6]);
+  sg__rtree_free(tree);
+
+  tree = sg__rtree_new();
+  ASSERT(sg__rtree_add(tree, r[5], 0) == 0);
+  ASSERT(sg__rtree_add(tree, r[4], 1) == 0);
+  ASSERT(sg__rtree_find(tree, "/static/index.html", 18, &match));
+  ASSERT(match.route == r[5]);
+  ASSERT(sg__rtree_find(tree, "/static/index.htm", 17, &match));
+  ASSERT(match.route == r[4]);
+  sg__rtree_free(tree);
+  sg_routes_cleanup(&routes);
+}
+
+int main(void) {
+  test__rtree_new();
+  test__rtree_free();
+  test__rtree_add();
+  test__rtree_find();
+  return EXIT_SUCCESS;
+}
@@ -38,12 +38,59 @@ static void test__strmap_new(void) {
   ASSERT(pair);
   ASSERT(strcmp(pair->name, "ABC") == 0);
   ASSERT(strcmp(pair->val, "123") == 0);
-  ASSERT(strcmp(pair->key, "abc") == 0);
+  ASSERT(pair->name == (char *) (pair + 1));
+  ASSERT(pair->val == pair->name + 4);
   sg__strmap_free(pair);
 }
 
 static void test__strmap_free(void) {
+  struct sg_strmap pair;
   sg__strmap_free(NULL);
+  memset(&pair, 0, sizeof(struct sg_strmap));
+  pair.name = pair.val = "abc";
+  pair.borrowed = true;
+  sg__strmap_free(&pair);
+  ASSERT(strcmp(pair.name, "abc") == 0);
+}
+
+static void test__strmap_add(void) {
+  struct sg_strmap *map = NULL, *pair = sg__strmap_new("Foo", "bar");
+  sg__strmap_add(&map, pair);
+  ASSERT(sg_strmap_count(map) == 1);
+  ASSERT(sg_strmap_get(map, "fOO") == pair->val);
+  sg_strmap_cleanup(&map);
+}
+
+static void test__strmap_borrow(void) {
+  struct sg_strmap *map = NULL, pairs[2];
+  char name[] = "Foo";
+  memset(pairs, 0, sizeof(pairs));
+  sg__strmap_borrow(&map, &pairs[0], name, "bar");
+  sg__strmap_borrow(&map, &pairs[1], "abc", "123");
+  ASSERT(sg_strmap_count(map) == 2);
+  ASSERT(pairs[0].borrowed);
+  ASSERT(pairs[0].name == name);
+  ASSERT(strcmp(sg_strmap_get(map, "FOO"), "bar") == 0);
+  ASSERT(strcmp(sg_strmap_get(map, "abc"), "123") == 0);
+  ASSERT(sg_strmap_rm(&map, "foo") == 0);
+  ASSERT(sg_strmap_count(map) == 1);
+  sg_strmap_cleanup(&map);
+  ASSERT(strcmp(name, "Foo") == 0);
+}
+
+static void test__strmap_cat(void) {
+  struct sg_strmap *map = NULL, *pair = sg__strmap_new("Foo", "bar");
+  sg__strmap_add(&map, pair);
+  ASSERT(sg_strmap_add(&map, "abc", "123") == 0);
+  ASSERT(sg__strmap_cat(&map, &pair, "", 0) == 0);
+  ASSERT(strcmp(pair->val, "bar") == 0);
+  ASSERT(sg__strmap_cat(&map, &pair, "bazqux", 3) == 0);
+  ASSERT(strcmp(pair->name, "Foo") == 0);
+  ASSERT(strcmp(pair->val, "barbaz") == 0);
+  ASSERT(sg_strmap_count(map) == 2);
+  ASSERT(sg_strmap_get(map, "FOO") == pair->val);
+  ASSERT(strcmp(sg_strmap_get(map, "abc"), "123") == 0);
+  sg_strmap_cleanup(&map);
 }
 
 static void test_strmap_name(struct sg_strmap *pair) {
@@ -160,6 +207,7 @@ static void test_strmap_get(struct sg_strmap **map, const char *name,
   ASSERT(strcmp(sg_strmap_get(*map, ""), "") == 0);
   ASSERT(strcmp(sg_strmap_get(*map, "xxx"), "yyy") == 0);
   ASSERT(strcmp(sg_strmap_get(*map, "yyy"), "xxx") == 0);
+  ASSERT(strcmp(sg_strmap_get(*map, "XxX"), "yyy") == 0);
 }
 
 static void test_strmap_rm(struct sg_strmap **map, const char *name,
@@ -380,6 +428,9 @@ int main(void) {
 
   test__strmap_new();
   test__strmap_free();
+  test__strmap_add();
+  test__strmap_borrow();
+  test__strmap_cat();
   test_strmap_name(pair);
   test_strmap_val(pair);
   test_strmap_add(&map, name, val);
@@ -87,6 +87,62 @@ static void test__toasciilower(void) {
   ASSERT(strcmp(str, "abÇñãÁÊd") == 0);
 }
 
+static void test__strncasecmp(void) {
+  ASSERT(sg__strncasecmp("", "", 0) == 0);
+  ASSERT(sg__strncasecmp("", "", 10) == 0);
+  ASSERT(sg__strncasecmp("abc", "ABC", 3) == 0);
+  ASSERT(sg__strncasecmp("Content-Type", "content-type", 12) == 0);
+  ASSERT(sg__strncasecmp("abc", "ABD", 2) == 0);
+  ASSERT(sg__strncasecmp("abc", "ABD", 3) < 0);
+  ASSERT(sg__strncasecmp("abd", "ABC", 3) > 0);
+  ASSERT(sg__strncasecmp("ab", "ABC", 3) < 0);
+  ASSERT(sg__strncasecmp("abc", "AB", 10) > 0);
+  ASSERT(sg__strncasecmp("[", "{", 1) != 0);
+}
+
+static void test__strcasehash(void) {
+  ASSERT(sg__strcasehash("", 0) == 2166136261U);
+  ASSERT(sg__strcasehash("abc", 3) == sg__strcasehash("ABC", 3));
+  ASSERT(sg__strcasehash("Content-Type", 12) ==
+         sg__strcasehash("content-type", 12));
+  ASSERT(sg__strcasehash("abc", 3) != sg__strcasehash("abd", 3));
+  ASSERT(sg__strcasehash("abc", 2) == sg__strcasehash("abd", 2));
+  ASSERT(sg__strcasehash("[", 1) != sg__strcasehash("{", 1));
+}
+
+static void test__xxh64(void) {
+  const char *str = "Nobody inspects the spammish repetition";
+  ASSERT(sg__xxh64("", 0) == UINT64_C(0xEF46DB3751D8E999));
+  ASSERT(sg__xxh64("abc", 3) == UINT64_C(0x44BC2CF5AD770999));
+  ASSERT(sg__xxh64(str, strlen(str)) == UINT64_C(0xFBCEA83C8A378BF1));
+  ASSERT(sg__xxh64(str, 32) != sg__xxh64(str, 33));
+}
+
+static void test__method_mask(void) {
+  ASSERT(sg__method_mask("GET") == SG_METHOD_GET);
+  ASSERT(sg__method_mask("HEAD") == SG_METHOD_HEAD);
+  ASSERT(sg__method_mask("PATCH") == SG_METHOD_PATCH);
+  ASSERT(sg__method_mask("get") == 0);
+  ASSERT(sg__method_mask("PROPFIND") == 0);
+  ASSERT(sg__method_mask("") == 0);
+}
+
+static void test__methods_str(void) {
+  char buf[100];
+  ASSERT(sg__methods_str(0, buf, sizeof(buf)) == 0);
+  ASSERT(strcmp(buf, "") == 0);
+  ASSERT(sg__methods_str(SG_METHOD_POST, buf, sizeof(buf)) == 4);
+  ASSERT(strcmp(buf, "POST") == 0);
+  ASSERT(sg__methods_str(SG_METHOD_GET | SG_METHOD_HEAD | SG_METHOD_DELETE,
+                         buf, sizeof(buf)) == 17);
+  ASSERT(strcmp(buf, "GET, HEAD, DELETE") == 0);
+  ASSERT(sg__methods_str(SG_METHOD_ANY, buf, sizeof(buf)) == 60);
+  ASSERT(strcmp(buf, "GET, HEAD, POST, PUT, DELETE, CONNECT, OPTIONS, TRACE, "
+                     "PATCH") == 0);
+  ASSERT(sg__methods_str(SG_METHOD_GET | SG_METHOD_HEAD, buf, 6) == 9);
+  ASSERT(strcmp(buf, "GET, ") == 0);
+}
+
 static void test__strjoin(void) {
   char *str;
   ASSERT(!sg__strjoin(0, "", ""));
@@ -505,6 +561,11 @@ int main(void) {
   test__pow();
   test__fmod();
   test__toasciilower();
+  test__strncasecmp();
+  test__strcasehash();
+  test__xxh64();
+  test__method_mask();
+  test__methods_str();
   test__strjoin();
   test__is_cookie_name();
   test__is_cookie_val();